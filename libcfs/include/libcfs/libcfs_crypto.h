@@ -46,6 +46,8 @@ enum cfs_crypto_hash_alg {
 	CFS_HASH_ALG_SHA384,
 	CFS_HASH_ALG_SHA512,
 	CFS_HASH_ALG_CRC32C,
+	CFS_HASH_ALG_T10IP512,
+	CFS_HASH_ALG_T10IP4K,
 	CFS_HASH_ALG_MAX
 };
 
@@ -59,6 +61,9 @@ static struct cfs_crypto_hash_type hash_types[] = {
 	[CFS_HASH_ALG_SHA256]  = { "sha256",   0,     32 },
 	[CFS_HASH_ALG_SHA384]  = { "sha384",   0,     48 },
 	[CFS_HASH_ALG_SHA512]  = { "sha512",   0,     64 },
+	/* per-sector IP checksums of 512 bytes/4KB sectors, folded by crc32 */
+	[CFS_HASH_ALG_T10IP512] = { "t10ip512", 0,      4 },
+	[CFS_HASH_ALG_T10IP4K] = { "t10ip4k",  0,      4 },
 };
 
 /**    Return pointer to type of hash for valid hash algorithm identifier */
@@ -670,9 +670,25 @@ void cfs_hash_bd_del_locked(cfs_hash_t *hs, cfs_hash_bd_t *bd,
 void cfs_hash_bd_move_locked(cfs_hash_t *hs, cfs_hash_bd_t *bd_old,
 			     cfs_hash_bd_t *bd_new, struct hlist_node *hnode);
 
+/**
+ * Drop a reference and return 1 with the bucket exclusively locked if it was
+ * the last one. With rwlock buckets the write lock is only taken for the
+ * last reference, so that lookups holding the read lock don't stall.
+ */
 static inline int cfs_hash_bd_dec_and_lock(cfs_hash_t *hs, cfs_hash_bd_t *bd,
 					   atomic_t *condition)
 {
+	if (cfs_hash_with_rw_bktlock(hs)) {
+		if (atomic_add_unless(condition, -1, 1))
+			return 0;
+
+		write_lock(&bd->bd_bucket->hsb_lock.rw);
+		if (atomic_dec_and_test(condition))
+			return 1;
+		write_unlock(&bd->bd_bucket->hsb_lock.rw);
+		return 0;
+	}
+
 	LASSERT(cfs_hash_with_spin_bktlock(hs));
 	return atomic_dec_and_lock(condition, &bd->bd_bucket->hsb_lock.spin);
 }
@@ -62,6 +62,8 @@ struct kuc_hdr {
 } __attribute__((aligned(sizeof(__u64))));
 
 #define KUC_CHANGELOG_MSG_MAXSIZE (sizeof(struct kuc_hdr)+CR_MAXSIZE)
+/* a batch of changelog records, kuc_msglen is only 16 bits */
+#define KUC_CHANGELOG_BATCH_MAXSIZE 32768
 
 #define KUC_MAGIC  0x191C /*Lustre9etLinC */
 #define KUC_FL_BLOCK 0x01   /* Wait for send */
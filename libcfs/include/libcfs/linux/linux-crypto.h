@@ -42,6 +42,12 @@ void cfs_crypto_crc32_unregister(void);
 int cfs_crypto_adler32_register(void);
 void cfs_crypto_adler32_unregister(void);
 
+/**
+ * Functions for start/stop shash T10-PI style IP checksums
+ */
+int cfs_crypto_t10ip_register(void);
+void cfs_crypto_t10ip_unregister(void);
+
 /**
  * Functions for start/stop shash crc32 pclmulqdq
  */
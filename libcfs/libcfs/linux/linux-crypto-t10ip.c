@@ -0,0 +1,322 @@
+/* GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see http://www.gnu.org/licenses
+ *
+ * Please  visit http://www.xyratex.com/contact if you need additional
+ * information or have any questions.
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * This is crypto api shash of the T10-PI style checksums.
+ *
+ * Each sector of the data gets its own 16-bit IP checksum, like the guard
+ * tag of a T10 protection information tuple, and the digest is the crc32 of
+ * the guard tags. The guards of the sectors do not depend on each other and
+ * csum_partial() is the arch optimized checksum of the network stack, so it
+ * costs much less CPU per byte than a crc32 or adler32 of the whole data.
+ *
+ * The sectors are counted from the start of the hashed data, whatever the
+ * chunks the data is updated with.
+ *
+ * On x86_64 the whole sectors of an update are summed by a multi-buffer
+ * engine, 4 sectors at a time in AVX2 or AVX-512 lanes, and a single sector
+ * is split in 4 parts whose sums are added. The guards are the same as with
+ * csum_partial(), so a node with the engine and one without agree.
+ */
+
+#include <linux/module.h>
+#include <linux/crc32.h>
+#include <net/checksum.h>
+#include <crypto/internal/hash.h>
+#include <libcfs/libcfs.h>
+
+#if defined(HAVE_PCLMULQDQ) && defined(CONFIG_AS_AVX2)
+#include <asm/cpufeature.h>
+#include <asm/i387.h>
+
+#define HAVE_T10IP_MB
+#endif
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+/* guard tags buffered before they are folded into the crc32 */
+#define T10IP_GUARD_BATCH	64
+
+struct t10ip_desc_ctx {
+	u32		tdc_crc;	/* crc32 of the folded guards */
+	__wsum		tdc_sum;	/* checksum of the current sector */
+	unsigned int	tdc_nob;	/* bytes of the current sector */
+	unsigned int	tdc_nguards;	/* guards in tdc_guards[] */
+	__sum16		tdc_guards[T10IP_GUARD_BATCH];
+};
+
+/* the sector size is the context of the tfm */
+static int t10ip512_cra_init(struct crypto_tfm *tfm)
+{
+	unsigned int *sector = crypto_tfm_ctx(tfm);
+
+	*sector = 512;
+	return 0;
+}
+
+static int t10ip4k_cra_init(struct crypto_tfm *tfm)
+{
+	unsigned int *sector = crypto_tfm_ctx(tfm);
+
+	*sector = 4096;
+	return 0;
+}
+
+static void t10ip_fold_guards(struct t10ip_desc_ctx *ctx)
+{
+	ctx->tdc_crc = crc32_le(ctx->tdc_crc, (unsigned char *)ctx->tdc_guards,
+				ctx->tdc_nguards * sizeof(ctx->tdc_guards[0]));
+	ctx->tdc_nguards = 0;
+}
+
+static inline void t10ip_add_guard(struct t10ip_desc_ctx *ctx, __sum16 guard)
+{
+	ctx->tdc_guards[ctx->tdc_nguards++] = guard;
+	if (ctx->tdc_nguards == T10IP_GUARD_BATCH)
+		t10ip_fold_guards(ctx);
+}
+
+#ifdef HAVE_T10IP_MB
+/* buffers summed at once by the multi-buffer engine */
+#define T10IP_MB_LANES		4
+
+asmlinkage void t10ip_sum4_avx2(const u8 **bufs, unsigned int len,
+				u32 *sums);
+#ifdef CONFIG_AS_AVX512
+asmlinkage void t10ip_sum4_avx512(const u8 **bufs, unsigned int len,
+				  u32 *sums);
+#endif
+
+/* the engine picked at registration, NULL when the CPU has none */
+static void (*t10ip_sum4)(const u8 **bufs, unsigned int len, u32 *sums);
+/* the buffer lengths the engine takes are a multiple of this */
+static unsigned int t10ip_sum4_align;
+static const char *t10ip_sum4_name = "none";
+
+static void t10ip_mb_select(void)
+{
+	if (!boot_cpu_has(X86_FEATURE_OSXSAVE))
+		return;
+#if defined(CONFIG_AS_AVX512) && defined(X86_FEATURE_AVX512F)
+	if (boot_cpu_has(X86_FEATURE_AVX512F)) {
+		t10ip_sum4 = t10ip_sum4_avx512;
+		t10ip_sum4_align = 64;
+		t10ip_sum4_name = "avx512";
+		return;
+	}
+#endif
+#ifdef X86_FEATURE_AVX2
+	if (boot_cpu_has(X86_FEATURE_AVX2)) {
+		t10ip_sum4 = t10ip_sum4_avx2;
+		t10ip_sum4_align = 32;
+		t10ip_sum4_name = "avx2";
+	}
+#endif
+}
+
+/*
+ * Add the guards of the @nsect whole sectors at @data with the multi-buffer
+ * engine, return false if it cannot be used here.
+ */
+static bool t10ip_mb_sectors(struct t10ip_desc_ctx *ctx, const u8 *data,
+			     unsigned int nsect, unsigned int sector)
+{
+	const u8	*bufs[T10IP_MB_LANES];
+	u32		 sums[T10IP_MB_LANES];
+	unsigned int	 part = sector / T10IP_MB_LANES;
+	__wsum		 sum;
+	int		 i;
+
+	if (t10ip_sum4 == NULL || part % t10ip_sum4_align != 0 ||
+	    !irq_fpu_usable())
+		return false;
+
+	kernel_fpu_begin();
+	/* one sector per lane */
+	for (; nsect >= T10IP_MB_LANES; nsect -= T10IP_MB_LANES) {
+		for (i = 0; i < T10IP_MB_LANES; i++)
+			bufs[i] = data + i * sector;
+		t10ip_sum4(bufs, sector, sums);
+		for (i = 0; i < T10IP_MB_LANES; i++)
+			t10ip_add_guard(ctx,
+					csum_fold((__force __wsum)sums[i]));
+		data += T10IP_MB_LANES * sector;
+	}
+	/* one part of a sector per lane */
+	for (; nsect > 0; nsect--) {
+		for (i = 0; i < T10IP_MB_LANES; i++)
+			bufs[i] = data + i * part;
+		t10ip_sum4(bufs, part, sums);
+		sum = 0;
+		for (i = 0; i < T10IP_MB_LANES; i++)
+			sum = csum_add(sum, (__force __wsum)sums[i]);
+		t10ip_add_guard(ctx, csum_fold(sum));
+		data += sector;
+	}
+	kernel_fpu_end();
+	return true;
+}
+#else /* !HAVE_T10IP_MB */
+static inline void t10ip_mb_select(void)
+{
+}
+
+static inline bool t10ip_mb_sectors(struct t10ip_desc_ctx *ctx,
+				    const u8 *data, unsigned int nsect,
+				    unsigned int sector)
+{
+	return false;
+}
+#endif /* HAVE_T10IP_MB */
+
+static int t10ip_init(struct shash_desc *desc)
+{
+	struct t10ip_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->tdc_crc = ~0;
+	ctx->tdc_sum = 0;
+	ctx->tdc_nob = 0;
+	ctx->tdc_nguards = 0;
+	return 0;
+}
+
+static int t10ip_update(struct shash_desc *desc, const u8 *data,
+			unsigned int len)
+{
+	struct t10ip_desc_ctx	*ctx = shash_desc_ctx(desc);
+	unsigned int		 sector = *(unsigned int *)
+					  crypto_shash_ctx(desc->tfm);
+	unsigned int		 count;
+
+	/* whole sectors are summed by the multi-buffer engine if possible */
+	if (ctx->tdc_nob == 0 && len >= sector &&
+	    t10ip_mb_sectors(ctx, data, len / sector, sector)) {
+		data += len - len % sector;
+		len %= sector;
+	}
+
+	while (len > 0) {
+		/* whole sectors are summed in one go */
+		if (ctx->tdc_nob == 0 && len >= sector) {
+			t10ip_add_guard(ctx, ip_compute_csum(data, sector));
+			data += sector;
+			len -= sector;
+			continue;
+		}
+
+		count = min(len, sector - ctx->tdc_nob);
+		ctx->tdc_sum = csum_block_add(ctx->tdc_sum,
+					      csum_partial(data, count, 0),
+					      ctx->tdc_nob);
+		ctx->tdc_nob += count;
+		data += count;
+		len -= count;
+
+		if (ctx->tdc_nob == sector) {
+			t10ip_add_guard(ctx, csum_fold(ctx->tdc_sum));
+			ctx->tdc_sum = 0;
+			ctx->tdc_nob = 0;
+		}
+	}
+	return 0;
+}
+
+static int t10ip_final(struct shash_desc *desc, u8 *out)
+{
+	struct t10ip_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	/* the short last sector */
+	if (ctx->tdc_nob > 0) {
+		t10ip_add_guard(ctx, csum_fold(ctx->tdc_sum));
+		ctx->tdc_sum = 0;
+		ctx->tdc_nob = 0;
+	}
+	if (ctx->tdc_nguards > 0)
+		t10ip_fold_guards(ctx);
+
+	*(u32 *)out = ctx->tdc_crc;
+	return 0;
+}
+
+static struct shash_alg alg_512 = {
+	.init		= t10ip_init,
+	.update		= t10ip_update,
+	.final		= t10ip_final,
+	.descsize	= sizeof(struct t10ip_desc_ctx),
+	.digestsize	= CHKSUM_DIGEST_SIZE,
+	.base		= {
+		.cra_name		= "t10ip512",
+		.cra_driver_name	= "t10ip512-csum",
+		.cra_priority		= 100,
+		.cra_blocksize		= CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(unsigned int),
+		.cra_module		= THIS_MODULE,
+		.cra_init		= t10ip512_cra_init,
+	}
+};
+
+static struct shash_alg alg_4k = {
+	.init		= t10ip_init,
+	.update		= t10ip_update,
+	.final		= t10ip_final,
+	.descsize	= sizeof(struct t10ip_desc_ctx),
+	.digestsize	= CHKSUM_DIGEST_SIZE,
+	.base		= {
+		.cra_name		= "t10ip4k",
+		.cra_driver_name	= "t10ip4k-csum",
+		.cra_priority		= 100,
+		.cra_blocksize		= CHKSUM_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(unsigned int),
+		.cra_module		= THIS_MODULE,
+		.cra_init		= t10ip4k_cra_init,
+	}
+};
+
+int cfs_crypto_t10ip_register(void)
+{
+	int rc;
+
+	t10ip_mb_select();
+#ifdef HAVE_T10IP_MB
+	CDEBUG(D_INFO, "T10-PI checksums multi-buffer engine: %s\n",
+	       t10ip_sum4_name);
+#endif
+
+	rc = crypto_register_shash(&alg_512);
+	if (rc != 0)
+		return rc;
+
+	rc = crypto_register_shash(&alg_4k);
+	if (rc != 0)
+		crypto_unregister_shash(&alg_512);
+	return rc;
+}
+EXPORT_SYMBOL(cfs_crypto_t10ip_register);
+
+void cfs_crypto_t10ip_unregister(void)
+{
+	crypto_unregister_shash(&alg_4k);
+	crypto_unregister_shash(&alg_512);
+}
+EXPORT_SYMBOL(cfs_crypto_t10ip_unregister);
@@ -263,6 +263,7 @@ static int cfs_crypto_test_hashes(void)
 }
 
 static int adler32;
+static int t10ip;
 
 #ifdef HAVE_CRC32
 static int crc32;
@@ -281,6 +282,7 @@ int cfs_crypto_register(void)
 	request_module("crc32c");
 
 	adler32 = cfs_crypto_adler32_register();
+	t10ip = cfs_crypto_t10ip_register();
 
 #ifdef HAVE_CRC32
 	crc32 = cfs_crypto_crc32_register();
@@ -301,6 +303,8 @@ void cfs_crypto_unregister(void)
 {
 	if (adler32 == 0)
 		cfs_crypto_adler32_unregister();
+	if (t10ip == 0)
+		cfs_crypto_t10ip_unregister();
 
 #ifdef HAVE_CRC32
 	if (crc32 == 0)
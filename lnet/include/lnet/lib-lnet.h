@@ -941,6 +941,7 @@ void lnet_acceptor_stop(void);
 
 void lnet_get_tunables(void);
 int lnet_peers_start_down(void);
+int lnet_route_select_adaptive(void);
 int lnet_peer_buffer_credits(lnet_ni_t *ni);
 
 int lnet_router_checker_start(void);
@@ -954,6 +955,7 @@ int lnet_ping(lnet_process_id_t id, int timeout_ms,
 
 int lnet_parse_ip2nets (char **networksp, char *ip2nets);
 int lnet_parse_routes (char *route_str, int *im_a_router);
+int lnet_parse_peer_nids(char *str);
 int lnet_parse_networks (cfs_list_t *nilist, char *networks);
 
 int lnet_nid2peer_locked(lnet_peer_t **lpp, lnet_nid_t nid, int cpt);
@@ -963,6 +965,12 @@ void lnet_peer_tables_cleanup(void);
 void lnet_peer_tables_destroy(void);
 int lnet_peer_tables_create(void);
 void lnet_debug_peer(lnet_nid_t nid);
+struct lnet_mr_peer *lnet_find_mr_peer(lnet_nid_t nid);
+lnet_nid_t lnet_peer_primary_nid(lnet_nid_t nid);
+int lnet_add_mr_peer(lnet_nid_t *nids, int nnids);
+void lnet_mr_peers_destroy(void);
+lnet_ni_t *lnet_select_rail_locked(struct lnet_mr_peer *mp, lnet_ni_t *src_ni,
+				   int cpt, lnet_nid_t *nidp);
 
 #ifndef __KERNEL__
 static inline int
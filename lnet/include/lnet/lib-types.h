@@ -407,6 +407,8 @@ struct lnet_tx_queue {
 	int			tq_credits_min;	/* lowest it's been */
 	int			tq_credits_max;	/* total # tx credits */
 	cfs_list_t		tq_delayed;	/* delayed TXs */
+	__u64			tq_send_count;	/* # messages sent */
+	__u64			tq_recv_count;	/* # messages received */
 };
 
 #define LNET_MAX_INTERFACES   16
@@ -504,8 +506,22 @@ typedef struct lnet_peer {
 	unsigned int		lp_ping_feats;
 	cfs_list_t		lp_routes;	/* routers on this peer */
 	lnet_rc_data_t		*lp_rcd;	/* router checker state */
+	__u64			lp_send_count;	/* # messages sent to me */
+	__u64			lp_recv_count;	/* # messages received from me */
+	/* router: moving average of tx credits in use, in
+	 * 1/LNET_RTR_LOAD_SCALE credit */
+	int			lp_txdeficit_avg;
+	/* router: moving average of ping round-trip time, in microseconds */
+	int			lp_rtt_avg;
+	/* router: time the last ping was sent, in microseconds */
+	__u64			lp_ping_sent_usec;
 } lnet_peer_t;
 
+/* fixed point of lnet_peer_t::lp_txdeficit_avg */
+#define LNET_RTR_LOAD_SCALE	16
+/* a new sample weighs 1/(1 << LNET_RTR_AVG_SHIFT) in router averages */
+#define LNET_RTR_AVG_SHIFT	3
+
 /* peer hash size */
 #define LNET_PEER_HASH_BITS     9
 #define LNET_PEER_HASH_SIZE     (1 << LNET_PEER_HASH_BITS)
@@ -518,6 +534,23 @@ struct lnet_peer_table {
 	cfs_list_t		*pt_hash;	/* NID->peer hash */
 };
 
+/* one NID of a multi-rail peer */
+struct lnet_peer_rail {
+	cfs_list_t		pr_hashlist;	/* chain on ln_mr_hash */
+	struct lnet_mr_peer	*pr_peer;	/* node this NID belongs to */
+	lnet_nid_t		pr_nid;
+};
+
+/* a node reachable through several NIDs, the first one is its primary NID */
+struct lnet_mr_peer {
+	cfs_list_t		mp_list;	/* chain on ln_mr_peers */
+	unsigned int		mp_seq;		/* round-robin among equal rails */
+	int			mp_nrails;	/* # NIDs */
+	struct lnet_peer_rail	mp_rails[LNET_MAX_INTERFACES];
+};
+
+#define lnet_mr_primary_nid(mp)	((mp)->mp_rails[0].pr_nid)
+
 /* peer aliveness is enabled only on routers for peers in a network where the
  * lnet_ni_t::ni_peertimeout has been set to a positive value */
 #define lnet_peer_aliveness_enabled(lp) (the_lnet.ln_routing != 0 && \
@@ -532,6 +565,7 @@ typedef struct {
 	unsigned int		lr_downis;	/* number of down NIs */
 	unsigned int		lr_hops;	/* how far I am */
 	unsigned int		lr_priority;	/* route priority */
+	__u64			lr_send_count;	/* # messages sent via me */
 } lnet_route_t;
 
 #define LNET_REMOTE_NETS_HASH_DEFAULT	(1U << 7)
@@ -744,6 +778,10 @@ typedef struct
 	struct lnet_msg_container	**ln_msg_containers;
 	lnet_counters_t			**ln_counters;
 	struct lnet_peer_table		**ln_peer_tables;
+	/* multi-rail peers, immutable while LNet is up */
+	cfs_list_t			ln_mr_peers;
+	/* NID->multi-rail peer hash, NULL if there is no multi-rail peer */
+	cfs_list_t			*ln_mr_hash;
 	/* failure simulation */
 	cfs_list_t			ln_test_peers;
 
@@ -63,6 +63,10 @@ static char *routes = "";
 CFS_MODULE_PARM(routes, "s", charp, 0444,
                 "routes to non-local networks");
 
+static char *peer_nids = "";
+CFS_MODULE_PARM(peer_nids, "s", charp, 0444,
+		"NIDs of multi-rail peers");
+
 static int rnet_htable_size = LNET_REMOTE_NETS_HASH_DEFAULT;
 CFS_MODULE_PARM(rnet_htable_size, "i", int, 0444,
 		"size of remote network hash table");
@@ -73,6 +77,12 @@ lnet_get_routes(void)
         return routes;
 }
 
+char *
+lnet_get_peer_nids(void)
+{
+	return peer_nids;
+}
+
 char *
 lnet_get_networks(void)
 {
@@ -120,6 +130,14 @@ lnet_get_routes(void)
         return (str == NULL) ? "" : str;
 }
 
+char *
+lnet_get_peer_nids(void)
+{
+	char *str = getenv("LNET_PEER_NIDS");
+
+	return (str == NULL) ? "" : str;
+}
+
 char *
 lnet_get_networks (void)
 {
@@ -749,6 +767,7 @@ lnet_prepare(lnet_pid_t requested_pid)
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_nis_cpt);
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_nis_zombie);
 	CFS_INIT_LIST_HEAD(&the_lnet.ln_routers);
+	CFS_INIT_LIST_HEAD(&the_lnet.ln_mr_peers);
 
 	rc = lnet_create_remote_nets_table();
 	if (rc != 0)
@@ -837,6 +856,7 @@ lnet_unprepare (void)
 
 	lnet_msg_containers_destroy();
 	lnet_peer_tables_destroy();
+	lnet_mr_peers_destroy();
 	lnet_rtrpools_free();
 
 	if (the_lnet.ln_counters != NULL) {
@@ -909,6 +929,10 @@ lnet_cpt_of_nid_locked(lnet_nid_t nid)
 	if (LNET_CPT_NUMBER == 1)
 		return 0; /* the only one */
 
+	/* all NIDs of a multi-rail peer are on the CPT of its primary NID,
+	 * so one lock covers all of them when choosing a rail */
+	nid = lnet_peer_primary_nid(nid);
+
 	/* take lnet_net_lock(any) would be OK */
 	if (!cfs_list_empty(&the_lnet.ln_nis_cpt)) {
 		cfs_list_for_each_entry(ni, &the_lnet.ln_nis_cpt, ni_cptlist) {
@@ -934,7 +958,8 @@ lnet_cpt_of_nid(lnet_nid_t nid)
 		return 0; /* the only one */
 
 	if (cfs_list_empty(&the_lnet.ln_nis_cpt))
-		return lnet_nid_cpt_hash(nid, LNET_CPT_NUMBER);
+		return lnet_nid_cpt_hash(lnet_peer_primary_nid(nid),
+					 LNET_CPT_NUMBER);
 
 	cpt = lnet_net_lock_current();
 	cpt2 = lnet_cpt_of_nid_locked(nid);
@@ -1471,6 +1496,11 @@ LNetNIInit(lnet_pid_t requested_pid)
         if (rc != 0)
                 goto failed0;
 
+	/* before any NI is up: NIDs of a multi-rail peer map to one CPT */
+	rc = lnet_parse_peer_nids(lnet_get_peer_nids());
+	if (rc != 0)
+		goto failed1;
+
         rc = lnet_startup_lndnis();
         if (rc != 0)
                 goto failed1;
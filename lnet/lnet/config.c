@@ -831,6 +831,93 @@ lnet_parse_routes (char *routes, int *im_a_router)
 	return rc;
 }
 
+static int
+lnet_parse_peer_nid_entry(char *str)
+{
+	lnet_nid_t	nids[LNET_MAX_INTERFACES];
+	int		nnids = 0;
+	char		*sep = str;
+	char		*token;
+	int		rc;
+
+	for (;;) {
+		/* scan for token start */
+		while (cfs_iswhite(*sep) || *sep == ',')
+			sep++;
+		if (*sep == 0)
+			break;
+
+		token = sep++;
+
+		/* scan for token end */
+		while (*sep != 0 && !cfs_iswhite(*sep) && *sep != ',')
+			sep++;
+		if (*sep != 0)
+			*sep++ = 0;
+
+		if (nnids == LNET_MAX_INTERFACES)
+			goto token_error;
+
+		nids[nnids] = libcfs_str2nid(token);
+		if (nids[nnids] == LNET_NID_ANY)
+			goto token_error;
+		nnids++;
+	}
+
+	if (nnids == 0)
+		return 0;
+
+	rc = lnet_add_mr_peer(nids, nnids);
+	if (rc != 0) {
+		CERROR("Can't add multi-rail peer %s: %d\n",
+		       libcfs_nid2str(nids[0]), rc);
+		return rc;
+	}
+	return 0;
+
+ token_error:
+	lnet_syntax("peer_nids", str, (int)(token - str), strlen(token));
+	return -EINVAL;
+}
+
+/*
+ * Each ';' or newline separated entry lists the NIDs of one multi-rail node,
+ * its primary NID first, e.g.
+ * "10.0.0.1@o2ib,10.0.1.1@o2ib1; 10.0.0.2@o2ib,10.0.1.2@o2ib1".  All nodes
+ * need the same list, since a receiver has to map any NID of a sender back
+ * to its primary NID.
+ */
+int
+lnet_parse_peer_nids(char *str)
+{
+	cfs_list_t		tbs;
+	lnet_text_buf_t		*ltb;
+	int			rc = 0;
+
+	CFS_INIT_LIST_HEAD(&tbs);
+
+	if (lnet_str2tbs_sep(&tbs, str) < 0) {
+		CERROR("Error parsing peer_nids\n");
+		return -EINVAL;
+	}
+
+	while (!cfs_list_empty(&tbs)) {
+		ltb = cfs_list_entry(tbs.next, lnet_text_buf_t, ltb_list);
+
+		if (rc == 0)
+			rc = lnet_parse_peer_nid_entry(ltb->ltb_text);
+
+		cfs_list_del(&ltb->ltb_list);
+		lnet_free_text_buf(ltb);
+	}
+
+	if (rc != 0)
+		lnet_mr_peers_destroy();
+
+	LASSERT(lnet_tbnob == 0);
+	return rc;
+}
+
 int
 lnet_match_network_token(char *token, int len, __u32 *ipaddrs, int nip)
 {
@@ -665,6 +665,14 @@ void
 lnet_prep_send(lnet_msg_t *msg, int type, lnet_process_id_t target,
                unsigned int offset, unsigned int len) 
 {
+	/* The ACK or REPLY to a multi-rail peer goes back to the NID the
+	 * request came from: lnet_parse() replaced it with the primary NID,
+	 * which may not be on the network of the NI the request arrived on */
+	if ((type == LNET_MSG_ACK || type == LNET_MSG_REPLY) &&
+	    msg->msg_from != target.nid &&
+	    lnet_peer_primary_nid(msg->msg_from) == target.nid)
+		target.nid = msg->msg_from;
+
         msg->msg_type = type;
         msg->msg_target = target;
         msg->msg_len = len;
@@ -1136,6 +1144,17 @@ lnet_return_rx_credits_locked(lnet_msg_t *msg)
         }
 }
 
+/* load of gateway \a lp: its average plus current tx credits in use; the
+ * current part spreads a burst of messages, the average steers new traffic
+ * away from a router which has been busy for a while */
+static int
+lnet_route_load(lnet_peer_t *lp)
+{
+	return lp->lp_txdeficit_avg + LNET_RTR_LOAD_SCALE +
+	       (lp->lp_ni->ni_peertxcredits - lp->lp_txcredits) *
+	       LNET_RTR_LOAD_SCALE;
+}
+
 static int
 lnet_compare_routes(lnet_route_t *r1, lnet_route_t *r2)
 {
@@ -1154,6 +1173,29 @@ lnet_compare_routes(lnet_route_t *r1, lnet_route_t *r2)
 	if (r1->lr_hops > r2->lr_hops)
 		return -1;
 
+	if (lnet_route_select_adaptive()) {
+		__u64	c1 = lnet_route_load(p1);
+		__u64	c2 = lnet_route_load(p2);
+
+		if (c1 < c2)
+			return 1;
+
+		if (c1 > c2)
+			return -1;
+
+		/* on equal load, prefer the router which answers its pings
+		 * faster, once both have been pinged */
+		if (p1->lp_rtt_avg != 0 && p2->lp_rtt_avg != 0) {
+			if (p1->lp_rtt_avg < p2->lp_rtt_avg)
+				return 1;
+
+			if (p1->lp_rtt_avg > p2->lp_rtt_avg)
+				return -1;
+		}
+
+		goto out;
+	}
+
 	if (p1->lp_txqnob < p2->lp_txqnob)
 		return 1;
 
@@ -1166,6 +1208,7 @@ lnet_compare_routes(lnet_route_t *r1, lnet_route_t *r2)
 	if (p1->lp_txcredits < p2->lp_txcredits)
 		return -1;
 
+ out:
 	if (r1->lr_seq - r2->lr_seq <= 0)
 		return 1;
 
@@ -1223,10 +1266,12 @@ lnet_find_route_locked(lnet_ni_t *ni, lnet_nid_t target, lnet_nid_t rtr_nid)
 	}
 
 	/* set sequence number on the best router to the latest sequence + 1
-	 * so we can round-robin all routers, it's race and inaccurate but
-	 * harmless and functional  */
-	if (best_route != NULL)
+	 * so we can round-robin all routers, and count its use; it's race and
+	 * inaccurate but harmless and functional  */
+	if (best_route != NULL) {
 		best_route->lr_seq = last_route->lr_seq + 1;
+		best_route->lr_send_count++;
+	}
 	return lp_best;
 }
 
@@ -1237,6 +1282,7 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
 	struct lnet_ni		*src_ni;
 	struct lnet_ni		*local_ni;
 	struct lnet_peer	*lp;
+	struct lnet_mr_peer	*mp;
 	int			cpt;
 	int			cpt2;
 	int			rc;
@@ -1276,6 +1322,32 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
                 LASSERT (!msg->msg_routing);
         }
 
+	/* Spread PUT and GET to a multi-rail peer over its NIDs; ACK and
+	 * REPLY go back to the NID the request came from, as set by
+	 * lnet_prep_send() */
+	if (!msg->msg_routing && rtr_nid == LNET_NID_ANY &&
+	    (msg->msg_type == LNET_MSG_PUT || msg->msg_type == LNET_MSG_GET) &&
+	    (mp = lnet_find_mr_peer(dst_nid)) != NULL) {
+		lnet_nid_t	rail_nid = dst_nid;
+		struct lnet_ni	*rail_ni;
+
+		rail_ni = lnet_select_rail_locked(mp, src_ni, cpt, &rail_nid);
+		if (rail_ni != NULL) {
+			if (src_ni != NULL) {
+				lnet_ni_decref_locked(src_ni, cpt);
+				src_ni = rail_ni;
+				src_nid = rail_ni->ni_nid;
+			} else {
+				/* picked again below from dst_nid */
+				lnet_ni_decref_locked(rail_ni, cpt);
+			}
+
+			dst_nid = rail_nid;
+			msg->msg_target.nid = dst_nid;
+			msg->msg_hdr.dest_nid = cpu_to_le64(dst_nid);
+		}
+	}
+
         /* Is this for someone on a local network? */
 	local_ni = lnet_net2ni_locked(LNET_NIDNET(dst_nid), cpt);
 
@@ -1402,6 +1474,8 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
         LASSERT (msg->msg_txpeer == NULL);
 
         msg->msg_txpeer = lp;                   /* msg takes my ref on lp */
+	lp->lp_send_count++;
+	src_ni->ni_tx_queues[cpt]->tq_send_count++;
 
         rc = lnet_post_send_locked(msg, 0);
 	lnet_net_unlock(cpt);
@@ -1938,7 +2012,9 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
 	} else {
 		/* convert common msg->hdr fields to host byteorder */
 		msg->msg_hdr.type	= type;
-		msg->msg_hdr.src_nid	= src_nid;
+		/* above LNet, a multi-rail peer is known by its primary NID */
+		msg->msg_hdr.src_nid	= src_nid != from_nid ? src_nid :
+					  lnet_peer_primary_nid(src_nid);
 		msg->msg_hdr.src_pid	= le32_to_cpu(msg->msg_hdr.src_pid);
 		msg->msg_hdr.dest_nid	= dest_nid;
 		msg->msg_hdr.dest_pid	= dest_pid;
@@ -1957,6 +2033,8 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
 		goto drop;
 	}
 
+	msg->msg_rxpeer->lp_recv_count++;
+	ni->ni_tx_queues[cpt]->tq_recv_count++;
 	lnet_msg_commit(msg, cpt);
 
 	if (!for_me) {
@@ -335,3 +335,224 @@ lnet_debug_peer(lnet_nid_t nid)
 
 	lnet_net_unlock(cpt);
 }
+
+struct lnet_mr_peer *
+lnet_find_mr_peer(lnet_nid_t nid)
+{
+	struct lnet_peer_rail	*rail;
+	cfs_list_t		*rails;
+
+	/* no locking: multi-rail peers only change while LNet is down */
+	if (the_lnet.ln_mr_hash == NULL)
+		return NULL;
+
+	rails = &the_lnet.ln_mr_hash[lnet_nid2peerhash(nid)];
+	cfs_list_for_each_entry(rail, rails, pr_hashlist) {
+		if (rail->pr_nid == nid)
+			return rail->pr_peer;
+	}
+
+	return NULL;
+}
+
+lnet_nid_t
+lnet_peer_primary_nid(lnet_nid_t nid)
+{
+	struct lnet_mr_peer *mp = lnet_find_mr_peer(nid);
+
+	return mp != NULL ? lnet_mr_primary_nid(mp) : nid;
+}
+
+int
+lnet_add_mr_peer(lnet_nid_t *nids, int nnids)
+{
+	struct lnet_mr_peer	*mp;
+	int			i;
+	int			j;
+
+	LASSERT(the_lnet.ln_refcount == 0);
+
+	if (nnids < 2 || nnids > LNET_MAX_INTERFACES)
+		return -EINVAL;
+
+	for (i = 0; i < nnids; i++) {
+		if (nids[i] == LNET_NID_ANY ||
+		    LNET_NETTYP(LNET_NIDNET(nids[i])) == LOLND ||
+		    lnet_find_mr_peer(nids[i]) != NULL)
+			return -EINVAL;
+
+		for (j = 0; j < i; j++) {
+			/* one NID per network: it's the only NID LNet can
+			 * reach on it */
+			if (LNET_NIDNET(nids[j]) == LNET_NIDNET(nids[i]))
+				return -EINVAL;
+		}
+	}
+
+	if (the_lnet.ln_mr_hash == NULL) {
+		LIBCFS_ALLOC(the_lnet.ln_mr_hash,
+			     LNET_PEER_HASH_SIZE * sizeof(cfs_list_t));
+		if (the_lnet.ln_mr_hash == NULL)
+			return -ENOMEM;
+
+		for (i = 0; i < LNET_PEER_HASH_SIZE; i++)
+			CFS_INIT_LIST_HEAD(&the_lnet.ln_mr_hash[i]);
+	}
+
+	LIBCFS_ALLOC(mp, sizeof(*mp));
+	if (mp == NULL)
+		return -ENOMEM;
+
+	mp->mp_nrails = nnids;
+	for (i = 0; i < nnids; i++) {
+		struct lnet_peer_rail *rail = &mp->mp_rails[i];
+
+		rail->pr_peer = mp;
+		rail->pr_nid = nids[i];
+		cfs_list_add_tail(&rail->pr_hashlist,
+				  &the_lnet.ln_mr_hash[lnet_nid2peerhash(
+							nids[i])]);
+	}
+	cfs_list_add_tail(&mp->mp_list, &the_lnet.ln_mr_peers);
+
+	CDEBUG(D_NET, "Multi-rail peer %s with %d NIDs\n",
+	       libcfs_nid2str(nids[0]), nnids);
+	return 0;
+}
+
+void
+lnet_mr_peers_destroy(void)
+{
+	struct lnet_mr_peer	*mp;
+	int			i;
+
+	while (!cfs_list_empty(&the_lnet.ln_mr_peers)) {
+		mp = cfs_list_entry(the_lnet.ln_mr_peers.next,
+				    struct lnet_mr_peer, mp_list);
+		cfs_list_del(&mp->mp_list);
+		for (i = 0; i < mp->mp_nrails; i++)
+			cfs_list_del(&mp->mp_rails[i].pr_hashlist);
+		LIBCFS_FREE(mp, sizeof(*mp));
+	}
+
+	if (the_lnet.ln_mr_hash != NULL) {
+		LIBCFS_FREE(the_lnet.ln_mr_hash,
+			    LNET_PEER_HASH_SIZE * sizeof(cfs_list_t));
+		the_lnet.ln_mr_hash = NULL;
+	}
+}
+
+static int
+lnet_ni_on_cpt(lnet_ni_t *ni, int cpt)
+{
+	int i;
+
+	if (ni->ni_cpts == NULL)
+		return 1;
+
+	for (i = 0; i < ni->ni_ncpts; i++) {
+		if (ni->ni_cpts[i] == cpt)
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * Choose which NID of multi-rail peer \a mp to send a message to, and from
+ * which local NI.
+ *
+ * A rail is usable if I have an NI on its network, and that NI is either
+ * \a src_ni or another NID of my own node: the receiver only knows my NIDs
+ * to be the same node if I'm a multi-rail peer to it too.  Without \a src_ni,
+ * the NID the message was addressed to is usable as well.  Among usable
+ * rails, prefer an NI bound to the CPT I'm running on, then the one with
+ * most free credits on both ends, then the shortest queue to the peer NID;
+ * ties are broken round-robin.
+ *
+ * \param mp	 the destination
+ * \param src_ni the NI the caller asked to send from, or NULL for any
+ * \param cpt	 the locked CPT, which is the CPT of all NIDs of \a mp
+ * \param nidp	 the NID the message is addressed to, returns the chosen one
+ *
+ * \retval the NI to send from, referenced on \a cpt
+ * \retval NULL no NID of \a mp is reachable on a local network
+ */
+lnet_ni_t *
+lnet_select_rail_locked(struct lnet_mr_peer *mp, lnet_ni_t *src_ni,
+			int cpt, lnet_nid_t *nidp)
+{
+	struct lnet_peer_table	*ptable = the_lnet.ln_peer_tables[cpt];
+	struct lnet_mr_peer	*self;
+	lnet_ni_t		*best_ni = NULL;
+	lnet_nid_t		best_nid = *nidp;
+	int			best_local = 0;
+	int			best_credits = 0;
+	long			best_qnob = 0;
+	int			cur = lnet_cpt_current();
+	int			start;
+	int			i;
+
+	self = src_ni != NULL ? lnet_find_mr_peer(src_ni->ni_nid) : NULL;
+	start = mp->mp_seq++ % mp->mp_nrails;
+
+	for (i = 0; i < mp->mp_nrails; i++) {
+		lnet_nid_t	nid;
+		lnet_ni_t	*ni;
+		lnet_peer_t	*lp;
+		int		local;
+		int		credits;
+		long		qnob = 0;
+
+		nid = mp->mp_rails[(start + i) % mp->mp_nrails].pr_nid;
+		ni = lnet_net2ni_locked(LNET_NIDNET(nid), cpt);
+		if (ni == NULL)
+			continue;
+
+		if (ni->ni_nid == nid) {
+			/* it's me */
+			lnet_ni_decref_locked(ni, cpt);
+			continue;
+		}
+
+		if (src_ni == NULL ?
+		    nid != *nidp && lnet_find_mr_peer(ni->ni_nid) == NULL :
+		    ni != src_ni &&
+		    (self == NULL || lnet_find_mr_peer(ni->ni_nid) != self)) {
+			lnet_ni_decref_locked(ni, cpt);
+			continue;
+		}
+
+		local = lnet_ni_on_cpt(ni, cur);
+		credits = ni->ni_tx_queues[cpt]->tq_credits;
+
+		lp = lnet_find_peer_locked(ptable, nid);
+		if (lp != NULL) {
+			credits = min(credits, lp->lp_txcredits);
+			qnob = lp->lp_txqnob;
+			lnet_peer_decref_locked(lp);
+		} else {
+			credits = min(credits, ni->ni_peertxcredits);
+		}
+
+		if (best_ni != NULL &&
+		    (best_local > local ||
+		     (best_local == local &&
+		      (best_credits > credits ||
+		       (best_credits == credits && best_qnob <= qnob))))) {
+			lnet_ni_decref_locked(ni, cpt);
+			continue;
+		}
+
+		if (best_ni != NULL)
+			lnet_ni_decref_locked(best_ni, cpt);
+
+		best_ni = ni;
+		best_nid = nid;
+		best_local = local;
+		best_credits = credits;
+		best_qnob = qnob;
+	}
+
+	*nidp = best_nid;
+	return best_ni;
+}
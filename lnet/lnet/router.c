@@ -100,12 +100,67 @@ static int router_ping_timeout = 50;
 CFS_MODULE_PARM(router_ping_timeout, "i", int, 0644,
 		"Seconds to wait for the reply to a router health query");
 
+static int adaptive_route_select = 0;
+CFS_MODULE_PARM(adaptive_route_select, "i", int, 0644,
+		"Choose routers by average load and ping RTT (0 to disable)");
+
 int
 lnet_peers_start_down(void)
 {
         return check_routers_before_use;
 }
 
+int
+lnet_route_select_adaptive(void)
+{
+	return adaptive_route_select;
+}
+
+static inline int
+lnet_rtr_avg(int avg, int sample)
+{
+	return avg + ((sample - avg) >> LNET_RTR_AVG_SHIFT);
+}
+
+static inline __u64
+lnet_rtr_usec(void)
+{
+	struct timeval tv;
+
+	do_gettimeofday(&tv);
+	return (__u64)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* sample how many tx credits of router \a rtr are in use, including
+ * messages queued for credits */
+static void
+lnet_rtr_sample_load_locked(lnet_peer_t *rtr)
+{
+	int deficit = rtr->lp_ni->ni_peertxcredits - rtr->lp_txcredits;
+
+	rtr->lp_txdeficit_avg = lnet_rtr_avg(rtr->lp_txdeficit_avg,
+					     deficit * LNET_RTR_LOAD_SCALE);
+}
+
+/* sample the round-trip time of the ping of router \a rtr which just
+ * got its reply, in microseconds rather than jiffies which most pings
+ * take less than */
+static void
+lnet_rtr_sample_rtt_locked(lnet_peer_t *rtr)
+{
+	__u64	now = lnet_rtr_usec();
+	int	rtt;
+
+	/* the wall clock may have been set back */
+	if (now <= rtr->lp_ping_sent_usec)
+		return;
+
+	rtt = min_t(__u64, now - rtr->lp_ping_sent_usec, INT_MAX);
+
+	rtr->lp_rtt_avg = rtr->lp_rtt_avg == 0 ? rtt :
+			  lnet_rtr_avg(rtr->lp_rtt_avg, rtt);
+}
+
 void
 lnet_notify_locked(lnet_peer_t *lp, int notifylnd, int alive, cfs_time_t when)
 {
@@ -725,6 +780,9 @@ lnet_router_checker_event(lnet_event_t *event)
 			goto out;
 	}
 
+	if (event->status == 0)
+		lnet_rtr_sample_rtt_locked(lp);
+
 	/* LNET_EVENT_REPLY */
 	/* A successful REPLY means the router is up.  If _any_ comms
 	 * to the router fail I assume it's down (this will happen if
@@ -945,6 +1003,8 @@ lnet_ping_router_locked (lnet_peer_t *rtr)
 		return;
 	}
 
+	lnet_rtr_sample_load_locked(rtr);
+
 	rcd = rtr->lp_rcd != NULL ?
 	      rtr->lp_rcd : lnet_create_rc_data_locked(rtr);
 
@@ -973,6 +1033,7 @@ lnet_ping_router_locked (lnet_peer_t *rtr)
 
                 rtr->lp_ping_notsent   = 1;
                 rtr->lp_ping_timestamp = now;
+		rtr->lp_ping_sent_usec = lnet_rtr_usec();
 
 		mdh = rcd->rcd_mdh;
 
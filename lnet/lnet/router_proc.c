@@ -161,8 +161,10 @@ int LL_PROC_PROTO(proc_lnet_routes)
                               the_lnet.ln_routing ? "enabled" : "disabled");
                 LASSERT (tmpstr + tmpsiz - s > 0);
 
-		s += snprintf(s, tmpstr + tmpsiz - s, "%-8s %4s %8s %7s %s\n",
-			      "net", "hops", "priority", "state", "router");
+		s += snprintf(s, tmpstr + tmpsiz - s,
+			      "%-8s %4s %8s %7s %-20s %10s %4s\n",
+			      "net", "hops", "priority", "state", "router",
+			      "sent", "util");
                 LASSERT (tmpstr + tmpsiz - s > 0);
 
 		lnet_net_lock(0);
@@ -221,13 +223,30 @@ int LL_PROC_PROTO(proc_lnet_routes)
 			unsigned int priority	= route->lr_priority;
 			lnet_nid_t   nid	= route->lr_gateway->lp_nid;
 			int          alive	= lnet_is_route_alive(route);
+			__u64	     sent	= route->lr_send_count;
+			__u64	     util	= sent;
+			__u64	     total	= 0;
+			lnet_route_t *re;
+
+			/* utilisation: % of the messages routed to the
+			 * network which went through this route */
+			cfs_list_for_each_entry(re, &rnet->lrn_routes, lr_list)
+				total += re->lr_send_count;
+			while (total > ~0U / 100) {
+				total >>= 1;
+				util >>= 1;
+			}
+			util *= 100;
+			if (total != 0)
+				do_div(util, (__u32)total);
 
 			s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%-8s %4u %8u %7s %s\n",
+				      "%-8s %4u %8u %7s %-20s %10"LPF64"u %4u\n",
 				      libcfs_net2str(net), hops,
 				      priority,
 				      alive ? "up" : "down",
-				      libcfs_nid2str(nid));
+				      libcfs_nid2str(nid), sent,
+				      (unsigned int)util);
 			LASSERT(tmpstr + tmpsiz - s > 0);
 		}
 
@@ -281,10 +300,10 @@ int LL_PROC_PROTO(proc_lnet_routers)
 
         if (*ppos == 0) {
 		s += snprintf(s, tmpstr + tmpsiz - s,
-			      "%-4s %7s %9s %6s %12s %9s %8s %7s %s\n",
+			      "%-4s %7s %9s %6s %12s %9s %8s %7s %-20s %8s %6s\n",
 			      "ref", "rtr_ref", "alive_cnt", "state",
 			      "last_ping", "ping_sent", "deadline",
-			      "down_ni", "router");
+			      "down_ni", "router", "rtt", "load");
 		LASSERT(tmpstr + tmpsiz - s > 0);
 
 		lnet_net_lock(0);
@@ -332,6 +351,9 @@ int LL_PROC_PROTO(proc_lnet_routers)
                         int last_ping = cfs_duration_sec(cfs_time_sub(now,
                                                      peer->lp_ping_timestamp));
 			int down_ni   = 0;
+			int rtt	      = peer->lp_rtt_avg;
+			int load      = peer->lp_txdeficit_avg /
+					LNET_RTR_LOAD_SCALE;
 			lnet_route_t *rtr;
 
 			if ((peer->lp_ping_feats &
@@ -348,20 +370,23 @@ int LL_PROC_PROTO(proc_lnet_routers)
 			}
 
                         if (deadline == 0)
-                                s += snprintf(s, tmpstr + tmpsiz - s,
-                                              "%-4d %7d %9d %6s %12d %9d %8s %7d %s\n",
-                                              nrefs, nrtrrefs, alive_cnt,
-                                              alive ? "up" : "down", last_ping,
-                                              pingsent, "NA", down_ni,
-                                              libcfs_nid2str(nid));
+				s += snprintf(s, tmpstr + tmpsiz - s,
+					      "%-4d %7d %9d %6s %12d %9d %8s "
+					      "%7d %-20s %8d %6d\n",
+					      nrefs, nrtrrefs, alive_cnt,
+					      alive ? "up" : "down", last_ping,
+					      pingsent, "NA", down_ni,
+					      libcfs_nid2str(nid), rtt, load);
                         else
-                                s += snprintf(s, tmpstr + tmpsiz - s,
-                                              "%-4d %7d %9d %6s %12d %9d %8lu %7d %s\n",
-                                              nrefs, nrtrrefs, alive_cnt,
-                                              alive ? "up" : "down", last_ping,
-                                              pingsent,
-                                              cfs_duration_sec(cfs_time_sub(deadline, now)),
-                                              down_ni, libcfs_nid2str(nid));
+				s += snprintf(s, tmpstr + tmpsiz - s,
+					      "%-4d %7d %9d %6s %12d %9d %8lu "
+					      "%7d %-20s %8d %6d\n",
+					      nrefs, nrtrrefs, alive_cnt,
+					      alive ? "up" : "down", last_ping,
+					      pingsent,
+					      cfs_duration_sec(cfs_time_sub(deadline, now)),
+					      down_ni, libcfs_nid2str(nid), rtt,
+					      load);
                         LASSERT (tmpstr + tmpsiz - s > 0);
                 }
 
@@ -421,9 +446,11 @@ int LL_PROC_PROTO(proc_lnet_peers)
 
         if (*ppos == 0) {
                 s += snprintf(s, tmpstr + tmpsiz - s,
-                              "%-24s %4s %5s %5s %5s %5s %5s %5s %5s %s\n",
-                              "nid", "refs", "state", "last", "max",
-                              "rtr", "min", "tx", "min", "queue");
+			      "%-24s %4s %5s %5s %5s %5s %5s %5s %5s %5s "
+			      "%10s %10s\n",
+			      "nid", "refs", "state", "last", "max",
+			      "rtr", "min", "tx", "min", "queue",
+			      "sent", "recv");
                 LASSERT (tmpstr + tmpsiz - s > 0);
 
 		hoff++;
@@ -494,6 +521,8 @@ int LL_PROC_PROTO(proc_lnet_peers)
                         int        rtrcr     = peer->lp_rtrcredits;
                         int        minrtrcr  = peer->lp_minrtrcredits;
                         int        txqnob    = peer->lp_txqnob;
+			__u64	   sent	     = peer->lp_send_count;
+			__u64	   recv	     = peer->lp_recv_count;
 
                         if (lnet_isrouter(peer) ||
                             lnet_peer_aliveness_enabled(peer))
@@ -517,10 +546,11 @@ int LL_PROC_PROTO(proc_lnet_peers)
 			lnet_net_unlock(cpt);
 
                         s += snprintf(s, tmpstr + tmpsiz - s,
-                                      "%-24s %4d %5s %5d %5d %5d %5d %5d %5d %d\n",
-                                      libcfs_nid2str(nid), nrefs, aliveness,
-                                      lastalive, maxcr, rtrcr, minrtrcr, txcr,
-                                      mintxcr, txqnob);
+				      "%-24s %4d %5s %5d %5d %5d %5d %5d %5d "
+				      "%5d %10"LPF64"u %10"LPF64"u\n",
+				      libcfs_nid2str(nid), nrefs, aliveness,
+				      lastalive, maxcr, rtrcr, minrtrcr, txcr,
+				      mintxcr, txqnob, sent, recv);
                         LASSERT (tmpstr + tmpsiz - s > 0);
 
 		} else { /* peer is NULL */
@@ -617,7 +647,7 @@ DECLARE_PROC_HANDLER(proc_lnet_buffers);
 
 int LL_PROC_PROTO(proc_lnet_nis)
 {
-	int	tmpsiz = 128 * LNET_CPT_NUMBER;
+	int	tmpsiz = 160 * LNET_CPT_NUMBER;
         int        rc = 0;
         char      *tmpstr;
         char      *s;
@@ -636,9 +666,10 @@ int LL_PROC_PROTO(proc_lnet_nis)
 
         if (*ppos == 0) {
                 s += snprintf(s, tmpstr + tmpsiz - s,
-                              "%-24s %6s %5s %4s %4s %4s %5s %5s %5s\n",
-                              "nid", "status", "alive", "refs", "peer",
-                              "rtr", "max", "tx", "min");
+			      "%-24s %6s %5s %4s %4s %4s %5s %5s %5s "
+			      "%10s %10s\n",
+			      "nid", "status", "alive", "refs", "peer",
+			      "rtr", "max", "tx", "min", "sent", "recv");
                 LASSERT (tmpstr + tmpsiz - s > 0);
         } else {
                 cfs_list_t        *n;
@@ -698,13 +729,15 @@ int LL_PROC_PROTO(proc_lnet_nis)
 					lnet_net_lock(i);
 
 				s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%-24s %6s %5d %4d %4d %4d %5d %5d %5d\n",
+				      "%-24s %6s %5d %4d %4d %4d %5d %5d %5d "
+				      "%10"LPF64"u %10"LPF64"u\n",
 				      libcfs_nid2str(ni->ni_nid), stat,
 				      last_alive, *ni->ni_refs[i],
 				      ni->ni_peertxcredits,
 				      ni->ni_peerrtrcredits,
 				      tq->tq_credits_max,
-				      tq->tq_credits, tq->tq_credits_min);
+				      tq->tq_credits, tq->tq_credits_min,
+				      tq->tq_send_count, tq->tq_recv_count);
 				if (i != 0)
 					lnet_net_unlock(i);
 			}
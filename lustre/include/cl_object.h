@@ -2160,10 +2160,17 @@ enum cl_enq_flags {
          * for async glimpse lock.
          */
         CEF_AGL          = 0x00000020,
+	/**
+	 * ask the server to grant exactly the requested extent, used together
+	 * with CEF_NONBLOCK for lock-ahead requests.
+	 *
+	 * \see ll_lock_ahead().
+	 */
+	CEF_LOCK_NO_EXPAND = 0x00000040,
         /**
          * mask of enq_flags.
          */
-        CEF_MASK         = 0x0000003f,
+        CEF_MASK         = 0x0000007f,
 };
 
 /**
@@ -211,11 +211,12 @@ enum lprocfs_fields_flags {
 struct lprocfs_stats {
 	/* # of counters */
 	unsigned short			ls_num;
-	/* 1 + the biggest cpu # whose ls_percpu slot has been allocated */
-	unsigned short			ls_biggest_alloc_num;
+	/* 1 + the biggest cpu # whose ls_percpu slot has been allocated,
+	 * only ever grows, updated locklessly by lprocfs_stats_alloc_one() */
+	unsigned int			ls_biggest_alloc_num;
 	enum lprocfs_stats_flags	ls_flags;
-	/* Lock used when there are no percpu stats areas; For percpu stats,
-	 * it is used to protect ls_biggest_alloc_num change */
+	/* Lock used when there are no percpu stats areas; percpu stats are
+	 * updated without any lock and only summed up when read */
 	spinlock_t			ls_lock;
 
 	/* has ls_num of counter headers */
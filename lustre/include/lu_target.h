@@ -322,6 +322,7 @@ void tgt_client_free(struct obd_export *exp);
 int tgt_client_del(const struct lu_env *env, struct obd_export *exp);
 int tgt_client_add(const struct lu_env *env, struct obd_export *exp, int);
 int tgt_client_new(const struct lu_env *env, struct obd_export *exp);
+void tgt_mult_trans_set(struct tgt_session_info *tsi);
 int tgt_client_data_read(const struct lu_env *env, struct lu_target *tg,
 			 struct lsd_client_data *lcd, loff_t *off, int index);
 int tgt_client_data_write(const struct lu_env *env, struct lu_target *tg,
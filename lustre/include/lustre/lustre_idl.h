@@ -1352,6 +1352,10 @@ extern void lustre_swab_ptlrpc_body(struct ptlrpc_body *pb);
 #define OBD_CONNECT_OPEN_BY_FID	0x20000000000000ULL /* open by fid won't pack
 						       name in request */
 #define OBD_CONNECT_LFSCK      0x40000000000000ULL/* support online LFSCK */
+#define OBD_CONNECT_BATCH_RPC  0x80000000000000ULL/* MDS_BATCH supported */
+#define OBD_CONNECT_MULTIOBJ_BRW 0x100000000000000ULL/* multi-object write */
+#define OBD_CONNECT_DESTROY_BATCH 0x200000000000000ULL/* OST_DESTROY_BATCH */
+#define OBD_CONNECT_LOCKAHEAD  0x400000000000000ULL/* lock-ahead, no expansion */
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -1396,7 +1400,8 @@ extern void lustre_swab_ptlrpc_body(struct ptlrpc_body *pb);
 				OBD_CONNECT_LVB_TYPE | OBD_CONNECT_LAYOUTLOCK |\
 				OBD_CONNECT_PINGLESS | OBD_CONNECT_MAX_EASIZE |\
 				OBD_CONNECT_FLOCK_DEAD | \
-				OBD_CONNECT_DISP_STRIPE | OBD_CONNECT_LFSCK)
+				OBD_CONNECT_DISP_STRIPE | OBD_CONNECT_LFSCK | \
+				OBD_CONNECT_BATCH_RPC)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
                                 OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -1414,7 +1419,10 @@ extern void lustre_swab_ptlrpc_body(struct ptlrpc_body *pb);
 				OBD_CONNECT_JOBSTATS | \
 				OBD_CONNECT_LIGHTWEIGHT | OBD_CONNECT_LVB_TYPE|\
 				OBD_CONNECT_LAYOUTLOCK | OBD_CONNECT_FID | \
-				OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK)
+				OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK | \
+				OBD_CONNECT_MULTIOBJ_BRW | \
+				OBD_CONNECT_DESTROY_BATCH | \
+				OBD_CONNECT_LOCKAHEAD)
 #define ECHO_CONNECT_SUPPORTED (0)
 #define MGS_CONNECT_SUPPORTED  (OBD_CONNECT_VERSION | OBD_CONNECT_AT | \
 				OBD_CONNECT_FULL20 | OBD_CONNECT_IMP_RECOV | \
@@ -1512,6 +1520,8 @@ typedef enum {
         OBD_CKSUM_CRC32 = 0x00000001,
         OBD_CKSUM_ADLER = 0x00000002,
         OBD_CKSUM_CRC32C= 0x00000004,
+	OBD_CKSUM_T10IP512 = 0x00000008, /* IP checksum per 512B sector */
+	OBD_CKSUM_T10IP4K  = 0x00000010, /* IP checksum per 4KB sector */
 } cksum_type_t;
 
 /*
@@ -1539,6 +1549,7 @@ typedef enum {
         OST_QUOTACHECK = 18,
         OST_QUOTACTL   = 19,
 	OST_QUOTA_ADJUST_QUNIT = 20, /* not used since 2.4 */
+	OST_DESTROY_BATCH = 21,
         OST_LAST_OPC
 } ost_cmd_t;
 #define OST_FIRST_OPC  OST_REPLY
@@ -1558,6 +1569,8 @@ enum obdo_flags {
         OBD_FL_CKSUM_CRC32  = 0x00001000, /* CRC32 checksum type */
         OBD_FL_CKSUM_ADLER  = 0x00002000, /* ADLER checksum type */
         OBD_FL_CKSUM_CRC32C = 0x00004000, /* CRC32C checksum type */
+	OBD_FL_CKSUM_T10IP512 = 0x00005000, /* T10-PI IP, 512B sector */
+	OBD_FL_CKSUM_T10IP4K  = 0x00006000, /* T10-PI IP, 4KB sector */
         OBD_FL_CKSUM_RSVD2  = 0x00008000, /* for future cksum types */
         OBD_FL_CKSUM_RSVD3  = 0x00010000, /* for future cksum types */
         OBD_FL_SHRINK_GRANT = 0x00020000, /* object shrink the grant */
@@ -1569,8 +1582,8 @@ enum obdo_flags {
 	OBD_FL_FLUSH	    = 0x00200000, /* flush pages on the OST */
 	OBD_FL_SHORT_IO	    = 0x00400000, /* short io request */
 
-        /* Note that while these checksum values are currently separate bits,
-         * in 2.x we can actually allow all values from 1-31 if we wanted. */
+	/* The first checksum values are separate bits, the T10-PI ones use
+	 * the values in between, as all values from 1-31 are allowed in 2.x */
         OBD_FL_CKSUM_ALL    = OBD_FL_CKSUM_CRC32 | OBD_FL_CKSUM_ADLER |
                               OBD_FL_CKSUM_CRC32C,
 
@@ -1885,6 +1898,9 @@ extern void lustre_swab_obd_statfs (struct obd_statfs *os);
 				      * that the client is running low on
 				      * space for unstable pages; asking
 				      * it to sync quickly */
+#define OBD_BRW_LOCAL1	0x80000000UL /* osd-specific flag, e.g. the page
+				      * is an overwrite of allocated blocks,
+				      * never sent over the wire */
 
 #define OBD_OBJECT_EOF 0xffffffffffffffffULL
 
@@ -2166,6 +2182,7 @@ typedef enum {
 	MDS_HSM_CT_REGISTER	= 59,
 	MDS_HSM_CT_UNREGISTER	= 60,
 	MDS_SWAP_LAYOUTS	= 61,
+	MDS_BATCH		= 62,
 	MDS_LAST_OPC
 } mds_cmd_t;
 
@@ -3335,7 +3352,8 @@ struct llog_changelog_ext_rec {
 struct llog_changelog_user_rec {
         struct llog_rec_hdr   cur_hdr;
         __u32                 cur_id;
-        __u32                 cur_padding;
+	__u32                 cur_mask;   /* 1 << changelog_rec_type wanted
+					   * by this user, 0 for all */
         __u64                 cur_endrec;
         struct llog_rec_tail  cur_tail;
 } __attribute__((packed));
@@ -3630,6 +3648,23 @@ struct ll_fiemap_info_key {
 };
 
 extern void lustre_swab_ost_body (struct ost_body *b);
+
+/* One record of OST_DESTROY_BATCH: obr_op is OST_DESTROY or OST_SETATTR.
+ * As with o_lcookie in OST_DESTROY, obr_cookie is only carried so that
+ * the sender can cancel its llog record once the batch commits, the OST
+ * does not interpret it. The reply has one rc per record in RMF_RCS. */
+struct ost_batch_rec {
+	struct ost_id		obr_oi;
+	struct llog_cookie	obr_cookie;
+	__u32			obr_op;
+	__u32			obr_count;	/* OST_DESTROY: objects */
+	__u32			obr_uid;	/* OST_SETATTR only */
+	__u32			obr_gid;	/* OST_SETATTR only */
+};
+
+#define OST_BATCH_MAX_RECS	512
+
+extern void lustre_swab_ost_batch_rec(struct ost_batch_rec *obr);
 extern void lustre_swab_ost_last_id(obd_id *id);
 extern void lustre_swab_fiemap(struct ll_user_fiemap *fiemap);
 
@@ -4021,6 +4056,34 @@ struct object_update_reply {
 void lustre_swab_object_update_result(struct object_update_result *our);
 void lustre_swab_object_update_reply(struct object_update_reply *our);
 
+/* MDS_BATCH carries bb_count complete request messages, and its reply the
+ * matching reply messages, each one 8-byte aligned after the header. */
+#define BATCH_REQUEST_MAGIC	0xBA7C0001
+#define BATCH_REPLY_MAGIC	0xBA7C0002
+#define BATCH_MAX_COUNT		64
+
+/* Each message of a batch has its own xid, so that the server can tell
+ * resent messages apart, and the client match replies with their requests */
+struct batch_msg {
+	__u64	bm_xid;		/* xid of the request, the same in its reply */
+	__u32	bm_len;		/* length of the message, in the reply 0
+				 * means that request was not handled */
+	__u32	bm_padding;
+};
+
+struct batch_buf {
+	__u32	bb_magic;
+	__u16	bb_count;	/* number of messages */
+	__u16	bb_padding;
+	__u32	bb_reply_size;	/* request: size of the reply buffer the
+				 * client prepared for each message,
+				 * reply: unused */
+	__u32	bb_padding2;
+	struct batch_msg bb_msgs[0];
+};
+
+void lustre_swab_batch_buf(struct batch_buf *bb);
+
 /** layout swap request structure
  * fid1 and fid2 are in mdt_body
  */
@@ -273,6 +273,7 @@ struct ost_id {
 #define LL_IOC_HSM_IMPORT		_IOWR('f', 245, struct hsm_user_import)
 #define LL_IOC_LMV_SET_DEFAULT_STRIPE	_IOWR('f', 246, struct lmv_user_md)
 #define LL_IOC_MIGRATE			_IOR('f', 247, int)
+#define LL_IOC_LOCK_AHEAD		_IOWR('f', 248, struct lu_lock_ahead)
 
 #define LL_STATFS_LMV		1
 #define LL_STATFS_LOV		2
@@ -863,13 +864,33 @@ struct ioc_changelog {
         __u32 icc_mdtindex;
         __u32 icc_id;
         __u32 icc_flags;
+	__u32 icc_typemask; /* with CHANGELOG_FLAG_BATCH only: mask of
+			     * 1 << changelog_rec_type to send, 0 for all */
 };
 
+/* icc_flags: send records in CL_BATCH messages */
+#define CHANGELOG_FLAG_BATCH 0x04
+
 enum changelog_message_type {
         CL_RECORD = 10, /* message is a changelog_rec */
         CL_EOF    = 11, /* at end of current changelog */
+	CL_BATCH  = 12, /* message is a series of changelog_ext_rec */
 };
 
+/* Records of a CL_BATCH message are all changelog_ext_rec, each one starting
+ * on an 8-byte boundary. */
+static inline int changelog_batch_rec_len(struct changelog_ext_rec *rec)
+{
+	return (sizeof(*rec) + rec->cr_namelen + 7) & ~7;
+}
+
+static inline struct changelog_ext_rec *
+changelog_batch_next(struct changelog_ext_rec *rec)
+{
+	return (struct changelog_ext_rec *)((char *)rec +
+					    changelog_batch_rec_len(rec));
+}
+
 /********* Misc **********/
 
 struct ioc_data_version {
@@ -879,6 +900,30 @@ struct ioc_data_version {
 #define LL_DV_RD_FLUSH (1 << 0) /* Flush dirty pages from clients */
 #define LL_DV_WR_FLUSH (1 << 1) /* Flush all caching pages from clients */
 
+/* LL_IOC_LOCK_AHEAD: ask for extent locks before doing IO, e.g. when several
+ * clients write disjoint, interleaved parts of a shared file. Each lock is
+ * granted exactly on the requested extent or not at all, the call never waits
+ * for a conflicting lock to be released. */
+enum lock_ahead_mode {
+	LLA_READ	= 1,
+	LLA_WRITE	= 2,
+};
+
+struct lu_lock_ahead_extent {
+	__u64	lle_start;	/* first byte */
+	__u64	lle_end;	/* last byte, inclusive */
+	__s32	lle_result;	/* 0 if granted, -EWOULDBLOCK on conflict */
+	__u32	lle_padding;
+};
+
+struct lu_lock_ahead {
+	__u32	lla_mode;	/* enum lock_ahead_mode */
+	__u32	lla_extent_count;
+	__u64	lla_padding;
+	struct lu_lock_ahead_extent lla_extents[0];
+};
+#define LLA_MAX_EXTENTS	1024
+
 #ifndef offsetof
 #define offsetof(typ, memb)     ((unsigned long)((char *)&(((typ *)0)->memb)))
 #endif
@@ -1227,6 +1272,40 @@ struct llapi_json_item_list {
 	struct llapi_json_item	*ljil_items;
 };
 
+/*
+ * Binary export of a lprocfs stats file, read from the "<stats>_binary" file
+ * next to it: one lprocfs_stats_bin_header followed by lsbh_count
+ * lprocfs_stats_bin_counter records, one per counter in index order,
+ * including counters without any sample. All fields are in host byte order.
+ */
+#define LPROCFS_STATS_BIN_MAGIC		0x4c535442	/* "LSTB" */
+#define LPROCFS_STATS_BIN_VERSION	1
+#define LPROCFS_STATS_BIN_NAME_LEN	32
+#define LPROCFS_STATS_BIN_UNITS_LEN	16
+
+struct lprocfs_stats_bin_header {
+	__u32	lsbh_magic;
+	__u16	lsbh_version;
+	/* number of counter records that follow */
+	__u16	lsbh_count;
+	/* size of each counter record, to allow appending fields */
+	__u32	lsbh_counter_size;
+	__u32	lsbh_snapshot_usec;
+	__u64	lsbh_snapshot_sec;
+};
+
+struct lprocfs_stats_bin_counter {
+	__u32	lsbc_config;	/* LPROCFS_CNTR_* and LPROCFS_TYPE_* */
+	__u32	lsbc_padding;
+	__s64	lsbc_count;
+	__s64	lsbc_min;
+	__s64	lsbc_max;
+	__s64	lsbc_sum;
+	__s64	lsbc_sumsquare;
+	char	lsbc_name[LPROCFS_STATS_BIN_NAME_LEN];
+	char	lsbc_units[LPROCFS_STATS_BIN_UNITS_LEN];
+};
+
 /** @} lustreuser */
 
 #endif /* _LUSTRE_USER_H */
@@ -285,6 +285,8 @@ extern int llapi_chomp_string(char *buf);
 
 extern int llapi_get_version(char *buffer, int buffer_size, char **version);
 extern int llapi_get_data_version(int fd, __u64 *data_version, __u64 flags);
+extern int llapi_lock_ahead(int fd, enum lock_ahead_mode mode,
+			    struct lu_lock_ahead_extent *extents, int count);
 extern int llapi_hsm_state_get_fd(int fd, struct hsm_user_state *hus);
 extern int llapi_hsm_state_get(const char *path, struct hsm_user_state *hus);
 extern int llapi_hsm_state_set_fd(int fd, __u64 setmask, __u64 clearmask,
@@ -325,6 +327,12 @@ extern int llapi_changelog_start(void **priv, int flags, const char *mdtname,
                                  long long startrec);
 extern int llapi_changelog_fini(void **priv);
 extern int llapi_changelog_recv(void *priv, struct changelog_ext_rec **rech);
+extern int llapi_changelog_start_batch(void **priv, int flags,
+				       const char *mdtname, long long startrec,
+				       __u32 typemask);
+extern int llapi_changelog_recv_batch(void *priv,
+				      struct changelog_ext_rec **recs,
+				      int *count);
 extern int llapi_changelog_free(struct changelog_ext_rec **rech);
 /* Allow records up to endrec to be destroyed; requires registered id. */
 extern int llapi_changelog_clear(const char *mdtname, const char *idstr,
@@ -334,6 +334,8 @@ struct ldlm_ns_bucket {
 enum {
 	/** LDLM namespace lock stats */
         LDLM_NSS_LOCKS          = 0,
+	/** reprocessing skipped, nothing waiting on the resource */
+	LDLM_NSS_REPROCESS_SKIP,
         LDLM_NSS_LAST
 };
 
@@ -596,6 +598,9 @@ struct ldlm_interval {
 	struct interval_node	li_node;  /* node for tree management */
 	cfs_list_t		li_group; /* the locks which have the same
 					   * policy - group of the policy */
+	cfs_list_t		li_wait_dup; /* waiting locks with the same
+					      * extent, only one is in tree */
+	unsigned int		li_waiting:1; /* in lr_waiting_itree */
 };
 #define to_ldlm_interval(n) container_of(n, struct ldlm_interval, li_node)
 
@@ -953,6 +958,13 @@ struct ldlm_resource {
 	 * Interval trees (only for extent locks) for all modes of this resource
 	 */
 	struct ldlm_interval_tree lr_itree[LCK_MODE_NUM];
+	/**
+	 * Interval tree of the extent locks on lr_waiting, all modes, so
+	 * that conflicts with waiting locks are found without a list walk
+	 */
+	struct interval_node	*lr_waiting_itree;
+	/** Number of locks in lr_waiting_itree for each lock mode */
+	int			lr_waiting_size[LCK_MODE_NUM];
 
 	/**
 	 * Server-side-only lock value block elements.
@@ -35,7 +35,7 @@
 #ifndef LDLM_ALL_FLAGS_MASK
 
 /** l_flags bits marked as "all_flags" bits */
-#define LDLM_FL_ALL_FLAGS_MASK          0x00FFFFFFC08F932FULL
+#define LDLM_FL_ALL_FLAGS_MASK          0x00FFFFFFC09F932FULL
 
 /** l_flags bits marked as "ast" bits */
 #define LDLM_FL_AST_MASK                0x0000000080008000ULL
@@ -53,7 +53,7 @@
 #define LDLM_FL_OFF_WIRE_MASK           0x00FFFFFF00000000ULL
 
 /** l_flags bits marked as "on_wire" bits */
-#define LDLM_FL_ON_WIRE_MASK            0x00000000C08F932FULL
+#define LDLM_FL_ON_WIRE_MASK            0x00000000C09F932FULL
 
 /** extent, mode, or resource changed */
 #define LDLM_FL_LOCK_CHANGED            0x0000000000000001ULL // bit   0
@@ -143,6 +143,14 @@
 #define ldlm_set_test_lock(_l)          LDLM_SET_FLAG((  _l), 1ULL << 19)
 #define ldlm_clear_test_lock(_l)        LDLM_CLEAR_FLAG((_l), 1ULL << 19)
 
+/**
+ * Do not expand this lock: grant exactly the requested extent. Used for
+ * lock-ahead requests, which must not conflict with each other. */
+#define LDLM_FL_NO_EXPANSION            0x0000000000100000ULL // bit  20
+#define ldlm_is_no_expansion(_l)        LDLM_TEST_FLAG(( _l), 1ULL << 20)
+#define ldlm_set_no_expansion(_l)       LDLM_SET_FLAG((  _l), 1ULL << 20)
+#define ldlm_clear_no_expansion(_l)     LDLM_CLEAR_FLAG((_l), 1ULL << 20)
+
 /**
  * Immediatelly cancel such locks when they block some other locks. Send
  * cancel notification to original lock holder, but expect no reply. This
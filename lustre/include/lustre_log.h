@@ -85,10 +85,14 @@ struct plain_handle_data {
         struct llog_cookie  phd_cookie; /* cookie of this log in its cat */
 };
 
+struct llog_cat_par_data;
+
 struct cat_handle_data {
         cfs_list_t              chd_head;
         struct llog_handle     *chd_current_log; /* currently open log */
 	struct llog_handle	*chd_next_log; /* llog to be used next */
+	/* parallel walk in progress, which updates the catalog header */
+	struct llog_cat_par_data *chd_par;
 };
 
 static inline void logid_to_fid(struct llog_logid *id, struct lu_fid *fid)
@@ -139,6 +143,10 @@ int llog_reverse_process(const struct lu_env *env,
 			 void *data, void *catdata);
 int llog_cancel_rec(const struct lu_env *env, struct llog_handle *loghandle,
 		    int index);
+/* most records llog_cancel_recs() cancels with one header write */
+#define LLOG_CANCEL_BATCH	64
+int llog_cancel_recs(const struct lu_env *env, struct llog_handle *loghandle,
+		     int count, struct llog_cookie *cookies);
 int llog_open(const struct lu_env *env, struct llog_ctxt *ctxt,
 	      struct llog_handle **lgh, struct llog_logid *logid,
 	      char *name, enum llog_open_param open_param);
@@ -200,6 +208,9 @@ int llog_cat_process_or_fork(const struct lu_env *env,
 			     void *data, int startcat, int startidx, bool fork);
 int llog_cat_process(const struct lu_env *env, struct llog_handle *cat_llh,
 		     llog_cb_t cb, void *data, int startcat, int startidx);
+int llog_cat_process_parallel(const struct lu_env *env,
+			      struct llog_handle *cat_llh, llog_cb_t cb,
+			      void *data, int nthreads);
 int llog_cat_reverse_process(const struct lu_env *env,
 			     struct llog_handle *cat_llh, llog_cb_t cb,
 			     void *data);
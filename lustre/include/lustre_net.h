@@ -117,6 +117,13 @@
 #define DT_MAX_BRW_PAGES	(DT_MAX_BRW_SIZE >> PAGE_CACHE_SHIFT)
 #define OFD_MAX_BRW_SIZE	(1 << LNET_MTU_BITS)
 
+/**
+ * Maximum number of objects a single OST_WRITE may carry when the peer
+ * supports OBD_CONNECT_MULTIOBJ_BRW.  Each extra object costs an obd_ioobj
+ * and an obdo in the request, see osc_brw_room().
+ */
+#define PTLRPC_MAX_BRW_OBJS	16
+
 /* When PAGE_SIZE is a constant, we can check our arithmetic here with cpp! */
 #ifdef __KERNEL__
 # if ((PTLRPC_MAX_BRW_PAGES & (PTLRPC_MAX_BRW_PAGES - 1)) != 0)
@@ -672,6 +679,7 @@ struct ptlrpc_reply_state {
         unsigned long          rs_handled:1;  /* been handled yet? */
         unsigned long          rs_on_net:1;   /* reply_out_callback pending? */
         unsigned long          rs_prealloc:1; /* rs from prealloc list */
+	unsigned long	       rs_cached:1;   /* rs from the svcpt cache */
         unsigned long          rs_committed:1;/* the transaction was committed
                                                  and the rs was dispatched
                                                  by ptlrpc_commit_replies */
@@ -1700,6 +1708,91 @@ struct nrs_orr_req {
 
 /** @} ORR/TRR */
 
+/**
+ * \name deadline
+ *
+ * Deadline policy, serving requests by arrival time plus a latency target
+ * of their class of operation.
+ * @{
+ */
+
+/**
+ * Request classes of the deadline policy: one per opcode, refined for
+ * MDS_REINT by the reint operation and for LDLM_ENQUEUE by the intent.
+ */
+enum nrs_dl_class {
+	NRS_DL_CLASS_REINT	= LUSTRE_MAX_OPCODES,
+	NRS_DL_CLASS_IT_OPEN	= NRS_DL_CLASS_REINT + REINT_MAX,
+	NRS_DL_CLASS_IT_LOOKUP,
+	NRS_DL_CLASS_IT_OTHER,
+	NRS_DL_CLASS_MAX
+};
+
+/**
+ * private data structure for the deadline policy's ctl operations
+ */
+enum nrs_ctl_dl {
+	/**
+	 * Read the latency target factor of a policy instance.
+	 */
+	NRS_CTL_DL_RD_FACTOR = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	/**
+	 * Write the latency target factor of a policy instance.
+	 */
+	NRS_CTL_DL_WR_FACTOR,
+	/**
+	 * Print the statistics of a policy instance to a seq_file.
+	 */
+	NRS_CTL_DL_RD_STATS,
+};
+
+/**
+ * Private data structure for the deadline policy
+ */
+struct nrs_dl_head {
+	/**
+	 * Resource object for policy instance.
+	 */
+	struct ptlrpc_nrs_resource	dh_res;
+	/**
+	 * Queued requests, sorted by deadline.
+	 */
+	cfs_binheap_t		       *dh_binheap;
+	/**
+	 * Sequence number of requests, for FIFO among equal deadlines.
+	 */
+	__u64				dh_sequence;
+	/**
+	 * Latency target of a class, in multiples of its handling time.
+	 */
+	__u32				dh_factor;
+	/**
+	 * Moving average of the handling time of each class of request, in
+	 * microseconds; 0 until one has been handled.
+	 */
+	__u64				dh_svc_time[NRS_DL_CLASS_MAX];
+	/**
+	 * Number of requests of each class handled so far.
+	 */
+	__u64				dh_handled[NRS_DL_CLASS_MAX];
+	/**
+	 * Number of requests started after their deadline.
+	 */
+	__u64				dh_late;
+};
+
+struct nrs_dl_req {
+	/** Time the request should be started by, in microseconds. */
+	__u64			dr_deadline;
+	__u64			dr_sequence;
+	/** Time the handling of the request started, in nanoseconds. */
+	__u64			dr_start;
+	/** enum nrs_dl_class of the request. */
+	__u32			dr_class;
+};
+
+/** @} deadline */
+
 #include <lustre_nrs_tbf.h>
 
 /**
@@ -1747,6 +1840,10 @@ struct ptlrpc_nrs_request {
 		 * TBF request definition
 		 */
 		struct nrs_tbf_req	tbf;
+		/**
+		 * Deadline request definition
+		 */
+		struct nrs_dl_req	dl;
 	} nr_u;
 	/**
 	 * Externally-registering policies may want to use this to allocate
@@ -2309,6 +2406,8 @@ struct ptlrpc_bulk_desc {
 	 * encrypt iov, size is either 0 or bd_iov_count.
 	 */
 	lnet_kiov_t           *bd_enc_iov;
+	/* CPU partition of the pool bd_enc_iov pages come from */
+	int			bd_enc_cpt;
 
 	lnet_kiov_t            bd_iov[0];
 #else
@@ -2554,6 +2653,9 @@ struct ptlrpc_service {
 	struct ptlrpc_service_part	*srv_parts[0];
 };
 
+/** # seconds of request buffer usage the rqbd pool is sized from */
+#define PTLRPC_RQBD_HIST	8
+
 /**
  * Definition of PortalRPC service partition data.
  * Although a service only has one instance of it right now, but we
@@ -2610,6 +2712,19 @@ struct ptlrpc_service_part {
 	cfs_list_t			scp_req_incoming;
 	/** timeout before re-posting reqs, in tick */
 	cfs_duration_t			scp_rqbd_timeout;
+	/**
+	 * # posted request buffers the partition is sized for, from the
+	 * peak # of request buffers filled per second in the last
+	 * PTLRPC_RQBD_HIST seconds, see ptlrpc_check_rqbd_pool()
+	 */
+	int				scp_rqbd_target;
+	/** second of the last accounted request buffer */
+	time_t				scp_rqbd_period;
+	/** # request buffers filled in each of the last seconds */
+	int				scp_rqbd_hist[PTLRPC_RQBD_HIST];
+	/** # request buffers allocated and freed since the start */
+	unsigned long			scp_rqbd_nalloc;
+	unsigned long			scp_rqbd_nfree;
 	/**
 	 * all threads sleep on this. This wait-queue is signalled when new
 	 * incoming request arrives and when difficult reply has to be handled.
@@ -2682,6 +2797,18 @@ struct ptlrpc_service_part {
 	wait_queue_head_t		scp_rep_waitq;
 	/** # 'difficult' replies */
 	atomic_t			scp_nreps_difficult;
+	/**
+	 * Recycled reply states of PTLRPC_RS_CACHE_SIZE bytes, so that small
+	 * replies are not allocated and freed one at a time.
+	 */
+	spinlock_t			scp_rep_cache_lock;
+	cfs_list_t			scp_rep_cache;
+	/** # reply states in scp_rep_cache */
+	int				scp_rep_ncached;
+	/** # reply states taken from scp_rep_cache */
+	unsigned long			scp_rep_cache_hits;
+	/** # reply states allocated because scp_rep_cache was empty */
+	unsigned long			scp_rep_cache_misses;
 };
 
 #define ptlrpc_service_for_each_part(part, i, svc)			\
@@ -2738,6 +2865,21 @@ struct ptlrpcd_ctl {
          * Record the partner index to be processed next.
          */
         int                         pc_cursor;
+	/**
+	 * CPU partition the thread is bound to, -1 for ptlrpcd_rcv.
+	 */
+	int				pc_cpt;
+	/**
+	 * RPCs completed by the thread, and stolen from its partners.
+	 */
+	__u64				pc_nr_done;
+	__u64				pc_nr_stolen;
+	/**
+	 * RPCs in the set when new ones are moved into it, and time from
+	 * the queueing of an RPC to its completion in milliseconds.
+	 */
+	struct obd_histogram		pc_depth_hist;
+	struct obd_histogram		pc_latency_hist;
 #ifndef __KERNEL__
         /**
          * Async rpcs flag to make sure that ptlrpcd_check() is called only
@@ -2780,9 +2922,13 @@ enum ptlrpcd_ctl_flags {
          */
         LIOD_RECOVERY    = 1 << 3,
         /**
-         * The ptlrpcd is bound to some CPU core.
+         * The ptlrpcd is bound to its CPU partition.
          */
         LIOD_BIND        = 1 << 4,
+	/**
+	 * The ptlrpcd thread stopped after it was idle, its set is kept.
+	 */
+	LIOD_IDLE        = 1 << 5,
 };
 
 /**
@@ -2985,6 +3131,10 @@ struct ptlrpc_request *ptlrpc_prep_req_pool(struct obd_import *imp,
 void ptlrpc_req_finished(struct ptlrpc_request *request);
 void ptlrpc_req_finished_with_imp_lock(struct ptlrpc_request *request);
 struct ptlrpc_request *ptlrpc_request_addref(struct ptlrpc_request *req);
+void ptlrpc_batch_sub_prep(struct ptlrpc_request *req);
+void ptlrpc_batch_sub_complete(const struct lu_env *env,
+			       struct ptlrpc_request *req,
+			       struct lustre_msg *msg, int len, int rc);
 struct ptlrpc_bulk_desc *ptlrpc_prep_bulk_imp(struct ptlrpc_request *req,
 					      unsigned npages, unsigned max_brw,
 					      unsigned type, unsigned portal);
@@ -3111,6 +3261,10 @@ int liblustre_check_services(void *arg);
 void ptlrpc_daemonize(char *name);
 int ptlrpc_service_health_check(struct ptlrpc_service *);
 void ptlrpc_server_drop_request(struct ptlrpc_request *req);
+int ptlrpc_server_handle_batch_sub(struct ptlrpc_request *req,
+				   struct lustre_msg *msg, int msglen,
+				   __u64 xid, void *repbuf, int repsize,
+				   __u32 opc, svc_handler_t handler);
 void ptlrpc_request_change_export(struct ptlrpc_request *req,
 				  struct obd_export *export);
 
@@ -3382,6 +3536,37 @@ static inline void ptlrpc_req_drop_rs(struct ptlrpc_request *req)
         req->rq_repmsg = NULL;
 }
 
+/** Size of the header of a MDS_BATCH buffer carrying \a count messages */
+static inline int batch_buf_hdr_size(int count)
+{
+	return cfs_size_round(sizeof(struct batch_buf) +
+			      count * sizeof(struct batch_msg));
+}
+
+/**
+ * Find the \a index'th message in the MDS_BATCH buffer \a bb of \a buflen
+ * bytes. Returns NULL if that message is empty or does not fit the buffer.
+ */
+static inline struct lustre_msg *batch_buf_msg(struct batch_buf *bb,
+					       int buflen, int index,
+					       int *msglen)
+{
+	__u64 off = batch_buf_hdr_size(bb->bb_count);
+	int   i;
+
+	LASSERT(index < bb->bb_count);
+
+	for (i = 0; i < index; i++)
+		off += cfs_size_round(bb->bb_msgs[i].bm_len);
+
+	if (bb->bb_msgs[index].bm_len == 0 ||
+	    off + bb->bb_msgs[index].bm_len > buflen)
+		return NULL;
+
+	*msglen = bb->bb_msgs[index].bm_len;
+	return (struct lustre_msg *)((char *)bb + off);
+}
+
 static inline __u32 lustre_request_magic(struct ptlrpc_request *req)
 {
         return lustre_msg_get_magic(req->rq_reqmsg);
@@ -3492,27 +3677,13 @@ void ptlrpc_pinger_ir_down(void);
 /** @} */
 int ptlrpc_pinger_suppress_pings(void);
 
-/* ptlrpc daemon bind policy */
-typedef enum {
-        /* all ptlrpcd threads are free mode */
-        PDB_POLICY_NONE          = 1,
-        /* all ptlrpcd threads are bound mode */
-        PDB_POLICY_FULL          = 2,
-        /* <free1 bound1> <free2 bound2> ... <freeN boundN> */
-        PDB_POLICY_PAIR          = 3,
-        /* <free1 bound1> <bound1 free2> ... <freeN boundN> <boundN free1>,
-         * means each ptlrpcd[X] has two partners: thread[X-1] and thread[X+1].
-         * If kernel supports NUMA, pthrpcd threads are binded and
-         * grouped by NUMA node */
-        PDB_POLICY_NEIGHBOR      = 4,
-} pdb_policy_t;
-
 /* ptlrpc daemon load policy
  * It is caller's duty to specify how to push the async RPC into some ptlrpcd
- * queue, but it is not enforced, affected by "ptlrpcd_bind_policy". If it is
- * "PDB_POLICY_FULL", then the RPC will be processed by the selected ptlrpcd,
- * Otherwise, the RPC may be processed by the selected ptlrpcd or its partner,
- * depends on which is scheduled firstly, to accelerate the RPC processing. */
+ * queue, but it is not enforced: the ptlrpcd threads are per CPU partition,
+ * the RPC is queued on a thread of the partition chosen by the policy, and
+ * may be processed by any partner thread of the same partition which steals
+ * it, depends on which is scheduled firstly, to accelerate the RPC processing.
+ */
 typedef enum {
         /* on the same CPU core as the caller */
         PDL_POLICY_SAME         = 1,
@@ -3539,6 +3710,7 @@ void ptlrpcd_decref(void);
  * @{
  */
 const char* ll_opcode2str(__u32 opcode);
+const char *ll_opcode_offset2str(int offset);
 #ifdef LPROCFS
 void ptlrpc_lprocfs_register_obd(struct obd_device *obd);
 void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd);
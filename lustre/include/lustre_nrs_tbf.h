@@ -75,6 +75,16 @@ struct nrs_tbf_client {
 	__u64				 tc_depth;
 	/** Time check-point. */
 	__u64				 tc_check_time;
+	/** Ceiling of RPC rate when borrowing from ancestor rules. */
+	__u64				 tc_ceil_rate;
+	/** Time to wait for next token at ceiling rate. */
+	__u64				 tc_ceil_nsecs;
+	/** RPC token number at ceiling rate. */
+	__u64				 tc_ceil_ntoken;
+	/** Time check-point of ceiling tokens. */
+	__u64				 tc_ceil_check_time;
+	/** Earliest time the client may be served, key of the heap. */
+	__u64				 tc_deadline;
 	/** List of queued requests. */
 	cfs_list_t			 tc_list;
 	/** Node in binary heap. */
@@ -116,6 +126,26 @@ struct nrs_tbf_rule {
 	__u64				 tr_nsecs;
 	/** Token bucket depth. */
 	__u64				 tr_depth;
+	/**
+	 * RPC/s a client of this rule may reach by borrowing idle tokens
+	 * of the ancestor rules, and the most this rule lends to its
+	 * children. Equal to tr_rpc_rate unless given.
+	 */
+	__u64				 tr_ceil_rate;
+	/** Parent rule which lends its idle tokens to this rule. */
+	struct nrs_tbf_rule		*tr_parent;
+	/** Number of rules having this one as parent. */
+	atomic_t			 tr_nchildren;
+	/**
+	 * Tokens this rule lends to the clients of child rules, refilled
+	 * at tr_rpc_rate and tr_ceil_rate, and charged for every RPC sent
+	 * by a client of this rule or of a descendant rule. Protected by
+	 * scp_req_lock.
+	 */
+	__u64				 tr_ntoken;
+	__u64				 tr_check_time;
+	__u64				 tr_ceil_ntoken;
+	__u64				 tr_ceil_check_time;
 	/** List of client. */
 	cfs_list_t			 tr_cli_list;
 	/** Flags of the rule. */
@@ -240,6 +270,8 @@ struct nrs_tbf_cmd {
 	enum nrs_tbf_cmd_type	 tc_cmd;
 	char			*tc_name;
 	__u64			 tc_rpc_rate;
+	__u64			 tc_ceil_rate;
+	char			*tc_parent;
 	cfs_list_t		 tc_nids;
 	char			*tc_nids_str;
 	cfs_list_t		 tc_jobids;
@@ -191,6 +191,7 @@ extern struct req_format RQF_MDS_QUOTACTL;
 extern struct req_format RQF_QC_CALLBACK;
 extern struct req_format RQF_QUOTA_DQACQ;
 extern struct req_format RQF_MDS_SWAP_LAYOUTS;
+extern struct req_format RQF_MDS_BATCH;
 /* MDS hsm formats */
 extern struct req_format RQF_MDS_HSM_STATE_GET;
 extern struct req_format RQF_MDS_HSM_STATE_SET;
@@ -212,6 +213,8 @@ extern struct req_format RQF_OST_SYNC;
 extern struct req_format RQF_OST_DESTROY;
 extern struct req_format RQF_OST_BRW_READ;
 extern struct req_format RQF_OST_BRW_WRITE;
+extern struct req_format RQF_OST_BRW_WRITE_MULTI;
+extern struct req_format RQF_OST_DESTROY_BATCH;
 extern struct req_format RQF_OST_STATFS;
 extern struct req_format RQF_OST_SET_GRANT_INFO;
 extern struct req_format RQF_OST_GET_INFO;
@@ -327,6 +330,9 @@ extern struct req_msg_field RMF_OBD_ID;
 extern struct req_msg_field RMF_FID;
 extern struct req_msg_field RMF_NIOBUF_REMOTE;
 extern struct req_msg_field RMF_RCS;
+extern struct req_msg_field RMF_OBDO_ARRAY;
+extern struct req_msg_field RMF_CAPA_ARRAY;
+extern struct req_msg_field RMF_OST_BATCH_REC;
 extern struct req_msg_field RMF_FIEMAP_KEY;
 extern struct req_msg_field RMF_FIEMAP_VAL;
 extern struct req_msg_field RMF_OST_ID;
@@ -342,6 +348,10 @@ extern struct req_msg_field RMF_U32;
 extern struct req_msg_field RMF_OUT_UPDATE;
 extern struct req_msg_field RMF_OUT_UPDATE_REPLY;
 
+/* batched request format */
+extern struct req_msg_field RMF_BATCH_REQ;
+extern struct req_msg_field RMF_BATCH_REP;
+
 /* LFSCK format */
 extern struct req_msg_field RMF_LFSCK_REQUEST;
 extern struct req_msg_field RMF_LFSCK_REPLY;
@@ -254,6 +254,20 @@ enum {
         NUM_SYNC_ON_CANCEL_STATES
 };
 
+/* Per-CPT partition of the OSC page LRU, see osc_page.c. Pages are kept
+ * on the list of the CPU partition they were allocated from, so that LRU
+ * maintenance and reclaim stay NUMA local. */
+struct osc_lru_part {
+	client_obd_lock_t	 olp_lock;	/* page list protector */
+	cfs_list_t		 olp_list;	/* lru page list */
+	atomic_t		 olp_in_list;	/* # of pages in olp_list */
+	atomic_t		 olp_shrinkers;	/* # of threads shrinking */
+	struct client_obd	*olp_cli;
+	/* ptlrpc work for background LRU shrinking of this partition */
+	void			*olp_work;
+	int			 olp_cpt;
+};
+
 struct mdc_rpc_lock;
 struct obd_import;
 struct client_obd {
@@ -328,22 +342,25 @@ struct client_obd {
 	atomic_t		 cl_pending_r_pages;
 	__u32			 cl_max_pages_per_rpc;
 	int                      cl_max_rpcs_in_flight;
+	/* objects a write RPC may carry, 1 disables multi-object writes */
+	int			 cl_max_objs_per_rpc;
 	struct obd_histogram     cl_read_rpc_hist;
 	struct obd_histogram     cl_write_rpc_hist;
 	struct obd_histogram     cl_read_page_hist;
 	struct obd_histogram     cl_write_page_hist;
 	struct obd_histogram     cl_read_offset_hist;
 	struct obd_histogram     cl_write_offset_hist;
+	struct obd_histogram	 cl_write_obj_hist;
 
 	/* lru for osc caching pages */
 	struct cl_client_cache	*cl_cache;
 	cfs_list_t		 cl_lru_osc; /* member of cl_cache->ccc_lru */
 	atomic_t		*cl_lru_left;
 	atomic_t		 cl_lru_busy;
+	/* non-forced shrinking is disabled while this is non-zero */
 	atomic_t		 cl_lru_shrinkers;
 	atomic_t		 cl_lru_in_list;
-	cfs_list_t		 cl_lru_list; /* lru page list */
-	client_obd_lock_t	 cl_lru_list_lock; /* page list protector */
+	struct osc_lru_part	**cl_lru_parts; /* per-CPT lru page lists */
 	atomic_t		 cl_unstable_count;
 
 	/* number of in flight destroy rpcs is limited to max_rpcs_in_flight */
@@ -353,6 +370,12 @@ struct client_obd {
         struct mdc_rpc_lock     *cl_rpc_lock;
         struct mdc_rpc_lock     *cl_close_lock;
 
+	/* intent getattr requests waiting to be sent in one MDS_BATCH */
+	spinlock_t		 cl_batch_lock;
+	cfs_list_t		 cl_batch_list;
+	int			 cl_batch_count;
+	int			 cl_batch_max;
+
         /* mgc datastruct */
 	struct mutex		 cl_mgc_mutex;
 	struct local_oid_storage *cl_mgc_los;
@@ -384,7 +407,6 @@ struct client_obd {
 
 	/* ptlrpc work for writeback in ptlrpcd context */
 	void			*cl_writeback_work;
-	void			*cl_lru_work;
 	/* hash tables for osc_quota_info */
 	cfs_hash_t		*cl_quota_hash[MAXQUOTAS];
 };
@@ -1324,6 +1346,8 @@ struct md_ops {
 	int (*m_get_remote_perm)(struct obd_export *, const struct lu_fid *,
 				 struct obd_capa *, __u32,
 				 struct ptlrpc_request **);
+
+	int (*m_intent_getattr_flush)(struct obd_export *);
 };
 
 struct lsm_operations {
@@ -46,6 +46,10 @@ static inline unsigned char cksum_obd2cfs(cksum_type_t cksum_type)
 		return CFS_HASH_ALG_ADLER32;
 	case OBD_CKSUM_CRC32C:
 		return CFS_HASH_ALG_CRC32C;
+	case OBD_CKSUM_T10IP512:
+		return CFS_HASH_ALG_T10IP512;
+	case OBD_CKSUM_T10IP4K:
+		return CFS_HASH_ALG_T10IP4K;
 	default:
 		CERROR("Unknown checksum type (%x)!!!\n", cksum_type);
 		LBUG();
@@ -53,6 +57,9 @@ static inline unsigned char cksum_obd2cfs(cksum_type_t cksum_type)
 	return 0;
 }
 
+/* checksum types which are supported, but only used when asked for */
+#define OBD_CKSUM_T10_OPT_IN	(OBD_CKSUM_T10IP512 | OBD_CKSUM_T10IP4K)
+
 /* The OBD_FL_CKSUM_* flags is packed into 5 bits of o_flags, since there can
  * only be a single checksum type per RPC.
  *
@@ -90,9 +97,25 @@ static inline obd_flag cksum_type_pack(cksum_type_t cksum_type)
 			flag = OBD_FL_CKSUM_ADLER;
 		}
 	}
+	if (cksum_type & OBD_CKSUM_T10IP512) {
+		tmp = cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP512));
+		if (tmp > performance) {
+			performance = tmp;
+			flag = OBD_FL_CKSUM_T10IP512;
+		}
+	}
+	if (cksum_type & OBD_CKSUM_T10IP4K) {
+		tmp = cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP4K));
+		if (tmp > performance) {
+			performance = tmp;
+			flag = OBD_FL_CKSUM_T10IP4K;
+		}
+	}
 	if (unlikely(cksum_type && !(cksum_type & (OBD_CKSUM_CRC32C |
 						   OBD_CKSUM_CRC32 |
-						   OBD_CKSUM_ADLER))))
+						   OBD_CKSUM_ADLER |
+						   OBD_CKSUM_T10IP512 |
+						   OBD_CKSUM_T10IP4K))))
 		CWARN("unknown cksum type %x\n", cksum_type);
 
 	return flag;
@@ -105,6 +128,10 @@ static inline cksum_type_t cksum_type_unpack(obd_flag o_flags)
 		return OBD_CKSUM_CRC32C;
 	case OBD_FL_CKSUM_CRC32:
 		return OBD_CKSUM_CRC32;
+	case OBD_FL_CKSUM_T10IP512:
+		return OBD_CKSUM_T10IP512;
+	case OBD_FL_CKSUM_T10IP4K:
+		return OBD_CKSUM_T10IP4K;
 	default:
 		break;
 	}
@@ -120,15 +147,22 @@ static inline cksum_type_t cksum_types_supported_client(void)
 {
 	cksum_type_t ret = OBD_CKSUM_ADLER;
 
-	CDEBUG(D_INFO, "Crypto hash speed: crc %d, crc32c %d, adler %d\n",
+	CDEBUG(D_INFO, "Crypto hash speed: crc %d, crc32c %d, adler %d, "
+	       "t10ip512 %d, t10ip4k %d\n",
 	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_CRC32)),
 	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_CRC32C)),
-	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_ADLER)));
+	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_ADLER)),
+	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP512)),
+	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP4K)));
 
 	if (cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_CRC32C)) > 0)
 		ret |= OBD_CKSUM_CRC32C;
 	if (cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_CRC32)) > 0)
 		ret |= OBD_CKSUM_CRC32;
+	if (cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP512)) > 0)
+		ret |= OBD_CKSUM_T10IP512;
+	if (cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP4K)) > 0)
+		ret |= OBD_CKSUM_T10IP4K;
 
 	return ret;
 }
@@ -139,10 +173,13 @@ static inline cksum_type_t cksum_types_supported_server(void)
 	int	     base_speed;
 	cksum_type_t    ret = OBD_CKSUM_ADLER;
 
-	CDEBUG(D_INFO, "Crypto hash speed: crc %d, crc32c %d, adler %d\n",
+	CDEBUG(D_INFO, "Crypto hash speed: crc %d, crc32c %d, adler %d, "
+	       "t10ip512 %d, t10ip4k %d\n",
 	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_CRC32)),
 	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_CRC32C)),
-	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_ADLER)));
+	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_ADLER)),
+	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP512)),
+	       cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP4K)));
 
 	base_speed = cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_ADLER)) / 2;
 
@@ -152,6 +189,12 @@ static inline cksum_type_t cksum_types_supported_server(void)
 	if (cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_CRC32)) >=
 	    base_speed)
 		ret |= OBD_CKSUM_CRC32;
+	if (cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP512)) >=
+	    base_speed)
+		ret |= OBD_CKSUM_T10IP512;
+	if (cfs_crypto_hash_speed(cksum_obd2cfs(OBD_CKSUM_T10IP4K)) >=
+	    base_speed)
+		ret |= OBD_CKSUM_T10IP4K;
 
 	return ret;
 }
@@ -163,14 +206,20 @@ static inline cksum_type_t cksum_types_supported_server(void)
  * Currently, calling cksum_type_pack() with a mask will return the fastest
  * checksum type due to its benchmarking at libcfs module load.
  * Caution is advised, however, since what is fastest on a single client may
- * not be the fastest or most efficient algorithm on the server.  */
+ * not be the fastest or most efficient algorithm on the server.
+ *
+ * The T10-PI style types are never selected here, however fast they are: they
+ * only check 16 bits per sector, so they are used only when chosen through
+ * osc.*.checksum_type. */
 static inline cksum_type_t cksum_type_select(cksum_type_t cksum_types)
 {
-	return cksum_type_unpack(cksum_type_pack(cksum_types));
+	return cksum_type_unpack(cksum_type_pack(cksum_types &
+						 ~OBD_CKSUM_T10_OPT_IN));
 }
 
 /* Checksum algorithm names. Must be defined in the same order as the
  * OBD_CKSUM_* flags. */
-#define DECLARE_CKSUM_NAME char *cksum_name[] = {"crc32", "adler", "crc32c"}
+#define DECLARE_CKSUM_NAME char *cksum_name[] = {"crc32", "adler", "crc32c", \
+						 "t10ip512", "t10ip4k"}
 
 #endif /* __OBD_H */
@@ -2015,6 +2015,20 @@ static inline int md_intent_getattr_async(struct obd_export *exp,
         RETURN(rc);
 }
 
+/**
+ * Send the intent getattr requests queued by md_intent_getattr_async() to
+ * be batched, see OBD_CONNECT_BATCH_RPC.
+ */
+static inline int md_intent_getattr_flush(struct obd_export *exp)
+{
+	int rc;
+	ENTRY;
+	EXP_CHECK_MD_OP(exp, intent_getattr_flush);
+	EXP_MD_COUNTER_INCREMENT(exp, intent_getattr_flush);
+	rc = MDP(exp->exp_obd, intent_getattr_flush)(exp);
+	RETURN(rc);
+}
+
 static inline int md_revalidate_lock(struct obd_export *exp,
                                      struct lookup_intent *it,
                                      struct lu_fid *fid, __u64 *bits)
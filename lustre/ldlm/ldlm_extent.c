@@ -178,92 +178,138 @@ static void ldlm_extent_internal_policy_granted(struct ldlm_lock *req,
         EXIT;
 }
 
+struct ldlm_extent_expand_args {
+	struct ldlm_lock	*req;
+	struct ldlm_extent	*new_ex;
+};
+
+/* Shrink the extent to grant so that it does not overlap the waiting locks
+ * of node \a n, which overlaps it. */
+static enum interval_iter ldlm_extent_expand_waiting_cb(struct interval_node *n,
+							 void *data)
+{
+	struct ldlm_extent_expand_args *priv = data;
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct ldlm_interval *dup = node;
+	struct ldlm_lock *req = priv->req;
+	struct ldlm_extent *new_ex = priv->new_ex;
+	__u64 req_start = req->l_req_extent.start;
+	__u64 req_end = req->l_req_extent.end;
+
+	/* go over all the waiting locks with this extent */
+	do {
+		struct ldlm_lock *lock;
+		struct ldlm_extent *l_extent;
+
+		lock = cfs_list_entry(dup->li_group.next, struct ldlm_lock,
+				      l_sl_policy);
+		l_extent = &lock->l_policy_data.l_extent;
+		dup = cfs_list_entry(dup->li_wait_dup.next,
+				     struct ldlm_interval, li_wait_dup);
+
+		/* We already hit the minimum requested size, search no more */
+		if (new_ex->start == req_start && new_ex->end == req_end)
+			return INTERVAL_ITER_STOP;
+
+		/* Don't conflict with ourselves */
+		if (req == lock)
+			continue;
+
+		/* Locks are compatible, overlap doesn't matter */
+		/* Until bug 20 is fixed, try to avoid granting overlapping
+		 * locks on one client (they take a long time to cancel) */
+		if (lockmode_compat(lock->l_req_mode, req->l_req_mode) &&
+		    lock->l_export != req->l_export)
+			continue;
+
+		/* The extent to grant may have shrunk since the search
+		 * started, if lock doesn't overlap it any more, skip it. */
+		if (!ldlm_extent_overlap(l_extent, new_ex))
+			continue;
+
+		/* Locks conflicting in requested extents and we can't satisfy
+		 * both locks, so ignore it.  Either we will ping-pong this
+		 * extent (we would regardless of what extent we granted) or
+		 * lock is unused and it shouldn't limit our extent growth. */
+		if (ldlm_extent_overlap(&lock->l_req_extent,
+					&req->l_req_extent))
+			continue;
+
+		/* We grow extents downwards only as far as they don't overlap
+		 * with already-granted locks, on the assumption that clients
+		 * will be writing beyond the initial requested end and would
+		 * then need to enqueue a new lock beyond previous request.
+		 * l_req_extent->end strictly < req_start, checked above. */
+		if (l_extent->start < req_start && new_ex->start != req_start) {
+			if (l_extent->end >= req_start)
+				new_ex->start = req_start;
+			else
+				new_ex->start = min(l_extent->end + 1,
+						    req_start);
+		}
+
+		/* If we need to cancel this lock anyways because our request
+		 * overlaps the granted lock, we grow up to its requested
+		 * extent start instead of limiting this extent, assuming that
+		 * clients are writing forwards and the lock had over grown
+		 * its extent downwards before we enqueued our request. */
+		if (l_extent->end > req_end) {
+			if (l_extent->start <= req_end)
+				new_ex->end = max(lock->l_req_extent.start - 1,
+						  req_end);
+			else
+				new_ex->end = max(l_extent->start - 1,
+						  req_end);
+		}
+	} while (dup != node);
+
+	return INTERVAL_ITER_CONT;
+}
+
 /* The purpose of this function is to return:
  * - the maximum extent
  * - containing the requested extent
  * - and not overlapping existing conflicting extents outside the requested one
- */
+ *
+ * Only the waiting locks overlapping the extent are looked up, in
+ * lr_waiting_itree; the conflicting ones are counted per mode, as for the
+ * granted locks. */
 static void
 ldlm_extent_internal_policy_waiting(struct ldlm_lock *req,
                                     struct ldlm_extent *new_ex)
 {
-        cfs_list_t *tmp;
         struct ldlm_resource *res = req->l_resource;
         ldlm_mode_t req_mode = req->l_req_mode;
         __u64 req_start = req->l_req_extent.start;
-        __u64 req_end = req->l_req_extent.end;
+	struct ldlm_extent_expand_args data = { .req = req,
+						.new_ex = new_ex };
+	struct interval_node_extent ext;
         int conflicting = 0;
+	int idx;
         ENTRY;
 
         lockmode_verify(req_mode);
 
-        /* for waiting locks */
-        cfs_list_for_each(tmp, &res->lr_waiting) {
-                struct ldlm_lock *lock;
-                struct ldlm_extent *l_extent;
-
-                lock = cfs_list_entry(tmp, struct ldlm_lock, l_res_link);
-                l_extent = &lock->l_policy_data.l_extent;
-
-                /* We already hit the minimum requested size, search no more */
-                if (new_ex->start == req_start && new_ex->end == req_end) {
-                        EXIT;
-                        return;
-                }
-
-                /* Don't conflict with ourselves */
-                if (req == lock)
-                        continue;
-
-                /* Locks are compatible, overlap doesn't matter */
-                /* Until bug 20 is fixed, try to avoid granting overlapping
-                 * locks on one client (they take a long time to cancel) */
-                if (lockmode_compat(lock->l_req_mode, req_mode) &&
-                    lock->l_export != req->l_export)
-                        continue;
-
-                /* If this is a high-traffic lock, don't grow downwards at all
-                 * or grow upwards too much */
-                ++conflicting;
-                if (conflicting > 4)
-                        new_ex->start = req_start;
-
-                /* If lock doesn't overlap new_ex, skip it. */
-                if (!ldlm_extent_overlap(l_extent, new_ex))
-                        continue;
-
-                /* Locks conflicting in requested extents and we can't satisfy
-                 * both locks, so ignore it.  Either we will ping-pong this
-                 * extent (we would regardless of what extent we granted) or
-                 * lock is unused and it shouldn't limit our extent growth. */
-                if (ldlm_extent_overlap(&lock->l_req_extent,&req->l_req_extent))
-                        continue;
-
-                /* We grow extents downwards only as far as they don't overlap
-                 * with already-granted locks, on the assumption that clients
-                 * will be writing beyond the initial requested end and would
-                 * then need to enqueue a new lock beyond previous request.
-                 * l_req_extent->end strictly < req_start, checked above. */
-                if (l_extent->start < req_start && new_ex->start != req_start) {
-                        if (l_extent->end >= req_start)
-                                new_ex->start = req_start;
-                        else
-                                new_ex->start = min(l_extent->end+1, req_start);
-                }
-
-                /* If we need to cancel this lock anyways because our request
-                 * overlaps the granted lock, we grow up to its requested
-                 * extent start instead of limiting this extent, assuming that
-                 * clients are writing forwards and the lock had over grown
-                 * its extent downwards before we enqueued our request. */
-                if (l_extent->end > req_end) {
-                        if (l_extent->start <= req_end)
-                                new_ex->end = max(lock->l_req_extent.start - 1,
-                                                  req_end);
-                        else
-                                new_ex->end = max(l_extent->start - 1, req_end);
-                }
-        }
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		if (!lockmode_compat(1 << idx, req_mode))
+			conflicting += res->lr_waiting_size[idx];
+	}
+	/* Don't conflict with ourselves */
+	if (req->l_tree_node != NULL && req->l_tree_node->li_waiting &&
+	    !lockmode_compat(req_mode, req_mode))
+		conflicting--;
+
+	/* If this is a high-traffic lock, don't grow downwards at all
+	 * or grow upwards too much */
+	if (conflicting > 4)
+		new_ex->start = req_start;
+
+	if (res->lr_waiting_itree != NULL) {
+		ext.start = new_ex->start;
+		ext.end = new_ex->end;
+		interval_search(res->lr_waiting_itree, &ext,
+				ldlm_extent_expand_waiting_cb, &data);
+	}
 
         ldlm_extent_internal_policy_fixup(req, new_ex, conflicting);
         EXIT;
@@ -287,6 +333,11 @@ static void ldlm_extent_policy(struct ldlm_resource *res,
                  */
                 return;
 
+	/* lock-ahead locks are granted exactly as requested, so that the
+	 * client can hold many adjacent non-conflicting locks */
+	if (ldlm_is_no_expansion(lock))
+		return;
+
         if (lock->l_policy_data.l_extent.start == 0 &&
             lock->l_policy_data.l_extent.end == OBD_OBJECT_EOF)
                 /* fast-path whole file locks */
@@ -363,6 +414,56 @@ static enum interval_iter ldlm_extent_compat_cb(struct interval_node *n,
         RETURN(INTERVAL_ITER_CONT);
 }
 
+struct ldlm_extent_waiting_args {
+	struct ldlm_lock	*lock;
+	int			 conflict;
+};
+
+static enum interval_iter ldlm_extent_waiting_cb(struct interval_node *n,
+						 void *data)
+{
+	struct ldlm_extent_waiting_args *priv = data;
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct ldlm_interval *dup = node;
+	struct ldlm_lock *lock;
+
+	/* go over all the waiting locks with this extent */
+	do {
+		lock = cfs_list_entry(dup->li_group.next, struct ldlm_lock,
+				      l_sl_policy);
+		if (lock != priv->lock &&
+		    !lockmode_compat(lock->l_req_mode, priv->lock->l_req_mode)) {
+			priv->conflict = 1;
+			return INTERVAL_ITER_STOP;
+		}
+		dup = cfs_list_entry(dup->li_wait_dup.next,
+				     struct ldlm_interval, li_wait_dup);
+	} while (dup != node);
+
+	return INTERVAL_ITER_CONT;
+}
+
+/**
+ * Check whether any lock on the waiting queue of \a res may conflict with
+ * \a req, by looking up the waiting locks overlapping its extent. This is
+ * conservative: locks queued after \a req are taken into account as well.
+ */
+static int ldlm_extent_waiting_conflict(struct ldlm_resource *res,
+					struct ldlm_lock *req)
+{
+	struct ldlm_extent_waiting_args data = { .lock = req,
+						 .conflict = 0 };
+	struct interval_node_extent ex = { .start = req->l_req_extent.start,
+					   .end = req->l_req_extent.end };
+
+	if (res->lr_waiting_itree == NULL)
+		return 0;
+
+	interval_search(res->lr_waiting_itree, &ex, ldlm_extent_waiting_cb,
+			&data);
+	return data.conflict;
+}
+
 /**
  * Determine if the lock is compatible with all locks on the queue.
  *
@@ -456,6 +557,13 @@ ldlm_extent_compat_queue(cfs_list_t *queue, struct ldlm_lock *req,
                         }
                 }
         } else { /* for waiting queue */
+		/* nothing on the waiting queue conflicts with us, the walk
+		 * below would only find compatible or disjoint locks. Group
+		 * requests still need it to find their place in the queue */
+		if (req_mode != LCK_GROUP &&
+		    !ldlm_extent_waiting_conflict(res, req))
+			RETURN(compat);
+
                 cfs_list_for_each(tmp, queue) {
                         check_contention = 1;
 
@@ -635,7 +743,7 @@ ldlm_extent_compat_queue(cfs_list_t *queue, struct ldlm_lock *req,
 
         RETURN(compat);
 destroylock:
-        cfs_list_del_init(&req->l_res_link);
+	ldlm_resource_unlink_lock(req);
         ldlm_lock_destroy_nolock(req);
         *err = compat;
         RETURN(compat);
@@ -743,6 +851,14 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
                 ldlm_extent_policy(res, lock, flags);
                 ldlm_resource_unlink_lock(lock);
                 ldlm_grant_lock(lock, NULL);
+	} else if ((*flags & LDLM_FL_BLOCK_NOWAIT) &&
+		   ldlm_is_no_expansion(lock)) {
+		/* lock-ahead lock is only granted at once, it must never
+		 * revoke the locks it conflicts with */
+		ldlm_resource_unlink_lock(lock);
+		ldlm_lock_destroy_nolock(lock);
+		*err = -EWOULDBLOCK;
+		GOTO(out, rc = -EWOULDBLOCK);
         } else {
                 /* If either of the compat_queue()s returned failure, then we
                  * have ASTs to send and must go onto the waiting list.
@@ -861,6 +977,7 @@ void ldlm_interval_free(struct ldlm_interval *node)
         if (node) {
                 LASSERT(cfs_list_empty(&node->li_group));
                 LASSERT(!interval_is_intree(&node->li_node));
+		LASSERT(!node->li_waiting);
                 OBD_SLAB_FREE(node, ldlm_interval_slab, sizeof(*node));
         }
 }
@@ -939,6 +1056,69 @@ void ldlm_extent_add_lock(struct ldlm_resource *res,
         ldlm_resource_add_lock(res, &res->lr_granted, lock);
 }
 
+/**
+ * Index a lock put on the waiting queue of \a res in lr_waiting_itree.
+ * Group locks conflict with any other extent lock, so they are indexed
+ * as [0, EOF]. The node of a waiting lock is not shared with other locks
+ * yet, it is only merged into a policy group once granted.
+ */
+void ldlm_extent_add_waiting(struct ldlm_resource *res, struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct interval_node *found;
+
+	check_res_locked(res);
+	/* a waiting lock can't be skipped, it would be missed by
+	 * ldlm_extent_waiting_conflict() */
+	LASSERT(node != NULL);
+	if (node->li_waiting)
+		return;
+
+	LASSERT(!interval_is_intree(&node->li_node));
+	if (lock->l_req_mode == LCK_GROUP)
+		interval_set(&node->li_node, 0, OBD_OBJECT_EOF);
+	else
+		interval_set(&node->li_node, lock->l_policy_data.l_extent.start,
+			     lock->l_policy_data.l_extent.end);
+
+	CFS_INIT_LIST_HEAD(&node->li_wait_dup);
+	found = interval_insert(&node->li_node, &res->lr_waiting_itree);
+	if (found != NULL) /* the same extent is waiting already */
+		cfs_list_add_tail(&node->li_wait_dup,
+				  &to_ldlm_interval(found)->li_wait_dup);
+	node->li_waiting = 1;
+	res->lr_waiting_size[lock_mode_to_index(lock->l_req_mode)]++;
+}
+
+/** Remove a lock leaving the waiting queue from lr_waiting_itree. */
+void ldlm_extent_del_waiting(struct ldlm_resource *res, struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_interval *next;
+	struct interval_node *found;
+
+	if (node == NULL || !node->li_waiting)
+		return;
+
+	node->li_waiting = 0;
+	res->lr_waiting_size[lock_mode_to_index(lock->l_req_mode)]--;
+	if (!interval_is_intree(&node->li_node)) {
+		cfs_list_del_init(&node->li_wait_dup);
+		return;
+	}
+
+	interval_erase(&node->li_node, &res->lr_waiting_itree);
+	if (cfs_list_empty(&node->li_wait_dup))
+		return;
+
+	/* another lock with the same extent takes our place in the tree */
+	next = cfs_list_entry(node->li_wait_dup.next, struct ldlm_interval,
+			      li_wait_dup);
+	cfs_list_del_init(&node->li_wait_dup);
+	found = interval_insert(&next->li_node, &res->lr_waiting_itree);
+	LASSERT(found == NULL);
+}
+
 /** Remove cancelled lock from resource interval tree. */
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 {
@@ -947,6 +1127,7 @@ void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
         struct ldlm_interval_tree *tree;
         int idx;
 
+	ldlm_extent_del_waiting(res, lock);
         if (!node || !interval_is_intree(&node->li_node)) /* duplicate unlink */
                 return;
 
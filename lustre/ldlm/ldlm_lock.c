@@ -2076,6 +2076,20 @@ void ldlm_reprocess_all(struct ldlm_resource *res)
                 return;
         }
 
+	/* Nothing to grant, so don't take lr_lock again after the enqueue
+	 * or cancel which got us here, enqueues and cancels of the other
+	 * locks of a hot resource contend on it. The caller changed the
+	 * granted queue under lr_lock just before, so a lock queued by
+	 * another thread before that is seen here, and one queued after it
+	 * was checked against the granted queue as changed by the caller. */
+	if (cfs_list_empty(&res->lr_converting) &&
+	    cfs_list_empty(&res->lr_waiting)) {
+		lprocfs_counter_incr(ldlm_res_to_ns(res)->ns_stats,
+				     LDLM_NSS_REPROCESS_SKIP);
+		EXIT;
+		return;
+	}
+
 restart:
         lock_res(res);
         rc = ldlm_reprocess_queue(res, &res->lr_converting, &rpc_list);
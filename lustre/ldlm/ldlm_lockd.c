@@ -1294,8 +1294,12 @@ existing_lock:
                                           dlm_req->lock_desc.l_resource.lr_type,
                                           &dlm_req->lock_desc.l_policy_data,
                                           &lock->l_policy_data);
-        if (dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT)
-                lock->l_req_extent = lock->l_policy_data.l_extent;
+	if (dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT) {
+		lock->l_req_extent = lock->l_policy_data.l_extent;
+		/* kept on the lock, a waiting lock is reprocessed later */
+		if (flags & LDLM_FL_NO_EXPANSION)
+			ldlm_set_no_expansion(lock);
+	}
 
 	err = ldlm_lock_enqueue(ns, &lock, cookie, &flags);
 	if (err) {
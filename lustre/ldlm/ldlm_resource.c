@@ -190,6 +190,30 @@ static int lprocfs_ns_locks_seq_show(struct seq_file *m, void *v)
 }
 LPROC_SEQ_FOPS_RO(lprocfs_ns_locks);
 
+static int lprocfs_ns_reprocess_skipped_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace	*ns = m->private;
+	__u64			skipped;
+
+	skipped = lprocfs_stats_collector(ns->ns_stats,
+					  LDLM_NSS_REPROCESS_SKIP,
+					  LPROCFS_FIELDS_FLAGS_SUM);
+	return lprocfs_u64_seq_show(m, &skipped);
+}
+LPROC_SEQ_FOPS_RO(lprocfs_ns_reprocess_skipped);
+
+static int lprocfs_ns_resource_hash_seq_show(struct seq_file *m, void *v)
+{
+	struct ldlm_namespace *ns = m->private;
+
+	/* depth distribution over the buckets: if many resources end up in
+	 * the same bucket, their lookups and creations contend on it */
+	cfs_hash_debug_header_seq(m);
+	cfs_hash_debug_str_seq(ns->ns_rs_hash, m);
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(lprocfs_ns_resource_hash);
+
 static int lprocfs_lru_size_seq_show(struct seq_file *m, void *v)
 {
 	struct ldlm_namespace *ns = m->private;
@@ -351,6 +375,8 @@ int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 
         lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LOCKS,
                              LPROCFS_CNTR_AVGMINMAX, "locks", "locks");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_REPROCESS_SKIP, 0,
+			     "reprocess_skipped", "reprocess");
 
         lock_name[MAX_STRING_SIZE] = '\0';
 
@@ -361,6 +387,8 @@ int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 		     &lprocfs_ns_resources_fops);
 	ldlm_add_var(&lock_vars[0], ns_pde, "lock_count", ns,
 		     &lprocfs_ns_locks_fops);
+	ldlm_add_var(&lock_vars[0], ns_pde, "resource_hash", ns,
+		     &lprocfs_ns_resource_hash_fops);
 
 	if (ns_is_client(ns)) {
 		ldlm_add_var(&lock_vars[0], ns_pde, "lock_unused_count",
@@ -384,6 +412,8 @@ int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 			     &ns->ns_contended_locks, &ldlm_rw_uint_fops);
 		ldlm_add_var(&lock_vars[0], ns_pde, "max_parallel_ast",
 			     &ns->ns_max_parallel_ast, &ldlm_rw_uint_fops);
+		ldlm_add_var(&lock_vars[0], ns_pde, "reprocess_skipped", ns,
+			     &lprocfs_ns_reprocess_skipped_fops);
 	}
 	return 0;
 }
@@ -606,7 +636,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
                                          nsd->nsd_hops,
                                          CFS_HASH_DEPTH |
                                          CFS_HASH_BIGNAME |
-                                         CFS_HASH_SPIN_BKTLOCK |
+					 CFS_HASH_RW_BKTLOCK |
                                          CFS_HASH_NO_ITEMREF);
         if (ns->ns_rs_hash == NULL)
                 GOTO(out_ns, NULL);
@@ -1041,7 +1071,9 @@ static struct ldlm_resource *ldlm_resource_new(void)
 		res->lr_itree[idx].lit_size = 0;
 		res->lr_itree[idx].lit_mode = 1 << idx;
 		res->lr_itree[idx].lit_root = NULL;
+		res->lr_waiting_size[idx] = 0;
 	}
+	res->lr_waiting_itree = NULL;
 
 	atomic_set(&res->lr_refcount, 1);
 	spin_lock_init(&res->lr_lock);
@@ -1076,6 +1108,8 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
         LASSERT(ns->ns_rs_hash != NULL);
         LASSERT(name->name[0] != 0);
 
+	/* buckets are rwlocks: lookups of existing resources, which is what
+	 * most enqueues do, only take the bucket shared */
         cfs_hash_bd_get_and_lock(ns->ns_rs_hash, (void *)name, &bd, 0);
         hnode = cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
         if (hnode != NULL) {
@@ -1244,31 +1278,29 @@ EXPORT_SYMBOL(ldlm_resource_putref);
 int ldlm_resource_putref_locked(struct ldlm_resource *res)
 {
 	struct ldlm_namespace *ns = ldlm_res_to_ns(res);
+	cfs_hash_bd_t	       bd;
+	int		       rc;
 
 	LASSERT_ATOMIC_GT_LT(&res->lr_refcount, 0, LI_POISON);
 	CDEBUG(D_INFO, "putref res: %p count: %d\n",
 	       res, atomic_read(&res->lr_refcount) - 1);
 
-	if (atomic_dec_and_test(&res->lr_refcount)) {
-		cfs_hash_bd_t bd;
+	if (atomic_add_unless(&res->lr_refcount, -1, 1))
+		return 0;
 
-		cfs_hash_bd_get(ldlm_res_to_ns(res)->ns_rs_hash,
-				&res->lr_name, &bd);
-		__ldlm_resource_putref_final(&bd, res);
-		cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 1);
-		/* NB: ns_rs_hash is created with CFS_HASH_NO_ITEMREF,
-		 * so we should never be here while calling cfs_hash_del,
-		 * cfs_hash_for_each_nolock is the only case we can get
-		 * here, which is safe to release cfs_hash_bd_lock.
-		 */
-		if (ns->ns_lvbo && ns->ns_lvbo->lvbo_free)
-			ns->ns_lvbo->lvbo_free(res);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+	/* NB: ns_rs_hash is created with CFS_HASH_NO_ITEMREF,
+	 * so we should never be here while calling cfs_hash_del,
+	 * cfs_hash_for_each_nolock is the only case we can get
+	 * here, which is safe to release cfs_hash_bd_lock.
+	 * It holds the bucket shared only, so drop it and take it
+	 * exclusively to remove the resource.
+	 */
+	cfs_hash_bd_get(ns->ns_rs_hash, &res->lr_name, &bd);
+	cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 0);
+	rc = ldlm_resource_putref(res);
+	cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 0);
 
-		cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 1);
-		return 1;
-	}
-	return 0;
+	return rc;
 }
 
 /**
@@ -1289,6 +1321,8 @@ void ldlm_resource_add_lock(struct ldlm_resource *res, cfs_list_t *head,
 	LASSERT(cfs_list_empty(&lock->l_res_link));
 
 	cfs_list_add_tail(&lock->l_res_link, head);
+	if (res->lr_type == LDLM_EXTENT && head == &res->lr_waiting)
+		ldlm_extent_add_waiting(res, lock);
 }
 
 /**
@@ -1314,6 +1348,9 @@ void ldlm_resource_insert_lock_after(struct ldlm_lock *original,
         LASSERT(cfs_list_empty(&new->l_res_link));
 
         cfs_list_add(&new->l_res_link, &original->l_res_link);
+	if (res->lr_type == LDLM_EXTENT && original->l_tree_node != NULL &&
+	    original->l_tree_node->li_waiting)
+		ldlm_extent_add_waiting(res, new);
  out:;
 }
 
@@ -397,6 +397,7 @@ int ll_file_release(struct inode *inode, struct file *file)
 		if (lli->lli_clob != NULL)
 			lov_read_and_clear_async_rc(lli->lli_clob);
                 lli->lli_async_rc = 0;
+		ll_readahead_fini(inode, &fd->fd_ras);
         }
 
         rc = ll_md_close(sbi->ll_md_exp, inode, file);
@@ -2306,6 +2307,105 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Enqueue a lock-ahead lock on each extent of \a lla, see LL_IOC_LOCK_AHEAD.
+ *
+ * The locks never block on a conflicting lock, neither of this client nor on
+ * the server. They ask for no expansion, so that the locks of the writers of
+ * a shared file stay on their own extents, and the writes which follow need
+ * no lock callback. All the enqueues are sent before any reply is waited
+ * for, so that the whole request costs about one round trip.
+ * The result of each enqueue is returned in lle_result: 0 if the lock is
+ * granted, and left in the cache for the IO which follows, -EWOULDBLOCK if
+ * it conflicts with another lock, which is left alone.
+ */
+static int ll_lock_ahead(struct inode *inode, struct lu_lock_ahead *lla)
+{
+	struct cl_object	*clob = ll_i2info(inode)->lli_clob;
+	struct cl_lock_descr	*descr;
+	struct cl_lock		**locks;
+	struct cl_lock		*lock;
+	struct lu_env		*env;
+	struct cl_io		*io;
+	int			 refcheck;
+	int			 rc;
+	__u32			 i;
+	ENTRY;
+
+	if (!ll_i2info(inode)->lli_has_smd)
+		RETURN(-ENODATA);
+
+	OBD_ALLOC_LARGE(locks, lla->lla_extent_count * sizeof(*locks));
+	if (locks == NULL)
+		RETURN(-ENOMEM);
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		GOTO(out_locks, rc = PTR_ERR(env));
+
+	io = ccc_env_thread_io(env);
+	io->ci_obj = clob;
+	io->ci_ignore_layout = 1;
+
+	rc = cl_io_init(env, io, CIT_MISC, clob);
+	if (rc > 0) {
+		/* released file, there is no object to lock */
+		rc = -ENODATA;
+	} else if (rc == 0) {
+		descr = &ccc_env_info(env)->cti_descr;
+		for (i = 0; i < lla->lla_extent_count; i++) {
+			struct lu_lock_ahead_extent *lle = &lla->lla_extents[i];
+
+			memset(descr, 0, sizeof(*descr));
+			descr->cld_obj = clob;
+			descr->cld_mode = lla->lla_mode == LLA_WRITE ?
+					  CLM_WRITE : CLM_READ;
+			descr->cld_start = cl_index(clob, lle->lle_start);
+			descr->cld_end = cl_index(clob, lle->lle_end);
+			descr->cld_enq_flags = CEF_MUST | CEF_NONBLOCK |
+					       CEF_LOCK_NO_EXPAND;
+
+			lock = cl_lock_hold(env, io, descr, "lockahead", lle);
+			if (IS_ERR(lock)) {
+				lle->lle_result = PTR_ERR(lock);
+				continue;
+			}
+
+			/* CEF_ASYNC and CEF_AGL are passed to the enqueue
+			 * only, not in the descriptor: they let lov return
+			 * without waiting for any sub-lock, while osc still
+			 * sends a plain, non-glimpse, enqueue. */
+			lle->lle_result = cl_enqueue(env, lock, io,
+						     CEF_ASYNC | CEF_AGL);
+			if (lle->lle_result == 0)
+				locks[i] = lock;
+			else
+				cl_lock_release(env, lock, "lockahead", lle);
+		}
+
+		for (i = 0; i < lla->lla_extent_count; i++) {
+			struct lu_lock_ahead_extent *lle = &lla->lla_extents[i];
+
+			lock = locks[i];
+			if (lock != NULL) {
+				lle->lle_result = cl_wait(env, lock);
+				if (lle->lle_result == 0)
+					cl_unuse(env, lock);
+				cl_lock_release(env, lock, "lockahead", lle);
+			}
+			CDEBUG(D_DLMTRACE, DFID": lock-ahead %s ["LPU64", "
+			       LPU64"]: rc = %d\n", PFID(ll_inode2fid(inode)),
+			       lla->lla_mode == LLA_WRITE ? "write" : "read",
+			       lle->lle_start, lle->lle_end, lle->lle_result);
+		}
+	}
+	cl_io_fini(env, io);
+	cl_env_put(env, &refcheck);
+out_locks:
+	OBD_FREE_LARGE(locks, lla->lla_extent_count * sizeof(*locks));
+	RETURN(rc);
+}
+
 static long
 ll_file_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
@@ -2612,6 +2712,48 @@ ll_file_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		OBD_FREE_PTR(hui);
 		RETURN(rc);
 	}
+	case LL_IOC_LOCK_AHEAD: {
+		struct lu_lock_ahead	 hdr;
+		struct lu_lock_ahead	*lla;
+		int			 size;
+		__u32			 i;
+
+		if (copy_from_user(&hdr, (void *)arg, sizeof(hdr)))
+			RETURN(-EFAULT);
+
+		if (hdr.lla_extent_count == 0 ||
+		    hdr.lla_extent_count > LLA_MAX_EXTENTS ||
+		    (hdr.lla_mode != LLA_READ && hdr.lla_mode != LLA_WRITE))
+			RETURN(-EINVAL);
+
+		if (hdr.lla_mode == LLA_WRITE && !(file->f_mode & FMODE_WRITE))
+			RETURN(-EBADF);
+
+		size = sizeof(hdr) +
+		       hdr.lla_extent_count * sizeof(hdr.lla_extents[0]);
+		OBD_ALLOC_LARGE(lla, size);
+		if (lla == NULL)
+			RETURN(-ENOMEM);
+
+		if (copy_from_user(lla, (void *)arg, size))
+			GOTO(out_lla, rc = -EFAULT);
+
+		/* the header may have changed under us */
+		lla->lla_mode = hdr.lla_mode;
+		lla->lla_extent_count = hdr.lla_extent_count;
+		for (i = 0; i < lla->lla_extent_count; i++) {
+			if (lla->lla_extents[i].lle_start >
+			    lla->lla_extents[i].lle_end)
+				GOTO(out_lla, rc = -EINVAL);
+		}
+
+		rc = ll_lock_ahead(inode, lla);
+		if (rc == 0 && copy_to_user((void *)arg, lla, size))
+			rc = -EFAULT;
+out_lla:
+		OBD_FREE_LARGE(lla, size);
+		RETURN(rc);
+	}
 
 	default: {
 		int err;
@@ -344,14 +344,25 @@ enum ra_stat {
         RA_STAT_MAX_IN_FLIGHT,
         RA_STAT_WRONG_GRAB_PAGE,
 	RA_STAT_FAILED_REACH_END,
+	RA_STAT_STREAM_RESUMED,
+	RA_STAT_STREAM_EVICTED,
+	RA_STAT_REVERSE,
+	RA_STAT_ASYNC,
 	_NR_RA_STAT,
 };
 
+/* maximum number of read streams tracked per file descriptor */
+#define LL_RA_STREAMS_MAX		8
+#define SBI_DEFAULT_READAHEAD_STREAMS	4
+
 struct ll_ra_info {
 	atomic_t	ra_cur_pages;
 	unsigned long	ra_max_pages;
 	unsigned long	ra_max_pages_per_file;
 	unsigned long	ra_max_read_ahead_whole_pages;
+	unsigned int	ra_max_streams;
+	/* build read-ahead windows beyond the current read in background */
+	unsigned int	ra_async:1;
 };
 
 /* ra_io_arg will be filled in the beginning of ll_readahead with
@@ -481,13 +492,25 @@ struct eacl_table {
 	cfs_list_t	et_entries[EE_HASHES];
 };
 
+/* read stream that was evicted or closed, see llite.*.read_ahead_streams */
+#define LL_RA_STREAM_HIST_MAX	32
+struct ll_ra_stream_info {
+	struct lu_fid	rsi_fid;
+	unsigned long	rsi_start;
+	unsigned long	rsi_end;
+	unsigned long	rsi_hits;
+	unsigned long	rsi_misses;
+	int		rsi_reverse;
+};
+
 struct ll_sb_info {
 	cfs_list_t		  ll_list;
 	/* this protects pglist and ra_info.  It isn't safe to
 	 * grab from interrupt contexts */
 	spinlock_t		  ll_lock;
 	spinlock_t		  ll_pp_extent_lock; /* pp_extent entry*/
-	spinlock_t		  ll_process_lock; /* ll_rw_process_info */
+	spinlock_t		  ll_process_lock; /* ll_rw_process_info and
+						    * ll_ra_stream_info */
         struct obd_uuid           ll_sb_uuid;
         struct obd_export        *ll_md_exp;
         struct obd_export        *ll_dt_exp;
@@ -514,6 +537,9 @@ struct ll_sb_info {
         struct lprocfs_stats     *ll_ra_stats;
 
         struct ll_ra_info         ll_ra_info;
+	/* the last LL_RA_STREAM_HIST_MAX read streams which were done with */
+	struct ll_ra_stream_info  ll_ra_stream_info[LL_RA_STREAM_HIST_MAX];
+	unsigned int		  ll_ra_stream_count;
         unsigned int              ll_namelen;
         struct file_operations   *ll_fop;
 
@@ -558,6 +584,30 @@ struct ll_ra_read {
         cfs_list_t          lrr_linkage;
 };
 
+/*
+ * read-ahead state of a read stream parked in ll_readahead_state::ras_streams,
+ * see the fields with the same names in ll_readahead_state.
+ */
+struct ll_ra_stream {
+	/* ras_stream_clock value when the stream was parked, 0 if unused */
+	unsigned long	rst_stamp;
+	unsigned long	rst_last_readpage;
+	unsigned long	rst_consecutive_pages;
+	unsigned long	rst_consecutive_requests;
+	unsigned long	rst_window_start;
+	unsigned long	rst_window_len;
+	unsigned long	rst_next_readahead;
+	unsigned long	rst_stride_length;
+	unsigned long	rst_stride_pages;
+	pgoff_t		rst_stride_offset;
+	unsigned long	rst_consecutive_stride_requests;
+	unsigned long	rst_last_request;
+	unsigned long	rst_consecutive_reverse;
+	unsigned long	rst_start;
+	unsigned long	rst_hits;
+	unsigned long	rst_misses;
+};
+
 /*
  * per file-descriptor read-ahead data.
  */
@@ -642,6 +692,35 @@ struct ll_readahead_state {
          * stride read-ahead will be enable
          */
         unsigned long   ras_consecutive_stride_requests;
+	/*
+	 * index of the first page missed by the current read request, and
+	 * the number of consecutive requests that each started right before
+	 * the previous one. Only more than 2 consecutive backward requests
+	 * enable reverse read-ahead.
+	 */
+	unsigned long	ras_last_request;
+	unsigned long	ras_consecutive_reverse;
+	/*
+	 * Read streams that were interrupted by an access to another part of
+	 * the file, so that several interleaved sequential, stride or reverse
+	 * readers sharing this descriptor each keep their own window instead
+	 * of resetting each other's. Only ll_ra_info::ra_max_streams entries
+	 * are used, and the least recently parked one is recycled first.
+	 */
+	unsigned long		ras_stream_clock;
+	struct ll_ra_stream	ras_streams[LL_RA_STREAMS_MAX];
+	/*
+	 * first page, page cache hits and misses of the current stream, kept
+	 * in ll_sb_info::ll_ra_stream_info once the stream is done with
+	 */
+	unsigned long		ras_stream_start;
+	unsigned long		ras_stream_hits;
+	unsigned long		ras_stream_misses;
+	/*
+	 * set while a read-ahead window of this descriptor is being built
+	 * by an asynchronous read-ahead scheduler, protected by ->ras_lock.
+	 */
+	unsigned int		ras_async_pending:1;
 };
 
 extern struct kmem_cache *ll_file_data_slab;
@@ -747,9 +826,12 @@ int ll_writepage(struct page *page, struct writeback_control *wbc);
 int ll_writepages(struct address_space *, struct writeback_control *wbc);
 int ll_readpage(struct file *file, struct page *page);
 void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras);
+void ll_readahead_fini(struct inode *inode, struct ll_readahead_state *ras);
 int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		 struct cl_page_list *queue, struct ll_readahead_state *ras,
-		 bool hit);
+		 bool hit, struct file *file);
+int ll_ra_async_init(void);
+void ll_ra_async_fini(void);
 int vvp_io_write_commit(const struct lu_env *env, struct cl_io *io);
 struct ll_cl_context *ll_cl_init(struct file *file, struct page *vmpage);
 void ll_cl_fini(struct ll_cl_context *lcc);
@@ -375,6 +375,112 @@ ll_max_read_ahead_whole_mb_seq_write(struct file *file, const char *buffer,
 }
 LPROC_SEQ_FOPS(ll_max_read_ahead_whole_mb);
 
+static int ll_max_read_ahead_streams_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	return seq_printf(m, "%u\n", sbi->ll_ra_info.ra_max_streams);
+}
+
+static ssize_t
+ll_max_read_ahead_streams_seq_write(struct file *file, const char *buffer,
+				    size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ll_sb_info *sbi = ll_s2sbi((struct super_block *)m->private);
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > LL_RA_STREAMS_MAX) {
+		CERROR("Bad max_read_ahead_streams value %d. Valid values are "
+		       "in the range [0, %d]\n", val, LL_RA_STREAMS_MAX);
+		return -ERANGE;
+	}
+
+	sbi->ll_ra_info.ra_max_streams = val;
+	return count;
+}
+LPROC_SEQ_FOPS(ll_max_read_ahead_streams);
+
+static int ll_read_ahead_streams_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+	struct ll_ra_stream_info *rsi;
+	struct timeval now;
+	char fid[FID_LEN + 1];
+	unsigned int i, count;
+
+	do_gettimeofday(&now);
+	seq_printf(m, "snapshot_time:         %lu.%lu (secs.usecs)\n",
+		   now.tv_sec, now.tv_usec);
+	seq_printf(m, "%-30s %3s %14s %14s %10s %10s\n", "FID", "DIR",
+		   "FIRST PAGE", "LAST PAGE", "HITS", "MISSES");
+
+	/* oldest first */
+	spin_lock(&sbi->ll_process_lock);
+	count = min_t(unsigned int, sbi->ll_ra_stream_count,
+		      LL_RA_STREAM_HIST_MAX);
+	for (i = sbi->ll_ra_stream_count - count;
+	     i != sbi->ll_ra_stream_count; i++) {
+		rsi = &sbi->ll_ra_stream_info[i % LL_RA_STREAM_HIST_MAX];
+		snprintf(fid, sizeof(fid), DFID, PFID(&rsi->rsi_fid));
+		seq_printf(m, "%-30s %3s %14lu %14lu %10lu %10lu\n",
+			   fid, rsi->rsi_reverse ? "bwd" : "fwd",
+			   rsi->rsi_start, rsi->rsi_end,
+			   rsi->rsi_hits, rsi->rsi_misses);
+	}
+	spin_unlock(&sbi->ll_process_lock);
+
+	return 0;
+}
+
+/* writing anything clears the history */
+static ssize_t
+ll_read_ahead_streams_seq_write(struct file *file, const char *buffer,
+				size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ll_sb_info *sbi = ll_s2sbi((struct super_block *)m->private);
+
+	spin_lock(&sbi->ll_process_lock);
+	sbi->ll_ra_stream_count = 0;
+	memset(sbi->ll_ra_stream_info, 0, sizeof(sbi->ll_ra_stream_info));
+	spin_unlock(&sbi->ll_process_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(ll_read_ahead_streams);
+
+static int ll_read_ahead_async_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	return seq_printf(m, "%u\n", sbi->ll_ra_info.ra_async);
+}
+
+static ssize_t
+ll_read_ahead_async_seq_write(struct file *file, const char *buffer,
+			      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ll_sb_info *sbi = ll_s2sbi((struct super_block *)m->private);
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	sbi->ll_ra_info.ra_async = !!val;
+	return count;
+}
+LPROC_SEQ_FOPS(ll_read_ahead_async);
+
 static int ll_max_cached_mb_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block     *sb    = m->private;
@@ -858,6 +964,12 @@ struct lprocfs_seq_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_max_readahead_per_file_mb_fops	},
 	{ .name	=	"max_read_ahead_whole_mb",
 	  .fops	=	&ll_max_read_ahead_whole_mb_fops	},
+	{ .name	=	"max_read_ahead_streams",
+	  .fops	=	&ll_max_read_ahead_streams_fops		},
+	{ .name	=	"read_ahead_streams",
+	  .fops	=	&ll_read_ahead_streams_fops		},
+	{ .name	=	"read_ahead_async",
+	  .fops	=	&ll_read_ahead_async_fops		},
 	{ .name	=	"max_cached_mb",
 	  .fops	=	&ll_max_cached_mb_fops			},
 	{ .name	=	"checksum_pages",
@@ -981,7 +1093,11 @@ static const char *ra_stat_string[] = {
 	[RA_STAT_EOF] = "read-ahead to EOF",
 	[RA_STAT_MAX_IN_FLIGHT] = "hit max r-a issue",
 	[RA_STAT_WRONG_GRAB_PAGE] = "wrong page from grab_cache_page",
-	[RA_STAT_FAILED_REACH_END] = "failed to reach end"
+	[RA_STAT_FAILED_REACH_END] = "failed to reach end",
+	[RA_STAT_STREAM_RESUMED] = "read stream resumed",
+	[RA_STAT_STREAM_EVICTED] = "read stream evicted",
+	[RA_STAT_REVERSE] = "reverse read-ahead",
+	[RA_STAT_ASYNC] = "async read-ahead"
 };
 
 LPROC_SEQ_FOPS_RO_TYPE(llite, name);
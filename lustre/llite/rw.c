@@ -444,6 +444,12 @@ static inline int stride_io_mode(struct ll_readahead_state *ras)
 {
         return ras->ras_consecutive_stride_requests > 1;
 }
+
+static inline int reverse_io_mode(struct ll_readahead_state *ras)
+{
+	return ras->ras_consecutive_reverse > 1;
+}
+
 /* The function calculates how much pages will be read in
  * [off, off + length], in such stride IO area,
  * stride_offset = st_off, stride_lengh = st_len,
@@ -573,9 +579,196 @@ static int ll_read_ahead_pages(const struct lu_env *env,
         return count;
 }
 
+/* per-CPT schedulers running asynchronous read-ahead */
+static struct cfs_wi_sched **ll_ra_scheds;
+
+struct ll_readahead_work {
+	cfs_workitem_t		 lrw_wi;
+	struct cfs_wi_sched	*lrw_sched;
+	/* holds a reference on the file, and thus on its fd_ras */
+	struct file		*lrw_file;
+	struct ra_io_arg	 lrw_ria;
+};
+
+static int ll_readahead_work_handler(cfs_workitem_t *wi)
+{
+	struct ll_readahead_work  *work = wi->wi_data;
+	struct file		  *file = work->lrw_file;
+	struct inode		  *inode = file->f_dentry->d_inode;
+	struct ll_sb_info	  *sbi = ll_i2sbi(inode);
+	struct ll_readahead_state *ras = ll_ras_get(file);
+	struct ra_io_arg	  *ria = &work->lrw_ria;
+	unsigned long		   ra_end = ria->ria_start;
+	unsigned long		   reserved, len;
+	struct cl_lock_descr	  *descr;
+	struct cl_2queue	  *queue;
+	struct cl_lock		  *lock;
+	struct lu_env		  *env;
+	struct cl_io		  *io;
+	int			   refcheck;
+	int			   rc;
+	ENTRY;
+
+	env = cl_env_get(&refcheck);
+	if (IS_ERR(env))
+		GOTO(out, rc = PTR_ERR(env));
+
+	io = ccc_env_thread_io(env);
+	io->ci_obj = ll_i2info(inode)->lli_clob;
+	io->ci_ignore_layout = 1;
+	rc = cl_io_init(env, io, CIT_MISC, io->ci_obj);
+	if (rc == 0) {
+		/* A CIT_MISC io cannot go through cl_io_lock(), so hold a read
+		 * lock on the window for as long as its pages are read, as the
+		 * reader's CIT_READ io does. Never wait for a conflicting
+		 * writer: the reader reads these pages itself then. */
+		descr = &ccc_env_info(env)->cti_descr;
+		memset(descr, 0, sizeof(*descr));
+		descr->cld_obj = io->ci_obj;
+		descr->cld_mode = CLM_READ;
+		descr->cld_start = ria->ria_start;
+		descr->cld_end = ria->ria_end;
+		descr->cld_enq_flags = CEF_NONBLOCK;
+		lock = cl_lock_request(env, io, descr, "readahead", current);
+		if (IS_ERR(lock))
+			rc = PTR_ERR(lock);
+	}
+	if (rc == 0) {
+		queue = &io->ci_queue;
+		cl_2queue_init(queue);
+
+		len = ria_page_count(ria);
+		reserved = ll_ra_count_get(sbi, ria, len, 0);
+		if (reserved < len)
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_MAX_IN_FLIGHT);
+
+		ll_read_ahead_pages(env, io, &queue->c2_qin, ria, &reserved,
+				    &ra_end);
+		if (reserved != 0)
+			ll_ra_count_put(sbi, reserved);
+
+		if (queue->c2_qin.pl_nr > 0)
+			rc = cl_io_submit_rw(env, io, CRT_READ, queue);
+		cl_page_list_disown(env, io, &queue->c2_qin);
+		cl_2queue_fini(env, queue);
+
+		cl_unuse(env, lock);
+		cl_lock_release(env, lock, "readahead", current);
+	}
+	cl_io_fini(env, io);
+	cl_env_put(env, &refcheck);
+	EXIT;
+out:
+	if (rc != 0)
+		CDEBUG(D_READA, DFID": async read-ahead %lu/%lu failed: %d\n",
+		       PFID(ll_inode2fid(inode)), ria->ria_start,
+		       ria->ria_end, rc);
+
+	/* let the reader issue what could not be read here, as in
+	 * ll_readahead() */
+	spin_lock(&ras->ras_lock);
+	if (ra_end != ria->ria_end + 1 && ra_end < ras->ras_next_readahead &&
+	    index_in_window(ra_end, ras->ras_window_start, 0,
+			    ras->ras_window_len))
+		ras->ras_next_readahead = ra_end;
+	ras->ras_async_pending = 0;
+	spin_unlock(&ras->ras_lock);
+
+	cfs_wi_exit(work->lrw_sched, wi);
+	fput(file);
+	OBD_FREE_PTR(work);
+
+	/* the workitem is freed */
+	return 1;
+}
+
+/**
+ * Hands the read-ahead window described by \a ria to the read-ahead
+ * scheduler of the current CPT, so that it is built and sent while the
+ * reader goes on consuming the pages read ahead previously.
+ *
+ * \retval 0 the window is read asynchronously
+ * \retval -ve the caller has to read it ahead itself
+ */
+static int ll_readahead_async(struct file *file, struct ra_io_arg *ria)
+{
+	struct ll_readahead_work *work;
+	int cpt;
+
+	if (ll_ra_scheds == NULL)
+		return -EAGAIN;
+
+	OBD_ALLOC_PTR(work);
+	if (work == NULL)
+		return -ENOMEM;
+
+	cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	work->lrw_sched = ll_ra_scheds[cpt];
+	get_file(file);
+	work->lrw_file = file;
+	work->lrw_ria = *ria;
+
+	cfs_wi_init(&work->lrw_wi, work, ll_readahead_work_handler);
+	cfs_wi_schedule(work->lrw_sched, &work->lrw_wi);
+	return 0;
+}
+
+int ll_ra_async_init(void)
+{
+	int nscheds = cfs_cpt_number(cfs_cpt_table);
+	int rc;
+	int i;
+
+	OBD_ALLOC(ll_ra_scheds, nscheds * sizeof(ll_ra_scheds[0]));
+	if (ll_ra_scheds == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < nscheds; i++) {
+		int nthrs = max(cfs_cpt_weight(cfs_cpt_table, i) / 2, 1);
+
+		rc = cfs_wi_sched_create("ll_ra", cfs_cpt_table, i, nthrs,
+					 &ll_ra_scheds[i]);
+		if (rc != 0) {
+			CERROR("Failed to create read-ahead scheduler for "
+			       "CPT %d: rc = %d\n", i, rc);
+			ll_ra_async_fini();
+			return rc;
+		}
+	}
+	return 0;
+}
+
+void ll_ra_async_fini(void)
+{
+	int nscheds = cfs_cpt_number(cfs_cpt_table);
+	int i;
+
+	if (ll_ra_scheds == NULL)
+		return;
+
+	for (i = 0; i < nscheds; i++) {
+		if (ll_ra_scheds[i] != NULL)
+			cfs_wi_sched_destroy(ll_ra_scheds[i]);
+	}
+	OBD_FREE(ll_ra_scheds, nscheds * sizeof(ll_ra_scheds[0]));
+	ll_ra_scheds = NULL;
+}
+
+/*
+ * Asynchronous read-ahead of the next window starts once fewer pages than
+ * this are left read ahead of the reader: a quarter of the window, and at
+ * least one RPC.
+ */
+static unsigned long ras_async_watermark(struct inode *inode,
+					 struct ll_readahead_state *ras)
+{
+	return max_t(unsigned long, ras->ras_window_len / 4,
+		     RAS_INCREASE_STEP(inode));
+}
+
 int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		 struct cl_page_list *queue, struct ll_readahead_state *ras,
-		 bool hit)
+		 bool hit, struct file *file)
 {
 	struct vvp_io *vio = vvp_env_io(env);
 	struct vvp_thread_info *vti = vvp_env_info(env);
@@ -586,6 +779,7 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
 	struct ll_ra_read *bead;
 	struct ra_io_arg *ria = &vti->vti_ria;
 	struct cl_object *clob;
+	bool async = false;
 	int ret = 0;
 	__u64 kms;
 	ENTRY;
@@ -613,6 +807,26 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
         else
                 bead = NULL;
 
+	/* While the reader consumes read-ahead pages, the next window is
+	 * left alone until the pages read ahead of the reader drop below the
+	 * low-water mark, and then built in the background by the read-ahead
+	 * scheduler. Only one window per descriptor is read asynchronously at
+	 * a time, the reader only reads ahead itself if it catches up. */
+	if (hit && bead != NULL && ll_i2sbi(inode)->ll_ra_info.ra_async &&
+	    !stride_io_mode(ras) && !reverse_io_mode(ras)) {
+		unsigned long ahead = 0;
+
+		if (ras->ras_next_readahead > ras->ras_last_readpage + 1)
+			ahead = ras->ras_next_readahead -
+				ras->ras_last_readpage - 1;
+		if (ahead > 0 && (ras->ras_async_pending ||
+				  ahead > ras_async_watermark(inode, ras))) {
+			spin_unlock(&ras->ras_lock);
+			RETURN(0);
+		}
+		async = !ras->ras_async_pending;
+	}
+
         /* Enlarge the RA window to encompass the full read */
         if (bead != NULL && ras->ras_window_start + ras->ras_window_len <
             bead->lrr_start + bead->lrr_count) {
@@ -670,6 +884,24 @@ int ll_readahead(const struct lu_env *env, struct cl_io *io,
 		RETURN(0);
 	}
 
+	/* nobody waits for a window entirely beyond the current read */
+	if (async && ria->ria_start >= bead->lrr_start + bead->lrr_count) {
+		spin_lock(&ras->ras_lock);
+		async = !ras->ras_async_pending;
+		ras->ras_async_pending = 1;
+		spin_unlock(&ras->ras_lock);
+
+		if (async) {
+			if (ll_readahead_async(file, ria) == 0) {
+				ll_ra_stats_inc(inode, RA_STAT_ASYNC);
+				RETURN(0);
+			}
+			spin_lock(&ras->ras_lock);
+			ras->ras_async_pending = 0;
+			spin_unlock(&ras->ras_lock);
+		}
+	}
+
 	CDEBUG(D_READA, DFID": ria: %lu/%lu, bead: %lu/%lu, hit: %d\n",
 	       PFID(lu_object_fid(&clob->co_lu)),
 	       ria->ria_start, ria->ria_end,
@@ -761,9 +993,192 @@ void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
 	spin_lock_init(&ras->ras_lock);
 	ras_reset(inode, ras, 0);
 	ras->ras_requests = 0;
+	ras->ras_last_request = 0;
+	ras->ras_consecutive_reverse = 0;
+	ras->ras_stream_clock = 0;
+	ras->ras_async_pending = 0;
+	ras->ras_stream_start = 0;
+	ras->ras_stream_hits = 0;
+	ras->ras_stream_misses = 0;
+	memset(ras->ras_streams, 0, sizeof(ras->ras_streams));
 	CFS_INIT_LIST_HEAD(&ras->ras_read_beads);
 }
 
+/* Keep the statistics of a read stream that is done with in the history
+ * shown by llite.*.read_ahead_streams */
+static void ras_stream_retire(struct ll_sb_info *sbi, struct inode *inode,
+			      const struct ll_ra_stream *rst)
+{
+	struct ll_ra_stream_info *rsi;
+
+	if (rst->rst_hits + rst->rst_misses == 0)
+		return;
+
+	spin_lock(&sbi->ll_process_lock);
+	rsi = &sbi->ll_ra_stream_info[sbi->ll_ra_stream_count++ %
+				      LL_RA_STREAM_HIST_MAX];
+	rsi->rsi_fid = *ll_inode2fid(inode);
+	rsi->rsi_start = rst->rst_start;
+	rsi->rsi_end = rst->rst_last_readpage;
+	rsi->rsi_hits = rst->rst_hits;
+	rsi->rsi_misses = rst->rst_misses;
+	rsi->rsi_reverse = rst->rst_consecutive_reverse > 1;
+	spin_unlock(&sbi->ll_process_lock);
+}
+
+/* called with the ras_lock held */
+static void ras_stream_save(struct ll_readahead_state *ras,
+			    struct ll_ra_stream *rst)
+{
+	rst->rst_stamp = ++ras->ras_stream_clock;
+	rst->rst_last_readpage = ras->ras_last_readpage;
+	rst->rst_consecutive_pages = ras->ras_consecutive_pages;
+	rst->rst_consecutive_requests = ras->ras_consecutive_requests;
+	rst->rst_window_start = ras->ras_window_start;
+	rst->rst_window_len = ras->ras_window_len;
+	rst->rst_next_readahead = ras->ras_next_readahead;
+	rst->rst_stride_length = ras->ras_stride_length;
+	rst->rst_stride_pages = ras->ras_stride_pages;
+	rst->rst_stride_offset = ras->ras_stride_offset;
+	rst->rst_consecutive_stride_requests =
+				ras->ras_consecutive_stride_requests;
+	rst->rst_last_request = ras->ras_last_request;
+	rst->rst_consecutive_reverse = ras->ras_consecutive_reverse;
+	rst->rst_start = ras->ras_stream_start;
+	rst->rst_hits = ras->ras_stream_hits;
+	rst->rst_misses = ras->ras_stream_misses;
+}
+
+/* called with the ras_lock held */
+static void ras_stream_load(struct ll_readahead_state *ras,
+			    const struct ll_ra_stream *rst)
+{
+	ras->ras_last_readpage = rst->rst_last_readpage;
+	ras->ras_consecutive_pages = rst->rst_consecutive_pages;
+	ras->ras_consecutive_requests = rst->rst_consecutive_requests;
+	ras->ras_window_start = rst->rst_window_start;
+	ras->ras_window_len = rst->rst_window_len;
+	ras->ras_next_readahead = rst->rst_next_readahead;
+	ras->ras_stride_length = rst->rst_stride_length;
+	ras->ras_stride_pages = rst->rst_stride_pages;
+	ras->ras_stride_offset = rst->rst_stride_offset;
+	ras->ras_consecutive_stride_requests =
+				rst->rst_consecutive_stride_requests;
+	ras->ras_last_request = rst->rst_last_request;
+	ras->ras_consecutive_reverse = rst->rst_consecutive_reverse;
+	ras->ras_stream_start = rst->rst_start;
+	ras->ras_stream_hits = rst->rst_hits;
+	ras->ras_stream_misses = rst->rst_misses;
+}
+
+/* The file descriptor is closed, record the statistics of all its streams */
+void ll_readahead_fini(struct inode *inode, struct ll_readahead_state *ras)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_ra_stream rst;
+	int i;
+
+	spin_lock(&ras->ras_lock);
+	ras_stream_save(ras, &rst);
+	ras_stream_retire(sbi, inode, &rst);
+	for (i = 0; i < LL_RA_STREAMS_MAX; i++) {
+		if (ras->ras_streams[i].rst_stamp != 0)
+			ras_stream_retire(sbi, inode, &ras->ras_streams[i]);
+	}
+	spin_unlock(&ras->ras_lock);
+}
+
+/*
+ * Check whether a read request starting at \a index ends right before the
+ * start of the previous request, i.e. the file is being read backward.  The
+ * new request is assumed to be as long as the previous one.
+ */
+static int ras_reverse_step(unsigned long last_request,
+			    unsigned long last_readpage, unsigned long index)
+{
+	if (index >= last_request || last_readpage < last_request)
+		return 0;
+
+	return index_in_window(index + last_readpage - last_request + 1,
+			       last_request, 8, 8);
+}
+
+/*
+ * The current stream is left by an access to some distant part of the file.
+ * Park it so that it can be resumed later, recycling the least recently
+ * parked slot. Called with the ras_lock held.
+ */
+static void ras_stream_park(struct ll_sb_info *sbi, struct inode *inode,
+			    struct ll_readahead_state *ras)
+{
+	unsigned int nr = min_t(unsigned int, sbi->ll_ra_info.ra_max_streams,
+				LL_RA_STREAMS_MAX);
+	struct ll_ra_stream *victim = NULL;
+	struct ll_ra_stream tmp;
+	unsigned int i;
+
+	if (ras->ras_consecutive_pages == 0)
+		return;
+
+	if (nr == 0) {
+		ras_stream_save(ras, &tmp);
+		ras_stream_retire(sbi, inode, &tmp);
+		return;
+	}
+
+	for (i = 0; i < nr; i++) {
+		struct ll_ra_stream *rst = &ras->ras_streams[i];
+
+		if (victim == NULL || rst->rst_stamp < victim->rst_stamp)
+			victim = rst;
+		if (rst->rst_stamp == 0)
+			break;
+	}
+
+	if (victim->rst_stamp != 0) {
+		ll_ra_stats_inc_sbi(sbi, RA_STAT_STREAM_EVICTED);
+		ras_stream_retire(sbi, inode, victim);
+	}
+	ras_stream_save(ras, victim);
+}
+
+/*
+ * Look for a parked stream that the access at \a index continues, either
+ * forward or backward. If found, it is swapped with the current stream and
+ * 1 is returned. Called with the ras_lock held.
+ */
+static int ras_stream_resume(struct ll_sb_info *sbi,
+			     struct ll_readahead_state *ras,
+			     unsigned long index)
+{
+	unsigned int nr = min_t(unsigned int, sbi->ll_ra_info.ra_max_streams,
+				LL_RA_STREAMS_MAX);
+	struct ll_ra_stream tmp;
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		struct ll_ra_stream *rst = &ras->ras_streams[i];
+
+		if (rst->rst_stamp == 0)
+			continue;
+
+		if (!index_in_window(index, rst->rst_last_readpage, 8, 8) &&
+		    !(ras->ras_request_index == 0 &&
+		      ras_reverse_step(rst->rst_last_request,
+				       rst->rst_last_readpage, index)))
+			continue;
+
+		tmp = *rst;
+		if (ras->ras_consecutive_pages != 0)
+			ras_stream_save(ras, rst);
+		else
+			rst->rst_stamp = 0;
+		ras_stream_load(ras, &tmp);
+		return 1;
+	}
+	return 0;
+}
+
 /*
  * Check whether the read request is in the stride window.
  * If it is in the stride window, return 1, otherwise return 0.
@@ -861,6 +1276,25 @@ static void ras_stride_increase_window(struct ll_readahead_state *ras,
         RAS_CDEBUG(ras);
 }
 
+/* Reverse read-ahead window covers the pages right before \a index */
+static void ras_reverse_window(struct inode *inode,
+			       struct ll_readahead_state *ras,
+			       struct ll_ra_info *ra, unsigned long index)
+{
+	unsigned long len;
+
+	/* grow with the pages the stream has read so far, as the forward
+	 * window grows with consecutive requests */
+	len = min(max(ras->ras_window_len, ras->ras_consecutive_pages) +
+		  RAS_INCREASE_STEP(inode), ra->ra_max_pages_per_file);
+	ras_set_start(inode, ras, index > len ? index - len : 0);
+	ras->ras_window_len = index - ras->ras_window_start + 1;
+	ras->ras_next_readahead = ras->ras_window_start;
+	ras_stride_reset(ras);
+
+	RAS_CDEBUG(ras);
+}
+
 static void ras_increase_window(struct inode *inode,
 				struct ll_readahead_state *ras,
 				struct ll_ra_info *ra)
@@ -882,13 +1316,61 @@ void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 		unsigned hit)
 {
 	struct ll_ra_info *ra = &sbi->ll_ra_info;
-	int zero = 0, stride_detect = 0, ra_miss = 0;
+	int zero = 0, stride_detect = 0, ra_miss = 0, reverse = 0;
 	ENTRY;
 
 	spin_lock(&ras->ras_lock);
 
         ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_HIT : RA_STAT_MISS);
 
+	/* An access to some other part of the file may be another reader
+	 * sharing this descriptor, so switch to its stream if it was seen
+	 * before, and park the current one otherwise. */
+	if (ras->ras_request_index == 0 &&
+	    ras_reverse_step(ras->ras_last_request, ras->ras_last_readpage,
+			     index)) {
+		reverse = 1;
+	} else if (!index_in_window(index, ras->ras_last_readpage, 8, 8)) {
+		if (ras_stream_resume(sbi, ras, index)) {
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_STREAM_RESUMED);
+			reverse = ras->ras_request_index == 0 &&
+				  ras_reverse_step(ras->ras_last_request,
+						   ras->ras_last_readpage,
+						   index);
+		} else if (!index_in_stride_window(ras, index)) {
+			ras_stream_park(sbi, inode, ras);
+			ras->ras_consecutive_reverse = 0;
+			ras->ras_stream_start = index;
+			ras->ras_stream_hits = 0;
+			ras->ras_stream_misses = 0;
+		}
+	}
+
+	if (hit)
+		ras->ras_stream_hits++;
+	else
+		ras->ras_stream_misses++;
+
+	if (ras->ras_request_index == 0) {
+		if (reverse)
+			ras->ras_consecutive_reverse++;
+		else
+			ras->ras_consecutive_reverse = 0;
+		ras->ras_last_request = index;
+	}
+
+	/* Backward reads only read ahead the pages before each request and
+	 * leave the forward window alone. */
+	if (reverse_io_mode(ras)) {
+		if (reverse) {
+			ras_reverse_window(inode, ras, ra, index);
+			ll_ra_stats_inc_sbi(sbi, RA_STAT_REVERSE);
+		}
+		ras->ras_consecutive_pages++;
+		ras->ras_last_readpage = index;
+		GOTO(out_unlock, 0);
+	}
+
         /* reset the read-ahead window in two cases.  First when the app seeks
          * or reads to some other part of the file.  Secondly if we get a
          * read-ahead miss that we think we've previously issued.  This can
@@ -1061,6 +1061,27 @@ static void ll_start_agl(struct dentry *parent, struct ll_statahead_info *sai)
 	EXIT;
 }
 
+/*
+ * Getattr intents may be queued by md_intent_getattr_async() to be sent in
+ * one batch RPC, they must be flushed before the statahead thread blocks.
+ */
+static inline void sa_flush(struct inode *dir)
+{
+	md_intent_getattr_flush(ll_i2mdexp(dir));
+}
+
+static struct lu_dirent *sa_dir_entry_next(struct inode *dir,
+					   struct md_op_data *op_data,
+					   struct lu_dirent *ent,
+					   struct page **ppage)
+{
+	/* moving to next page may need a readdir RPC */
+	if (lu_dirent_next(ent) == NULL)
+		sa_flush(dir);
+
+	return ll_dir_entry_next(dir, op_data, ent, ppage);
+}
+
 static int ll_statahead_thread(void *arg)
 {
 	struct dentry            *parent = (struct dentry *)arg;
@@ -1109,7 +1130,7 @@ static int ll_statahead_thread(void *arg)
 	ll_dir_chain_init(&chain);
 	for (ent = ll_dir_entry_start(dir, op_data, &page);
 	     ent != NULL && !IS_ERR(ent);
-	     ent = ll_dir_entry_next(dir, op_data, ent, &page)) {
+	     ent = sa_dir_entry_next(dir, op_data, ent, &page)) {
 		__u64 hash;
 		int namelen;
 		char *name;
@@ -1156,6 +1177,8 @@ static int ll_statahead_thread(void *arg)
 			continue;
 
 keep_it:
+		if (sa_sent_full(sai))
+			sa_flush(dir);
 		l_wait_event(thread->t_ctl_waitq,
 			     !sa_sent_full(sai) ||
 			     !sa_received_empty(sai) ||
@@ -1211,6 +1234,7 @@ do_it:
 	 /*
 	 * End of directory reached.
 	 */
+	sa_flush(dir);
 	while (1) {
 		l_wait_event(thread->t_ctl_waitq,
 			     !sa_received_empty(sai) ||
@@ -1241,6 +1265,7 @@ do_it:
 	spin_unlock(&plli->lli_agl_lock);
 out:
 	EXIT;
+	sa_flush(dir);
 	ll_finish_md_op_data(op_data);
         if (sai->sai_agl_valid) {
 		spin_lock(&plli->lli_agl_lock);
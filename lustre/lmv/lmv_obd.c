@@ -3195,6 +3195,32 @@ int lmv_intent_getattr_async(struct obd_export *exp,
 	RETURN(rc);
 }
 
+int lmv_intent_getattr_flush(struct obd_export *exp)
+{
+	struct obd_device	*obd = exp->exp_obd;
+	struct lmv_obd		*lmv = &obd->u.lmv;
+	int			 rc = 0;
+	int			 rc2;
+	int			 i;
+	ENTRY;
+
+	rc = lmv_check_connect(obd);
+	if (rc)
+		RETURN(rc);
+
+	for (i = 0; i < lmv->desc.ld_tgt_count; i++) {
+		struct lmv_tgt_desc *tgt = lmv->tgts[i];
+
+		if (tgt == NULL || tgt->ltd_exp == NULL)
+			continue;
+
+		rc2 = md_intent_getattr_flush(tgt->ltd_exp);
+		if (rc2 != 0 && rc == 0)
+			rc = rc2;
+	}
+	RETURN(rc);
+}
+
 int lmv_revalidate_lock(struct obd_export *exp, struct lookup_intent *it,
                         struct lu_fid *fid, __u64 *bits)
 {
@@ -3393,7 +3419,8 @@ struct md_ops lmv_md_ops = {
         .m_unpack_capa          = lmv_unpack_capa,
         .m_get_remote_perm      = lmv_get_remote_perm,
         .m_intent_getattr_async = lmv_intent_getattr_async,
-        .m_revalidate_lock      = lmv_revalidate_lock
+        .m_revalidate_lock      = lmv_revalidate_lock,
+	.m_intent_getattr_flush	= lmv_intent_getattr_flush
 };
 
 int __init lmv_init(void)
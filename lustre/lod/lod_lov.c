@@ -228,7 +228,8 @@ int lod_add_device(const struct lu_env *env, struct lod_device *lod,
 					   OBD_CONNECT_LVB_TYPE |
 					   OBD_CONNECT_VERSION |
 					   OBD_CONNECT_PINGLESS |
-					   OBD_CONNECT_LFSCK;
+					   OBD_CONNECT_LFSCK |
+					   OBD_CONNECT_DESTROY_BATCH;
 
 		data->ocd_group = tgt_index;
 		ltd = &lod->lod_ost_descs;
@@ -74,6 +74,34 @@ static ssize_t mdc_max_rpcs_in_flight_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(mdc_max_rpcs_in_flight);
 
+static int mdc_max_getattr_batch_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+
+	return seq_printf(m, "%d\n", dev->u.cli.cl_batch_max);
+}
+
+static ssize_t mdc_max_getattr_batch_seq_write(struct file *file,
+					       const char *buffer,
+					       size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	int val;
+	int rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	/* 0 or 1 disables batching of statahead getattr requests */
+	if (val < 0 || val > BATCH_MAX_COUNT)
+		return -ERANGE;
+
+	dev->u.cli.cl_batch_max = val;
+	return count;
+}
+LPROC_SEQ_FOPS(mdc_max_getattr_batch);
+
 LPROC_SEQ_FOPS_WO_TYPE(mdc, ping);
 
 LPROC_SEQ_FOPS_RO_TYPE(mdc, uuid);
@@ -132,6 +160,8 @@ struct lprocfs_seq_vars lprocfs_mdc_obd_vars[] = {
 	  .fops	=	&mdc_obd_max_pages_per_rpc_fops	},
 	{ .name	=	"max_rpcs_in_flight",
 	  .fops	=	&mdc_max_rpcs_in_flight_fops	},
+	{ .name	=	"max_getattr_batch",
+	  .fops	=	&mdc_max_getattr_batch_fops	},
 	{ .name	=	"timeouts",
 	  .fops	=	&mdc_timeouts_fops		},
 	{ .name	=	"import",
@@ -44,6 +44,12 @@
 extern struct lprocfs_seq_vars lprocfs_mdc_obd_vars[];
 #endif
 
+/* default number of statahead getattr requests sent in one MDS_BATCH */
+#define MDC_BATCH_MAX_DEFAULT	16
+/* keep a batch well below the request size limit of the MDS regular
+ * portal, leaving room for the security payload */
+#define MDC_BATCH_MAX_REQSIZE	(MDS_REG_MAXREQSIZE / 2)
+
 void mdc_pack_body(struct ptlrpc_request *req, const struct lu_fid *fid,
                    struct obd_capa *oc, __u64 valid, int ea_size,
                    __u32 suppgid, int flags);
@@ -157,6 +163,7 @@ int mdc_revalidate_lock(struct obd_export *exp, struct lookup_intent *it,
 int mdc_intent_getattr_async(struct obd_export *exp,
                              struct md_enqueue_info *minfo,
                              struct ldlm_enqueue_info *einfo);
+int mdc_intent_getattr_flush(struct obd_export *exp);
 
 ldlm_mode_t mdc_lock_match(struct obd_export *exp, __u64 flags,
                            const struct lu_fid *fid, ldlm_type_t type,
@@ -56,6 +56,12 @@ struct mdc_getattr_args {
         struct obd_export           *ga_exp;
         struct md_enqueue_info      *ga_minfo;
         struct ldlm_enqueue_info    *ga_einfo;
+	int			     ga_batched;
+};
+
+struct mdc_batch_args {
+	struct obd_export	*ba_exp;
+	cfs_list_t		 ba_reqs;
 };
 
 int it_open_error(int phase, struct lookup_intent *it)
@@ -1228,7 +1234,9 @@ static int mdc_intent_getattr_async_interpret(const struct lu_env *env,
 
         obddev = class_exp2obd(exp);
 
-	obd_put_request_slot(&obddev->u.cli);
+	/* a batched request holds no slot, its batch does */
+	if (!ga->ga_batched)
+		obd_put_request_slot(&obddev->u.cli);
         if (OBD_FAIL_CHECK(OBD_FAIL_MDC_GETATTR_ENQUEUE))
                 rc = -ETIMEDOUT;
 
@@ -1259,6 +1267,210 @@ out:
         return 0;
 }
 
+static int mdc_getattr_batch_enabled(struct obd_export *exp)
+{
+	return class_exp2obd(exp)->u.cli.cl_batch_max > 1 &&
+	       (exp_connect_flags(exp) & OBD_CONNECT_BATCH_RPC);
+}
+
+static int mdc_getattr_batch_send(struct obd_export *exp, cfs_list_t *reqs,
+				  int count, bool slot_held);
+
+/* Find the reply to the batched request of xid \a xid in the batch reply */
+static struct lustre_msg *mdc_getattr_batch_reply(struct batch_buf *bb,
+						  int buflen, __u64 xid,
+						  int *len)
+{
+	int i;
+
+	for (i = 0; i < bb->bb_count; i++) {
+		if (bb->bb_msgs[i].bm_xid == xid)
+			return batch_buf_msg(bb, buflen, i, len);
+	}
+	return NULL;
+}
+
+static int mdc_getattr_batch_interpret(const struct lu_env *env,
+				       struct ptlrpc_request *req,
+				       void *args, int rc)
+{
+	struct mdc_batch_args	*ba = args;
+	struct ptlrpc_request	*sub;
+	struct batch_buf	*bb = NULL;
+	struct lustre_msg	*msg;
+	cfs_list_t		 resend;
+	int			 nresend = 0;
+	int			 buflen = 0;
+	int			 len = 0;
+	bool			 handled = false;
+	ENTRY;
+
+	CFS_INIT_LIST_HEAD(&resend);
+	if (rc == 0) {
+		bb = req_capsule_server_get(&req->rq_pill, &RMF_BATCH_REP);
+		buflen = req_capsule_get_size(&req->rq_pill, &RMF_BATCH_REP,
+					      RCL_SERVER);
+		if (bb == NULL || bb->bb_magic != BATCH_REPLY_MAGIC ||
+		    batch_buf_hdr_size(bb->bb_count) > buflen) {
+			DEBUG_REQ(D_ERROR, req, "bad batch reply");
+			rc = -EPROTO;
+		}
+	}
+
+	/* each reply carries the xid of its request */
+	while (!cfs_list_empty(&ba->ba_reqs)) {
+		sub = cfs_list_entry(ba->ba_reqs.next, struct ptlrpc_request,
+				     rq_list);
+		cfs_list_del_init(&sub->rq_list);
+
+		msg = NULL;
+		if (rc == 0)
+			msg = mdc_getattr_batch_reply(bb, buflen, sub->rq_xid,
+						      &len);
+		if (rc == 0 && msg == NULL) {
+			/* not handled by the server for lack of room in the
+			 * batch reply, send it again in a new batch */
+			DEBUG_REQ(D_INFO, sub, "not handled in batch, resend");
+			cfs_list_add_tail(&sub->rq_list, &resend);
+			nresend++;
+			continue;
+		}
+		handled = true;
+		ptlrpc_batch_sub_complete(env, sub, msg, len, rc);
+	}
+
+	/* The new batch takes over the RPC slot of this one. The server
+	 * handles at least the first request of a batch, anything else
+	 * would only be sent again and again. */
+	if (nresend > 0 && !handled) {
+		DEBUG_REQ(D_ERROR, req, "no request handled in batch");
+		rc = -EPROTO;
+		while (!cfs_list_empty(&resend)) {
+			sub = cfs_list_entry(resend.next,
+					     struct ptlrpc_request, rq_list);
+			cfs_list_del_init(&sub->rq_list);
+			ptlrpc_batch_sub_complete(env, sub, NULL, 0, rc);
+		}
+		nresend = 0;
+	}
+	if (nresend > 0)
+		mdc_getattr_batch_send(ba->ba_exp, &resend, nresend, true);
+	else
+		obd_put_request_slot(&class_exp2obd(ba->ba_exp)->u.cli);
+
+	RETURN(0);
+}
+
+/**
+ * Pack the \a count requests on \a reqs into one MDS_BATCH RPC and hand it
+ * to ptlrpcd. The batch takes one RPC slot, or the one of the batch the
+ * requests come back from if \a slot_held. On failure the requests are
+ * completed with the error, as if they had failed on their own.
+ */
+static int mdc_getattr_batch_send(struct obd_export *exp, cfs_list_t *reqs,
+				  int count, bool slot_held)
+{
+	struct client_obd	*cli = &class_exp2obd(exp)->u.cli;
+	struct ptlrpc_request	*req;
+	struct ptlrpc_request	*sub;
+	struct mdc_batch_args	*ba;
+	struct batch_buf	*bb;
+	int			 reqsize;
+	int			 repsize;
+	int			 maxrep = 0;
+	int			 off;
+	int			 i = 0;
+	int			 rc;
+	ENTRY;
+
+	LASSERT(count > 0 && count <= BATCH_MAX_COUNT);
+
+	if (!slot_held) {
+		rc = obd_get_request_slot(cli);
+		if (rc != 0)
+			GOTO(err, rc);
+	}
+
+	/* the server keeps the same reply space for each message */
+	reqsize = batch_buf_hdr_size(count);
+	cfs_list_for_each_entry(sub, reqs, rq_list) {
+		reqsize += cfs_size_round(sub->rq_reqlen);
+		maxrep = max(maxrep, sub->rq_replen);
+	}
+	repsize = batch_buf_hdr_size(count) + count * cfs_size_round(maxrep);
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp), &RQF_MDS_BATCH);
+	if (req == NULL)
+		GOTO(err_slot, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_REQ, RCL_CLIENT,
+			     reqsize);
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_BATCH);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(err_slot, rc);
+	}
+
+	bb = req_capsule_client_get(&req->rq_pill, &RMF_BATCH_REQ);
+	bb->bb_magic = BATCH_REQUEST_MAGIC;
+	bb->bb_count = count;
+	bb->bb_padding = 0;
+	bb->bb_reply_size = maxrep;
+	bb->bb_padding2 = 0;
+
+	off = batch_buf_hdr_size(count);
+	cfs_list_for_each_entry(sub, reqs, rq_list) {
+		ptlrpc_batch_sub_prep(sub);
+		bb->bb_msgs[i].bm_xid = sub->rq_xid;
+		bb->bb_msgs[i].bm_len = sub->rq_reqlen;
+		bb->bb_msgs[i].bm_padding = 0;
+		i++;
+		memcpy((char *)bb + off, sub->rq_reqmsg, sub->rq_reqlen);
+		off += cfs_size_round(sub->rq_reqlen);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_BATCH_REP, RCL_SERVER,
+			     repsize);
+	ptlrpc_request_set_replen(req);
+
+	CLASSERT(sizeof(*ba) <= sizeof(req->rq_async_args));
+	ba = ptlrpc_req_async_args(req);
+	ba->ba_exp = exp;
+	CFS_INIT_LIST_HEAD(&ba->ba_reqs);
+	cfs_list_splice_init(reqs, &ba->ba_reqs);
+
+	req->rq_interpret_reply = mdc_getattr_batch_interpret;
+	ptlrpcd_add_req(req, PDL_POLICY_LOCAL, -1);
+
+	RETURN(0);
+err_slot:
+	obd_put_request_slot(cli);
+err:
+	while (!cfs_list_empty(reqs)) {
+		sub = cfs_list_entry(reqs->next, struct ptlrpc_request,
+				     rq_list);
+		cfs_list_del_init(&sub->rq_list);
+		ptlrpc_batch_sub_complete(NULL, sub, NULL, 0, rc);
+	}
+	RETURN(rc);
+}
+
+/* Queue the packed getattr request \a req to be sent in a batch. */
+static void mdc_getattr_batch_add(struct obd_export *exp,
+				  struct ptlrpc_request *req)
+{
+	struct client_obd	*cli = &class_exp2obd(exp)->u.cli;
+	int			 full;
+
+	spin_lock(&cli->cl_batch_lock);
+	cfs_list_add_tail(&req->rq_list, &cli->cl_batch_list);
+	full = ++cli->cl_batch_count >= cli->cl_batch_max;
+	spin_unlock(&cli->cl_batch_lock);
+
+	if (full)
+		mdc_intent_getattr_flush(exp);
+}
+
 int mdc_intent_getattr_async(struct obd_export *exp,
                              struct md_enqueue_info *minfo,
                              struct ldlm_enqueue_info *einfo)
@@ -1277,6 +1489,7 @@ int mdc_intent_getattr_async(struct obd_export *exp,
                                                          MDS_INODELOCK_UPDATE }
                                  };
         int                      rc = 0;
+	int			 batched;
 	__u64                    flags = LDLM_FL_HAS_INTENT;
 	ENTRY;
 
@@ -1290,16 +1503,20 @@ int mdc_intent_getattr_async(struct obd_export *exp,
 	if (IS_ERR(req))
 		RETURN(PTR_ERR(req));
 
-	rc = obd_get_request_slot(&obddev->u.cli);
-        if (rc != 0) {
-                ptlrpc_req_finished(req);
-                RETURN(rc);
-        }
+	batched = mdc_getattr_batch_enabled(exp);
+	if (!batched) {
+		rc = obd_get_request_slot(&obddev->u.cli);
+		if (rc != 0) {
+			ptlrpc_req_finished(req);
+			RETURN(rc);
+		}
+	}
 
         rc = ldlm_cli_enqueue(exp, &req, einfo, &res_id, &policy, &flags, NULL,
 			      0, LVB_T_NONE, &minfo->mi_lockh, 1);
         if (rc < 0) {
-		obd_put_request_slot(&obddev->u.cli);
+		if (!batched)
+			obd_put_request_slot(&obddev->u.cli);
                 ptlrpc_req_finished(req);
                 RETURN(rc);
         }
@@ -1309,9 +1526,61 @@ int mdc_intent_getattr_async(struct obd_export *exp,
         ga->ga_exp = exp;
         ga->ga_minfo = minfo;
         ga->ga_einfo = einfo;
+	ga->ga_batched = batched;
 
         req->rq_interpret_reply = mdc_intent_getattr_async_interpret;
-        ptlrpcd_add_req(req, PDL_POLICY_LOCAL, -1);
+	if (batched)
+		mdc_getattr_batch_add(exp, req);
+	else
+		ptlrpcd_add_req(req, PDL_POLICY_LOCAL, -1);
 
         RETURN(0);
 }
+
+/**
+ * Send the intent getattr requests queued on \a exp by
+ * mdc_intent_getattr_async() in as few MDS_BATCH RPCs as the batch limits
+ * allow. The caller must flush before it waits for any of those requests.
+ */
+int mdc_intent_getattr_flush(struct obd_export *exp)
+{
+	struct client_obd	*cli = &class_exp2obd(exp)->u.cli;
+	struct ptlrpc_request	*sub;
+	cfs_list_t		 reqs;
+	cfs_list_t		 chunk;
+	int			 reqsize;
+	int			 count;
+	int			 rc = 0;
+	int			 rc2;
+	ENTRY;
+
+	CFS_INIT_LIST_HEAD(&reqs);
+	spin_lock(&cli->cl_batch_lock);
+	cfs_list_splice_init(&cli->cl_batch_list, &reqs);
+	cli->cl_batch_count = 0;
+	spin_unlock(&cli->cl_batch_lock);
+
+	while (!cfs_list_empty(&reqs)) {
+		CFS_INIT_LIST_HEAD(&chunk);
+		reqsize = batch_buf_hdr_size(BATCH_MAX_COUNT);
+		count = 0;
+
+		while (!cfs_list_empty(&reqs) && count < BATCH_MAX_COUNT) {
+			sub = cfs_list_entry(reqs.next, struct ptlrpc_request,
+					     rq_list);
+			if (count > 0 && reqsize + cfs_size_round(sub->rq_reqlen) >
+					 MDC_BATCH_MAX_REQSIZE)
+				break;
+
+			reqsize += cfs_size_round(sub->rq_reqlen);
+			cfs_list_move_tail(&sub->rq_list, &chunk);
+			count++;
+		}
+
+		rc2 = mdc_getattr_batch_send(exp, &chunk, count, false);
+		if (rc2 != 0 && rc == 0)
+			rc = rc2;
+	}
+
+	RETURN(rc);
+}
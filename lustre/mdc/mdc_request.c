@@ -2162,7 +2162,7 @@ static struct kuc_hdr *changelog_kuc_hdr(char *buf, int len, int flags)
 {
 	struct kuc_hdr *lh = (struct kuc_hdr *)buf;
 
-	LASSERT(len <= KUC_CHANGELOG_MSG_MAXSIZE);
+	LASSERT(len <= KUC_CHANGELOG_BATCH_MAXSIZE);
 
 	lh->kuc_magic = KUC_MAGIC;
 	lh->kuc_transport = KUC_TRANSPORT_CHANGELOG;
@@ -2180,8 +2180,62 @@ struct changelog_show {
 	struct file	*cs_fp;
 	char		*cs_buf;
 	struct obd_device *cs_obd;
+	/* CHANGELOG_FLAG_BATCH: records are gathered in cs_buf */
+	__u32		cs_typemask;
+	int		cs_buf_size;
+	int		cs_len;
+	unsigned int	cs_batch:1;
 };
 
+/* send the records gathered in cs_buf as one CL_BATCH message */
+static int changelog_batch_flush(struct changelog_show *cs)
+{
+	struct kuc_hdr	*lh;
+	int		 rc;
+
+	if (cs->cs_len == sizeof(*lh))
+		return 0;
+
+	lh = changelog_kuc_hdr(cs->cs_buf, cs->cs_len, cs->cs_flags);
+	lh->kuc_msgtype = CL_BATCH;
+	rc = libcfs_kkuc_msg_put(cs->cs_fp, lh);
+	CDEBUG(D_CHANGELOG, "kucmsg fp %p batch len %d rc %d\n", cs->cs_fp,
+	       cs->cs_len, rc);
+	cs->cs_len = sizeof(*lh);
+	return rc;
+}
+
+/* add @rec to the batch in extended format, so that userspace can walk the
+ * records in place */
+static int changelog_batch_add(struct changelog_show *cs,
+			       struct changelog_rec *rec)
+{
+	struct changelog_ext_rec	*ext;
+	int				 len;
+	int				 rc;
+
+	len = cfs_size_round(sizeof(*ext) + rec->cr_namelen);
+	if (cs->cs_len + len > cs->cs_buf_size) {
+		rc = changelog_batch_flush(cs);
+		if (rc != 0)
+			return rc;
+	}
+
+	ext = (struct changelog_ext_rec *)(cs->cs_buf + cs->cs_len);
+	/* padding is sent too, don't leak stale data */
+	memset(ext, 0, len);
+	if (CHANGELOG_REC_EXTENDED(rec)) {
+		memcpy(ext, rec, sizeof(*ext) + rec->cr_namelen);
+	} else {
+		memcpy(ext, rec, sizeof(*rec));
+		ext->cr_flags = (rec->cr_flags & CLF_FLAGMASK) |
+				CLF_EXT_VERSION;
+		memcpy(ext->cr_name, rec->cr_name, rec->cr_namelen);
+	}
+	cs->cs_len += len;
+	return 0;
+}
+
 static int changelog_kkuc_cb(const struct lu_env *env, struct llog_handle *llh,
 			     struct llog_rec_hdr *hdr, void *data)
 {
@@ -2213,6 +2267,13 @@ static int changelog_kkuc_cb(const struct lu_env *env, struct llog_handle *llh,
 		PFID(&rec->cr.cr_tfid), PFID(&rec->cr.cr_pfid),
 		rec->cr.cr_namelen, changelog_rec_name(&rec->cr));
 
+	if (cs->cs_batch) {
+		if (cs->cs_typemask != 0 &&
+		    !(cs->cs_typemask & (1U << rec->cr.cr_type)))
+			RETURN(0);
+		RETURN(changelog_batch_add(cs, &rec->cr));
+	}
+
 	len = sizeof(*lh) + changelog_rec_size(&rec->cr) + rec->cr.cr_namelen;
 
         /* Set up the message */
@@ -2231,12 +2292,15 @@ static int mdc_changelog_send_thread(void *csdata)
 	struct llog_ctxt *ctxt = NULL;
 	struct llog_handle *llh = NULL;
 	struct kuc_hdr *kuch;
-	int rc;
+	int rc, rc2;
 
-	CDEBUG(D_CHANGELOG, "changelog to fp=%p start "LPU64"\n",
-	       cs->cs_fp, cs->cs_startrec);
+	CDEBUG(D_CHANGELOG, "changelog to fp=%p start "LPU64" flags %#x\n",
+	       cs->cs_fp, cs->cs_startrec, cs->cs_flags);
 
-	OBD_ALLOC(cs->cs_buf, KUC_CHANGELOG_MSG_MAXSIZE);
+	cs->cs_buf_size = cs->cs_batch ? KUC_CHANGELOG_BATCH_MAXSIZE :
+					 KUC_CHANGELOG_MSG_MAXSIZE;
+	cs->cs_len = sizeof(*kuch);
+	OBD_ALLOC_LARGE(cs->cs_buf, cs->cs_buf_size);
 	if (cs->cs_buf == NULL)
 		GOTO(out, rc = -ENOMEM);
 
@@ -2258,6 +2322,12 @@ static int mdc_changelog_send_thread(void *csdata)
 	}
 
 	rc = llog_cat_process(NULL, llh, changelog_kkuc_cb, cs, 0, 0);
+	if (cs->cs_batch) {
+		/* records already gathered are valid whatever the result */
+		rc2 = changelog_batch_flush(cs);
+		if (rc == 0)
+			rc = rc2;
+	}
 
         /* Send EOF no matter what our result */
         if ((kuch = changelog_kuc_hdr(cs->cs_buf, sizeof(*kuch),
@@ -2273,7 +2343,7 @@ out:
         if (ctxt)
                 llog_ctxt_put(ctxt);
 	if (cs->cs_buf)
-		OBD_FREE(cs->cs_buf, KUC_CHANGELOG_MSG_MAXSIZE);
+		OBD_FREE_LARGE(cs->cs_buf, cs->cs_buf_size);
 	OBD_FREE_PTR(cs);
 	return rc;
 }
@@ -2295,6 +2365,10 @@ static int mdc_ioc_changelog_send(struct obd_device *obd,
 	/* matching fput in mdc_changelog_send_thread */
 	cs->cs_fp = fget(icc->icc_id);
 	cs->cs_flags = icc->icc_flags;
+	if (icc->icc_flags & CHANGELOG_FLAG_BATCH) {
+		cs->cs_batch = 1;
+		cs->cs_typemask = icc->icc_typemask;
+	}
 
 	/*
 	 * New thread because we should return to user app before
@@ -3134,6 +3208,7 @@ static int mdc_setup(struct obd_device *obd, struct lustre_cfg *cfg)
         rc = client_obd_setup(obd, cfg);
         if (rc)
                 GOTO(err_close_lock, rc);
+	cli->cl_batch_max = MDC_BATCH_MAX_DEFAULT;
 #ifdef LPROCFS
 	obd->obd_vars = lprocfs_mdc_obd_vars;
 	lprocfs_seq_obd_setup(obd);
@@ -3429,7 +3504,8 @@ struct md_ops mdc_md_ops = {
         .m_unpack_capa      = mdc_unpack_capa,
         .m_get_remote_perm  = mdc_get_remote_perm,
         .m_intent_getattr_async = mdc_intent_getattr_async,
-        .m_revalidate_lock      = mdc_revalidate_lock
+        .m_revalidate_lock      = mdc_revalidate_lock,
+	.m_intent_getattr_flush	= mdc_intent_getattr_flush
 };
 
 int __init mdc_init(void)
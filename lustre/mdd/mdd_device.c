@@ -263,6 +263,80 @@ static struct llog_operations changelog_orig_logops;
 static int
 mdd_changelog_on(const struct lu_env *env, struct mdd_device *mdd, int on);
 
+/* log only the record types enabled by the administrator that some
+ * registered user wants */
+void mdd_changelog_update_mask(struct mdd_device *mdd)
+{
+	spin_lock(&mdd->mdd_cl.mc_user_lock);
+	mdd->mdd_cl.mc_current_mask = mdd->mdd_cl.mc_mask &
+				      mdd->mdd_cl.mc_users_mask;
+	spin_unlock(&mdd->mdd_cl.mc_user_lock);
+}
+
+struct mdd_changelog_users_data {
+	__u64	mcus_minrec;
+	int	mcus_minuser;
+	int	mcus_mask;
+	int	mcus_count;
+};
+
+static int mdd_changelog_users_scan_cb(const struct lu_env *env,
+				       struct llog_handle *llh,
+				       struct llog_rec_hdr *hdr, void *data)
+{
+	struct llog_changelog_user_rec	*rec;
+	struct mdd_changelog_users_data	*mcus = data;
+
+	LASSERT(llh->lgh_hdr->llh_flags & LLOG_F_IS_PLAIN);
+
+	rec = (struct llog_changelog_user_rec *)hdr;
+
+	mcus->mcus_count++;
+	mcus->mcus_mask |= rec->cur_mask != 0 ? rec->cur_mask :
+						CHANGELOG_ALLMASK;
+	if (mcus->mcus_minuser == 0 || rec->cur_endrec < mcus->mcus_minrec) {
+		mcus->mcus_minuser = rec->cur_id;
+		mcus->mcus_minrec = rec->cur_endrec;
+	}
+	return 0;
+}
+
+/** Refresh the record type mask and the slowest user after the
+ * registered users changed. */
+static int mdd_changelog_users_scan(const struct lu_env *env,
+				    struct mdd_device *mdd)
+{
+	struct mdd_changelog_users_data	 mcus = { 0 };
+	struct llog_ctxt		*ctxt;
+	int				 rc;
+
+	ctxt = llog_get_context(mdd2obd_dev(mdd),
+				LLOG_CHANGELOG_USER_ORIG_CTXT);
+	if (ctxt == NULL)
+		return -ENXIO;
+
+	rc = llog_cat_process(env, ctxt->loc_handle,
+			      mdd_changelog_users_scan_cb, &mcus, 0, 0);
+	llog_ctxt_put(ctxt);
+	if (rc < 0) {
+		CERROR("%s: cannot scan changelog users: rc = %d\n",
+		       mdd2obd_dev(mdd)->obd_name, rc);
+		return rc;
+	}
+
+	spin_lock(&mdd->mdd_cl.mc_user_lock);
+	/* without users changelogs are off anyway */
+	mdd->mdd_cl.mc_users_mask = mcus.mcus_count > 0 ?
+				    mcus.mcus_mask | CHANGELOG_MINMASK :
+				    CHANGELOG_ALLMASK;
+	mdd->mdd_cl.mc_minuser = mcus.mcus_minuser;
+	mdd->mdd_cl.mc_minrec = mcus.mcus_minrec;
+	spin_unlock(&mdd->mdd_cl.mc_user_lock);
+
+	mdd_changelog_update_mask(mdd);
+	return 0;
+}
+
 static int mdd_changelog_llog_init(const struct lu_env *env,
 				   struct mdd_device *mdd)
 {
@@ -342,6 +416,10 @@ static int mdd_changelog_llog_init(const struct lu_env *env,
 		GOTO(out_uclose, rc);
 	}
 
+	rc = mdd_changelog_users_scan(env, mdd);
+	if (rc < 0)
+		GOTO(out_uclose, rc);
+
 	/* If we have registered users, assume we want changelogs on */
 	if (mdd->mdd_cl.mc_lastuser > 0) {
 		rc = mdd_changelog_on(env, mdd, 1);
@@ -374,6 +452,12 @@ static int mdd_changelog_init(const struct lu_env *env, struct mdd_device *mdd)
 	mdd->mdd_cl.mc_mask = CHANGELOG_DEFMASK;
 	spin_lock_init(&mdd->mdd_cl.mc_user_lock);
 	mdd->mdd_cl.mc_lastuser = 0;
+	mdd->mdd_cl.mc_users_mask = CHANGELOG_ALLMASK;
+	mdd->mdd_cl.mc_current_mask = CHANGELOG_DEFMASK;
+	mdd->mdd_cl.mc_minuser = 0;
+	mdd->mdd_cl.mc_minrec = 0;
+	mdd->mdd_cl.mc_max_idle_indexes = 0;
+	mdd->mdd_cl.mc_gc_running = 0;
 
 	rc = mdd_changelog_llog_init(env, mdd);
 	if (rc) {
@@ -393,6 +477,10 @@ static void mdd_changelog_fini(const struct lu_env *env,
 
 	mdd->mdd_cl.mc_flags = 0;
 
+	/* the garbage collection thread uses the llogs */
+	if (mdd->mdd_cl.mc_gc_running)
+		wait_for_completion(&mdd->mdd_cl.mc_gc_done);
+
 	ctxt = llog_get_context(obd, LLOG_CHANGELOG_ORIG_CTXT);
 	if (ctxt) {
 		llog_cat_close(env, ctxt->loc_handle);
@@ -507,7 +595,7 @@ int mdd_changelog_write_header(const struct lu_env *env,
 
 	ENTRY;
 
-	if (mdd->mdd_cl.mc_mask & (1 << CL_MARK)) {
+	if (mdd->mdd_cl.mc_current_mask & (1 << CL_MARK)) {
 		mdd->mdd_cl.mc_starttime = cfs_time_current_64();
 		RETURN(0);
 	}
@@ -1269,7 +1357,8 @@ static struct obd_ops mdd_obd_device_ops = {
 };
 
 static int mdd_changelog_user_register(const struct lu_env *env,
-				       struct mdd_device *mdd, int *id)
+				       struct mdd_device *mdd, int *id,
+				       __u32 mask)
 {
         struct llog_ctxt *ctxt;
         struct llog_changelog_user_rec *rec;
@@ -1302,11 +1391,16 @@ static int mdd_changelog_user_register(const struct lu_env *env,
 	}
 	*id = rec->cur_id = ++mdd->mdd_cl.mc_lastuser;
 	rec->cur_endrec = mdd->mdd_cl.mc_index;
+	/* 0 means all types, otherwise CL_MARK records are always sent */
+	rec->cur_mask = mask != 0 ? mask | CHANGELOG_MINMASK : 0;
 	spin_unlock(&mdd->mdd_cl.mc_user_lock);
 
 	rc = llog_cat_add(env, ctxt->loc_handle, &rec->cur_hdr, NULL, NULL);
+	if (rc == 0)
+		rc = mdd_changelog_users_scan(env, mdd);
 
-        CDEBUG(D_IOCTL, "Registered changelog user %d\n", *id);
+	CDEBUG(D_IOCTL, "Registered changelog user %d mask %#x\n", *id,
+	       rec->cur_mask);
 out:
         OBD_FREE_PTR(rec);
         llog_ctxt_put(ctxt);
@@ -1343,10 +1437,30 @@ static int mdd_changelog_user_purge_cb(const struct lu_env *env,
 
         mcud->mcud_usercount++;
 
-        /* If we have a new endrec for this id, use it for the following
-           min check instead of its old value */
-        if (rec->cur_id == mcud->mcud_id)
-                rec->cur_endrec = max(rec->cur_endrec, mcud->mcud_endrec);
+	if (rec->cur_id == mcud->mcud_id) {
+		mcud->mcud_found = 1;
+
+		/* Special case: unregister this user, which no longer
+		 * references any record, so leave it out of the min check */
+		if (mcud->mcud_endrec == MCUD_UNREGISTER) {
+			struct llog_cookie cookie;
+
+			cookie.lgc_lgl = llh->lgh_id;
+			cookie.lgc_index = hdr->lrh_index;
+
+			rc = llog_cat_cancel_records(env,
+						llh->u.phd.phd_cat_handle,
+						1, &cookie);
+			if (rc == 0)
+				mcud->mcud_usercount--;
+
+			RETURN(rc);
+		}
+
+		/* If we have a new endrec for this id, use it for the
+		 * following min check instead of its old value */
+		rec->cur_endrec = max(rec->cur_endrec, mcud->mcud_endrec);
+	}
 
         /* Track the minimum referenced record */
         if (mcud->mcud_minid == 0 || mcud->mcud_minrec > rec->cur_endrec) {
@@ -1357,24 +1471,6 @@ static int mdd_changelog_user_purge_cb(const struct lu_env *env,
         if (rec->cur_id != mcud->mcud_id)
                 RETURN(0);
 
-        /* Update this user's record */
-        mcud->mcud_found = 1;
-
-        /* Special case: unregister this user */
-        if (mcud->mcud_endrec == MCUD_UNREGISTER) {
-                struct llog_cookie cookie;
-
-                cookie.lgc_lgl = llh->lgh_id;
-                cookie.lgc_index = hdr->lrh_index;
-
-		rc = llog_cat_cancel_records(env, llh->u.phd.phd_cat_handle,
-					     1, &cookie);
-                if (rc == 0)
-                        mcud->mcud_usercount--;
-
-                RETURN(rc);
-        }
-
         /* Update the endrec */
         CDEBUG(D_IOCTL, "Rewriting changelog user %d endrec to "LPU64"\n",
                mcud->mcud_id, rec->cur_endrec);
@@ -1421,7 +1517,11 @@ static int mdd_changelog_user_purge(const struct lu_env *env,
 	rc = llog_cat_process(env, ctxt->loc_handle,
 			      mdd_changelog_user_purge_cb, (void *)&data,
 			      0, 0);
-        if ((rc >= 0) && (data.mcud_minrec > 0)) {
+	if (rc >= 0 && data.mcud_found && data.mcud_minid == 0) {
+		/* the last user was unregistered, nothing is referenced */
+		CDEBUG(D_IOCTL, "Purging all changelog entries\n");
+		rc = mdd_changelog_llog_cancel(env, mdd, 0);
+	} else if ((rc >= 0) && (data.mcud_minrec > 0)) {
                 CDEBUG(D_IOCTL, "Purging changelog entries up to "LPD64
                        ", referenced by "CHANGELOG_USER_PREFIX"%d\n",
                        data.mcud_minrec, data.mcud_minid);
@@ -1440,6 +1540,9 @@ static int mdd_changelog_user_purge(const struct lu_env *env,
                rc = -ENOENT;
         }
 
+	if (data.mcud_found)
+		mdd_changelog_users_scan(env, mdd);
+
         if (!rc && data.mcud_usercount == 0)
                 /* No more users; turn changelogs off */
                 rc = mdd_changelog_on(env, mdd, 0);
@@ -1447,6 +1550,79 @@ static int mdd_changelog_user_purge(const struct lu_env *env,
         RETURN (rc);
 }
 
+static int mdd_changelog_gc_thread(void *data)
+{
+	struct mdd_device	*mdd = data;
+	struct lu_env		 env;
+	__u64			 minrec;
+	__u64			 cur;
+	int			 user;
+	int			 rc;
+
+	rc = lu_env_init(&env, LCT_MD_THREAD);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	spin_lock(&mdd->mdd_cl.mc_user_lock);
+	user = mdd->mdd_cl.mc_minuser;
+	minrec = mdd->mdd_cl.mc_minrec;
+	spin_unlock(&mdd->mdd_cl.mc_user_lock);
+	spin_lock(&mdd->mdd_cl.mc_lock);
+	cur = mdd->mdd_cl.mc_index;
+	spin_unlock(&mdd->mdd_cl.mc_lock);
+
+	if (user != 0 && cur - minrec > mdd->mdd_cl.mc_max_idle_indexes) {
+		LCONSOLE_WARN("%s: deregistering changelog user "
+			      CHANGELOG_USER_PREFIX"%d, "LPU64" records "
+			      "behind, the limit is "LPU64"\n",
+			      mdd2obd_dev(mdd)->obd_name, user, cur - minrec,
+			      mdd->mdd_cl.mc_max_idle_indexes);
+		rc = mdd_changelog_user_purge(&env, mdd, user,
+					      MCUD_UNREGISTER);
+		if (rc != 0)
+			CERROR("%s: cannot deregister changelog user "
+			       CHANGELOG_USER_PREFIX"%d: rc = %d\n",
+			       mdd2obd_dev(mdd)->obd_name, user, rc);
+	}
+	lu_env_fini(&env);
+out:
+	complete(&mdd->mdd_cl.mc_gc_done);
+	return rc;
+}
+
+/** Called after record \a index was added to the changelog, so that a
+ * user no longer clearing records does not pin the whole log: once it is
+ * more than changelog_max_idle_indexes records behind it is deregistered
+ * by a separate thread, outside of the caller's transaction. */
+void mdd_changelog_gc_check(struct mdd_device *mdd, __u64 index)
+{
+	struct mdd_changelog	*mc = &mdd->mdd_cl;
+	struct task_struct	*task;
+
+	if (mc->mc_max_idle_indexes == 0)
+		return;
+
+	spin_lock(&mc->mc_user_lock);
+	if (mc->mc_minuser == 0 ||
+	    index - mc->mc_minrec <= mc->mc_max_idle_indexes ||
+	    (mc->mc_gc_running && !completion_done(&mc->mc_gc_done)) ||
+	    !(mc->mc_flags & CLM_ON)) {
+		spin_unlock(&mc->mc_user_lock);
+		return;
+	}
+	mc->mc_gc_running = 1;
+	init_completion(&mc->mc_gc_done);
+	spin_unlock(&mc->mc_user_lock);
+
+	task = kthread_run(mdd_changelog_gc_thread, mdd, "chlg_gc_thread");
+	if (IS_ERR(task)) {
+		CERROR("%s: cannot start changelog garbage collection "
+		       "thread: rc = %ld\n", mdd2obd_dev(mdd)->obd_name,
+		       PTR_ERR(task));
+		complete(&mc->mc_gc_done);
+	}
+}
+
 /** mdd_iocontrol
  * May be called remotely from mdt_iocontrol_handle or locally from
  * mdt_iocontrol. Data may be freeform - remote handling doesn't enforce
@@ -1503,7 +1679,8 @@ static int mdd_iocontrol(const struct lu_env *env, struct md_device *m,
 
         switch (cmd) {
         case OBD_IOC_CHANGELOG_REG:
-                rc = mdd_changelog_user_register(env, mdd, &data->ioc_u32_1);
+		rc = mdd_changelog_user_register(env, mdd, &data->ioc_u32_1,
+						 data->ioc_u32_2);
                 break;
         case OBD_IOC_CHANGELOG_DEREG:
                 rc = mdd_changelog_user_purge(env, mdd, data->ioc_u32_1,
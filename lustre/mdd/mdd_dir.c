@@ -696,6 +696,8 @@ int mdd_changelog_store(const struct lu_env *env, struct mdd_device *mdd,
 	rec->cr.cr_index = ++mdd->mdd_cl.mc_index;
 	spin_unlock(&mdd->mdd_cl.mc_lock);
 
+	mdd_changelog_gc_check(mdd, rec->cr.cr_index);
+
 	ctxt = llog_get_context(obd, LLOG_CHANGELOG_ORIG_CTXT);
 	if (ctxt == NULL)
 		return -ENXIO;
@@ -734,6 +736,8 @@ mdd_changelog_ext_store(const struct lu_env *env, struct mdd_device *mdd,
 	rec->cr.cr_index = ++mdd->mdd_cl.mc_index;
 	spin_unlock(&mdd->mdd_cl.mc_lock);
 
+	mdd_changelog_gc_check(mdd, rec->cr.cr_index);
+
 	ctxt = llog_get_context(obd, LLOG_CHANGELOG_ORIG_CTXT);
 	if (ctxt == NULL)
 		return -ENXIO;
@@ -769,7 +773,7 @@ int mdd_changelog_ns_store(const struct lu_env *env, struct mdd_device *mdd,
 	/* Not recording */
 	if (!(mdd->mdd_cl.mc_flags & CLM_ON))
 		RETURN(0);
-	if ((mdd->mdd_cl.mc_mask & (1 << type)) == 0)
+	if ((mdd->mdd_cl.mc_current_mask & (1 << type)) == 0)
 		RETURN(0);
 
 	LASSERT(target != NULL);
@@ -836,7 +840,7 @@ static int mdd_changelog_ext_ns_store(const struct lu_env  *env,
 	/* Not recording */
 	if (!(mdd->mdd_cl.mc_flags & CLM_ON))
 		RETURN(0);
-	if ((mdd->mdd_cl.mc_mask & (1 << type)) == 0)
+	if ((mdd->mdd_cl.mc_current_mask & (1 << type)) == 0)
 		RETURN(0);
 
 	LASSERT(sfid != NULL);
@@ -68,11 +68,22 @@
 struct mdd_changelog {
 	spinlock_t		mc_lock;	/* for index */
 	int			mc_flags;
-	int			mc_mask;
+	int			mc_mask;	/* set by the administrator */
+	/* record types actually logged, mc_mask & mc_users_mask */
+	int			mc_current_mask;
 	__u64			mc_index;
 	__u64			mc_starttime;
 	spinlock_t		mc_user_lock;
 	int			mc_lastuser;
+	/* below protected by mc_user_lock, refreshed by
+	 * mdd_changelog_users_scan() */
+	int			mc_users_mask;	/* union of the users' masks */
+	int			mc_minuser;	/* user the furthest behind */
+	__u64			mc_minrec;	/* and its last cleared index */
+	/* deregister a user lagging by more records than this, 0 never */
+	__u64			mc_max_idle_indexes;
+	unsigned int		mc_gc_running:1;
+	struct completion	mc_gc_done;
 };
 
 static inline __u64 cl_time(void) {
@@ -322,6 +333,8 @@ struct lu_object *mdd_object_alloc(const struct lu_env *env,
 int mdd_local_file_create(const struct lu_env *env, struct mdd_device *mdd,
 			  const struct lu_fid *pfid, const char *name,
 			  __u32 mode, struct lu_fid *fid);
+void mdd_changelog_update_mask(struct mdd_device *mdd);
+void mdd_changelog_gc_check(struct mdd_device *mdd, __u64 index);
 
 int mdd_acl_chmod(const struct lu_env *env, struct mdd_object *o, __u32 mode,
                   struct thandle *handle);
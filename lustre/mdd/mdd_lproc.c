@@ -162,8 +162,10 @@ static int lprocfs_wr_changelog_mask(struct file *file, const char *buffer,
 
 	rc = cfs_str2mask(kernbuf, changelog_type2str, &mdd->mdd_cl.mc_mask,
 			  CHANGELOG_MINMASK, CHANGELOG_ALLMASK);
-	if (rc == 0)
+	if (rc == 0) {
+		mdd_changelog_update_mask(mdd);
 		rc = count;
+	}
 out:
 	OBD_FREE(kernbuf, PAGE_CACHE_SIZE);
 	return rc;
@@ -173,6 +175,7 @@ struct cucb_data {
         char *page;
         int count;
         int idx;
+	__u64 cur;
 };
 
 static int lprocfs_changelog_users_cb(const struct lu_env *env,
@@ -186,9 +189,14 @@ static int lprocfs_changelog_users_cb(const struct lu_env *env,
 
         rec = (struct llog_changelog_user_rec *)hdr;
 
-        cucb->idx += snprintf(cucb->page + cucb->idx, cucb->count - cucb->idx,
-                              CHANGELOG_USER_PREFIX"%-3d "LPU64"\n",
-                              rec->cur_id, rec->cur_endrec);
+	/* lag is the number of records the user did not clear yet */
+	cucb->idx += snprintf(cucb->page + cucb->idx, cucb->count - cucb->idx,
+			      CHANGELOG_USER_PREFIX"%-3d "LPU64" "LPU64" %#x\n",
+			      rec->cur_id, rec->cur_endrec,
+			      cucb->cur > rec->cur_endrec ?
+			      cucb->cur - rec->cur_endrec : 0,
+			      rec->cur_mask != 0 ? rec->cur_mask :
+						   CHANGELOG_ALLMASK);
         if (cucb->idx >= cucb->count)
                 return -ENOSPC;
 
@@ -226,12 +234,13 @@ static int lprocfs_rd_changelog_users(char *page, char **start, off_t off,
         cucb.count = count;
         cucb.page = page;
         cucb.idx = 0;
+	cucb.cur = cur;
 
         cucb.idx += snprintf(cucb.page + cucb.idx, cucb.count - cucb.idx,
                               "current index: "LPU64"\n", cur);
 
         cucb.idx += snprintf(cucb.page + cucb.idx, cucb.count - cucb.idx,
-                              "%-5s %s\n", "ID", "index");
+			     "%-5s %s %s %s\n", "ID", "index", "lag", "mask");
 
 	llog_cat_process(&env, ctxt->loc_handle, lprocfs_changelog_users_cb,
 			 &cucb, 0, 0);
@@ -241,6 +250,34 @@ static int lprocfs_rd_changelog_users(char *page, char **start, off_t off,
 	return cucb.idx;
 }
 
+static int lprocfs_rd_changelog_max_idle_indexes(char *page, char **start,
+						 off_t off, int count,
+						 int *eof, void *data)
+{
+	struct mdd_device *mdd = data;
+
+	*eof = 1;
+	return snprintf(page, count, LPU64"\n",
+			mdd->mdd_cl.mc_max_idle_indexes);
+}
+
+static int lprocfs_wr_changelog_max_idle_indexes(struct file *file,
+						 const char *buffer,
+						 unsigned long count,
+						 void *data)
+{
+	struct mdd_device *mdd = data;
+	__u64 val;
+	int rc;
+
+	rc = lprocfs_write_u64_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	mdd->mdd_cl.mc_max_idle_indexes = val;
+	return count;
+}
+
 static int lprocfs_rd_sync_perm(char *page, char **start, off_t off,
                                 int count, int *eof, void *data)
 {
@@ -350,6 +387,9 @@ static struct lprocfs_vars lprocfs_mdd_obd_vars[] = {
         { "changelog_mask",  lprocfs_rd_changelog_mask,
                              lprocfs_wr_changelog_mask, 0 },
         { "changelog_users", lprocfs_rd_changelog_users, 0, 0},
+	{ "changelog_max_idle_indexes",
+			     lprocfs_rd_changelog_max_idle_indexes,
+			     lprocfs_wr_changelog_max_idle_indexes, 0 },
         { "sync_permission", lprocfs_rd_sync_perm, lprocfs_wr_sync_perm, 0 },
 	{ "lfsck_speed_limit", lprocfs_rd_lfsck_speed_limit,
 			       lprocfs_wr_lfsck_speed_limit, 0 },
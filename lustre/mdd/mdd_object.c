@@ -647,7 +647,7 @@ int mdd_changelog_data_store(const struct lu_env *env, struct mdd_device *mdd,
         /* Not recording */
         if (!(mdd->mdd_cl.mc_flags & CLM_ON))
                 RETURN(0);
-        if ((mdd->mdd_cl.mc_mask & (1 << type)) == 0)
+        if ((mdd->mdd_cl.mc_current_mask & (1 << type)) == 0)
                 RETURN(0);
 
         LASSERT(mdd_obj != NULL);
@@ -733,7 +733,7 @@ static int mdd_attr_set_changelog(const struct lu_env *env,
         bits |= (valid & LA_MTIME) ? 1 << CL_MTIME : 0;
         bits |= (valid & LA_CTIME) ? 1 << CL_CTIME : 0;
         bits |= (valid & LA_ATIME) ? 1 << CL_ATIME : 0;
-        bits = bits & mdd->mdd_cl.mc_mask;
+        bits = bits & mdd->mdd_cl.mc_current_mask;
 	/* This is an implementation limit rather than a protocol limit */
 	CLASSERT(CL_LAST <= sizeof(int) * 8);
         if (bits == 0)
@@ -4214,6 +4214,103 @@ int mdt_tgt_getxattr(struct tgt_session_info *tsi)
 	return rc;
 }
 
+/**
+ * Handle MDS_BATCH: a set of intent getattr enqueues, typically sent by the
+ * client statahead for the entries of one directory. Each of them is handled
+ * by the generic target code exactly as if it had arrived on its own, and
+ * its reply, including the granted LOOKUP|UPDATE lock handle, is packed into
+ * the batch reply in the same order and with the xid of its request. The ones
+ * left unhandled, with a zero length in the batch reply, are sent again by
+ * the client.
+ */
+static int mdt_batch(struct tgt_session_info *tsi)
+{
+	struct ptlrpc_request	*req = tgt_ses_req(tsi);
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct batch_buf	*bb;
+	struct batch_buf	*rbb;
+	struct lustre_msg	*msg;
+	int			 buflen;
+	int			 repsize;
+	int			 off;
+	int			 len;
+	int			 i;
+	int			 rc;
+	ENTRY;
+
+	bb = req_capsule_client_get(pill, &RMF_BATCH_REQ);
+	if (bb == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	buflen = req_capsule_get_size(pill, &RMF_BATCH_REQ, RCL_CLIENT);
+	/* a sub-request reply can't be larger than a reply of the service */
+	if (bb->bb_magic != BATCH_REQUEST_MAGIC || bb->bb_count == 0 ||
+	    bb->bb_count > BATCH_MAX_COUNT ||
+	    batch_buf_hdr_size(bb->bb_count) > buflen ||
+	    bb->bb_reply_size == 0 ||
+	    bb->bb_reply_size > req->rq_rqbd->rqbd_svcpt->scp_service->
+				srv_max_reply_size) {
+		CERROR("%s: bad batch from %s: magic %#x, count %u, size %u\n",
+		       tgt_name(tsi->tsi_tgt), libcfs_id2str(req->rq_peer),
+		       bb->bb_magic, bb->bb_count, bb->bb_reply_size);
+		RETURN(err_serious(-EPROTO));
+	}
+
+	repsize = batch_buf_hdr_size(bb->bb_count) +
+		  bb->bb_count * cfs_size_round(bb->bb_reply_size);
+	req_capsule_set_size(pill, &RMF_BATCH_REP, RCL_SERVER, repsize);
+	rc = req_capsule_server_pack(pill);
+	if (rc)
+		RETURN(err_serious(rc));
+
+	rbb = req_capsule_server_get(pill, &RMF_BATCH_REP);
+	rbb->bb_magic = BATCH_REPLY_MAGIC;
+	rbb->bb_count = bb->bb_count;
+	rbb->bb_padding = 0;
+	rbb->bb_reply_size = 0;
+	rbb->bb_padding2 = 0;
+
+	off = batch_buf_hdr_size(bb->bb_count);
+	for (i = 0; i < bb->bb_count; i++) {
+		rbb->bb_msgs[i].bm_xid = bb->bb_msgs[i].bm_xid;
+		rbb->bb_msgs[i].bm_len = 0;
+		rbb->bb_msgs[i].bm_padding = 0;
+
+		msg = batch_buf_msg(bb, buflen, i, &len);
+		if (msg == NULL) {
+			rc = -EPROTO;
+		} else if (repsize - off < bb->bb_reply_size) {
+			/* a larger reply took the space of this one, it is
+			 * not handled so that no lock is granted for it */
+			rc = -ENOSPC;
+		} else {
+			rc = ptlrpc_server_handle_batch_sub(req, msg, len,
+							bb->bb_msgs[i].bm_xid,
+							(char *)rbb + off,
+							repsize - off,
+							LDLM_ENQUEUE,
+							tgt_request_handle);
+		}
+		if (rc < 0) {
+			CDEBUG(D_INFO, "%s: batched request %d of %u from %s "
+			       "failed: rc = %d\n", tgt_name(tsi->tsi_tgt), i,
+			       bb->bb_count, libcfs_id2str(req->rq_peer), rc);
+			continue;
+		}
+
+		rbb->bb_msgs[i].bm_len = rc;
+		off += cfs_size_round(rc);
+		if (off > repsize)
+			off = repsize;
+	}
+
+	/* each sub-request restored the session of the batch */
+	LASSERT(tgt_ses_info(req->rq_svc_thread->t_env) == tsi);
+	req_capsule_shrink(pill, &RMF_BATCH_REP, off, RCL_SERVER);
+
+	RETURN(0);
+}
+
 static struct tgt_handler mdt_tgt_handlers[] = {
 TGT_RPC_HANDLER(MDS_FIRST_OPC,
 		0,			MDS_CONNECT,	mdt_tgt_connect,
@@ -4255,6 +4352,7 @@ TGT_MDT_HDL(HABEO_CORPUS| HABEO_REFERO, MDS_HSM_REQUEST,
 TGT_MDT_HDL(HABEO_CLAVIS | HABEO_CORPUS | HABEO_REFERO | MUTABOR,
 	    MDS_SWAP_LAYOUTS,
 	    mdt_swap_layouts),
+TGT_MDT_HDL(0,				MDS_BATCH,	mdt_batch),
 };
 
 static struct tgt_handler mdt_sec_ctx_ops[] = {
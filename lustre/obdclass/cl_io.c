@@ -1548,10 +1548,19 @@ void cl_req_attr_set(const struct lu_env *env, struct cl_req *req,
         LASSERT(!cfs_list_empty(&req->crq_pages));
         ENTRY;
 
-        /* Take any page to use as a model. */
         page = cfs_list_entry(req->crq_pages.next, struct cl_page, cp_flight);
 
         for (i = 0; i < req->crq_nrobjs; ++i) {
+		/*
+		 * Take any page of the i-th object to use as a model. Objects
+		 * are numbered in the order their first page was added, so
+		 * the scan can resume from the previous model page.
+		 */
+		while (cl_object_top(page->cp_obj) != req->crq_o[i].ro_obj) {
+			LASSERT(page->cp_flight.next != &req->crq_pages);
+			page = cfs_list_entry(page->cp_flight.next,
+					      struct cl_page, cp_flight);
+		}
                 cfs_list_for_each_entry(slice, &req->crq_layers, crs_linkage) {
                         const struct cl_page_slice *scan;
                         const struct cl_object     *obj;
@@ -169,6 +169,93 @@ out_err:
 }
 EXPORT_SYMBOL(llog_cancel_rec);
 
+/**
+ * Cancel up to LLOG_CANCEL_BATCH records of the same plain llog, writing
+ * its header once instead of once per record as llog_cancel_rec() does.
+ *
+ * Returns -ENOENT if some of the records were already cancelled, and
+ * LLOG_DEL_PLAIN if the llog became empty and was destroyed.
+ */
+int llog_cancel_recs(const struct lu_env *env, struct llog_handle *loghandle,
+		     int count, struct llog_cookie *cookies)
+{
+	struct llog_log_hdr	*llh = loghandle->lgh_hdr;
+	__u64			 cleared = 0;
+	int			 i, done = 0, rc = 0;
+
+	ENTRY;
+
+	LASSERT(count > 0 && count <= LLOG_CANCEL_BATCH);
+
+	spin_lock(&loghandle->lgh_hdr_lock);
+	for (i = 0; i < count; i++) {
+		int index = cookies[i].lgc_index;
+
+		if (index == 0) {
+			CERROR("Can't cancel index 0 which is header\n");
+			rc = -EINVAL;
+			continue;
+		}
+		if (!ext2_clear_bit(index, llh->llh_bitmap)) {
+			CDEBUG(D_RPCTRACE, "Catalog index %u already clear?\n",
+			       index);
+			if (rc == 0)
+				rc = -ENOENT;
+			continue;
+		}
+		llh->llh_count--;
+		cleared |= 1ULL << i;
+		done++;
+	}
+
+	if (done == 0) {
+		spin_unlock(&loghandle->lgh_hdr_lock);
+		RETURN(rc);
+	}
+
+	CDEBUG(D_RPCTRACE, "Canceled %d records in log "DOSTID"\n",
+	       done, POSTID(&loghandle->lgh_id.lgl_oi));
+
+	if ((llh->llh_flags & LLOG_F_ZAP_WHEN_EMPTY) &&
+	    (llh->llh_count == 1) &&
+	    (loghandle->lgh_last_idx == (LLOG_BITMAP_BYTES * 8) - 1)) {
+		spin_unlock(&loghandle->lgh_hdr_lock);
+		rc = llog_destroy(env, loghandle);
+		if (rc < 0) {
+			CERROR("%s: can't destroy empty llog #"DOSTID
+			       "#%08x: rc = %d\n",
+			       loghandle->lgh_ctxt->loc_obd->obd_name,
+			       POSTID(&loghandle->lgh_id.lgl_oi),
+			       loghandle->lgh_id.lgl_ogen, rc);
+			GOTO(out_err, rc);
+		}
+		RETURN(LLOG_DEL_PLAIN);
+	}
+	spin_unlock(&loghandle->lgh_hdr_lock);
+
+	i = llog_write(env, loghandle, &llh->llh_hdr, NULL, 0, NULL, 0);
+	if (i < 0) {
+		CERROR("%s: fail to write header for llog #"DOSTID
+		       "#%08x: rc = %d\n",
+		       loghandle->lgh_ctxt->loc_obd->obd_name,
+		       POSTID(&loghandle->lgh_id.lgl_oi),
+		       loghandle->lgh_id.lgl_ogen, i);
+		GOTO(out_err, rc = i);
+	}
+	RETURN(rc);
+out_err:
+	spin_lock(&loghandle->lgh_hdr_lock);
+	for (i = 0; i < count; i++) {
+		if (!(cleared & (1ULL << i)))
+			continue;
+		ext2_set_bit(cookies[i].lgc_index, llh->llh_bitmap);
+		llh->llh_count++;
+	}
+	spin_unlock(&loghandle->lgh_hdr_lock);
+	return rc;
+}
+EXPORT_SYMBOL(llog_cancel_recs);
+
 static int llog_read_header(const struct lu_env *env,
 			    struct llog_handle *handle,
 			    struct obd_uuid *uuid)
@@ -270,13 +357,18 @@ out:
 }
 EXPORT_SYMBOL(llog_init_handle);
 
+/* chunks read at once from a local llog, so that the records following
+ * the current chunk are already in memory when the callback returns */
+#define LLOG_PROCESS_READAHEAD	4
+
 static int llog_process_thread(void *arg)
 {
 	struct llog_process_info	*lpi = arg;
 	struct llog_handle		*loghandle = lpi->lpi_loghandle;
 	struct llog_log_hdr		*llh = loghandle->lgh_hdr;
 	struct llog_process_cat_data	*cd  = lpi->lpi_catdata;
-	char				*buf;
+	char				*buf = NULL;
+	int				 buf_len = LLOG_CHUNK_SIZE;
 	__u64				 cur_offset = LLOG_CHUNK_SIZE;
 	__u64				 last_offset;
 	int				 rc = 0, index = 1, last_index;
@@ -287,11 +379,19 @@ static int llog_process_thread(void *arg)
 
         LASSERT(llh);
 
-        OBD_ALLOC(buf, LLOG_CHUNK_SIZE);
-        if (!buf) {
-                lpi->lpi_rc = -ENOMEM;
+	/* remote llogs are read through llog_client, one chunk per RPC */
+	if (loghandle->lgh_obj != NULL) {
+		buf_len = LLOG_PROCESS_READAHEAD * LLOG_CHUNK_SIZE;
+		OBD_ALLOC_LARGE(buf, buf_len);
+	}
+	if (buf == NULL) {
+		buf_len = LLOG_CHUNK_SIZE;
+		OBD_ALLOC_LARGE(buf, buf_len);
+	}
+	if (buf == NULL) {
+		lpi->lpi_rc = -ENOMEM;
 		RETURN(0);
-        }
+	}
 
         if (cd != NULL) {
                 last_called_index = cd->lpcd_first_idx;
@@ -318,10 +418,10 @@ repeat:
                        index, last_index);
 
                 /* get the buf with our target record; avoid old garbage */
-                memset(buf, 0, LLOG_CHUNK_SIZE);
+		memset(buf, 0, buf_len);
                 last_offset = cur_offset;
 		rc = llog_next_block(lpi->lpi_env, loghandle, &saved_index,
-				     index, &cur_offset, buf, LLOG_CHUNK_SIZE);
+				     index, &cur_offset, buf, buf_len);
                 if (rc)
                         GOTO(out, rc);
 
@@ -329,7 +429,7 @@ repeat:
                  * since it is used at the "end" of the loop and the rec
                  * swabbing is done at the beginning of the loop. */
                 for (rec = (struct llog_rec_hdr *)buf;
-                     (char *)rec < buf + LLOG_CHUNK_SIZE;
+		     (char *)rec < buf + buf_len;
                      rec = (struct llog_rec_hdr *)((char *)rec + rec->lrh_len)){
 
                         CDEBUG(D_OTHER, "processing rec 0x%p type %#x\n",
@@ -364,7 +464,7 @@ repeat:
                         CDEBUG(D_OTHER,
                                "lrh_index: %d lrh_len: %d (%d remains)\n",
                                rec->lrh_index, rec->lrh_len,
-                               (int)(buf + LLOG_CHUNK_SIZE - (char *)rec));
+			       (int)(buf + buf_len - (char *)rec));
 
                         loghandle->lgh_cur_idx = rec->lrh_index;
                         loghandle->lgh_cur_offset = (char *)rec - (char *)buf +
@@ -413,7 +513,7 @@ out:
 		rc = 0;
 	}
 
-	OBD_FREE(buf, LLOG_CHUNK_SIZE);
+	OBD_FREE_LARGE(buf, buf_len);
         lpi->lpi_rc = rc;
         return 0;
 }
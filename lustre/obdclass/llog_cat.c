@@ -261,6 +261,17 @@ enum {
         LLOGH_LOG
 };
 
+/* whether no more records can be added to plain llog @loghandle, which can
+ * be made to happen after cfs_fail_val records to get many plain llogs */
+static inline bool llog_cat_log_full(struct llog_handle *loghandle)
+{
+	if (OBD_FAIL_CHECK(OBD_FAIL_CAT_RECORDS) &&
+	    loghandle->lgh_last_idx >= cfs_fail_val)
+		return true;
+	return loghandle->lgh_last_idx >=
+	       LLOG_BITMAP_SIZE(loghandle->lgh_hdr) - 1;
+}
+
 /** Return the currently active log handle.  If the current log handle doesn't
  * have enough space left for the current record, start a new one.
  *
@@ -284,8 +295,7 @@ static struct llog_handle *llog_cat_current_log(struct llog_handle *cathandle,
 
 		down_write_nested(&loghandle->lgh_lock, LLOGH_LOG);
 		llh = loghandle->lgh_hdr;
-		if (llh == NULL ||
-		    loghandle->lgh_last_idx < LLOG_BITMAP_SIZE(llh) - 1) {
+		if (llh == NULL || !llog_cat_log_full(loghandle)) {
 			up_read(&cathandle->lgh_lock);
                         RETURN(loghandle);
                 } else {
@@ -305,7 +315,7 @@ static struct llog_handle *llog_cat_current_log(struct llog_handle *cathandle,
 		down_write_nested(&loghandle->lgh_lock, LLOGH_LOG);
 		llh = loghandle->lgh_hdr;
 		LASSERT(llh);
-                if (loghandle->lgh_last_idx < LLOG_BITMAP_SIZE(llh) - 1) {
+		if (!llog_cat_log_full(loghandle)) {
 			up_write(&cathandle->lgh_lock);
                         RETURN(loghandle);
                 } else {
@@ -492,7 +502,8 @@ EXPORT_SYMBOL(llog_cat_add);
  * - the log is not empty, just write out the log header
  *
  * The cookies may be in different log files, so we need to get new logs
- * each time.
+ * each time. Consecutive cookies of the same log are cancelled together,
+ * so that its header is written once for all of them.
  *
  * Assumes caller has already pushed us into the kernel context.
  */
@@ -500,34 +511,51 @@ int llog_cat_cancel_records(const struct lu_env *env,
 			    struct llog_handle *cathandle, int count,
 			    struct llog_cookie *cookies)
 {
-	int i, index, rc = 0, failed = 0;
+	int i, n, index, rc = 0, failed = 0;
 
 	ENTRY;
 
-	for (i = 0; i < count; i++, cookies++) {
+	for (i = 0; i < count; i += n, cookies += n) {
 		struct llog_handle	*loghandle;
 		struct llog_logid	*lgl = &cookies->lgc_lgl;
 		int			 lrc;
 
-		rc = llog_cat_id2handle(env, cathandle, &loghandle, lgl);
-		if (rc) {
+		for (n = 1; n < count - i && n < LLOG_CANCEL_BATCH; n++) {
+			struct llog_logid *next = &cookies[n].lgc_lgl;
+
+			if (ostid_id(&next->lgl_oi) != ostid_id(&lgl->lgl_oi) ||
+			    ostid_seq(&next->lgl_oi) !=
+			    ostid_seq(&lgl->lgl_oi) ||
+			    next->lgl_ogen != lgl->lgl_ogen)
+				break;
+		}
+
+		lrc = llog_cat_id2handle(env, cathandle, &loghandle, lgl);
+		if (lrc) {
 			CERROR("%s: cannot find handle for llog "DOSTID": %d\n",
 			       cathandle->lgh_ctxt->loc_obd->obd_name,
-			       POSTID(&lgl->lgl_oi), rc);
-			failed++;
+			       POSTID(&lgl->lgl_oi), lrc);
+			failed += n;
+			rc = lrc;
 			continue;
 		}
 
-		lrc = llog_cancel_rec(env, loghandle, cookies->lgc_index);
+		if (n == 1)
+			lrc = llog_cancel_rec(env, loghandle,
+					      cookies->lgc_index);
+		else
+			lrc = llog_cancel_recs(env, loghandle, n, cookies);
 		if (lrc == LLOG_DEL_PLAIN) { /* log has been destroyed */
 			index = loghandle->u.phd.phd_cookie.lgc_index;
-			rc = llog_cat_cleanup(env, cathandle, loghandle,
-					      index);
+			lrc = llog_cat_cleanup(env, cathandle, loghandle,
+					       index);
+			if (lrc)
+				rc = lrc;
 		} else if (lrc == -ENOENT) {
 			if (rc == 0) /* ENOENT shouldn't rewrite any error */
 				rc = lrc;
 		} else if (lrc < 0) {
-			failed++;
+			failed += n;
 			rc = lrc;
 		}
 		llog_handle_put(loghandle);
@@ -592,45 +620,57 @@ int llog_cat_process_cb(const struct lu_env *env, struct llog_handle *cat_llh,
 	RETURN(rc);
 }
 
-int llog_cat_process_or_fork(const struct lu_env *env,
-			     struct llog_handle *cat_llh,
-			     llog_cb_t cb, void *data, int startcat,
-			     int startidx, bool fork)
+/* run @cat_cb over the catalog records, also when the catalog wrapped */
+static int llog_cat_process_common(const struct lu_env *env,
+				   struct llog_handle *cat_llh,
+				   llog_cb_t cat_cb, void *data, bool fork)
 {
-        struct llog_process_data d;
-        struct llog_log_hdr *llh = cat_llh->lgh_hdr;
-        int rc;
-        ENTRY;
+	struct llog_log_hdr *llh = cat_llh->lgh_hdr;
+	int rc;
 
-        LASSERT(llh->llh_flags & LLOG_F_IS_CAT);
-        d.lpd_data = data;
-        d.lpd_cb = cb;
-        d.lpd_startcat = startcat;
-        d.lpd_startidx = startidx;
+	ENTRY;
 
-        if (llh->llh_cat_idx > cat_llh->lgh_last_idx) {
-                struct llog_process_cat_data cd;
+	LASSERT(llh->llh_flags & LLOG_F_IS_CAT);
 
-                CWARN("catlog "DOSTID" crosses index zero\n",
-                      POSTID(&cat_llh->lgh_id.lgl_oi));
+	if (llh->llh_cat_idx > cat_llh->lgh_last_idx) {
+		struct llog_process_cat_data cd;
 
-                cd.lpcd_first_idx = llh->llh_cat_idx;
-                cd.lpcd_last_idx = 0;
-		rc = llog_process_or_fork(env, cat_llh, llog_cat_process_cb,
-					  &d, &cd, fork);
+		CWARN("catlog "DOSTID" crosses index zero\n",
+		      POSTID(&cat_llh->lgh_id.lgl_oi));
+
+		cd.lpcd_first_idx = llh->llh_cat_idx;
+		cd.lpcd_last_idx = 0;
+		rc = llog_process_or_fork(env, cat_llh, cat_cb, data, &cd,
+					  fork);
 		if (rc != 0)
 			RETURN(rc);
 
 		cd.lpcd_first_idx = 0;
 		cd.lpcd_last_idx = cat_llh->lgh_last_idx;
-		rc = llog_process_or_fork(env, cat_llh, llog_cat_process_cb,
-					  &d, &cd, fork);
-        } else {
-		rc = llog_process_or_fork(env, cat_llh, llog_cat_process_cb,
-					  &d, NULL, fork);
-        }
+		rc = llog_process_or_fork(env, cat_llh, cat_cb, data, &cd,
+					  fork);
+	} else {
+		rc = llog_process_or_fork(env, cat_llh, cat_cb, data, NULL,
+					  fork);
+	}
 
-        RETURN(rc);
+	RETURN(rc);
+}
+
+int llog_cat_process_or_fork(const struct lu_env *env,
+			     struct llog_handle *cat_llh,
+			     llog_cb_t cb, void *data, int startcat,
+			     int startidx, bool fork)
+{
+	struct llog_process_data d;
+
+	d.lpd_data = data;
+	d.lpd_cb = cb;
+	d.lpd_startcat = startcat;
+	d.lpd_startidx = startidx;
+
+	return llog_cat_process_common(env, cat_llh, llog_cat_process_cb, &d,
+				       fork);
 }
 EXPORT_SYMBOL(llog_cat_process_or_fork);
 
@@ -642,6 +682,291 @@ int llog_cat_process(const struct lu_env *env, struct llog_handle *cat_llh,
 }
 EXPORT_SYMBOL(llog_cat_process);
 
+static int llog_cat_cancel_index(const struct lu_env *env,
+				 struct llog_handle *cathandle, int index);
+
+#ifdef __KERNEL__
+/* default number of threads walking a catalog in parallel */
+#define LLOG_CAT_PAR_THREADS	8
+
+struct llog_cat_par_entry {
+	cfs_list_t		 lpe_list;
+	struct llog_logid_rec	 lpe_rec;
+};
+
+struct llog_cat_par_cancel {
+	cfs_list_t		 lpc_list;
+	int			 lpc_index;
+};
+
+struct llog_cat_par_data {
+	struct llog_handle	*lcp_cat;
+	llog_cb_t		 lcp_cb;
+	void			*lcp_data;
+	spinlock_t		 lcp_lock;
+	/* catalog records not taken by a thread yet */
+	cfs_list_t		 lcp_entries;
+	int			 lcp_count;
+	/* catalog indices to cancel, only by the thread which started the
+	 * walk so that the catalog header is updated by one thread */
+	cfs_list_t		 lcp_cancels;
+	/* first error, stops the other threads */
+	int			 lcp_rc;
+	atomic_t		 lcp_running;
+	wait_queue_head_t	 lcp_waitq;
+};
+
+static int llog_cat_par_collect(const struct lu_env *env,
+				struct llog_handle *cat_llh,
+				struct llog_rec_hdr *rec, void *data)
+{
+	struct llog_cat_par_data	*lcp = data;
+	struct llog_cat_par_entry	*lpe;
+
+	if (rec->lrh_type != LLOG_LOGID_MAGIC) {
+		CERROR("invalid record in catalog\n");
+		return -EINVAL;
+	}
+
+	OBD_ALLOC_PTR(lpe);
+	if (lpe == NULL)
+		return -ENOMEM;
+
+	lpe->lpe_rec = *(struct llog_logid_rec *)rec;
+	cfs_list_add_tail(&lpe->lpe_list, &lcp->lcp_entries);
+	lcp->lcp_count++;
+	return 0;
+}
+
+/*
+ * Called by llog_cat_cleanup() while \a cathandle is walked in parallel, to
+ * queue the cancel of \a index for llog_cat_par_cancel(). Returns -EAGAIN
+ * if the catalog is not walked in parallel.
+ */
+static int llog_cat_par_queue_cancel(struct llog_handle *cathandle, int index)
+{
+	struct llog_cat_par_data	*lcp = cathandle->u.chd.chd_par;
+	struct llog_cat_par_cancel	*lpc;
+
+	if (lcp == NULL)
+		return -EAGAIN;
+
+	OBD_ALLOC_PTR(lpc);
+	if (lpc == NULL)
+		return -ENOMEM;
+
+	lpc->lpc_index = index;
+	spin_lock(&lcp->lcp_lock);
+	cfs_list_add_tail(&lpc->lpc_list, &lcp->lcp_cancels);
+	spin_unlock(&lcp->lcp_lock);
+	return 0;
+}
+
+static void llog_cat_par_cancel(const struct lu_env *env,
+				struct llog_cat_par_data *lcp)
+{
+	struct llog_cat_par_cancel	*lpc;
+
+	while (1) {
+		spin_lock(&lcp->lcp_lock);
+		if (cfs_list_empty(&lcp->lcp_cancels)) {
+			spin_unlock(&lcp->lcp_lock);
+			break;
+		}
+		lpc = cfs_list_entry(lcp->lcp_cancels.next,
+				     struct llog_cat_par_cancel, lpc_list);
+		cfs_list_del(&lpc->lpc_list);
+		spin_unlock(&lcp->lcp_lock);
+
+		llog_cat_cancel_index(env, lcp->lcp_cat, lpc->lpc_index);
+		OBD_FREE_PTR(lpc);
+	}
+}
+
+static void llog_cat_par_run(const struct lu_env *env,
+			     struct llog_cat_par_data *lcp, bool master)
+{
+	struct llog_cat_par_entry	*lpe;
+	int				 rc;
+
+	while (1) {
+		/* the walking thread cancels the catalog records of the
+		 * plain llogs destroyed so far */
+		if (master)
+			llog_cat_par_cancel(env, lcp);
+
+		spin_lock(&lcp->lcp_lock);
+		if (lcp->lcp_rc != 0 || cfs_list_empty(&lcp->lcp_entries)) {
+			spin_unlock(&lcp->lcp_lock);
+			break;
+		}
+		lpe = cfs_list_entry(lcp->lcp_entries.next,
+				     struct llog_cat_par_entry, lpe_list);
+		cfs_list_del(&lpe->lpe_list);
+		spin_unlock(&lcp->lcp_lock);
+
+		rc = lcp->lcp_cb(env, lcp->lcp_cat, &lpe->lpe_rec.lid_hdr,
+				 lcp->lcp_data);
+		OBD_FREE_PTR(lpe);
+		if (rc != 0) {
+			spin_lock(&lcp->lcp_lock);
+			if (lcp->lcp_rc == 0)
+				lcp->lcp_rc = rc;
+			spin_unlock(&lcp->lcp_lock);
+		}
+	}
+}
+
+static int llog_cat_par_thread(void *arg)
+{
+	struct llog_cat_par_data	*lcp = arg;
+	struct lu_env			 env;
+	int				 rc;
+
+	unshare_fs_struct();
+
+	/* same env as llog_process_thread_daemonize() */
+	rc = lu_env_init(&env, LCT_LOCAL | LCT_MG_THREAD);
+	if (rc == 0) {
+		llog_cat_par_run(&env, lcp, false);
+		lu_env_fini(&env);
+	} else {
+		spin_lock(&lcp->lcp_lock);
+		if (lcp->lcp_rc == 0)
+			lcp->lcp_rc = rc;
+		spin_unlock(&lcp->lcp_lock);
+	}
+
+	/* the walking thread frees @lcp once it has seen lcp_running drop to
+	 * 0 and taken lcp_lock, so this is the last access to @lcp */
+	spin_lock(&lcp->lcp_lock);
+	if (atomic_dec_and_test(&lcp->lcp_running))
+		wake_up(&lcp->lcp_waitq);
+	spin_unlock(&lcp->lcp_lock);
+	return 0;
+}
+
+/*
+ * Call @cat_cb for each record of the catalog from up to @nthreads threads,
+ * the caller being one of them. The catalog is read first, then its records
+ * are handed out one by one, so @cat_cb is called concurrently for different
+ * plain llogs, in no particular order. Meanwhile llog_cat_cleanup() only
+ * queues its catalog cancels, which the caller does by itself so that the
+ * catalog header is never updated concurrently.
+ */
+static int llog_cat_walk_parallel(const struct lu_env *env,
+				  struct llog_handle *cat_llh,
+				  llog_cb_t cat_cb, void *data, int nthreads)
+{
+	struct llog_cat_par_data	*lcp;
+	struct llog_cat_par_entry	*lpe, *tmp;
+	int				 started = 0;
+	int				 rc;
+	int				 i;
+
+	ENTRY;
+
+	OBD_ALLOC_PTR(lcp);
+	if (lcp == NULL)
+		RETURN(-ENOMEM);
+
+	lcp->lcp_cat = cat_llh;
+	lcp->lcp_cb = cat_cb;
+	lcp->lcp_data = data;
+	spin_lock_init(&lcp->lcp_lock);
+	CFS_INIT_LIST_HEAD(&lcp->lcp_entries);
+	CFS_INIT_LIST_HEAD(&lcp->lcp_cancels);
+	atomic_set(&lcp->lcp_running, 0);
+	init_waitqueue_head(&lcp->lcp_waitq);
+
+	rc = llog_cat_process_common(env, cat_llh, llog_cat_par_collect, lcp,
+				     false);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	if (nthreads <= 0)
+		nthreads = min_t(int, num_online_cpus(), LLOG_CAT_PAR_THREADS);
+	nthreads = min(nthreads, lcp->lcp_count);
+
+	CDEBUG(D_HA, "%s: process %d logs of catalog "DOSTID" with %d "
+	       "threads\n", cat_llh->lgh_ctxt->loc_obd->obd_name,
+	       lcp->lcp_count, POSTID(&cat_llh->lgh_id.lgl_oi), nthreads);
+
+	cat_llh->u.chd.chd_par = lcp;
+	/* the caller is the first thread */
+	for (i = 1; i < nthreads; i++) {
+		struct task_struct *task;
+
+		atomic_inc(&lcp->lcp_running);
+		task = kthread_run(llog_cat_par_thread, lcp, "llog_cat_%02d",
+				   i);
+		if (IS_ERR(task)) {
+			atomic_dec(&lcp->lcp_running);
+			CWARN("%s: cannot start thread, %d running: rc = %ld\n",
+			      cat_llh->lgh_ctxt->loc_obd->obd_name, started,
+			      PTR_ERR(task));
+			break;
+		}
+		started++;
+	}
+
+	llog_cat_par_run(env, lcp, true);
+	wait_event(lcp->lcp_waitq, atomic_read(&lcp->lcp_running) == 0);
+	/* wait for the last thread to be done with wake_up() */
+	spin_lock(&lcp->lcp_lock);
+	spin_unlock(&lcp->lcp_lock);
+	cat_llh->u.chd.chd_par = NULL;
+	llog_cat_par_cancel(env, lcp);
+	rc = lcp->lcp_rc;
+	EXIT;
+out:
+	cfs_list_for_each_entry_safe(lpe, tmp, &lcp->lcp_entries, lpe_list) {
+		cfs_list_del(&lpe->lpe_list);
+		OBD_FREE_PTR(lpe);
+	}
+	OBD_FREE_PTR(lcp);
+	return rc;
+}
+#else
+static int llog_cat_par_queue_cancel(struct llog_handle *cathandle, int index)
+{
+	return -EAGAIN;
+}
+
+static int llog_cat_walk_parallel(const struct lu_env *env,
+				  struct llog_handle *cat_llh,
+				  llog_cb_t cat_cb, void *data, int nthreads)
+{
+	return llog_cat_process_common(env, cat_llh, cat_cb, data, false);
+}
+#endif
+
+/**
+ * Process the plain llogs of a catalog in parallel, @nthreads of them at a
+ * time, 0 picks a default. Records of one plain llog are still passed to
+ * @cb in order, from a single thread, but plain llogs are not processed in
+ * catalog order and @cb has to be safe to call concurrently for different
+ * ones. The catalog records of the plain llogs destroyed meanwhile are
+ * cancelled by the calling thread only. LLOG_PROC_BREAK or an error
+ * returned by @cb stops all threads once they are done with their current
+ * plain llog.
+ */
+int llog_cat_process_parallel(const struct lu_env *env,
+			      struct llog_handle *cat_llh, llog_cb_t cb,
+			      void *data, int nthreads)
+{
+	struct llog_process_data d;
+
+	d.lpd_data = data;
+	d.lpd_cb = cb;
+	d.lpd_startcat = 0;
+	d.lpd_startidx = 0;
+
+	return llog_cat_walk_parallel(env, cat_llh, llog_cat_process_cb, &d,
+				      nthreads);
+}
+EXPORT_SYMBOL(llog_cat_process_parallel);
+
 static int llog_cat_reverse_process_cb(const struct lu_env *env,
 				       struct llog_handle *cat_llh,
 				       struct llog_rec_hdr *rec, void *data)
@@ -770,8 +1095,24 @@ int llog_cat_cleanup(const struct lu_env *env, struct llog_handle *cathandle,
 		/* llog was opened and keep in a list, close it now */
 		llog_close(env, loghandle);
 	}
-	/* remove plain llog entry from catalog by index */
+	/* the threads of a parallel walk leave the catalog header to the
+	 * thread which started it */
+	rc = llog_cat_par_queue_cancel(cathandle, index);
+	if (rc != -EAGAIN)
+		return rc;
+
+	return llog_cat_cancel_index(env, cathandle, index);
+}
+
+/* remove plain llog entry from catalog by index */
+static int llog_cat_cancel_index(const struct lu_env *env,
+				 struct llog_handle *cathandle, int index)
+{
+	int rc;
+
+	spin_lock(&cathandle->lgh_hdr_lock);
 	llog_cat_set_first_idx(cathandle, index);
+	spin_unlock(&cathandle->lgh_hdr_lock);
 	rc = llog_cancel_rec(env, cathandle, index);
 	if (rc == 0)
 		CDEBUG(D_HA, "cancel plain log at index"
@@ -838,7 +1179,9 @@ int llog_cat_init_and_process(const struct lu_env *env,
 	if (rc)
 		RETURN(rc);
 
-	rc = llog_process_or_fork(env, llh, cat_cancel_cb, NULL, NULL, false);
+	/* plain llogs are opened and checked independently, which takes
+	 * a while for a large backlog after failover, do it in parallel */
+	rc = llog_cat_walk_parallel(env, llh, cat_cancel_cb, NULL, 0);
 	if (rc)
 		CERROR("%s: llog_process() with cat_cancel_cb failed: rc = "
 		       "%d\n", llh->lgh_ctxt->loc_obd->obd_name, rc);
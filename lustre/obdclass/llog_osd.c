@@ -573,8 +573,10 @@ static int llog_osd_next_block(const struct lu_env *env,
 
 		llog_skip_over(cur_offset, *cur_idx, next_idx);
 
-		/* read up to next LLOG_CHUNK_SIZE block */
-		lgi->lgi_buf.lb_len = LLOG_CHUNK_SIZE -
+		/* read up to the end of the LLOG_CHUNK_SIZE block, or of
+		 * the following ones if the caller's buffer can hold them,
+		 * records never cross a chunk boundary */
+		lgi->lgi_buf.lb_len = len -
 				      (*cur_offset & (LLOG_CHUNK_SIZE - 1));
 		lgi->lgi_buf.lb_buf = buf;
 
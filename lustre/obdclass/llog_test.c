@@ -473,6 +473,22 @@ static int plain_print_cb(const struct lu_env *env, struct llog_handle *llh,
 	RETURN(0);
 }
 
+static atomic_t plain_par_counter;
+
+/* called concurrently for different plain llogs */
+static int plain_par_cb(const struct lu_env *env, struct llog_handle *llh,
+			struct llog_rec_hdr *rec, void *data)
+{
+	if (!(llh->lgh_hdr->llh_flags & LLOG_F_IS_PLAIN)) {
+		CERROR("log is not plain\n");
+		RETURN(-EINVAL);
+	}
+
+	atomic_inc(&plain_par_counter);
+
+	RETURN(0);
+}
+
 static int cancel_count;
 
 static int llog_cancel_rec_cb(const struct lu_env *env,
@@ -591,11 +607,25 @@ static int llog_test_5(const struct lu_env *env, struct obd_device *obd)
 		GOTO(out, rc = -EINVAL);
 	}
 
+	CWARN("5g: print plain log entries in parallel.. expect 6\n");
+	atomic_set(&plain_par_counter, 0);
+	rc = llog_cat_process_parallel(env, llh, plain_par_cb, NULL, 0);
+	if (rc) {
+		CERROR("5g: parallel process with plain_par_cb failed: %d\n",
+		       rc);
+		GOTO(out, rc);
+	}
+	if (atomic_read(&plain_par_counter) != 6) {
+		CERROR("5g: found %d records\n",
+		       atomic_read(&plain_par_counter));
+		GOTO(out, rc = -EINVAL);
+	}
+
 out:
-	CWARN("5g: close re-opened catalog\n");
+	CWARN("5h: close re-opened catalog\n");
 	rc2 = llog_cat_close(env, llh);
 	if (rc2) {
-		CERROR("5g: close log %s failed: %d\n", name, rc2);
+		CERROR("5h: close log %s failed: %d\n", name, rc2);
 		if (rc == 0)
 			rc = rc2;
 	}
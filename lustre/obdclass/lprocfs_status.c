@@ -1032,6 +1032,12 @@ static const char *obd_connect_names[] = {
 	"pingless",
 	"flock_deadlock",
 	"disp_stripe",
+	"open_by_fid",
+	"lfsck",
+	"batch_rpc",
+	"multiobj_brw",
+	"destroy_batch",
+	"lockahead",
 	"unknown",
 	NULL
 };
@@ -2013,36 +2019,40 @@ EXPORT_SYMBOL(lprocfs_free_per_client_stats);
 int lprocfs_stats_alloc_one(struct lprocfs_stats *stats, unsigned int cpuid)
 {
 	struct lprocfs_counter  *cntr;
+	struct lprocfs_percpu   *percpu;
 	unsigned int            percpusize;
+	unsigned int            old;
 	int                     rc = -ENOMEM;
-	unsigned long           flags = 0;
 	int                     i;
 
 	LASSERT(stats->ls_percpu[cpuid] == NULL);
 	LASSERT((stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU) == 0);
 
 	percpusize = lprocfs_stats_counter_size(stats);
-	LIBCFS_ALLOC_ATOMIC(stats->ls_percpu[cpuid], percpusize);
-	if (stats->ls_percpu[cpuid] != NULL) {
+	LIBCFS_ALLOC_ATOMIC(percpu, percpusize);
+	if (percpu != NULL) {
 		rc = 0;
-		if (unlikely(stats->ls_biggest_alloc_num <= cpuid)) {
-			if (stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE)
-				spin_lock_irqsave(&stats->ls_lock, flags);
-			else
-				spin_lock(&stats->ls_lock);
-			if (stats->ls_biggest_alloc_num <= cpuid)
-				stats->ls_biggest_alloc_num = cpuid + 1;
-			if (stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) {
-				spin_unlock_irqrestore(&stats->ls_lock, flags);
-			} else {
-				spin_unlock(&stats->ls_lock);
-			}
-		}
-		/* initialize the ls_percpu[cpuid] non-zero counter */
+		/* initialize the non-zero counters before the area is
+		 * published in ls_percpu[cpuid], a concurrent reader must not
+		 * see them uninitialized */
 		for (i = 0; i < stats->ls_num; ++i) {
-			cntr = lprocfs_stats_counter_get(stats, cpuid, i);
+			cntr = &percpu->lp_cntr[i];
+			if ((stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) != 0)
+				cntr = (void *)cntr + i * sizeof(__s64);
 			cntr->lc_min = LC_MIN_INIT;
 		}
+		smp_wmb();
+		stats->ls_percpu[cpuid] = percpu;
+		/* readers only look at slots below ls_biggest_alloc_num, so
+		 * publish it after the slot is ready, and without taking
+		 * ls_lock which would be shared by all CPUs */
+		smp_wmb();
+		do {
+			old = stats->ls_biggest_alloc_num;
+			if (old > cpuid)
+				break;
+		} while (cmpxchg(&stats->ls_biggest_alloc_num, old,
+				 cpuid + 1) != old);
 	}
 	return rc;
 }
@@ -2267,16 +2277,95 @@ struct file_operations lprocfs_stats_seq_fops = {
         .release = lprocfs_seq_release,
 };
 
+/*
+ * Binary export of all counters of a stats at once, see
+ * struct lprocfs_stats_bin_header, so that collectors don't have to parse
+ * the text format.
+ */
+static int lprocfs_stats_bin_seq_show(struct seq_file *p, void *v)
+{
+	struct lprocfs_stats		*stats = p->private;
+	struct lprocfs_stats_bin_header	 bhdr;
+	struct lprocfs_stats_bin_counter bcnt;
+	struct lprocfs_counter_header	*hdr;
+	struct lprocfs_counter		 ctr;
+	struct timeval			 now;
+	int				 idx;
+
+	do_gettimeofday(&now);
+	memset(&bhdr, 0, sizeof(bhdr));
+	bhdr.lsbh_magic = LPROCFS_STATS_BIN_MAGIC;
+	bhdr.lsbh_version = LPROCFS_STATS_BIN_VERSION;
+	bhdr.lsbh_count = stats->ls_num;
+	bhdr.lsbh_counter_size = sizeof(bcnt);
+	bhdr.lsbh_snapshot_sec = now.tv_sec;
+	bhdr.lsbh_snapshot_usec = now.tv_usec;
+	/* seq_read() retries with a larger buffer if this overflows */
+	seq_write(p, &bhdr, sizeof(bhdr));
+
+	for (idx = 0; idx < stats->ls_num; idx++) {
+		hdr = &stats->ls_cnt_header[idx];
+		lprocfs_stats_collect(stats, idx, &ctr);
+
+		memset(&bcnt, 0, sizeof(bcnt));
+		bcnt.lsbc_config = hdr->lc_config;
+		bcnt.lsbc_count = ctr.lc_count;
+		if (ctr.lc_count > 0) {
+			bcnt.lsbc_min = ctr.lc_min;
+			bcnt.lsbc_max = ctr.lc_max;
+		}
+		bcnt.lsbc_sum = ctr.lc_sum;
+		bcnt.lsbc_sumsquare = ctr.lc_sumsquare;
+		if (hdr->lc_name != NULL)
+			strlcpy(bcnt.lsbc_name, hdr->lc_name,
+				sizeof(bcnt.lsbc_name));
+		if (hdr->lc_units != NULL)
+			strlcpy(bcnt.lsbc_units, hdr->lc_units,
+				sizeof(bcnt.lsbc_units));
+
+		seq_write(p, &bcnt, sizeof(bcnt));
+	}
+	return 0;
+}
+
+static int lprocfs_stats_bin_seq_open(struct inode *inode, struct file *file)
+{
+	struct lprocfs_stats *stats = PDE_DATA(inode);
+
+#ifndef HAVE_ONLY_PROCFS_SEQ
+	if (LPROCFS_ENTRY_CHECK(PDE(inode)))
+		return -ENOENT;
+#endif
+	return single_open(file, lprocfs_stats_bin_seq_show, stats);
+}
+
+static struct file_operations lprocfs_stats_bin_seq_fops = {
+	.owner   = THIS_MODULE,
+	.open    = lprocfs_stats_bin_seq_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = lprocfs_single_release,
+};
+
 int lprocfs_register_stats(struct proc_dir_entry *root, const char *name,
                            struct lprocfs_stats *stats)
 {
 	struct proc_dir_entry *entry;
+	char bin_name[MAX_STRING_SIZE];
 	LASSERT(root != NULL);
 
 	entry = proc_create_data(name, 0644, root,
 				 &lprocfs_stats_seq_fops, stats);
 	if (entry == NULL)
 		return -ENOMEM;
+
+	snprintf(bin_name, sizeof(bin_name), "%s_binary", name);
+	entry = proc_create_data(bin_name, 0444, root,
+				 &lprocfs_stats_bin_seq_fops, stats);
+	if (entry == NULL) {
+		remove_proc_entry(name, root);
+		return -ENOMEM;
+	}
 	return 0;
 }
 EXPORT_SYMBOL(lprocfs_register_stats);
@@ -1520,6 +1520,142 @@ out:
 	return rc;
 }
 
+/* Destroy or chown one object of an OST_DESTROY_BATCH request, the same
+ * way ofd_destroy_hdl() and ofd_setattr_hdl() do for a single one. */
+static int ofd_batch_rec_handle(struct tgt_session_info *tsi,
+				struct ost_batch_rec *obr)
+{
+	struct ofd_device	*ofd = ofd_exp(tsi->tsi_exp);
+	struct ofd_thread_info	*fti = tsi2ofd_info(tsi);
+	struct lu_fid		*fid = &fti->fti_fid;
+	struct ldlm_resource	*res;
+	struct ofd_object	*fo;
+	obd_id			 oid = ostid_id(&obr->obr_oi);
+	__u32			 count;
+	int			 rc;
+
+	if (oid == 0)
+		return -EPROTO;
+
+	rc = ostid_to_fid(fid, &obr->obr_oi,
+			  tsi->tsi_tgt->lut_lsd.lsd_osd_index);
+	if (rc != 0)
+		return rc;
+
+	switch (obr->obr_op) {
+	case OST_DESTROY:
+		count = obr->obr_count ?: 1;
+		while (count > 0) {
+			int lrc;
+
+			lrc = ofd_destroy_by_fid(tsi->tsi_env, ofd, fid, 0);
+			if (lrc == -ENOENT) {
+				CDEBUG(D_INODE, "%s: destroying non-existent "
+				       "object "DFID"\n", ofd_name(ofd),
+				       PFID(fid));
+				if (rc == 0)
+					rc = lrc;
+			} else if (lrc != 0) {
+				CERROR("%s: error destroying object "DFID
+				       ": %d\n", ofd_name(ofd), PFID(fid), lrc);
+				rc = lrc;
+			}
+
+			if (--count > 0) {
+				lrc = fid_set_id(fid, ++oid);
+				if (unlikely(lrc != 0))
+					return lrc;
+			}
+		}
+		ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_DESTROY,
+				 tsi->tsi_jobid, 1);
+		break;
+	case OST_SETATTR:
+		fo = ofd_object_find_exists(tsi->tsi_env, ofd, fid);
+		if (IS_ERR(fo))
+			return PTR_ERR(fo);
+
+		memset(&fti->fti_attr, 0, sizeof(fti->fti_attr));
+		fti->fti_attr.la_uid = obr->obr_uid;
+		fti->fti_attr.la_gid = obr->obr_gid;
+		fti->fti_attr.la_valid = LA_UID | LA_GID;
+		rc = ofd_attr_set(tsi->tsi_env, fo, &fti->fti_attr, NULL);
+		ofd_object_put(tsi->tsi_env, fo);
+		if (rc != 0)
+			return rc;
+
+		/* see ofd_setattr_hdl() for why this is done after put */
+		ost_fid_build_resid(fid, &fti->fti_resid);
+		res = ldlm_resource_get(ofd->ofd_namespace, NULL,
+					&fti->fti_resid, LDLM_EXTENT, 0);
+		if (res != NULL) {
+			ldlm_res_lvbo_update(res, NULL, 0);
+			ldlm_resource_putref(res);
+		}
+		ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_SETATTR,
+				 tsi->tsi_jobid, 1);
+		break;
+	default:
+		rc = -EOPNOTSUPP;
+		break;
+	}
+
+	return rc;
+}
+
+/**
+ * OST_DESTROY_BATCH handler, used by OSP to sync many unlink/setattr llog
+ * records in one RPC. Each record gets its own result in RMF_RCS so that
+ * the sender cancels exactly the records which were applied, the request
+ * itself only fails if it can't be parsed.
+ */
+static int ofd_destroy_batch_hdl(struct tgt_session_info *tsi)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct ofd_device	*ofd = ofd_exp(tsi->tsi_exp);
+	struct ost_batch_rec	*obr;
+	__u32			*rcs;
+	int			 count;
+	int			 i;
+	int			 rc;
+
+	ENTRY;
+
+	if (OBD_FAIL_CHECK(OBD_FAIL_OST_EROFS))
+		RETURN(-EROFS);
+
+	obr = req_capsule_client_get(pill, &RMF_OST_BATCH_REC);
+	if (obr == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	count = req_capsule_get_size(pill, &RMF_OST_BATCH_REC, RCL_CLIENT) /
+		sizeof(*obr);
+	if (count == 0 || count > OST_BATCH_MAX_RECS)
+		RETURN(err_serious(-EPROTO));
+
+	req_capsule_set_size(pill, &RMF_RCS, RCL_SERVER,
+			     count * sizeof(*rcs));
+	rc = req_capsule_server_pack(pill);
+	if (rc != 0)
+		RETURN(err_serious(rc));
+
+	rcs = req_capsule_server_get(pill, &RMF_RCS);
+	LASSERT(rcs != NULL);
+
+	CDEBUG(D_HA, "%s: batch of %d destroy/setattr records\n",
+	       ofd_name(ofd), count);
+
+	/* each record commits in its own transaction(s), the reply carries
+	 * the highest transno so that OSP cancels the llog records only once
+	 * all of them are on disk */
+	tgt_mult_trans_set(tsi);
+
+	for (i = 0; i < count; i++)
+		rcs[i] = ofd_batch_rec_handle(tsi, &obr[i]);
+
+	RETURN(0);
+}
+
 static int ofd_statfs_hdl(struct tgt_session_info *tsi)
 {
 	struct obd_statfs	*osfs;
@@ -2053,6 +2189,8 @@ TGT_OST_HDL_HP(HABEO_CORPUS| HABEO_REFERO | MUTABOR,
 							ofd_hp_punch),
 TGT_OST_HDL(HABEO_CORPUS| HABEO_REFERO,	OST_SYNC,	ofd_sync_hdl),
 TGT_OST_HDL(0		| HABEO_REFERO,	OST_QUOTACTL,	ofd_quotactl),
+TGT_OST_HDL(0		| MUTABOR,	OST_DESTROY_BATCH,
+						ofd_destroy_batch_hdl),
 };
 
 static struct tgt_opc_slice ofd_common_slice[] = {
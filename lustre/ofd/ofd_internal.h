@@ -326,6 +326,9 @@ struct ofd_thread_info {
 
 	/* Space used by the I/O, used by grant code */
 	unsigned long			 fti_used;
+	/* local buffers of each object of a BRW write, set by
+	 * ofd_preprw_write() and consumed by ofd_commitrw() */
+	int				 fti_brw_nr_local[PTLRPC_MAX_BRW_OBJS];
 	struct ost_lvb			 fti_lvb;
 	struct lfsck_request		 fti_lr;
 };
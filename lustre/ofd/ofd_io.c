@@ -421,19 +421,20 @@ unlock:
 	return rc;
 }
 
-static int ofd_preprw_write(const struct lu_env *env, struct obd_export *exp,
-			    struct ofd_device *ofd, const struct lu_fid *fid,
-			    struct lu_attr *la, struct obdo *oa,
-			    int objcount, struct obd_ioobj *obj,
-			    struct niobuf_remote *rnb, int *nr_local,
-			    struct niobuf_local *lnb, char *jobid)
+/*
+ * Find and read-lock one object of a BRW write. The reference and the lock
+ * are kept until ofd_commitrw_write(), or dropped by ofd_preprw_write_put()
+ * if the preparation fails.
+ */
+static struct ofd_object *ofd_preprw_write_get(const struct lu_env *env,
+					       struct obd_export *exp,
+					       struct ofd_device *ofd,
+					       struct obdo *oa,
+					       struct obd_ioobj *obj)
 {
+	const struct lu_fid	*fid = &oa->o_oi.oi_fid;
 	struct ofd_object	*fo;
-	int			 i, j, k, rc = 0, tot_bytes = 0;
-
-	ENTRY;
-	LASSERT(env != NULL);
-	LASSERT(objcount == 1);
+	int			 rc;
 
 	if (unlikely(exp->exp_obd->obd_recovering)) {
 		struct ofd_thread_info *info = ofd_info(env);
@@ -458,66 +459,118 @@ static int ofd_preprw_write(const struct lu_env *env, struct obd_export *exp,
 	}
 
 	if (IS_ERR(fo))
-		GOTO(out, rc = PTR_ERR(fo));
+		return fo;
 	LASSERT(fo != NULL);
 
 	ofd_read_lock(env, fo);
 	if (!ofd_object_exists(fo)) {
 		CERROR("%s: BRW to missing obj "DOSTID"\n",
 		       exp->exp_obd->obd_name, POSTID(&obj->ioo_oid));
-		ofd_read_unlock(env, fo);
-		ofd_object_put(env, fo);
 		GOTO(out, rc = -ENOENT);
 	}
 
 	if (ofd->ofd_lfsck_verify_pfid && oa->o_valid & OBD_MD_FLFID) {
 		rc = ofd_verify_ff(env, fo, oa);
-		if (rc != 0) {
-			ofd_read_unlock(env, fo);
-			ofd_object_put(env, fo);
+		if (rc != 0)
+			GOTO(out, rc);
+	}
+
+	return fo;
+out:
+	ofd_read_unlock(env, fo);
+	ofd_object_put(env, fo);
+	return ERR_PTR(rc);
+}
+
+static void ofd_preprw_write_put(const struct lu_env *env,
+				 struct ofd_object *fo,
+				 struct niobuf_local *lnb, int nr_local)
+{
+	if (nr_local > 0)
+		dt_bufs_put(env, ofd_object_child(fo), lnb, nr_local);
+	ofd_read_unlock(env, fo);
+	ofd_object_put(env, fo);
+}
+
+static int ofd_preprw_write(const struct lu_env *env, struct obd_export *exp,
+			    struct ofd_device *ofd, struct obdo *oa,
+			    int objcount, struct obd_ioobj *obj,
+			    struct niobuf_remote *rnb, int *nr_local,
+			    struct niobuf_local *lnb, char *jobid)
+{
+	struct ofd_thread_info	*info = ofd_info(env);
+	struct ofd_object	*fo[PTLRPC_MAX_BRW_OBJS];
+	struct niobuf_remote	*nb = rnb;
+	int			*nr_obj = info->fti_brw_nr_local;
+	int			 niocount = 0;
+	int			 i, j, k, l, rc = 0, tot_bytes = 0;
+
+	ENTRY;
+	LASSERT(env != NULL);
+	LASSERT(objcount > 0 && objcount <= PTLRPC_MAX_BRW_OBJS);
+
+	/* the objects come sorted by FID, see tgt_io_multi_unpack() */
+	for (i = 0; i < objcount; i++) {
+		fo[i] = ofd_preprw_write_get(env, exp, ofd, &oa[i], &obj[i]);
+		if (IS_ERR(fo[i])) {
+			rc = PTR_ERR(fo[i]);
+			while (i-- > 0)
+				ofd_preprw_write_put(env, fo[i], NULL, 0);
 			GOTO(out, rc);
 		}
+		niocount += obj[i].ioo_bufcnt;
 	}
 
 	/* Process incoming grant info, set OBD_BRW_GRANTED flag and grant some
-	 * space back if possible */
-	ofd_grant_prepare_write(env, exp, oa, rnb, obj->ioo_bufcnt);
+	 * space back if possible. The grant information of the whole request
+	 * is carried by the first obdo. */
+	ofd_grant_prepare_write(env, exp, oa, rnb, niocount);
 
 	/* parse remote buffers to local buffers and prepare the latter */
 	*nr_local = 0;
-	for (i = 0, j = 0; i < obj->ioo_bufcnt; i++) {
-		rc = dt_bufs_get(env, ofd_object_child(fo),
-				 rnb + i, lnb + j, 1,
-				 ofd_object_capa(env, fo));
-		if (unlikely(rc < 0))
-			GOTO(err, rc);
-		LASSERT(rc <= PTLRPC_MAX_BRW_PAGES);
-		/* correct index for local buffers to continue with */
-		for (k = 0; k < rc; k++) {
-			lnb[j+k].lnb_flags = rnb[i].rnb_flags;
-			if (!(rnb[i].rnb_flags & OBD_BRW_GRANTED))
-				lnb[j+k].lnb_rc = -ENOSPC;
-
-			/* remote client can't break through quota */
-			if (exp_connect_rmtclient(exp))
-				lnb[j+k].lnb_flags &= ~OBD_BRW_NOQUOTA;
+	for (i = 0, j = 0; i < objcount; i++) {
+		struct dt_object *o = ofd_object_child(fo[i]);
+
+		nr_obj[i] = 0;
+		for (k = 0; k < obj[i].ioo_bufcnt; k++, nb++) {
+			rc = dt_bufs_get(env, o, nb, lnb + j, 1,
+					 ofd_object_capa(env, fo[i]));
+			if (unlikely(rc < 0))
+				GOTO(err, rc);
+			LASSERT(rc <= PTLRPC_MAX_BRW_PAGES);
+			/* correct index for local buffers to continue with */
+			for (l = 0; l < rc; l++) {
+				lnb[j + l].lnb_flags = nb->rnb_flags;
+				if (!(nb->rnb_flags & OBD_BRW_GRANTED))
+					lnb[j + l].lnb_rc = -ENOSPC;
+
+				/* remote client can't break through quota */
+				if (exp_connect_rmtclient(exp))
+					lnb[j + l].lnb_flags &=
+							~OBD_BRW_NOQUOTA;
+			}
+			j += rc;
+			nr_obj[i] += rc;
+			LASSERT(j <= PTLRPC_MAX_BRW_PAGES);
+			tot_bytes += nb->rnb_len;
 		}
-		j += rc;
-		*nr_local += rc;
-		LASSERT(j <= PTLRPC_MAX_BRW_PAGES);
-		tot_bytes += rnb[i].rnb_len;
+
+		rc = dt_write_prep(env, o, lnb + j - nr_obj[i], nr_obj[i]);
+		if (unlikely(rc != 0))
+			GOTO(err, rc);
 	}
+	*nr_local = j;
 	LASSERT(*nr_local > 0 && *nr_local <= PTLRPC_MAX_BRW_PAGES);
 
-	rc = dt_write_prep(env, ofd_object_child(fo), lnb, *nr_local);
-	if (unlikely(rc != 0))
-		GOTO(err, rc);
-
 	ofd_counter_incr(exp, LPROC_OFD_STATS_WRITE, jobid, tot_bytes);
 	RETURN(0);
 err:
-	dt_bufs_put(env, ofd_object_child(fo), lnb, *nr_local);
-	ofd_read_unlock(env, fo);
+	/* objects after the failing one have no buffers yet */
+	for (k = 0, j = 0; k < objcount; k++) {
+		l = k <= i ? nr_obj[k] : 0;
+		ofd_preprw_write_put(env, fo[k], lnb + j, l);
+		j += l;
+	}
 	/* ofd_grant_prepare_write() was called, so we must commit */
 	ofd_grant_commit(env, exp, rc);
 out:
@@ -539,6 +592,7 @@ int ofd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
 	struct ofd_thread_info	*info;
 	char			*jobid;
 	const struct lu_fid	*fid = &oa->o_oi.oi_fid;
+	int			 i;
 	int			 rc = 0;
 
 	if (*nr_local > PTLRPC_MAX_BRW_PAGES) {
@@ -560,40 +614,44 @@ int ofd_preprw(const struct lu_env *env, int cmd, struct obd_export *exp,
 
 	LASSERT(oa != NULL);
 
-	if (OBD_FAIL_CHECK(OBD_FAIL_OST_ENOENT)) {
-		struct ofd_seq		*oseq;
+	/* a multi-object write has one obdo per object */
+	for (i = 0; i < objcount; i++) {
+		LASSERT(obj[i].ioo_bufcnt > 0);
 
-		oseq = ofd_seq_load(env, ofd, ostid_seq(&oa->o_oi));
-		if (IS_ERR(oseq)) {
-			CERROR("%s: Can not find seq for "DOSTID
-			       ": rc = %ld\n", ofd_name(ofd), POSTID(&oa->o_oi),
-			       PTR_ERR(oseq));
-			RETURN(-EINVAL);
-		}
+		if (OBD_FAIL_CHECK(OBD_FAIL_OST_ENOENT)) {
+			struct ofd_seq		*oseq;
+
+			oseq = ofd_seq_load(env, ofd, ostid_seq(&oa[i].o_oi));
+			if (IS_ERR(oseq)) {
+				CERROR("%s: Can not find seq for "DOSTID
+				       ": rc = %ld\n", ofd_name(ofd),
+				       POSTID(&oa[i].o_oi), PTR_ERR(oseq));
+				RETURN(-EINVAL);
+			}
 
-		if (oseq->os_destroys_in_progress == 0) {
-			/* don't fail lookups for orphan recovery, it causes
-			 * later LBUGs when objects still exist during
-			 * precreate */
+			if (oseq->os_destroys_in_progress == 0) {
+				/* don't fail lookups for orphan recovery, it
+				 * causes later LBUGs when objects still exist
+				 * during precreate */
+				ofd_seq_put(env, oseq);
+				RETURN(-ENOENT);
+			}
 			ofd_seq_put(env, oseq);
-			RETURN(-ENOENT);
 		}
-		ofd_seq_put(env, oseq);
 	}
 
-	LASSERT(objcount == 1);
-	LASSERT(obj->ioo_bufcnt > 0);
-
 	if (cmd == OBD_BRW_WRITE) {
-		rc = ofd_auth_capa(exp, fid, ostid_seq(&oa->o_oi),
-				   capa, CAPA_OPC_OSS_WRITE);
-		if (rc == 0) {
-			la_from_obdo(&info->fti_attr, oa, OBD_MD_FLGETATTR);
-			rc = ofd_preprw_write(env, exp, ofd, fid,
-					      &info->fti_attr, oa, objcount,
+		/* capa holds one capability per object, like oa */
+		for (i = 0; i < objcount && rc == 0; i++)
+			rc = ofd_auth_capa(exp, &oa[i].o_oi.oi_fid,
+					   ostid_seq(&oa[i].o_oi),
+					   capa == NULL || capa == BYPASS_CAPA ?
+					   capa : &capa[i], CAPA_OPC_OSS_WRITE);
+		if (rc == 0)
+			rc = ofd_preprw_write(env, exp, ofd, oa, objcount,
 					      obj, rnb, nr_local, lnb, jobid);
-		}
 	} else if (cmd == OBD_BRW_READ) {
+		LASSERT(objcount == 1);
 		rc = ofd_auth_capa(exp, fid, ostid_seq(&oa->o_oi),
 				   capa, CAPA_OPC_OSS_READ);
 		if (rc == 0) {
@@ -794,7 +852,6 @@ ofd_commitrw_write(const struct lu_env *env, struct obd_export *exp,
 		   struct lu_attr *la, struct filter_fid *ff, int objcount,
 		   int niocount, struct niobuf_local *lnb, int old_rc)
 {
-	struct ofd_thread_info	*info = ofd_info(env);
 	struct ofd_object	*fo;
 	struct dt_object	*o;
 	struct thandle		*th;
@@ -911,10 +968,78 @@ out:
 	ofd_object_put(env, fo);
 	/* second put is pair to object_get in ofd_preprw_write */
 	ofd_object_put(env, fo);
-	ofd_grant_commit(env, info->fti_exp, old_rc);
 	RETURN(rc);
 }
 
+/*
+ * Commit the local buffers of one object of a BRW write and pack the
+ * resulting attributes and quota flags into its obdo.
+ */
+static int ofd_commitrw_write_obj(const struct lu_env *env,
+				  struct obd_export *exp,
+				  struct ofd_device *ofd, struct obdo *oa,
+				  int npages, struct niobuf_local *lnb,
+				  int old_rc)
+{
+	struct ofd_thread_info	*info = ofd_info(env);
+	struct ofd_mod_data	*fmd;
+	struct filter_fid	*ff = NULL;
+	const struct lu_fid	*fid = &oa->o_oi.oi_fid;
+	__u64			 valid;
+	int			 rc;
+
+	/* Don't update timestamps if this write is older than a
+	 * setattr which modifies the timestamps. b=10150 */
+
+	/* XXX when we start having persistent reservations this needs
+	 * to be changed to ofd_fmd_get() to create the fmd if it
+	 * doesn't already exist so we can store the reservation handle
+	 * there. */
+	valid = OBD_MD_FLUID | OBD_MD_FLGID;
+	fmd = ofd_fmd_find(exp, fid);
+	if (!fmd || fmd->fmd_mactime_xid < info->fti_xid)
+		valid |= OBD_MD_FLATIME | OBD_MD_FLMTIME |
+			 OBD_MD_FLCTIME;
+	ofd_fmd_put(exp, fmd);
+	la_from_obdo(&info->fti_attr, oa, valid);
+
+	if (oa->o_valid & OBD_MD_FLFID) {
+		ff = &info->fti_mds_fid;
+		ofd_prepare_fidea(ff, oa);
+	}
+
+	rc = ofd_commitrw_write(env, exp, ofd, fid, &info->fti_attr,
+				ff, 1, npages, lnb, old_rc);
+	if (rc == 0)
+		obdo_from_la(oa, &info->fti_attr,
+			     OFD_VALID_FLAGS | LA_GID | LA_UID);
+	else
+		obdo_from_la(oa, &info->fti_attr, LA_GID | LA_UID);
+
+	/* don't report overquota flag if we failed before reaching
+	 * commit */
+	if (old_rc == 0 && (rc == 0 || rc == -EDQUOT)) {
+		/* return the overquota flags to client */
+		if (lnb[0].lnb_flags & OBD_BRW_OVER_USRQUOTA) {
+			if (oa->o_valid & OBD_MD_FLFLAGS)
+				oa->o_flags |= OBD_FL_NO_USRQUOTA;
+			else
+				oa->o_flags = OBD_FL_NO_USRQUOTA;
+		}
+
+		if (lnb[0].lnb_flags & OBD_BRW_OVER_GRPQUOTA) {
+			if (oa->o_valid & OBD_MD_FLFLAGS)
+				oa->o_flags |= OBD_FL_NO_GRPQUOTA;
+			else
+				oa->o_flags = OBD_FL_NO_GRPQUOTA;
+		}
+
+		oa->o_valid |= OBD_MD_FLFLAGS;
+		oa->o_valid |= OBD_MD_FLUSRQUOTA | OBD_MD_FLGRPQUOTA;
+	}
+	return rc;
+}
+
 int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		 struct obdo *oa, int objcount, struct obd_ioobj *obj,
 		 struct niobuf_remote *rnb, int npages,
@@ -922,65 +1047,27 @@ int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		 int old_rc)
 {
 	struct ofd_thread_info	*info = ofd_info(env);
-	struct ofd_mod_data	*fmd;
-	__u64			 valid;
 	struct ofd_device	*ofd = ofd_exp(exp);
-	struct filter_fid	*ff = NULL;
 	const struct lu_fid	*fid = &oa->o_oi.oi_fid;
 	int			 rc = 0;
 
 	LASSERT(npages > 0);
 
 	if (cmd == OBD_BRW_WRITE) {
-		/* Don't update timestamps if this write is older than a
-		 * setattr which modifies the timestamps. b=10150 */
-
-		/* XXX when we start having persistent reservations this needs
-		 * to be changed to ofd_fmd_get() to create the fmd if it
-		 * doesn't already exist so we can store the reservation handle
-		 * there. */
-		valid = OBD_MD_FLUID | OBD_MD_FLGID;
-		fmd = ofd_fmd_find(exp, fid);
-		if (!fmd || fmd->fmd_mactime_xid < info->fti_xid)
-			valid |= OBD_MD_FLATIME | OBD_MD_FLMTIME |
-				 OBD_MD_FLCTIME;
-		ofd_fmd_put(exp, fmd);
-		la_from_obdo(&info->fti_attr, oa, valid);
-
-		if (oa->o_valid & OBD_MD_FLFID) {
-			ff = &info->fti_mds_fid;
-			ofd_prepare_fidea(ff, oa);
-		}
-
-		rc = ofd_commitrw_write(env, exp, ofd, fid, &info->fti_attr,
-					ff, objcount, npages, lnb, old_rc);
-		if (rc == 0)
-			obdo_from_la(oa, &info->fti_attr,
-				     OFD_VALID_FLAGS | LA_GID | LA_UID);
-		else
-			obdo_from_la(oa, &info->fti_attr, LA_GID | LA_UID);
-
-		/* don't report overquota flag if we failed before reaching
-		 * commit */
-		if (old_rc == 0 && (rc == 0 || rc == -EDQUOT)) {
-			/* return the overquota flags to client */
-			if (lnb[0].lnb_flags & OBD_BRW_OVER_USRQUOTA) {
-				if (oa->o_valid & OBD_MD_FLFLAGS)
-					oa->o_flags |= OBD_FL_NO_USRQUOTA;
-				else
-					oa->o_flags = OBD_FL_NO_USRQUOTA;
-			}
-
-			if (lnb[0].lnb_flags & OBD_BRW_OVER_GRPQUOTA) {
-				if (oa->o_valid & OBD_MD_FLFLAGS)
-					oa->o_flags |= OBD_FL_NO_GRPQUOTA;
-				else
-					oa->o_flags = OBD_FL_NO_GRPQUOTA;
-			}
-
-			oa->o_valid |= OBD_MD_FLFLAGS;
-			oa->o_valid |= OBD_MD_FLUSRQUOTA | OBD_MD_FLGRPQUOTA;
+		int i, nr, rc2;
+
+		/* every object is committed, and unlocked, even after an
+		 * error, the first error is returned */
+		for (i = 0, nr = 0; i < objcount; i++) {
+			rc2 = ofd_commitrw_write_obj(env, exp, ofd, &oa[i],
+						info->fti_brw_nr_local[i],
+						lnb + nr, old_rc);
+			if (rc == 0)
+				rc = rc2;
+			nr += info->fti_brw_nr_local[i];
 		}
+		LASSERT(nr == npages);
+		ofd_grant_commit(env, info->fti_exp, old_rc);
 	} else if (cmd == OBD_BRW_READ) {
 		struct ldlm_namespace *ns = ofd->ofd_namespace;
 
@@ -81,8 +81,12 @@ static int ofd_export_stats_init(struct ofd_device *ofd,
 
 	num_stats = NUM_OBD_STATS + LPROC_OFD_STATS_LAST;
 
-	stats->nid_stats = lprocfs_alloc_stats(num_stats,
-					       LPROCFS_STATS_FLAG_NOPERCPU);
+	/* per-client stats are updated on every BRW, keep them percpu so
+	 * that ofd_preprw() doesn't serialize on the stats lock. The percpu
+	 * areas are only allocated for the CPUs serving this client, and
+	 * lprocfs_no_percpu_stats=1 trades this for less memory on servers
+	 * with very many clients. */
+	stats->nid_stats = lprocfs_alloc_stats(num_stats, 0);
 	if (stats->nid_stats == NULL)
 		return -ENOMEM;
 
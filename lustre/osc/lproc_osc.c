@@ -219,6 +219,22 @@ osc_cached_mb_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(osc_cached_mb);
 
+static int osc_lru_partitions_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+	struct osc_lru_part *olp;
+	int i;
+
+	seq_printf(m, "max_pages_per_cpt: %lu\n", osc_lru_part_max(cli));
+	cfs_percpt_for_each(olp, i, cli->cl_lru_parts)
+		seq_printf(m, "cpt %d: { in_list: %d, shrinkers: %d }\n",
+			   i, atomic_read(&olp->olp_in_list),
+			   atomic_read(&olp->olp_shrinkers));
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(osc_lru_partitions);
+
 static int osc_cur_dirty_bytes_seq_show(struct seq_file *m, void *v)
 {
 	struct obd_device *dev = m->private;
@@ -518,6 +534,35 @@ static ssize_t osc_obd_max_pages_per_rpc_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(osc_obd_max_pages_per_rpc);
 
+static int osc_max_objs_per_rpc_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+
+	return seq_printf(m, "%d\n", dev->u.cli.cl_max_objs_per_rpc);
+}
+
+static ssize_t osc_max_objs_per_rpc_seq_write(struct file *file,
+					      const char *buffer,
+					      size_t count, loff_t *off)
+{
+	struct obd_device *dev = ((struct seq_file *)file->private_data)->private;
+	struct client_obd *cli = &dev->u.cli;
+	int val, rc;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 1 || val > PTLRPC_MAX_BRW_OBJS)
+		return -ERANGE;
+
+	client_obd_list_lock(&cli->cl_loi_list_lock);
+	cli->cl_max_objs_per_rpc = val;
+	client_obd_list_unlock(&cli->cl_loi_list_lock);
+	return count;
+}
+LPROC_SEQ_FOPS(osc_max_objs_per_rpc);
+
 static int osc_unstable_stats_seq_show(struct seq_file *m, void *v)
 {
 	struct obd_device *dev = m->private;
@@ -581,12 +626,16 @@ struct lprocfs_seq_vars lprocfs_osc_obd_vars[] = {
 	  .fops	=	&osc_obd_max_pages_per_rpc_fops	},
 	{ .name	=	"max_rpcs_in_flight",
 	  .fops	=	&osc_max_rpcs_in_flight_fops	},
+	{ .name	=	"max_objs_per_rpc",
+	  .fops	=	&osc_max_objs_per_rpc_fops	},
 	{ .name	=	"destroys_in_flight",
 	  .fops	=	&osc_destroys_in_flight_fops	},
 	{ .name	=	"max_dirty_mb",
 	  .fops	=	&osc_max_dirty_mb_fops		},
 	{ .name	=	"osc_cached_mb",
 	  .fops	=	&osc_cached_mb_fops		},
+	{ .name	=	"lru_partitions",
+	  .fops	=	&osc_lru_partitions_fops	},
 	{ .name	=	"cur_dirty_bytes",
 	  .fops	=	&osc_cur_dirty_bytes_fops	},
 	{ .name	=	"cur_grant_bytes",
@@ -712,6 +761,20 @@ static int osc_rpc_stats_seq_show(struct seq_file *seq, void *v)
                         break;
         }
 
+	seq_printf(seq, "\n\t\t\twrite\n");
+	seq_printf(seq, "objects per rpc       rpcs   %% cum %%\n");
+
+	write_tot = lprocfs_oh_sum(&cli->cl_write_obj_hist);
+
+	write_cum = 0;
+	for (i = 1; i < OBD_HIST_MAX && write_cum < write_tot; i++) {
+		unsigned long w = cli->cl_write_obj_hist.oh_buckets[i];
+
+		write_cum += w;
+		seq_printf(seq, "%d:\t\t%10lu %3lu %3lu\n",
+			   i, w, pct(w, write_tot), pct(write_cum, write_tot));
+	}
+
         client_obd_list_unlock(&cli->cl_loi_list_lock);
 
         return 0;
@@ -731,6 +794,7 @@ static ssize_t osc_rpc_stats_seq_write(struct file *file, const char *buf,
         lprocfs_oh_clear(&cli->cl_write_page_hist);
         lprocfs_oh_clear(&cli->cl_read_offset_hist);
         lprocfs_oh_clear(&cli->cl_write_offset_hist);
+	lprocfs_oh_clear(&cli->cl_write_obj_hist);
 
         return len;
 }
@@ -1895,6 +1895,12 @@ static void osc_ap_completion(const struct lu_env *env, struct client_obd *cli,
 	EXIT;
 }
 
+#define list_to_obj(list, item) ({					      \
+	cfs_list_t *__tmp = (list)->next;				      \
+	cfs_list_del_init(__tmp);					      \
+	cfs_list_entry(__tmp, struct osc_object, oo_##item);		      \
+})
+
 /**
  * Try to add extent to one RPC. We need to think about the following things:
  * - # of pages must not be over max_pages_per_rpc
@@ -1910,7 +1916,11 @@ static int try_to_add_extent_for_io(struct client_obd *cli,
 	EASSERT((ext->oe_state == OES_CACHE || ext->oe_state == OES_LOCK_DONE),
 		ext);
 
-	*max_pages = max(ext->oe_mppr, *max_pages);
+	/* extents of other objects may only fill the room that is left */
+	if (cfs_list_empty(rpclist) ||
+	    cfs_list_entry(rpclist->next, struct osc_extent,
+			   oe_link)->oe_obj == ext->oe_obj)
+		*max_pages = max(ext->oe_mppr, *max_pages);
 	if (*pc + ext->oe_nr_pages > *max_pages)
 		RETURN(0);
 
@@ -1950,12 +1960,12 @@ static int try_to_add_extent_for_io(struct client_obd *cli,
  * 5. Traverse the extent tree from the 1st extent;
  * 6. Above steps exit if there is no space in this RPC.
  */
-static int get_write_extents(struct osc_object *obj, cfs_list_t *rpclist)
+static int get_write_extents(struct osc_object *obj, cfs_list_t *rpclist,
+			     int page_count, unsigned int *max)
 {
 	struct client_obd *cli = osc_cli(obj);
 	struct osc_extent *ext;
-	int page_count = 0;
-	unsigned int max_pages = cli->cl_max_pages_per_rpc;
+	unsigned int max_pages = *max;
 
 	LASSERT(osc_object_is_locked(obj));
 	while (!cfs_list_empty(&obj->oo_hp_exts)) {
@@ -1964,18 +1974,18 @@ static int get_write_extents(struct osc_object *obj, cfs_list_t *rpclist)
 		LASSERT(ext->oe_state == OES_CACHE);
 		if (!try_to_add_extent_for_io(cli, ext, rpclist, &page_count,
 					      &max_pages))
-			return page_count;
+			goto out;
 		EASSERT(ext->oe_nr_pages <= max_pages, ext);
 	}
 	if (page_count == max_pages)
-		return page_count;
+		goto out;
 
 	while (!cfs_list_empty(&obj->oo_urgent_exts)) {
 		ext = cfs_list_entry(obj->oo_urgent_exts.next,
 				     struct osc_extent, oe_link);
 		if (!try_to_add_extent_for_io(cli, ext, rpclist, &page_count,
 					      &max_pages))
-			return page_count;
+			goto out;
 
 		if (!ext->oe_intree)
 			continue;
@@ -1988,11 +1998,11 @@ static int get_write_extents(struct osc_object *obj, cfs_list_t *rpclist)
 
 			if (!try_to_add_extent_for_io(cli, ext, rpclist,
 						      &page_count, &max_pages))
-				return page_count;
+				goto out;
 		}
 	}
 	if (page_count == max_pages)
-		return page_count;
+		goto out;
 
 	ext = first_extent(obj);
 	while (ext != NULL) {
@@ -2005,13 +2015,111 @@ static int get_write_extents(struct osc_object *obj, cfs_list_t *rpclist)
 
 		if (!try_to_add_extent_for_io(cli, ext, rpclist, &page_count,
 					      &max_pages))
-			return page_count;
+			goto out;
 
 		ext = next_extent(ext);
 	}
+out:
+	*max = max_pages;
 	return page_count;
 }
 
+static inline int osc_multiobj_brw(struct client_obd *cli)
+{
+	return cli->cl_max_objs_per_rpc > 1 && cli->cl_import != NULL &&
+	       OCD_HAS_FLAG(&cli->cl_import->imp_connect_data, MULTIOBJ_BRW);
+}
+
+/**
+ * Maximum number of pages an OST_WRITE of \a nobjs objects may carry without
+ * overflowing the OST request buffer, assuming no niobuf gets merged.
+ */
+static int osc_brw_room(int nobjs)
+{
+	int size = OST_IO_MAXREQSIZE - 1024 /* lustre_msg and alignment */ -
+		   sizeof(struct ptlrpc_body) - sizeof(struct ost_body) -
+		   sizeof(struct lustre_capa) -
+		   nobjs * sizeof(struct obd_ioobj) -
+		   (nobjs - 1) * sizeof(struct obdo);
+
+	return size > 0 ? size / sizeof(struct niobuf_remote) : 0;
+}
+
+/**
+ * Fill the room left in a write RPC with extents of other objects ready for
+ * writeback, so that flushing many small files does not cost one RPC per
+ * file.  Only objects already on the ready list are picked, and the lock of
+ * \a osc has been dropped so that no two object locks are ever nested.
+ *
+ * \retval number of pages added to \a rpclist
+ */
+static int osc_gather_write_extents(const struct lu_env *env,
+				    struct client_obd *cli,
+				    struct osc_object *osc, cfs_list_t *rpclist,
+				    int page_count, unsigned int max_pages)
+{
+	struct osc_object **objs = osc_env_info(env)->oti_brw_objs;
+	struct osc_extent *ext;
+	int nobjs = 1;
+	int nr = 0;
+	int total = page_count;
+	int i;
+	ENTRY;
+
+	ext = cfs_list_entry(rpclist->next, struct osc_extent, oe_link);
+	if (!osc_multiobj_brw(cli) || ext->oe_srvlock || ext->oe_memalloc ||
+	    page_count >= max_pages)
+		RETURN(0);
+
+	client_obd_list_lock(&cli->cl_loi_list_lock);
+	while (nr < cli->cl_max_objs_per_rpc - 1 &&
+	       !cfs_list_empty(&cli->cl_loi_ready_list)) {
+		objs[nr] = list_to_obj(&cli->cl_loi_ready_list, ready_item);
+		cl_object_get(osc2cl(objs[nr]));
+		nr++;
+	}
+	client_obd_list_unlock(&cli->cl_loi_list_lock);
+
+	for (i = 0; i < nr; i++) {
+		struct osc_object *obj = objs[i];
+		unsigned int room = min_t(unsigned int, max_pages,
+					  osc_brw_room(nobjs + 1));
+		cfs_list_t *last = rpclist->prev;
+		int count;
+
+		if (obj == osc || total >= room)
+			goto next;
+
+		osc_object_lock(obj);
+		if (!osc_makes_rpc(cli, obj, OBD_BRW_WRITE)) {
+			osc_object_unlock(obj);
+			goto next;
+		}
+
+		count = get_write_extents(obj, rpclist, total, &room) - total;
+		if (count > 0) {
+			osc_update_pending(obj, OBD_BRW_WRITE, -count);
+			for (ext = cfs_list_entry(last->next, struct osc_extent,
+						  oe_link);
+			     &ext->oe_link != rpclist;
+			     ext = cfs_list_entry(ext->oe_link.next,
+						  struct osc_extent, oe_link)) {
+				if (ext->oe_state == OES_CACHE)
+					osc_extent_state_set(ext, OES_LOCKING);
+				else
+					osc_extent_state_set(ext, OES_RPC);
+			}
+			total += count;
+			nobjs++;
+		}
+		osc_object_unlock(obj);
+next:
+		osc_list_maint(cli, obj);
+		cl_object_put(env, osc2cl(obj));
+	}
+	RETURN(total - page_count);
+}
+
 static int
 osc_send_write_rpc(const struct lu_env *env, struct client_obd *cli,
 		   struct osc_object *osc, pdl_policy_t pol)
@@ -2021,13 +2129,14 @@ osc_send_write_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct osc_extent *tmp;
 	struct osc_extent *first = NULL;
 	obd_count page_count = 0;
+	unsigned int max_pages = cli->cl_max_pages_per_rpc;
 	int srvlock = 0;
 	int rc = 0;
 	ENTRY;
 
 	LASSERT(osc_object_is_locked(osc));
 
-	page_count = get_write_extents(osc, &rpclist);
+	page_count = get_write_extents(osc, &rpclist, 0, &max_pages);
 	LASSERT(equi(page_count == 0, cfs_list_empty(&rpclist)));
 
 	if (cfs_list_empty(&rpclist))
@@ -2048,6 +2157,9 @@ osc_send_write_rpc(const struct lu_env *env, struct client_obd *cli,
 	 * lock order is page lock -> object lock. */
 	osc_object_unlock(osc);
 
+	page_count += osc_gather_write_extents(env, cli, osc, &rpclist,
+					       page_count, max_pages);
+
 	cfs_list_for_each_entry_safe(ext, tmp, &rpclist, oe_link) {
 		if (ext->oe_state == OES_LOCKING) {
 			rc = osc_extent_make_ready(env, ext);
@@ -2123,12 +2235,6 @@ osc_send_read_rpc(const struct lu_env *env, struct client_obd *cli,
 	RETURN(rc);
 }
 
-#define list_to_obj(list, item) ({					      \
-	cfs_list_t *__tmp = (list)->next;				      \
-	cfs_list_del_init(__tmp);					      \
-	cfs_list_entry(__tmp, struct osc_object, oo_##item);		      \
-})
-
 /* This is called by osc_check_rpcs() to find which objects have pages that
  * we could be sending.  These lists are maintained by osc_makes_rpc(). */
 static struct osc_object *osc_next_obj(struct client_obd *cli)
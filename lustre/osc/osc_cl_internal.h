@@ -119,6 +119,10 @@ struct osc_thread_info {
 	 */
 	pgoff_t			oti_next_index;
 	pgoff_t			oti_fn_index; /* first non-overlapped index */
+	/**
+	 * Objects of a multi-object write RPC, see osc_build_rpc().
+	 */
+	struct osc_object	*oti_brw_objs[PTLRPC_MAX_BRW_OBJS];
 };
 
 struct osc_object {
@@ -387,6 +391,11 @@ struct osc_page {
 	 * lru page list. See osc_lru_{del|use}() in osc_page.c for usage.
 	 */
 	cfs_list_t            ops_lru;
+	/**
+	 * CPU partition of the lru list this page belongs to, see
+	 * client_obd::cl_lru_parts.
+	 */
+	int		      ops_cpt;
 	/**
 	 * Linkage into a per-osc_object list of pages in flight. For
 	 * debugging.
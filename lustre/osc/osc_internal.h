@@ -138,6 +138,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		   int target, bool force);
 int osc_lru_reclaim(struct client_obd *cli);
+unsigned long osc_lru_part_max(struct client_obd *cli);
 
 extern spinlock_t osc_ast_guard;
 unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock);
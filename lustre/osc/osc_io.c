@@ -805,9 +805,14 @@ static void osc_req_attr_set(const struct lu_env *env,
 
 		clerq = slice->crs_req;
 		LASSERT(!cfs_list_empty(&clerq->crq_pages));
-		apage = container_of(clerq->crq_pages.next,
-				     struct cl_page, cp_flight);
-		opg = osc_cl_page_osc(apage, NULL);
+		/* a multi-object write carries pages of several objects */
+		opg = NULL;
+		cfs_list_for_each_entry(apage, &clerq->crq_pages, cp_flight) {
+			opg = osc_cl_page_osc(apage, NULL);
+			if (opg->ops_cl.cpl_obj == obj)
+				break;
+		}
+		LASSERT(opg != NULL && opg->ops_cl.cpl_obj == obj);
 		subobj = opg->ops_cl.cpl_obj;
 		lock = cl_lock_at_pgoff(env, subobj, osc_index(opg),
 					NULL, 1, 1);
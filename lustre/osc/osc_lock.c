@@ -276,6 +276,8 @@ static __u64 osc_enq2ldlm_flags(__u32 enqflags)
 		result |= LDLM_FL_HAS_INTENT;
 	if (enqflags & CEF_DISCARD_DATA)
 		result |= LDLM_FL_AST_DISCARD_DATA;
+	if (enqflags & CEF_LOCK_NO_EXPAND)
+		result |= LDLM_FL_NO_EXPANSION;
 	return result;
 }
 
@@ -1156,7 +1158,14 @@ static int osc_lock_enqueue_wait(const struct lu_env *env,
 	spin_unlock(&hdr->coh_lock_guard);
 
         if (conflict) {
-                if (lock->cll_descr.cld_mode == CLM_GROUP) {
+		if (olck->ols_flags & LDLM_FL_NO_EXPANSION) {
+			/* lock-ahead request never cancels a lock of this
+			 * client, nor waits for it */
+			CDEBUG(D_DLMTRACE, "lock-ahead %p is conflicted with "
+			       "%p, give up\n", lock, conflict);
+			cl_lock_put(env, conflict);
+			rc = -EWOULDBLOCK;
+		} else if (lock->cll_descr.cld_mode == CLM_GROUP) {
                         /* we want a group lock but a previous lock request
                          * conflicts, we do not wait but return 0 so the
                          * request is send to the server
@@ -1210,6 +1219,12 @@ static int osc_lock_enqueue(const struct lu_env *env,
 	LASSERTF(ergo(ols->ols_glimpse, lock->cll_descr.cld_mode <= CLM_READ),
 		"lock = %p, ols = %p\n", lock, ols);
 
+	/* an older server would expand a lock-ahead lock anyway */
+	if ((ols->ols_flags & LDLM_FL_NO_EXPANSION) &&
+	    !OCD_HAS_FLAG(&osc_cli(cl2osc(slice->cls_obj))->cl_import->
+			  imp_connect_data, LOCKAHEAD))
+		RETURN(-EOPNOTSUPP);
+
         result = osc_lock_enqueue_wait(env, ols);
         if (result == 0) {
                 if (!osc_lock_is_lockless(ols)) {
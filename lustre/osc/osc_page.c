@@ -527,6 +527,12 @@ void osc_page_submit(const struct lu_env *env, struct osc_page *opg,
  * for free LRU slots - this will be very bad so the algorithm requires each
  * OSC to free slots voluntarily to maintain a reasonable number of free slots
  * at any time.
+ *
+ * The LRU list of each OSC is split per CPU partition (client_obd::
+ * cl_lru_parts). A page is kept on the list of the partition it was allocated
+ * from, each partition has its own lock and background shrinking work, and
+ * reclaim starts from the partition of the calling thread. This avoids
+ * contention on a single list lock and freeing pages across NUMA nodes.
  */
 
 static CFS_DECL_WAITQ(osc_lru_waitq);
@@ -536,12 +542,34 @@ static const int lru_shrink_min = 2 << (20 - PAGE_CACHE_SHIFT); /* 2M */
 /* free this number at most otherwise it will take too long time to finsih. */
 static const int lru_shrink_max = 8 << (20 - PAGE_CACHE_SHIFT); /* 8M */
 
+static inline struct osc_lru_part *osc_lru_part(struct client_obd *cli,
+						int cpt)
+{
+	return cli->cl_lru_parts[cpt];
+}
+
+/**
+ * Share of the LRU budget of this OSC for each of its CPU partitions.
+ */
+unsigned long osc_lru_part_max(struct client_obd *cli)
+{
+	struct cl_client_cache *cache = cli->cl_cache;
+
+	if (cache == NULL || atomic_read(&cache->ccc_users) == 0)
+		return 0;
+
+	return cache->ccc_lru_max / atomic_read(&cache->ccc_users) /
+	       cfs_percpt_number(cli->cl_lru_parts);
+}
+
 /* Check if we can free LRU slots from this OSC. If there exists LRU waiters,
  * we should free slots aggressively. In this way, slots are freed in a steady
- * step to maintain fairness among OSCs.
+ * step to maintain fairness among OSCs. When running out of slots, only the
+ * partitions holding a fair part of the OSC budget are shrunk, so that a
+ * partition with few pages is not drained by a busy one.
  *
  * Return how many LRU pages should be freed. */
-static int osc_cache_too_much(struct client_obd *cli)
+static int osc_cache_too_much(struct client_obd *cli, struct osc_lru_part *olp)
 {
 	struct cl_client_cache *cache = cli->cl_cache;
 	int pages = atomic_read(&cli->cl_lru_in_list);
@@ -552,6 +580,9 @@ static int osc_cache_too_much(struct client_obd *cli)
 	/* if it's going to run out LRU slots, we should free some, but not
 	 * too much to maintain faireness among OSCs. */
 	if (atomic_read(cli->cl_lru_left) < cache->ccc_lru_max >> 4) {
+		if (olp != NULL &&
+		    atomic_read(&olp->olp_in_list) < osc_lru_part_max(cli) / 2)
+			return 0;
 		if (pages >= budget)
 			return lru_shrink_max;
 		else if (pages >= budget / 2)
@@ -561,52 +592,79 @@ static int osc_cache_too_much(struct client_obd *cli)
 	return 0;
 }
 
+static int osc_lru_shrink_part(const struct lu_env *env,
+			       struct client_obd *cli,
+			       struct osc_lru_part *olp, int target,
+			       bool force);
+
 int lru_queue_work(const struct lu_env *env, void *data)
 {
-	struct client_obd *cli = data;
+	struct osc_lru_part *olp = data;
+	struct client_obd *cli = olp->olp_cli;
 
-	CDEBUG(D_CACHE, "Run LRU work for client obd %p.\n", cli);
+	CDEBUG(D_CACHE, "Run LRU work for client obd %p cpt %d.\n",
+	       cli, olp->olp_cpt);
 
-	if (osc_cache_too_much(cli))
-		osc_lru_shrink(env, cli, lru_shrink_max, true);
+	if (osc_cache_too_much(cli, olp))
+		osc_lru_shrink_part(env, cli, olp, lru_shrink_max, true);
 
 	RETURN(0);
 }
 
+static void osc_lru_splice(struct client_obd *cli, struct osc_lru_part *olp,
+			   cfs_list_t *lru, int npages)
+{
+	client_obd_list_lock(&olp->olp_lock);
+	cfs_list_splice_tail(lru, &olp->olp_list);
+	atomic_add(npages, &olp->olp_in_list);
+	atomic_sub(npages, &cli->cl_lru_busy);
+	atomic_add(npages, &cli->cl_lru_in_list);
+	client_obd_list_unlock(&olp->olp_lock);
+	CFS_INIT_LIST_HEAD(lru);
+
+	/* XXX: May set force to be true for better performance */
+	if (osc_cache_too_much(cli, olp))
+		(void)ptlrpcd_queue_work(olp->olp_work);
+}
+
 void osc_lru_add_batch(struct client_obd *cli, cfs_list_t *plist)
 {
 	CFS_LIST_HEAD(lru);
 	struct osc_async_page *oap;
+	struct osc_lru_part *olp = NULL;
 	int npages = 0;
 
+	/* pages of one RPC mostly come from the same partition, add them
+	 * to the partition lists in runs */
 	cfs_list_for_each_entry(oap, plist, oap_pending_item) {
 		struct osc_page *opg = oap2osc_page(oap);
 
 		if (!opg->ops_in_lru)
 			continue;
 
+		if (olp != osc_lru_part(cli, opg->ops_cpt)) {
+			if (npages > 0)
+				osc_lru_splice(cli, olp, &lru, npages);
+			olp = osc_lru_part(cli, opg->ops_cpt);
+			npages = 0;
+		}
+
 		++npages;
 		LASSERT(cfs_list_empty(&opg->ops_lru));
-		cfs_list_add(&opg->ops_lru, &lru);
+		cfs_list_add_tail(&opg->ops_lru, &lru);
 	}
 
-	if (npages > 0) {
-		client_obd_list_lock(&cli->cl_lru_list_lock);
-		cfs_list_splice_tail(&lru, &cli->cl_lru_list);
-		atomic_sub(npages, &cli->cl_lru_busy);
-		atomic_add(npages, &cli->cl_lru_in_list);
-		client_obd_list_unlock(&cli->cl_lru_list_lock);
-
-		/* XXX: May set force to be true for better performance */
-		if (osc_cache_too_much(cli))
-			(void)ptlrpcd_queue_work(cli->cl_lru_work);
-	}
+	if (npages > 0)
+		osc_lru_splice(cli, olp, &lru, npages);
 }
 
-static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
+static void __osc_lru_del(struct client_obd *cli, struct osc_lru_part *olp,
+			  struct osc_page *opg)
 {
+	LASSERT(atomic_read(&olp->olp_in_list) > 0);
 	LASSERT(atomic_read(&cli->cl_lru_in_list) > 0);
 	cfs_list_del_init(&opg->ops_lru);
+	atomic_dec(&olp->olp_in_list);
 	atomic_dec(&cli->cl_lru_in_list);
 }
 
@@ -617,21 +675,23 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
 	if (opg->ops_in_lru) {
-		client_obd_list_lock(&cli->cl_lru_list_lock);
+		struct osc_lru_part *olp = osc_lru_part(cli, opg->ops_cpt);
+
+		client_obd_list_lock(&olp->olp_lock);
 		if (!cfs_list_empty(&opg->ops_lru)) {
-			__osc_lru_del(cli, opg);
+			__osc_lru_del(cli, olp, opg);
 		} else {
 			LASSERT(atomic_read(&cli->cl_lru_busy) > 0);
 			atomic_dec(&cli->cl_lru_busy);
 		}
-		client_obd_list_unlock(&cli->cl_lru_list_lock);
+		client_obd_list_unlock(&olp->olp_lock);
 
 		atomic_inc(cli->cl_lru_left);
 		/* this is a great place to release more LRU pages if
 		 * this osc occupies too many LRU pages and kernel is
 		 * stealing one of them. */
 		if (!memory_pressure_get())
-			(void)ptlrpcd_queue_work(cli->cl_lru_work);
+			(void)ptlrpcd_queue_work(olp->olp_work);
 		wake_up(&osc_lru_waitq);
 	} else {
 		LASSERT(cfs_list_empty(&opg->ops_lru));
@@ -646,9 +706,11 @@ static void osc_lru_use(struct client_obd *cli, struct osc_page *opg)
 	/* If page is being transfered for the first time,
 	 * ops_lru should be empty */
 	if (opg->ops_in_lru && !cfs_list_empty(&opg->ops_lru)) {
-		client_obd_list_lock(&cli->cl_lru_list_lock);
-		__osc_lru_del(cli, opg);
-		client_obd_list_unlock(&cli->cl_lru_list_lock);
+		struct osc_lru_part *olp = osc_lru_part(cli, opg->ops_cpt);
+
+		client_obd_list_lock(&olp->olp_lock);
+		__osc_lru_del(cli, olp, opg);
+		client_obd_list_unlock(&olp->olp_lock);
 		atomic_inc(&cli->cl_lru_busy);
 	}
 }
@@ -671,10 +733,12 @@ static void discard_pagevec(const struct lu_env *env, struct cl_io *io,
 }
 
 /**
- * Drop @target of pages from LRU at most.
+ * Drop @target of pages from the LRU list of partition @olp at most.
  */
-int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
-		   int target, bool force)
+static int osc_lru_shrink_part(const struct lu_env *env,
+			       struct client_obd *cli,
+			       struct osc_lru_part *olp, int target,
+			       bool force)
 {
 	struct cl_io *io;
 	struct cl_object *clobj = NULL;
@@ -686,39 +750,40 @@ int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	int rc = 0;
 	ENTRY;
 
-	LASSERT(atomic_read(&cli->cl_lru_in_list) >= 0);
-	if (atomic_read(&cli->cl_lru_in_list) == 0 || target <= 0)
+	LASSERT(atomic_read(&olp->olp_in_list) >= 0);
+	if (atomic_read(&olp->olp_in_list) == 0 || target <= 0)
 		RETURN(0);
 
 	if (!force) {
-		if (atomic_read(&cli->cl_lru_shrinkers) > 0)
+		if (atomic_read(&cli->cl_lru_shrinkers) > 0 ||
+		    atomic_read(&olp->olp_shrinkers) > 0)
 			RETURN(-EBUSY);
 
-		if (atomic_inc_return(&cli->cl_lru_shrinkers) > 1) {
-			atomic_dec(&cli->cl_lru_shrinkers);
+		if (atomic_inc_return(&olp->olp_shrinkers) > 1) {
+			atomic_dec(&olp->olp_shrinkers);
 			RETURN(-EBUSY);
 		}
 	} else {
-		atomic_inc(&cli->cl_lru_shrinkers);
+		atomic_inc(&olp->olp_shrinkers);
 	}
 
 	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
 	io = &osc_env_info(env)->oti_io;
 
-	client_obd_list_lock(&cli->cl_lru_list_lock);
-	maxscan = min(target << 1, atomic_read(&cli->cl_lru_in_list));
-	while (!cfs_list_empty(&cli->cl_lru_list)) {
+	client_obd_list_lock(&olp->olp_lock);
+	maxscan = min(target << 1, atomic_read(&olp->olp_in_list));
+	while (!cfs_list_empty(&olp->olp_list)) {
 		struct cl_page *page;
 		bool will_free = false;
 
 		if (--maxscan < 0)
 			break;
 
-		opg = cfs_list_entry(cli->cl_lru_list.next, struct osc_page,
+		opg = cfs_list_entry(olp->olp_list.next, struct osc_page,
 				     ops_lru);
 		page = opg->ops_cl.cpl_page;
 		if (cl_page_in_use_noref(page)) {
-			cfs_list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			cfs_list_move_tail(&opg->ops_lru, &olp->olp_list);
 			continue;
 		}
 
@@ -727,7 +792,7 @@ int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			struct cl_object *tmp = page->cp_obj;
 
 			cl_object_get(tmp);
-			client_obd_list_unlock(&cli->cl_lru_list_lock);
+			client_obd_list_unlock(&olp->olp_lock);
 
 			if (clobj != NULL) {
 				discard_pagevec(env, io, pvec, index);
@@ -743,7 +808,7 @@ int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			io->ci_ignore_layout = 1;
 			rc = cl_io_init(env, io, CIT_MISC, clobj);
 
-			client_obd_list_lock(&cli->cl_lru_list_lock);
+			client_obd_list_lock(&olp->olp_lock);
 
 			if (rc != 0)
 				break;
@@ -756,7 +821,7 @@ int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			if (!cl_page_in_use_noref(page)) {
 				/* remove it from lru list earlier to avoid
 				 * lock contention */
-				__osc_lru_del(cli, opg);
+				__osc_lru_del(cli, olp, opg);
 				opg->ops_in_lru = 0; /* will be discarded */
 
 				cl_page_get(page);
@@ -767,24 +832,24 @@ int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		}
 
 		if (!will_free) {
-			cfs_list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			cfs_list_move_tail(&opg->ops_lru, &olp->olp_list);
 			continue;
 		}
 
-		/* Don't discard and free the page with cl_lru_list held */
+		/* Don't discard and free the page with olp_lock held */
 		pvec[index++] = page;
 		if (unlikely(index == OTI_PVEC_SIZE)) {
-			client_obd_list_unlock(&cli->cl_lru_list_lock);
+			client_obd_list_unlock(&olp->olp_lock);
 			discard_pagevec(env, io, pvec, index);
 			index = 0;
 
-			client_obd_list_lock(&cli->cl_lru_list_lock);
+			client_obd_list_lock(&olp->olp_lock);
 		}
 
 		if (++count >= target)
 			break;
 	}
-	client_obd_list_unlock(&cli->cl_lru_list_lock);
+	client_obd_list_unlock(&olp->olp_lock);
 
 	if (clobj != NULL) {
 		discard_pagevec(env, io, pvec, index);
@@ -793,7 +858,7 @@ int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		cl_object_put(env, clobj);
 	}
 
-	atomic_dec(&cli->cl_lru_shrinkers);
+	atomic_dec(&olp->olp_shrinkers);
 	if (count > 0) {
 		atomic_add(count, cli->cl_lru_left);
 		wake_up_all(&osc_lru_waitq);
@@ -801,6 +866,35 @@ int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 	RETURN(count > 0 ? count : rc);
 }
 
+/**
+ * Drop @target of pages from LRU at most, starting from the partition of the
+ * calling thread.
+ */
+int osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
+		   int target, bool force)
+{
+	int ncpt = cfs_percpt_number(cli->cl_lru_parts);
+	int cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	int count = 0;
+	int rc = 0;
+	int i;
+	ENTRY;
+
+	LASSERT(atomic_read(&cli->cl_lru_in_list) >= 0);
+	if (atomic_read(&cli->cl_lru_in_list) == 0 || target <= 0)
+		RETURN(0);
+
+	for (i = 0; i < ncpt && count < target; i++) {
+		rc = osc_lru_shrink_part(env, cli,
+					 osc_lru_part(cli, (cpt + i) % ncpt),
+					 target - count, force);
+		if (rc > 0)
+			count += rc;
+	}
+
+	RETURN(count > 0 ? count : rc);
+}
+
 static inline int max_to_shrink(struct client_obd *cli)
 {
 	return min(atomic_read(&cli->cl_lru_in_list) >> 1, lru_shrink_max);
@@ -822,7 +916,7 @@ int osc_lru_reclaim(struct client_obd *cli)
 	if (IS_ERR(env))
 		RETURN(rc);
 
-	rc = osc_lru_shrink(env, cli, osc_cache_too_much(cli), false);
+	rc = osc_lru_shrink(env, cli, osc_cache_too_much(cli, NULL), false);
 	if (rc != 0) {
 		if (rc == -EBUSY)
 			rc = 0;
@@ -854,10 +948,11 @@ int osc_lru_reclaim(struct client_obd *cli)
 			atomic_read(&cli->cl_lru_busy));
 
 		cfs_list_move_tail(&cli->cl_lru_osc, &cache->ccc_lru);
-		if (osc_cache_too_much(cli) > 0) {
+		if (osc_cache_too_much(cli, NULL) > 0) {
 			spin_unlock(&cache->ccc_lru_lock);
 
-			rc = osc_lru_shrink(env, cli, osc_cache_too_much(cli),
+			rc = osc_lru_shrink(env, cli,
+					    osc_cache_too_much(cli, NULL),
 					    true);
 			spin_lock(&cache->ccc_lru_lock);
 			if (rc != 0)
@@ -910,6 +1005,9 @@ static int osc_lru_reserve(const struct lu_env *env, struct osc_object *obj,
 
 out:
 	if (rc >= 0) {
+		/* keep the page on the LRU of the partition it is
+		 * allocated from */
+		opg->ops_cpt = cfs_cpt_current(cfs_cpt_table, 1);
 		atomic_inc(&cli->cl_lru_busy);
 		opg->ops_in_lru = 1;
 		rc = 0;
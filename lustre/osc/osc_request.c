@@ -70,7 +70,7 @@ struct osc_brw_async_args {
 	struct client_obd	 *aa_cli;
 	struct list_head	  aa_oaps;
 	struct list_head	  aa_exts;
-	struct obd_capa	 *aa_ocapa;
+	struct obd_capa	**aa_ocapa;	/* one per object, or NULL */
 	struct cl_req		 *aa_clerq;
 };
 
@@ -1169,6 +1169,66 @@ static inline int can_merge_pages(struct brw_page *p1, struct brw_page *p2)
         return (p1->off + p1->count == p2->off);
 }
 
+/* Whether two pages of a BRW belong to different objects.  Only the write
+ * path built by osc_build_rpc() carries several objects, so this is only
+ * consulted when @nobjs > 1 and the pages are known to come from oaps. */
+static inline int osc_brw_new_obj(int nobjs, struct brw_page *p1,
+				  struct brw_page *p2)
+{
+	return nobjs > 1 &&
+	       brw_page2oap(p1)->oap_obj != brw_page2oap(p2)->oap_obj;
+}
+
+/* Number of objects carried by a BRW request, see osc_brw_prep_request() */
+static int osc_brw_nr_objs(struct ptlrpc_request *req)
+{
+	return req_capsule_get_size(&req->rq_pill, &RMF_OBD_IOOBJ,
+				    RCL_CLIENT) / sizeof(struct obd_ioobj);
+}
+
+static struct obdo *osc_brw_oa_alloc(int nobjs)
+{
+	struct obdo *oa;
+
+	if (nobjs == 1)
+		OBDO_ALLOC(oa);
+	else
+		OBD_ALLOC(oa, nobjs * sizeof(*oa));
+	return oa;
+}
+
+static void osc_brw_oa_free(struct obdo *oa, int nobjs)
+{
+	if (nobjs == 1)
+		OBDO_FREE(oa);
+	else
+		OBD_FREE(oa, nobjs * sizeof(*oa));
+}
+
+/* Take a reference on the capabilities of the @nobjs objects of a BRW for
+ * its resends, the array is released by osc_brw_capa_put() */
+static struct obd_capa **osc_brw_capa_get(struct obd_capa **ocapa, int nobjs)
+{
+	struct obd_capa **oc;
+	int		  k;
+
+	OBD_ALLOC(oc, nobjs * sizeof(*oc));
+	if (oc == NULL)
+		return NULL;
+	for (k = 0; k < nobjs; k++)
+		oc[k] = capa_get(ocapa[k]);
+	return oc;
+}
+
+static void osc_brw_capa_put(struct obd_capa **ocapa, int nobjs)
+{
+	int k;
+
+	for (k = 0; k < nobjs; k++)
+		capa_put(ocapa[k]);
+	OBD_FREE(ocapa, nobjs * sizeof(*ocapa));
+}
+
 static obd_count osc_checksum_bulk(int nob, obd_count pg_count,
 				   struct brw_page **pga, int opc,
 				   cksum_type_t cksum_type)
@@ -1226,11 +1286,22 @@ static obd_count osc_checksum_bulk(int nob, obd_count pg_count,
 	return cksum;
 }
 
+/**
+ * Pack a BRW request for \a page_count pages of \a nobjs objects.
+ *
+ * \a oa is an array of \a nobjs obdos and \a pga holds the pages of each
+ * object in turn, in the same order as \a oa. Writes of more than one
+ * object use RQF_OST_BRW_WRITE_MULTI: oa[0] travels in the ost_body, the
+ * rest in RMF_OBDO_ARRAY, and there is one obd_ioobj per object. \a ocapa
+ * is NULL or holds the capability of each object, that of oa[0] goes in
+ * RMF_CAPA1 and the others in RMF_CAPA_ARRAY.
+ */
 static int osc_brw_prep_request(int cmd, struct client_obd *cli,struct obdo *oa,
+				int nobjs,
                                 struct lov_stripe_md *lsm, obd_count page_count,
                                 struct brw_page **pga,
                                 struct ptlrpc_request **reqp,
-                                struct obd_capa *ocapa, int reserve,
+				struct obd_capa **ocapa, int reserve,
                                 int resend)
 {
         struct ptlrpc_request   *req;
@@ -1238,7 +1309,10 @@ static int osc_brw_prep_request(int cmd, struct client_obd *cli,struct obdo *oa,
         struct ost_body         *body;
         struct obd_ioobj        *ioobj;
         struct niobuf_remote    *niobuf;
-        int niocount, i, requested_nob, opc, rc;
+	struct obdo		*oarr = NULL;
+	struct lustre_capa	*carr = NULL;
+	int			 ncapa = 0;
+        int niocount, i, k, requested_nob, opc, rc;
         struct osc_brw_async_args *aa;
         struct req_capsule      *pill;
         struct brw_page *pg_prev;
@@ -1253,25 +1327,42 @@ static int osc_brw_prep_request(int cmd, struct client_obd *cli,struct obdo *oa,
                 opc = OST_WRITE;
                 req = ptlrpc_request_alloc_pool(cli->cl_import,
                                                 cli->cl_import->imp_rq_pool,
+						nobjs > 1 ?
+						&RQF_OST_BRW_WRITE_MULTI :
                                                 &RQF_OST_BRW_WRITE);
         } else {
+		LASSERT(nobjs == 1);
                 opc = OST_READ;
                 req = ptlrpc_request_alloc(cli->cl_import, &RQF_OST_BRW_READ);
         }
         if (req == NULL)
                 RETURN(-ENOMEM);
 
+	/* niobufs never span two objects */
         for (niocount = i = 1; i < page_count; i++) {
-                if (!can_merge_pages(pga[i - 1], pga[i]))
+		if (!can_merge_pages(pga[i - 1], pga[i]) ||
+		    osc_brw_new_obj(nobjs, pga[i - 1], pga[i]))
                         niocount++;
         }
 
         pill = &req->rq_pill;
         req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
-                             sizeof(*ioobj));
+			     nobjs * sizeof(*ioobj));
         req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
                              niocount * sizeof(*niobuf));
-        osc_set_capa_size(req, &RMF_CAPA1, ocapa);
+	if (nobjs > 1) {
+		req_capsule_set_size(pill, &RMF_OBDO_ARRAY, RCL_CLIENT,
+				     (nobjs - 1) * sizeof(*oarr));
+		req_capsule_set_size(pill, &RMF_OBDO_ARRAY, RCL_SERVER,
+				     (nobjs - 1) * sizeof(*oarr));
+		/* the capabilities of objects 1..nobjs-1, if any */
+		for (k = 1; ocapa != NULL && k < nobjs; k++)
+			if (ocapa[k] != NULL)
+				ncapa = nobjs - 1;
+		req_capsule_set_size(pill, &RMF_CAPA_ARRAY, RCL_CLIENT,
+				     ncapa * sizeof(*carr));
+	}
+	osc_set_capa_size(req, &RMF_CAPA1, ocapa ? ocapa[0] : NULL);
 
         rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, opc);
         if (rc) {
@@ -1299,33 +1390,59 @@ static int osc_brw_prep_request(int cmd, struct client_obd *cli,struct obdo *oa,
         LASSERT(body != NULL && ioobj != NULL && niobuf != NULL);
 
 	lustre_set_wire_obdo(&req->rq_import->imp_connect_data, &body->oa, oa);
+	if (nobjs > 1) {
+		oarr = req_capsule_client_get(pill, &RMF_OBDO_ARRAY);
+		LASSERT(oarr != NULL);
+		if (ncapa > 0)
+			carr = req_capsule_client_get(pill, &RMF_CAPA_ARRAY);
+		for (k = 1; k < nobjs; k++) {
+			lustre_set_wire_obdo(&req->rq_import->imp_connect_data,
+					     &oarr[k - 1], &oa[k]);
+			if (carr == NULL || ocapa[k] == NULL)
+				continue;
+			capa_cpy(&carr[k - 1], ocapa[k]);
+			oarr[k - 1].o_valid |= OBD_MD_FLOSSCAPA;
+			DEBUG_CAPA(D_SEC, &carr[k - 1], "pack");
+		}
+	}
 
-	obdo_to_ioobj(oa, ioobj);
-	ioobj->ioo_bufcnt = niocount;
-	/* The high bits of ioo_max_brw tells server _maximum_ number of bulks
-	 * that might be send for this request.  The actual number is decided
-	 * when the RPC is finally sent in ptlrpc_register_bulk(). It sends
-	 * "max - 1" for old client compatibility sending "0", and also so the
-	 * the actual maximum is a power-of-two number, not one less. LU-1431 */
-	ioobj_max_brw_set(ioobj, desc->bd_md_max_brw);
-	osc_pack_capa(req, body, ocapa);
+	for (k = 0; k < nobjs; k++) {
+		obdo_to_ioobj(&oa[k], &ioobj[k]);
+		ioobj[k].ioo_bufcnt = 0;
+		/* The high bits of ioo_max_brw tells server _maximum_ number
+		 * of bulks that might be send for this request.  The actual
+		 * number is decided when the RPC is finally sent in
+		 * ptlrpc_register_bulk(). It sends "max - 1" for old client
+		 * compatibility sending "0", and also so the the actual
+		 * maximum is a power-of-two number, not one less. LU-1431 */
+		ioobj_max_brw_set(&ioobj[k], desc->bd_md_max_brw);
+	}
+	osc_pack_capa(req, body, ocapa ? ocapa[0] : NULL);
 	LASSERT(page_count > 0);
 	pg_prev = pga[0];
-        for (requested_nob = i = 0; i < page_count; i++, niobuf++) {
+        for (requested_nob = i = k = 0; i < page_count; i++, niobuf++) {
                 struct brw_page *pg = pga[i];
                 int poff = pg->off & ~CFS_PAGE_MASK;
+		/* first and last page of the current object */
+		int first = i == 0 || osc_brw_new_obj(nobjs, pg_prev, pg);
+		int last = i == page_count - 1 ||
+			   osc_brw_new_obj(nobjs, pg, pga[i + 1]);
+
+		if (i > 0 && first)
+			k++;
+		LASSERT(k < nobjs);
 
                 LASSERT(pg->count > 0);
                 /* make sure there is no gap in the middle of page array */
-		LASSERTF(page_count == 1 ||
-			 (ergo(i == 0, poff + pg->count == PAGE_CACHE_SIZE) &&
-			  ergo(i > 0 && i < page_count - 1,
+		LASSERTF((first && last) ||
+			 (ergo(first, poff + pg->count == PAGE_CACHE_SIZE) &&
+			  ergo(!first && !last,
 			       poff == 0 && pg->count == PAGE_CACHE_SIZE)   &&
-			  ergo(i == page_count - 1, poff == 0)),
+			  ergo(last, poff == 0)),
 			 "i: %d/%d pg: %p off: "LPU64", count: %u\n",
 			 i, page_count, pg, pg->off, pg->count);
 #ifdef __linux__
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+                LASSERTF(first || pg->off > pg_prev->off,
                          "i %d p_c %u pg %p [pri %lu ind %lu] off "LPU64
                          " prev_pg %p [pri %lu ind %lu] off "LPU64"\n",
                          i, page_count,
@@ -1333,7 +1450,7 @@ static int osc_brw_prep_request(int cmd, struct client_obd *cli,struct obdo *oa,
                          pg_prev->pg, page_private(pg_prev->pg),
                          pg_prev->pg->index, pg_prev->off);
 #else
-                LASSERTF(i == 0 || pg->off > pg_prev->off,
+                LASSERTF(first || pg->off > pg_prev->off,
                          "i %d p_c %u\n", i, page_count);
 #endif
                 LASSERT((pga[0]->flag & OBD_BRW_SRVLOCK) ==
@@ -1342,16 +1459,18 @@ static int osc_brw_prep_request(int cmd, struct client_obd *cli,struct obdo *oa,
 		ptlrpc_prep_bulk_page_pin(desc, pg->pg, poff, pg->count);
                 requested_nob += pg->count;
 
-                if (i > 0 && can_merge_pages(pg_prev, pg)) {
+                if (!first && can_merge_pages(pg_prev, pg)) {
                         niobuf--;
                         niobuf->len += pg->count;
                 } else {
                         niobuf->offset = pg->off;
                         niobuf->len    = pg->count;
                         niobuf->flags  = pg->flag;
+			ioobj[k].ioo_bufcnt++;
                 }
                 pg_prev = pg;
         }
+	LASSERT(k == nobjs - 1);
 
         LASSERTF((void *)(niobuf - niocount) ==
                 req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE),
@@ -1423,8 +1542,11 @@ static int osc_brw_prep_request(int cmd, struct client_obd *cli,struct obdo *oa,
         aa->aa_ppga = pga;
         aa->aa_cli = cli;
         CFS_INIT_LIST_HEAD(&aa->aa_oaps);
-        if (ocapa && reserve)
-                aa->aa_ocapa = capa_get(ocapa);
+	if (ocapa && reserve) {
+		aa->aa_ocapa = osc_brw_capa_get(ocapa, nobjs);
+		if (aa->aa_ocapa == NULL)
+			GOTO(out, rc = -ENOMEM);
+	}
 
         *reqp = req;
         RETURN(0);
@@ -1487,6 +1609,9 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                         &req->rq_import->imp_connection->c_peer;
         struct client_obd *cli = aa->aa_cli;
         struct ost_body *body;
+	struct obdo *oarr = NULL;
+	int nobjs = osc_brw_nr_objs(req);
+	int k;
         __u32 client_cksum = 0;
         ENTRY;
 
@@ -1501,16 +1626,29 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                 DEBUG_REQ(D_INFO, req, "Can't unpack body\n");
                 RETURN(-EPROTO);
         }
+	if (nobjs > 1) {
+		oarr = req_capsule_server_sized_get(&req->rq_pill,
+						    &RMF_OBDO_ARRAY,
+						    (nobjs - 1) *
+						    sizeof(*oarr));
+		if (oarr == NULL) {
+			DEBUG_REQ(D_INFO, req, "Can't unpack obdo array\n");
+			RETURN(-EPROTO);
+		}
+	}
 
         /* set/clear over quota flag for a uid/gid */
-        if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE &&
-            body->oa.o_valid & (OBD_MD_FLUSRQUOTA | OBD_MD_FLGRPQUOTA)) {
-                unsigned int qid[MAXQUOTAS] = { body->oa.o_uid, body->oa.o_gid };
+	for (k = 0; k < nobjs &&
+		    lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE; k++) {
+		struct obdo *roa = k == 0 ? &body->oa : &oarr[k - 1];
+		unsigned int qid[MAXQUOTAS] = { roa->o_uid, roa->o_gid };
+
+		if (!(roa->o_valid & (OBD_MD_FLUSRQUOTA | OBD_MD_FLGRPQUOTA)))
+			continue;
 
                 CDEBUG(D_QUOTA, "setdq for [%u %u] with valid "LPX64", flags %x\n",
-                       body->oa.o_uid, body->oa.o_gid, body->oa.o_valid,
-                       body->oa.o_flags);
-                osc_quota_setdq(cli, qid, body->oa.o_valid, body->oa.o_flags);
+		       roa->o_uid, roa->o_gid, roa->o_valid, roa->o_flags);
+		osc_quota_setdq(cli, qid, roa->o_valid, roa->o_flags);
         }
 
         osc_update_grant(cli, body);
@@ -1629,9 +1767,13 @@ static int osc_brw_fini_request(struct ptlrpc_request *req, int rc)
                 rc = 0;
         }
 out:
-	if (rc >= 0)
+	if (rc >= 0) {
 		lustre_get_wire_obdo(&req->rq_import->imp_connect_data,
 				     aa->aa_oa, &body->oa);
+		for (k = 1; k < nobjs; k++)
+			lustre_get_wire_obdo(&req->rq_import->imp_connect_data,
+					     &aa->aa_oa[k], &oarr[k - 1]);
+	}
 
         RETURN(rc);
 }
@@ -1650,6 +1792,7 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
         rc = osc_brw_prep_request(lustre_msg_get_opc(request->rq_reqmsg) ==
                                         OST_WRITE ? OBD_BRW_WRITE :OBD_BRW_READ,
                                   aa->aa_cli, aa->aa_oa,
+				  osc_brw_nr_objs(request),
                                   NULL /* lsm unused by osc currently */,
                                   aa->aa_page_count, aa->aa_ppga,
                                   &new_req, aa->aa_ocapa, 0, 1);
@@ -1747,6 +1890,56 @@ static void osc_release_ppga(struct brw_page **ppga, obd_count count)
         OBD_FREE(ppga, sizeof(*ppga) * count);
 }
 
+/* Update the attributes of the object written or read by @last from @oa */
+static void osc_brw_update_attr(const struct lu_env *env,
+				struct ptlrpc_request *req, struct obdo *oa,
+				struct osc_async_page *last)
+{
+	struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+	unsigned long valid = 0;
+	struct cl_object *obj = osc2cl(last->oap_obj);
+
+	cl_object_attr_lock(obj);
+	if (oa->o_valid & OBD_MD_FLBLOCKS) {
+		attr->cat_blocks = oa->o_blocks;
+		valid |= CAT_BLOCKS;
+	}
+	if (oa->o_valid & OBD_MD_FLMTIME) {
+		attr->cat_mtime = oa->o_mtime;
+		valid |= CAT_MTIME;
+	}
+	if (oa->o_valid & OBD_MD_FLATIME) {
+		attr->cat_atime = oa->o_atime;
+		valid |= CAT_ATIME;
+	}
+	if (oa->o_valid & OBD_MD_FLCTIME) {
+		attr->cat_ctime = oa->o_ctime;
+		valid |= CAT_CTIME;
+	}
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+		struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
+		loff_t last_off = last->oap_count + last->oap_obj_off;
+
+		/* Change file size if this is an out of quota or
+		 * direct IO write and it extends the file size */
+		if (loi->loi_lvb.lvb_size < last_off) {
+			attr->cat_size = last_off;
+			valid |= CAT_SIZE;
+		}
+		/* Extend KMS if it's not a lockless write */
+		if (loi->loi_kms < last_off &&
+		    oap2osc_page(last)->ops_srvlock == 0) {
+			attr->cat_kms = last_off;
+			valid |= CAT_KMS;
+		}
+	}
+
+	if (valid != 0)
+		cl_object_attr_set(env, obj, attr, valid);
+	cl_object_attr_unlock(obj);
+}
+
 static int brw_interpret(const struct lu_env *env,
                          struct ptlrpc_request *req, void *data, int rc)
 {
@@ -1754,6 +1947,7 @@ static int brw_interpret(const struct lu_env *env,
 	struct osc_extent *ext;
 	struct osc_extent *tmp;
 	struct client_obd *cli = aa->aa_cli;
+	int nobjs = osc_brw_nr_objs(req);
         ENTRY;
 
         rc = osc_brw_fini_request(req, rc);
@@ -1783,62 +1977,30 @@ static int brw_interpret(const struct lu_env *env,
 			rc = -EIO;
 	}
 
-        if (aa->aa_ocapa) {
-                capa_put(aa->aa_ocapa);
-                aa->aa_ocapa = NULL;
-        }
+	if (aa->aa_ocapa) {
+		osc_brw_capa_put(aa->aa_ocapa, osc_brw_nr_objs(req));
+		aa->aa_ocapa = NULL;
+	}
 
 	if (rc == 0) {
-		struct obdo *oa = aa->aa_oa;
-		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
-		unsigned long valid = 0;
-		struct cl_object *obj;
-		struct osc_async_page *last;
-
-		last = brw_page2oap(aa->aa_ppga[aa->aa_page_count - 1]);
-		obj = osc2cl(last->oap_obj);
-
-		cl_object_attr_lock(obj);
-		if (oa->o_valid & OBD_MD_FLBLOCKS) {
-			attr->cat_blocks = oa->o_blocks;
-			valid |= CAT_BLOCKS;
-		}
-		if (oa->o_valid & OBD_MD_FLMTIME) {
-			attr->cat_mtime = oa->o_mtime;
-			valid |= CAT_MTIME;
+		int i, k;
+
+		/* pages of each object are contiguous in aa_ppga and the
+		 * objects are in the same order as in aa_oa */
+		for (i = k = 0; i < aa->aa_page_count; i++) {
+			struct osc_async_page *last;
+
+			last = brw_page2oap(aa->aa_ppga[i]);
+			if (i < aa->aa_page_count - 1 &&
+			    brw_page2oap(aa->aa_ppga[i + 1])->oap_obj ==
+			    last->oap_obj)
+				continue;
+			LASSERT(k < nobjs);
+			osc_brw_update_attr(env, req, &aa->aa_oa[k++], last);
 		}
-		if (oa->o_valid & OBD_MD_FLATIME) {
-			attr->cat_atime = oa->o_atime;
-			valid |= CAT_ATIME;
-		}
-		if (oa->o_valid & OBD_MD_FLCTIME) {
-			attr->cat_ctime = oa->o_ctime;
-			valid |= CAT_CTIME;
-		}
-
-		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
-			struct lov_oinfo *loi = cl2osc(obj)->oo_oinfo;
-			loff_t last_off = last->oap_count + last->oap_obj_off;
-
-			/* Change file size if this is an out of quota or
-			 * direct IO write and it extends the file size */
-			if (loi->loi_lvb.lvb_size < last_off) {
-				attr->cat_size = last_off;
-				valid |= CAT_SIZE;
-			}
-			/* Extend KMS if it's not a lockless write */
-			if (loi->loi_kms < last_off &&
-			    oap2osc_page(last)->ops_srvlock == 0) {
-				attr->cat_kms = last_off;
-				valid |= CAT_KMS;
-			}
-		}
-
-		if (valid != 0)
-			cl_object_attr_set(env, obj, attr, valid);
-		cl_object_attr_unlock(obj);
+		LASSERT(k == nobjs);
 	}
-	OBDO_FREE(aa->aa_oa);
+	osc_brw_oa_free(aa->aa_oa, nobjs);
 
 	cfs_list_for_each_entry_safe(ext, tmp, &aa->aa_exts, oe_link) {
 		cfs_list_del_init(&ext->oe_link);
@@ -1890,9 +2052,23 @@ static void brw_commit(struct ptlrpc_request *req)
  * that the total pages in this list are NOT over max pages per RPC.
  * Extents in the list must be in OES_RPC state.
  */
+/* Order objects the way the OST expects them in a multi-object write */
+static int osc_object_cmp(struct osc_object *o1, struct osc_object *o2)
+{
+	struct ost_id *oi1 = &o1->oo_oinfo->loi_oi;
+	struct ost_id *oi2 = &o2->oo_oinfo->loi_oi;
+
+	if (ostid_seq(oi1) != ostid_seq(oi2))
+		return ostid_seq(oi1) < ostid_seq(oi2) ? -1 : 1;
+	if (ostid_id(oi1) != ostid_id(oi2))
+		return ostid_id(oi1) < ostid_id(oi2) ? -1 : 1;
+	return 0;
+}
+
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  cfs_list_t *ext_list, int cmd, pdl_policy_t pol)
 {
+	struct osc_object		**objs = osc_env_info(env)->oti_brw_objs;
 	struct ptlrpc_request		*req = NULL;
 	struct osc_extent		*ext;
 	struct brw_page			**pga = NULL;
@@ -1903,44 +2079,72 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	struct cl_req			*clerq = NULL;
 	enum cl_req_type		crt = (cmd & OBD_BRW_WRITE) ? CRT_WRITE :
 								      CRT_READ;
-	struct ldlm_lock		*lock = NULL;
 	struct cl_req_attr		*crattr = NULL;
+	struct obd_capa			*ocapa[PTLRPC_MAX_BRW_OBJS];
 	obd_off				starting_offset = OBD_OBJECT_EOF;
-	obd_off				ending_offset = 0;
 	int				mpflag = 0;
 	int				mem_tight = 0;
 	int				page_count = 0;
+	int				nobjs = 0;
+	int				ncapa = 0;
 	int				i;
+	int				k;
 	int				rc;
 	CFS_LIST_HEAD(rpc_list);
 
 	ENTRY;
 	LASSERT(!cfs_list_empty(ext_list));
 
-	/* add pages into rpc_list to build BRW rpc */
+	/* collect the objects of the RPC, sorted as tgt_io_multi_unpack()
+	 * wants them to avoid lock inversion between object writes */
 	cfs_list_for_each_entry(ext, ext_list, oe_link) {
 		LASSERT(ext->oe_state == OES_RPC);
 		mem_tight |= ext->oe_memalloc;
-		cfs_list_for_each_entry(oap, &ext->oe_pages, oap_pending_item) {
-			++page_count;
-			cfs_list_add_tail(&oap->oap_rpc_item, &rpc_list);
-			if (starting_offset > oap->oap_obj_off)
-				starting_offset = oap->oap_obj_off;
-			else
-				LASSERT(oap->oap_page_off == 0);
-			if (ending_offset < oap->oap_obj_off + oap->oap_count)
-				ending_offset = oap->oap_obj_off +
-						oap->oap_count;
-			else
-				LASSERT(oap->oap_page_off + oap->oap_count ==
-					PAGE_CACHE_SIZE);
+		for (k = 0; k < nobjs && objs[k] != ext->oe_obj; k++)
+			;
+		if (k < nobjs)
+			continue;
+		LASSERT(nobjs < PTLRPC_MAX_BRW_OBJS);
+		for (k = nobjs++; k > 0 &&
+		     osc_object_cmp(objs[k - 1], ext->oe_obj) > 0; k--)
+			objs[k] = objs[k - 1];
+		objs[k] = ext->oe_obj;
+	}
+
+	/* add pages into rpc_list to build BRW rpc, one object after another */
+	for (k = 0; k < nobjs; k++) {
+		obd_off obj_start = OBD_OBJECT_EOF;
+		obd_off obj_end = 0;
+
+		cfs_list_for_each_entry(ext, ext_list, oe_link) {
+			if (ext->oe_obj != objs[k])
+				continue;
+			cfs_list_for_each_entry(oap, &ext->oe_pages,
+						oap_pending_item) {
+				++page_count;
+				cfs_list_add_tail(&oap->oap_rpc_item,
+						  &rpc_list);
+				if (obj_start > oap->oap_obj_off)
+					obj_start = oap->oap_obj_off;
+				else
+					LASSERT(oap->oap_page_off == 0);
+				if (obj_end < oap->oap_obj_off + oap->oap_count)
+					obj_end = oap->oap_obj_off +
+						  oap->oap_count;
+				else
+					LASSERT(oap->oap_page_off +
+						oap->oap_count ==
+						PAGE_CACHE_SIZE);
+			}
 		}
+		if (starting_offset > obj_start)
+			starting_offset = obj_start;
 	}
 
 	if (mem_tight)
 		mpflag = cfs_memory_pressure_get_and_set();
 
-	OBD_ALLOC(crattr, sizeof(*crattr));
+	OBD_ALLOC(crattr, nobjs * sizeof(*crattr));
 	if (crattr == NULL)
 		GOTO(out, rc = -ENOMEM);
 
@@ -1948,7 +2152,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	if (pga == NULL)
 		GOTO(out, rc = -ENOMEM);
 
-	OBDO_ALLOC(oa);
+	oa = osc_brw_oa_alloc(nobjs);
 	if (oa == NULL)
 		GOTO(out, rc = -ENOMEM);
 
@@ -1956,11 +2160,9 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	cfs_list_for_each_entry(oap, &rpc_list, oap_rpc_item) {
 		struct cl_page *page = oap2cl_page(oap);
 		if (clerq == NULL) {
-			clerq = cl_req_alloc(env, page, crt,
-					     1 /* only 1-object rpcs for now */);
+			clerq = cl_req_alloc(env, page, crt, nobjs);
 			if (IS_ERR(clerq))
 				GOTO(out, rc = PTR_ERR(clerq));
-			lock = oap->oap_ldlm_lock;
 		}
 		if (mem_tight)
 			oap->oap_brw_flags |= OBD_BRW_MEMALLOC;
@@ -1975,12 +2177,24 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 
 	/* always get the data for the obdo for the rpc */
 	LASSERT(clerq != NULL);
-	crattr->cra_oa = oa;
+	for (k = 0; k < nobjs; k++)
+		crattr[k].cra_oa = &oa[k];
 	cl_req_attr_set(env, clerq, crattr, ~0ULL);
-	if (lock) {
-		oa->o_handle = lock->l_remote_handle;
-		oa->o_valid |= OBD_MD_FLHANDLE;
+
+	/* the lock handle and page order are per object: pages of each
+	 * object are contiguous in @pga, in the order of @objs */
+	for (i = k = 0; i < page_count; i++) {
+		oap = brw_page2oap(pga[i]);
+		if (i > 0 && brw_page2oap(pga[i - 1])->oap_obj == oap->oap_obj)
+			continue;
+		LASSERT(oap->oap_obj == objs[k]);
+		if (oap->oap_ldlm_lock) {
+			oa[k].o_handle = oap->oap_ldlm_lock->l_remote_handle;
+			oa[k].o_valid |= OBD_MD_FLHANDLE;
+		}
+		k++;
 	}
+	LASSERT(k == nobjs);
 
 	rc = cl_req_prep(env, clerq);
 	if (rc != 0) {
@@ -1988,9 +2202,21 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		GOTO(out, rc);
 	}
 
-	sort_brw_pages(pga, page_count);
-	rc = osc_brw_prep_request(cmd, cli, oa, NULL, page_count,
-			pga, &req, crattr->cra_capa, 1, 0);
+	for (i = k = 0; i < page_count; i++) {
+		if (i < page_count - 1 &&
+		    brw_page2oap(pga[i])->oap_obj ==
+		    brw_page2oap(pga[i + 1])->oap_obj)
+			continue;
+		sort_brw_pages(pga + k, i + 1 - k);
+		k = i + 1;
+	}
+	for (k = 0; k < nobjs; k++) {
+		ocapa[k] = crattr[k].cra_capa;
+		if (ocapa[k] != NULL)
+			ncapa++;
+	}
+	rc = osc_brw_prep_request(cmd, cli, oa, nobjs, NULL, page_count,
+			pga, &req, ncapa > 0 ? ocapa : NULL, 1, 0);
 	if (rc != 0) {
 		CERROR("prep_req failed: %d\n", rc);
 		GOTO(out, rc);
@@ -2050,11 +2276,13 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		lprocfs_oh_tally(&cli->cl_write_rpc_hist, cli->cl_w_in_flight);
 		lprocfs_oh_tally_log2(&cli->cl_write_offset_hist,
 				      starting_offset + 1);
+		lprocfs_oh_tally(&cli->cl_write_obj_hist, nobjs);
 	}
 	client_obd_list_unlock(&cli->cl_loi_list_lock);
 
-	DEBUG_REQ(D_INODE, req, "%d pages, aa %p. now %dr/%dw in flight",
-		  page_count, aa, cli->cl_r_in_flight,
+	DEBUG_REQ(D_INODE, req, "%d pages of %d objects, aa %p. "
+		  "now %dr/%dw in flight", page_count, nobjs, aa,
+		  cli->cl_r_in_flight,
 		  cli->cl_w_in_flight);
 
 	/* XXX: Maybe the caller can check the RPC bulk descriptor to
@@ -2078,15 +2306,16 @@ out:
 		cfs_memory_pressure_restore(mpflag);
 
 	if (crattr != NULL) {
-		capa_put(crattr->cra_capa);
-		OBD_FREE(crattr, sizeof(*crattr));
+		for (k = 0; k < nobjs; k++)
+			capa_put(crattr[k].cra_capa);
+		OBD_FREE(crattr, nobjs * sizeof(*crattr));
 	}
 
 	if (rc != 0) {
 		LASSERT(req == NULL);
 
 		if (oa)
-			OBDO_FREE(oa);
+			osc_brw_oa_free(oa, nobjs);
 		if (pga)
 			OBD_FREE(pga, sizeof(*pga) * page_count);
 		/* this should happen rarely and is pretty bad, it makes the
@@ -3089,6 +3318,65 @@ static int brw_queue_work(const struct lu_env *env, void *data)
 	RETURN(0);
 }
 
+/* Set up the per-CPT page LRU lists and their background shrinking work. */
+static int osc_lru_parts_setup(struct client_obd *cli)
+{
+	struct osc_lru_part *olp;
+	void		    *handler;
+	int		     i;
+
+	cli->cl_lru_parts = cfs_percpt_alloc(cfs_cpt_table, sizeof(*olp));
+	if (cli->cl_lru_parts == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(olp, i, cli->cl_lru_parts) {
+		client_obd_list_lock_init(&olp->olp_lock);
+		CFS_INIT_LIST_HEAD(&olp->olp_list);
+		atomic_set(&olp->olp_in_list, 0);
+		atomic_set(&olp->olp_shrinkers, 0);
+		olp->olp_cli = cli;
+		olp->olp_cpt = i;
+
+		handler = ptlrpcd_alloc_work(cli->cl_import, lru_queue_work,
+					     olp);
+		if (IS_ERR(handler))
+			return PTR_ERR(handler);
+		olp->olp_work = handler;
+	}
+	return 0;
+}
+
+static void osc_lru_parts_fini_work(struct client_obd *cli)
+{
+	struct osc_lru_part *olp;
+	int		     i;
+
+	if (cli->cl_lru_parts == NULL)
+		return;
+
+	cfs_percpt_for_each(olp, i, cli->cl_lru_parts) {
+		if (olp->olp_work != NULL) {
+			ptlrpcd_destroy_work(olp->olp_work);
+			olp->olp_work = NULL;
+		}
+	}
+}
+
+static void osc_lru_parts_cleanup(struct client_obd *cli)
+{
+	struct osc_lru_part *olp;
+	int		     i;
+
+	if (cli->cl_lru_parts == NULL)
+		return;
+
+	osc_lru_parts_fini_work(cli);
+	cfs_percpt_for_each(olp, i, cli->cl_lru_parts)
+		LASSERT(cfs_list_empty(&olp->olp_list));
+	cfs_percpt_free(cli->cl_lru_parts);
+	cli->cl_lru_parts = NULL;
+}
+
 int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 {
 	struct client_obd *cli = &obd->u.cli;
@@ -3110,10 +3398,9 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 		GOTO(out_client_setup, rc = PTR_ERR(handler));
 	cli->cl_writeback_work = handler;
 
-	handler = ptlrpcd_alloc_work(cli->cl_import, lru_queue_work, cli);
-	if (IS_ERR(handler))
-		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
-	cli->cl_lru_work = handler;
+	rc = osc_lru_parts_setup(cli);
+	if (rc)
+		GOTO(out_ptlrpcd_work, rc);
 
 	rc = osc_quota_setup(obd);
 	if (rc)
@@ -3170,10 +3457,7 @@ out_ptlrpcd_work:
 		ptlrpcd_destroy_work(cli->cl_writeback_work);
 		cli->cl_writeback_work = NULL;
 	}
-	if (cli->cl_lru_work != NULL) {
-		ptlrpcd_destroy_work(cli->cl_lru_work);
-		cli->cl_lru_work = NULL;
-	}
+	osc_lru_parts_cleanup(cli);
 out_client_setup:
 	client_obd_cleanup(obd);
 out_ptlrpcd:
@@ -3214,10 +3498,7 @@ static int osc_precleanup(struct obd_device *obd, enum obd_cleanup_stage stage)
                         ptlrpcd_destroy_work(cli->cl_writeback_work);
                         cli->cl_writeback_work = NULL;
                 }
-		if (cli->cl_lru_work) {
-			ptlrpcd_destroy_work(cli->cl_lru_work);
-			cli->cl_lru_work = NULL;
-		}
+		osc_lru_parts_fini_work(cli);
                 obd_cleanup_client_import(obd);
                 ptlrpc_lprocfs_unregister_obd(obd);
                 lprocfs_obd_cleanup(obd);
@@ -3247,6 +3528,7 @@ int osc_cleanup(struct obd_device *obd)
 		atomic_dec(&cli->cl_cache->ccc_users);
 		cli->cl_cache = NULL;
 	}
+	osc_lru_parts_cleanup(cli);
 
         /* free memory of osc quota cache */
         osc_quota_cleanup(obd);
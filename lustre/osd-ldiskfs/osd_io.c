@@ -272,6 +272,9 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
         int            page_idx;
         int            i;
         int            rc = 0;
+#ifndef HAVE_REQUEST_QUEUE_UNPLUG_FN
+	struct blk_plug plug;
+#endif
         ENTRY;
 
         LASSERT(iobuf->dr_npages == npages);
@@ -279,6 +282,15 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
         osd_brw_stats_update(osd, iobuf);
         iobuf->dr_start_time = cfs_time_current();
 
+#ifndef HAVE_REQUEST_QUEUE_UNPLUG_FN
+	/* hold the bios of the whole iobuf in the per-task plug list, so
+	 * they are merged and dispatched to the device in one batch rather
+	 * than one by one. Only the bios of this RPC are batched, and the
+	 * block layer picks the hardware queue of the CPU the thread runs
+	 * on, within its CPT when the OSS threads are bound to CPTs */
+	blk_start_plug(&plug);
+#endif
+
         for (page_idx = 0, block_idx = 0;
              page_idx < npages;
              page_idx++, block_idx += blocks_per_page) {
@@ -365,6 +377,11 @@ static int osd_do_bio(struct osd_device *osd, struct inode *inode,
         }
 
 out:
+#ifndef HAVE_REQUEST_QUEUE_UNPLUG_FN
+	/* must be flushed before waiting for the reads below */
+	blk_finish_plug(&plug);
+#endif
+
 	/* in order to achieve better IO throughput, we don't wait for writes
 	 * completion here. instead we proceed with transaction commit in
 	 * parallel and wait for IO completion once transaction is stopped
@@ -520,8 +537,56 @@ struct bpointers {
 	int num;
 	int init_num;
 	int create;
+	/* the following runs of contiguous pages, mapped by the same walk
+	 * of the extent tree */
+	struct page **pages;
+	int npages;
+	int next;
+	int blocks_per_page;
 };
 
+/* move \a bp to the next run of contiguous pages, return 0 if none */
+static int osd_bp_next_run(struct bpointers *bp)
+{
+	struct page *fp;
+	int clen = 1;
+
+	if (bp->next >= bp->npages)
+		return 0;
+
+	fp = bp->pages[bp->next++];
+	while (bp->next < bp->npages &&
+	       bp->pages[bp->next]->index == fp->index + clen) {
+		bp->next++;
+		clen++;
+	}
+	bp->start = fp->index * bp->blocks_per_page;
+	bp->num = clen * bp->blocks_per_page;
+	return 1;
+}
+
+/*
+ * Trim the hole \a cex to the part of the current run it covers, so that
+ * blocks are never allocated between two runs. Return 0 if \a cex lies
+ * entirely before the current run, the walk then just steps over it.
+ */
+static int osd_bp_trim_hole(struct bpointers *bp, struct ldiskfs_ext_cache *cex)
+{
+	unsigned long end = cex->ec_block + cex->ec_len;
+
+	if (bp->num == 0 && osd_bp_next_run(bp) == 0)
+		return 0;
+	if (end <= bp->start)
+		return 0;
+
+	if (cex->ec_block < bp->start)
+		cex->ec_block = bp->start;
+	if (end > bp->start + bp->num)
+		end = bp->start + bp->num;
+	cex->ec_len = end - cex->ec_block;
+	return 1;
+}
+
 static long ldiskfs_ext_find_goal(struct inode *inode,
 				  struct ldiskfs_ext_path *path,
 				  unsigned long block, int *aflags)
@@ -609,14 +674,12 @@ static int ldiskfs_ext_new_extent_cb(struct inode *inode,
 		goto map;
 	}
 
+	if (osd_bp_trim_hole(bp, cex) == 0)
+		return EXT_CONTINUE;
+
 	if (bp->create == 0) {
-		i = 0;
-		if (cex->ec_block < bp->start)
-			i = bp->start - cex->ec_block;
-		if (i >= cex->ec_len)
-			CERROR("nothing to do?! i = %d, e_num = %u\n",
-					i, cex->ec_len);
-		for (; i < cex->ec_len && bp->num; i++) {
+		/* the hole was trimmed to start at bp->start */
+		for (i = 0; i < cex->ec_len && bp->num; i++) {
 			*(bp->blocks) = 0;
 			bp->blocks++;
 			bp->num--;
@@ -695,7 +758,7 @@ out:
 map:
 	if (err >= 0) {
 		/* map blocks */
-		if (bp->num == 0) {
+		if (bp->num == 0 && osd_bp_next_run(bp) == 0) {
 			CERROR("hmm. why do we find this extent?\n");
 			CERROR("initial space: %lu:%u\n",
 				bp->start, bp->init_num);
@@ -710,12 +773,10 @@ map:
 				(unsigned long long)cex->ec_start);
 #endif
 		}
+again:
 		i = 0;
 		if (cex->ec_block < bp->start)
 			i = bp->start - cex->ec_block;
-		if (i >= cex->ec_len)
-			CERROR("nothing to do?! i = %d, e_num = %u\n",
-					i, cex->ec_len);
 		for (; i < cex->ec_len && bp->num; i++) {
 			*(bp->blocks) = cex->ec_start + i;
 #ifdef LDISKFS_EXT_CACHE_EXTENT /* until kernel 2.6.37 */
@@ -732,6 +793,10 @@ map:
 			bp->num--;
 			bp->start++;
 		}
+		/* an existing extent may cover the next runs too */
+		if (bp->num == 0 && osd_bp_next_run(bp) != 0 &&
+		    bp->start < cex->ec_block + cex->ec_len)
+			goto again;
 	}
 	return err;
 }
@@ -750,6 +815,9 @@ int osd_ldiskfs_map_nblocks(struct inode *inode, unsigned long block,
 	bp.start = block;
 	bp.init_num = bp.num = num;
 	bp.create = create;
+	bp.pages = NULL;
+	bp.npages = 0;
+	bp.next = 0;
 
 	err = ldiskfs_ext_walk_space(inode, block, num,
 					 ldiskfs_ext_new_extent_cb, &bp);
@@ -758,52 +826,37 @@ int osd_ldiskfs_map_nblocks(struct inode *inode, unsigned long block,
 	return err;
 }
 
+/*
+ * Map all the pages at once: the pages are sorted already, a single walk of
+ * the extent tree goes over all runs of contiguous pages, skipping the gaps
+ * between them, and allocates each hole covered by a run in one request so
+ * that it ends up in one extent.
+ */
 int osd_ldiskfs_map_ext_inode_pages(struct inode *inode, struct page **page,
 				    int pages, unsigned long *blocks,
 				    int create)
 {
-	int blocks_per_page = PAGE_CACHE_SIZE >> inode->i_blkbits;
-	int rc = 0, i = 0;
-	struct page *fp = NULL;
-	int clen = 0;
+	struct bpointers	bp;
+	unsigned long		last;
+	int			rc;
 
 	CDEBUG(D_OTHER, "inode %lu: map %d pages from %lu\n",
 		inode->i_ino, pages, (*page)->index);
 
-	/* pages are sorted already. so, we just have to find
-	 * contig. space and process them properly */
-	while (i < pages) {
-		if (fp == NULL) {
-			/* start new extent */
-			fp = *page++;
-			clen = 1;
-			i++;
-			continue;
-		} else if (fp->index + clen == (*page)->index) {
-			/* continue the extent */
-			page++;
-			clen++;
-			i++;
-			continue;
-		}
-
-		/* process found extent */
-		rc = osd_ldiskfs_map_nblocks(inode, fp->index * blocks_per_page,
-					     clen * blocks_per_page, blocks,
-					     create);
-		if (rc)
-			GOTO(cleanup, rc);
-
-		/* look for next extent */
-		fp = NULL;
-		blocks += blocks_per_page * clen;
-	}
+	bp.blocks = blocks;
+	bp.create = create;
+	bp.pages = page;
+	bp.npages = pages;
+	bp.next = 0;
+	bp.blocks_per_page = PAGE_CACHE_SIZE >> inode->i_blkbits;
+	osd_bp_next_run(&bp);
+	bp.init_num = bp.num;
+
+	last = (page[pages - 1]->index + 1) * bp.blocks_per_page;
+	rc = ldiskfs_ext_walk_space(inode, bp.start, last - bp.start,
+				    ldiskfs_ext_new_extent_cb, &bp);
+	ldiskfs_ext_invalidate_cache(inode);
 
-	if (fp)
-		rc = osd_ldiskfs_map_nblocks(inode, fp->index * blocks_per_page,
-					     clen * blocks_per_page, blocks,
-					     create);
-cleanup:
 	return rc;
 }
 
@@ -862,6 +915,8 @@ static int osd_write_prep(const struct lu_env *env, struct dt_object *dt,
         __s64                   maxidx;
         int                     rc = 0;
         int                     i;
+	int			j;
+	int			bpp;
         int                     cache = 0;
 
         LASSERT(inode);
@@ -892,12 +947,13 @@ static int osd_write_prep(const struct lu_env *env, struct dt_object *dt,
                  */
                 ClearPageUptodate(lnb[i].page);
 
+		/* all pages are looked up below, see OBD_BRW_LOCAL1 */
+		osd_iobuf_add_page(iobuf, lnb[i].page);
+
 		if (lnb[i].len == PAGE_CACHE_SIZE)
                         continue;
 
-                if (maxidx >= lnb[i].page->index) {
-                        osd_iobuf_add_page(iobuf, lnb[i].page);
-                } else {
+                if (maxidx < lnb[i].page->index) {
                         long off;
                         char *p = kmap(lnb[i].page);
 
@@ -915,43 +971,50 @@ static int osd_write_prep(const struct lu_env *env, struct dt_object *dt,
 	timediff = cfs_timeval_sub(&end, &start, NULL);
 	lprocfs_counter_add(osd->od_stats, LPROC_OSD_GET_PAGE, timediff);
 
-        if (iobuf->dr_npages) {
-		rc = osd_ldiskfs_map_inode_pages(inode, iobuf->dr_pages,
-						 iobuf->dr_npages,
-						 iobuf->dr_blocks,
-						 0, NULL);
-                if (likely(rc == 0)) {
-                        rc = osd_do_bio(osd, inode, iobuf);
-                        /* do IO stats for preparation reads */
-                        osd_fini_iobuf(osd, iobuf);
-                }
-        }
-        RETURN(rc);
-}
-
-/* Check if a block is allocated or not */
-static int osd_is_mapped(struct inode *inode, obd_size offset)
-{
-	sector_t (*fs_bmap)(struct address_space *, sector_t);
-
-	fs_bmap = inode->i_mapping->a_ops->bmap;
+	/* Look up the blocks of every page once, before the transaction is
+	 * started: this brings the extent tree into memory for the
+	 * allocation at commit time, and tells osd_declare_write_commit()
+	 * and osd_write_commit() which pages are overwrites, so that they
+	 * need neither bmap() each page nor reserve credits for them. */
+	rc = osd_ldiskfs_map_inode_pages(inode, iobuf->dr_pages,
+					 iobuf->dr_npages, iobuf->dr_blocks,
+					 0, NULL);
+	if (unlikely(rc != 0))
+		RETURN(rc);
 
-	/* We can't know if we are overwriting or not */
-	if (unlikely(fs_bmap == NULL))
-		return 0;
+	bpp = PAGE_CACHE_SIZE >> inode->i_blkbits;
+	for (i = 0, j = 0; i < npages; i++) {
+		unsigned long *blocks = iobuf->dr_blocks + i * bpp;
+		int k;
 
-	if (i_size_read(inode) == 0)
-		return 0;
+		lnb[i].flags |= OBD_BRW_LOCAL1;
+		for (k = 0; k < bpp; k++) {
+			if (blocks[k] == 0) {
+				lnb[i].flags &= ~OBD_BRW_LOCAL1;
+				break;
+			}
+		}
 
-	/* Beyond EOF, must not be mapped */
-	if (((i_size_read(inode) - 1) >> inode->i_blkbits) <
-	    (offset >> inode->i_blkbits))
-		return 0;
+		/* only partial pages inside the file have to be read */
+		if (lnb[i].len == PAGE_CACHE_SIZE ||
+		    maxidx < lnb[i].page->index)
+			continue;
 
-	if (fs_bmap(inode->i_mapping, offset >> inode->i_blkbits) == 0)
-		return 0;
+		if (j != i) {
+			iobuf->dr_pages[j] = iobuf->dr_pages[i];
+			memmove(iobuf->dr_blocks + j * bpp, blocks,
+				bpp * sizeof(*blocks));
+		}
+		j++;
+	}
+	iobuf->dr_npages = j;
 
-	return 1;
+	if (iobuf->dr_npages) {
+		rc = osd_do_bio(osd, inode, iobuf);
+		/* do IO stats for preparation reads */
+		osd_fini_iobuf(osd, iobuf);
+	}
+        RETURN(rc);
 }
 
 static int osd_declare_write_commit(const struct lu_env *env,
@@ -962,7 +1025,7 @@ static int osd_declare_write_commit(const struct lu_env *env,
         const struct osd_device *osd = osd_obj2dev(osd_dt_obj(dt));
         struct inode            *inode = osd_dt_obj(dt)->oo_inode;
         struct osd_thandle      *oh;
-        int                      extents = 1;
+        int                      extents = 0;
         int                      depth;
         int                      i;
         int                      newblocks;
@@ -976,16 +1039,20 @@ static int osd_declare_write_commit(const struct lu_env *env,
         oh = container_of0(handle, struct osd_thandle, ot_super);
         LASSERT(oh->ot_handle == NULL);
 
-        newblocks = npages;
+        newblocks = 0;
 
-        /* calculate number of extents (probably better to pass nb) */
+	/* calculate number of extents to be allocated: pages found mapped
+	 * by osd_write_prep() are overwritten in place and need no credits
+	 * for the block allocation */
 	for (i = 0; i < npages; i++) {
-		if (i && lnb[i].lnb_file_offset !=
-		    lnb[i - 1].lnb_file_offset + lnb[i - 1].len)
-			extents++;
-
-		if (!osd_is_mapped(inode, lnb[i].lnb_file_offset))
+		if (!(lnb[i].flags & OBD_BRW_LOCAL1)) {
+			if (newblocks == 0 || lnb[i].lnb_file_offset !=
+			    lnb[i - 1].lnb_file_offset + lnb[i - 1].len ||
+			    (lnb[i - 1].flags & OBD_BRW_LOCAL1))
+				extents++;
+			newblocks++;
 			quota_space += PAGE_CACHE_SIZE;
+		}
 
 		/* ignore quota for the whole request if any page is from
 		 * client cache or written by root.
@@ -1002,6 +1069,12 @@ static int osd_declare_write_commit(const struct lu_env *env,
 			ignore_quota = true;
 	}
 
+	if (newblocks == 0) {
+		/* pure overwrite, only the inode is modified */
+		oh->ot_credits++;
+		goto out_declare;
+	}
+
         /*
          * each extent can go into new leaf causing a split
          * 5 is max tree depth: inode + 4 index blocks
@@ -1044,6 +1117,7 @@ static int osd_declare_write_commit(const struct lu_env *env,
         else
                 oh->ot_credits += newblocks;
 
+out_declare:
 	/* make sure the over quota flags were not set */
 	lnb[0].flags &= ~(OBD_BRW_OVER_USRQUOTA | OBD_BRW_OVER_GRPQUOTA);
 
@@ -1084,8 +1158,7 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
 	ll_vfs_dq_init(inode);
 
         for (i = 0; i < npages; i++) {
-                if (lnb[i].rc == -ENOSPC &&
-		    osd_is_mapped(inode, lnb[i].lnb_file_offset)) {
+		if (lnb[i].rc == -ENOSPC && (lnb[i].flags & OBD_BRW_LOCAL1)) {
                         /* Allow the write to proceed if overwriting an
                          * existing block */
                         lnb[i].rc = 0;
@@ -203,6 +203,8 @@ out:
  *      instead I use the lowest bit of the address so that:
  *        arc buffer:  .lnb_obj = abuf          (arc we loan for write)
  *        dbuf buffer: .lnb_obj = dbuf | 1      (dbuf we get for read)
+ *        part buffer: .lnb_obj = abuf | 2      (arc we loan to copy a
+ *                                               partial block from)
  *        copy buffer: .lnb_page->mapping = obj (page we allocate for write)
  *
  *      bzzz, to blame
@@ -233,6 +235,10 @@ static int osd_bufs_put(const struct lu_env *env, struct dt_object *dt,
 				ptr &= ~1UL;
 				dmu_buf_rele((void *)ptr, osd_zerocopy_tag);
 				atomic_dec(&osd->od_zerocopy_pin);
+			} else if (ptr & 2UL) {
+				ptr &= ~2UL;
+				dmu_return_arcbuf((void *)ptr);
+				atomic_dec(&osd->od_zerocopy_loan);
 			} else if (lnb[i].dentry != NULL) {
 				dmu_return_arcbuf((void *)lnb[i].dentry);
 				atomic_dec(&osd->od_zerocopy_loan);
@@ -330,6 +336,65 @@ err:
 	RETURN(rc);
 }
 
+/*
+ * Loan an arcbuf for the fragment [off, off + len) of a block and map its
+ * pages to \a lnb. The fragment starts at the same offset within the first
+ * page as in the file, so the data is contiguous in the arcbuf. Return the
+ * number of pages used, or 0 if the arcbuf can't be used.
+ */
+static int osd_bufs_get_partial(struct osd_device *osd, struct osd_object *obj,
+				loff_t off, int len, struct niobuf_local *lnb)
+{
+	arc_buf_t	*abuf;
+	char		*addr;
+	void		*dbf;
+	int		 pgoff = off & ~CFS_PAGE_MASK;
+	int		 plen;
+	int		 i = 0;
+
+	abuf = dmu_request_arcbuf(obj->oo_db,
+				  (pgoff + len + PAGE_CACHE_SIZE - 1) &
+				  CFS_PAGE_MASK);
+	if (unlikely(abuf == NULL))
+		return 0;
+
+	/* pages are handed to ptlrpc, the buffer must start a page */
+	if (unlikely((unsigned long)abuf->b_data & ~CFS_PAGE_MASK)) {
+		dmu_return_arcbuf(abuf);
+		return 0;
+	}
+
+	atomic_inc(&osd->od_zerocopy_loan);
+
+	/* see comment in osd_bufs_put() */
+	dbf = (void *)((unsigned long)abuf | 2);
+	addr = abuf->b_data;
+	while (len > 0) {
+		plen = min_t(int, len, PAGE_CACHE_SIZE - pgoff);
+
+		lnb[i].lnb_file_offset = off;
+		lnb[i].lnb_page_offset = pgoff;
+		lnb[i].len = plen;
+		lnb[i].rc = 0;
+		/* only the first page releases the arcbuf */
+		lnb[i].dentry = dbf;
+		dbf = NULL;
+
+		lnb[i].page = kmem_to_page(addr);
+		LASSERT(lnb[i].page);
+
+		lprocfs_counter_add(osd->od_stats, LPROC_OSD_COPY_IO, 1);
+
+		len -= plen;
+		off += plen;
+		addr += PAGE_CACHE_SIZE;
+		pgoff = 0;
+		i++;
+	}
+
+	return i;
+}
+
 static int osd_bufs_get_write(const struct lu_env *env, struct osd_object *obj,
 				loff_t off, ssize_t len, struct niobuf_local *lnb)
 {
@@ -397,6 +462,20 @@ static int osd_bufs_get_write(const struct lu_env *env, struct osd_object *obj,
 				lprocfs_counter_add(osd->od_stats,
 						LPROC_OSD_TAIL_IO, 1);
 
+			/* a partial block can't be assigned, it has to be
+			 * copied into the dbuf. but loaning one arcbuf for
+			 * the whole fragment lets osd_write_commit() do that
+			 * with a single dmu_write() instead of one per page */
+			rc = osd_bufs_get_partial(osd, obj, off, sz_in_block,
+						  lnb + i);
+			if (rc > 0) {
+				len -= sz_in_block;
+				off += sz_in_block;
+				i += rc;
+				npages += rc;
+				continue;
+			}
+
 			/* can't use zerocopy, allocate temp. buffers */
 			while (sz_in_block > 0) {
 				plen = min_t(int, sz_in_block, PAGE_CACHE_SIZE);
@@ -647,7 +726,9 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
 	udmu_objset_t      *uos = &osd->od_objset;
 	struct osd_thandle *oh;
 	uint64_t            new_size = 0;
-	int                 i, rc = 0;
+	arc_buf_t          *abuf = NULL;
+	uint64_t            abuf_off = 0;
+	int                 i, j, rc = 0;
 	ENTRY;
 
 	LASSERT(dt_object_exists(dt));
@@ -657,6 +738,18 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
 	oh = container_of0(th, struct osd_thandle, ot_super);
 
 	for (i = 0; i < npages; i++) {
+		unsigned long ptr = (unsigned long)lnb[i].dentry;
+
+		/* track the arcbuf the pages of a partial block were loaned
+		 * from, see osd_bufs_get_partial(). only its first page
+		 * refers to it, every other buffer starts a new block */
+		if (ptr & 2UL) {
+			abuf = (arc_buf_t *)(ptr & ~2UL);
+			abuf_off = lnb[i].lnb_file_offset & CFS_PAGE_MASK;
+		} else if (ptr != 0 || lnb[i].page->mapping == (void *)obj) {
+			abuf = NULL;
+		}
+
 		CDEBUG(D_INODE, "write %u bytes at %u\n",
 			(unsigned) lnb[i].len,
 			(unsigned) lnb[i].lnb_file_offset);
@@ -676,8 +769,23 @@ static int osd_write_commit(const struct lu_env *env, struct dt_object *dt,
 				lnb[i].lnb_file_offset, lnb[i].len,
 				kmap(lnb[i].page), oh->ot_tx);
 			kunmap(lnb[i].page);
+		} else if (abuf != NULL) {
+			/* the fragment is contiguous in the arcbuf, copy all
+			 * its pages with a single dmu_write() */
+			for (j = i + 1; j < npages && lnb[j].dentry == NULL &&
+			     lnb[j].page->mapping != (void *)obj &&
+			     lnb[j].rc == 0; j++)
+				;
+			dmu_write(osd->od_objset.os, obj->oo_db->db_object,
+				  lnb[i].lnb_file_offset,
+				  lnb[j - 1].lnb_file_offset + lnb[j - 1].len -
+				  lnb[i].lnb_file_offset,
+				  (char *)abuf->b_data +
+				  (lnb[i].lnb_file_offset - abuf_off),
+				  oh->ot_tx);
+			i = j - 1;
 		} else if (lnb[i].dentry) {
-			LASSERT(((unsigned long)lnb[i].dentry & 1) == 0);
+			LASSERT(((unsigned long)lnb[i].dentry & 3) == 0);
 			/* buffer loaned for zerocopy, try to use it.
 			 * notice that dmu_assign_arcbuf() is smart
 			 * enough to recognize changed blocksize
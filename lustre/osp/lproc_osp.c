@@ -195,6 +195,40 @@ static int osp_wr_max_rpcs_in_prog(struct file *file, const char *buffer,
 	return count;
 }
 
+static int osp_rd_max_sync_batch(char *page, char **start, off_t off,
+				 int count, int *eof, void *data)
+{
+	struct obd_device	*dev = data;
+	struct osp_device	*osp = lu2osp_dev(dev->obd_lu_dev);
+
+	if (osp == NULL)
+		return -EINVAL;
+
+	return snprintf(page, count, "%d\n", osp->opd_syn_max_batch);
+}
+
+static int osp_wr_max_sync_batch(struct file *file, const char *buffer,
+				 unsigned long count, void *data)
+{
+	struct obd_device	*dev = data;
+	struct osp_device	*osp = lu2osp_dev(dev->obd_lu_dev);
+	int			 val, rc;
+
+	if (osp == NULL)
+		return -EINVAL;
+
+	rc = lprocfs_write_helper(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	/* 0 or 1 sends one OST_DESTROY/OST_SETATTR per llog record */
+	if (val < 0 || val > OST_BATCH_MAX_RECS)
+		return -ERANGE;
+
+	osp->opd_syn_max_batch = val;
+	return count;
+}
+
 static int osp_rd_create_count(char *page, char **start, off_t off, int count,
 			       int *eof, void *data)
 {
@@ -472,6 +506,8 @@ static struct lprocfs_vars lprocfs_osp_obd_vars[] = {
 				osp_wr_max_rpcs_in_flight, 0 },
 	{ "max_rpcs_in_progress", osp_rd_max_rpcs_in_prog,
 				  osp_wr_max_rpcs_in_prog, 0 },
+	{ "max_sync_batch",	osp_rd_max_sync_batch,
+				osp_wr_max_sync_batch, 0 },
 	{ "create_count",	osp_rd_create_count,
 				osp_wr_create_count, 0 },
 	{ "max_create_count",	osp_rd_max_create_count,
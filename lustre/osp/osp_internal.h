@@ -163,6 +163,13 @@ struct osp_device {
 	/* number of RPC in processing (including non-committed by OST) */
 	int				 opd_syn_rpc_in_progress;
 	int				 opd_syn_max_rpc_in_progress;
+	/* OST_DESTROY_BATCH being filled, and records packed in it */
+	struct ptlrpc_request		*opd_syn_batch;
+	int				 opd_syn_batch_count;
+	/* records per OST_DESTROY_BATCH, 0 or 1 sends one RPC per record */
+	int				 opd_syn_max_batch;
+	/* llog cookies of committed changes, cancelled together */
+	struct llog_cookie		*opd_syn_cookies;
 	/* osd api's commit cb control structure */
 	struct dt_txn_callback		 opd_syn_txn_cb;
 	/* last used change number -- semantically similar to transno */
@@ -90,6 +90,7 @@ static void osp_sync_remove_from_tracker(struct osp_device *d);
 #define OSP_SYN_THRESHOLD	10
 #define OSP_MAX_IN_FLIGHT	8
 #define OSP_MAX_IN_PROGRESS	4096
+#define OSP_MAX_BATCH		256
 
 #define OSP_JOB_MAGIC		0x26112005
 
@@ -120,6 +121,27 @@ static inline int osp_sync_low_in_flight(struct osp_device *d)
 	return d->opd_syn_rpc_in_flight < d->opd_syn_max_rpc_in_flight;
 }
 
+/* can the record be sent in an OST_DESTROY_BATCH? */
+static inline int osp_sync_batch_rec(struct osp_device *d,
+				     struct llog_rec_hdr *rec)
+{
+	struct obd_import *imp = d->opd_obd->u.cli.cl_import;
+
+	if (d->opd_syn_max_batch <= 1 || d->opd_connect_mdt)
+		return 0;
+	if (!(imp->imp_connect_data.ocd_connect_flags &
+	      OBD_CONNECT_DESTROY_BATCH))
+		return 0;
+	return rec->lrh_type == MDS_UNLINK_REC ||
+	       rec->lrh_type == MDS_UNLINK64_REC ||
+	       rec->lrh_type == MDS_SETATTR64_REC;
+}
+
+static inline int osp_sync_is_batch(struct ptlrpc_request *req)
+{
+	return lustre_msg_get_opc(req->rq_reqmsg) == OST_DESTROY_BATCH;
+}
+
 static inline int osp_sync_has_work(struct osp_device *d)
 {
 	/* has new/old changes and low in-progress? */
@@ -346,12 +368,14 @@ static int osp_sync_interpret(const struct lu_env *env,
 	CDEBUG(D_HA, "reply req %p/%d, rc %d, transno %u\n", req,
 	       atomic_read(&req->rq_refcount),
 	       rc, (unsigned) req->rq_transno);
-	LASSERT(rc || req->rq_transno);
+	LASSERT(rc || req->rq_transno || osp_sync_is_batch(req));
 
-	if (rc == -ENOENT) {
+	if (rc == -ENOENT || (rc == 0 && req->rq_transno == 0)) {
 		/*
 		 * we tried to destroy object or update attributes,
-		 * but object doesn't exist anymore - cancell llog record
+		 * but object doesn't exist anymore - cancell llog record.
+		 * a batch changing nothing on OST gets no transno either,
+		 * its records are cancelled according to their own rc
 		 */
 		LASSERT(req->rq_transno == 0);
 		LASSERT(cfs_list_empty(&req->rq_exp_list));
@@ -420,6 +444,166 @@ static void osp_sync_send_new_rpc(struct osp_device *d,
 	ptlrpcd_add_req(req, PDL_POLICY_ROUND, -1);
 }
 
+static struct ptlrpc_request *osp_sync_new_batch(struct osp_device *d)
+{
+	struct ptlrpc_request	*req;
+	struct obd_import	*imp;
+	int			 max;
+	int			 rc;
+
+	imp = d->opd_obd->u.cli.cl_import;
+	LASSERT(imp);
+	req = ptlrpc_request_alloc(imp, &RQF_OST_DESTROY_BATCH);
+	if (req == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	/* sized for a full batch, shrunk when sent */
+	max = min(d->opd_syn_max_batch, OST_BATCH_MAX_RECS);
+	req_capsule_set_size(&req->rq_pill, &RMF_OST_BATCH_REC, RCL_CLIENT,
+			     max * sizeof(struct ost_batch_rec));
+	rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, OST_DESTROY_BATCH);
+	if (rc) {
+		ptlrpc_req_finished(req);
+		return ERR_PTR(rc);
+	}
+
+	CFS_INIT_LIST_HEAD(&req->rq_exp_list);
+	req->rq_svc_thread = (void *) OSP_JOB_MAGIC;
+
+	req->rq_interpret_reply = osp_sync_interpret;
+	req->rq_commit_cb = osp_sync_request_commit_cb;
+	req->rq_cb_data = d;
+
+	return req;
+}
+
+/*
+ * send the batch being filled, if any. this is called when it is full and
+ * before the sync thread goes to sleep, so that a partial batch doesn't
+ * wait for more records while holding an RPC slot
+ */
+static void osp_sync_send_batch(struct osp_device *d)
+{
+	struct ptlrpc_request	*req = d->opd_syn_batch;
+	int			 count = d->opd_syn_batch_count;
+
+	if (req == NULL)
+		return;
+
+	d->opd_syn_batch = NULL;
+	d->opd_syn_batch_count = 0;
+	LASSERT(count > 0);
+
+	req_capsule_shrink(&req->rq_pill, &RMF_OST_BATCH_REC,
+			   count * sizeof(struct ost_batch_rec), RCL_CLIENT);
+	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
+			     count * sizeof(__u32));
+	ptlrpc_request_set_replen(req);
+
+	CDEBUG(D_HA, "%s: send batch of %d records\n",
+	       d->opd_obd->obd_name, count);
+	osp_sync_send_new_rpc(d, req);
+}
+
+/* records of a batch not sent are left in llog for the next run */
+static void osp_sync_drop_batch(struct osp_device *d)
+{
+	if (d->opd_syn_batch == NULL)
+		return;
+
+	ptlrpc_req_finished(d->opd_syn_batch);
+	d->opd_syn_batch = NULL;
+	d->opd_syn_batch_count = 0;
+
+	spin_lock(&d->opd_syn_lock);
+	d->opd_syn_rpc_in_flight--;
+	d->opd_syn_rpc_in_progress--;
+	spin_unlock(&d->opd_syn_lock);
+}
+
+static int osp_sync_add_batch_rec(struct osp_device *d,
+				  struct llog_handle *llh,
+				  struct llog_rec_hdr *h)
+{
+	struct ptlrpc_request	*req = d->opd_syn_batch;
+	struct ost_batch_rec	*obr;
+	int			 max;
+	int			 rc;
+
+	if (req == NULL) {
+		/* the whole batch takes a single RPC slot, accounted as
+		 * osp_sync_process_record() does for a single record */
+		spin_lock(&d->opd_syn_lock);
+		d->opd_syn_rpc_in_flight++;
+		d->opd_syn_rpc_in_progress++;
+		spin_unlock(&d->opd_syn_lock);
+
+		req = osp_sync_new_batch(d);
+		if (IS_ERR(req)) {
+			spin_lock(&d->opd_syn_lock);
+			d->opd_syn_rpc_in_flight--;
+			d->opd_syn_rpc_in_progress--;
+			spin_unlock(&d->opd_syn_lock);
+			return PTR_ERR(req);
+		}
+		d->opd_syn_batch = req;
+		d->opd_syn_batch_count = 0;
+	}
+
+	obr = req_capsule_client_get(&req->rq_pill, &RMF_OST_BATCH_REC);
+	LASSERT(obr);
+	max = req_capsule_get_size(&req->rq_pill, &RMF_OST_BATCH_REC,
+				   RCL_CLIENT) / sizeof(*obr);
+	LASSERT(d->opd_syn_batch_count < max);
+	obr += d->opd_syn_batch_count;
+	memset(obr, 0, sizeof(*obr));
+
+	switch (h->lrh_type) {
+	/* case MDS_UNLINK_REC is kept for compatibility */
+	case MDS_UNLINK_REC: {
+		struct llog_unlink_rec *rec = (struct llog_unlink_rec *)h;
+
+		ostid_set_seq(&obr->obr_oi, rec->lur_oseq);
+		ostid_set_id(&obr->obr_oi, rec->lur_oid);
+		obr->obr_op = OST_DESTROY;
+		obr->obr_count = rec->lur_count;
+		break;
+	}
+	case MDS_UNLINK64_REC: {
+		struct llog_unlink64_rec *rec = (struct llog_unlink64_rec *)h;
+
+		rc = fid_to_ostid(&rec->lur_fid, &obr->obr_oi);
+		if (rc < 0)
+			return rc;
+		obr->obr_op = OST_DESTROY;
+		obr->obr_count = rec->lur_count;
+		break;
+	}
+	case MDS_SETATTR64_REC: {
+		struct llog_setattr64_rec *rec = (struct llog_setattr64_rec *)h;
+
+		obr->obr_oi = rec->lsr_oi;
+		obr->obr_op = OST_SETATTR;
+		obr->obr_uid = rec->lsr_uid;
+		obr->obr_gid = rec->lsr_gid;
+		break;
+	}
+	default:
+		LBUG();
+	}
+
+	/* the cookie is taken back from the request to cancel the record
+	 * once the batch is committed, see osp_sync_process_committed() */
+	obr->obr_cookie.lgc_lgl = llh->lgh_id;
+	obr->obr_cookie.lgc_subsys = LLOG_MDS_OST_ORIG_CTXT;
+	obr->obr_cookie.lgc_index = h->lrh_index;
+
+	if (++d->opd_syn_batch_count == max)
+		osp_sync_send_batch(d);
+
+	return 0;
+}
+
 static struct ptlrpc_request *osp_sync_new_job(struct osp_device *d,
 					       struct llog_handle *llh,
 					       struct llog_rec_hdr *h,
@@ -658,29 +842,46 @@ static int osp_sync_process_record(const struct lu_env *env,
 	 * and fire after next commit callback
 	 */
 
-	/* notice we increment counters before sending RPC, to be consistent
-	 * in RPC interpret callback which may happen very quickly */
-	spin_lock(&d->opd_syn_lock);
-	d->opd_syn_rpc_in_flight++;
-	d->opd_syn_rpc_in_progress++;
-	spin_unlock(&d->opd_syn_lock);
+	if (osp_sync_batch_rec(d, rec)) {
+		/* the batch does its own in-flight/in-progress accounting */
+		rc = osp_sync_add_batch_rec(d, llh, rec);
+	} else {
+		/* notice we increment counters before sending RPC, to be
+		 * consistent in RPC interpret callback which may happen
+		 * very quickly */
+		spin_lock(&d->opd_syn_lock);
+		d->opd_syn_rpc_in_flight++;
+		d->opd_syn_rpc_in_progress++;
+		spin_unlock(&d->opd_syn_lock);
 
-	switch (rec->lrh_type) {
-	/* case MDS_UNLINK_REC is kept for compatibility */
-	case MDS_UNLINK_REC:
-		rc = osp_sync_new_unlink_job(d, llh, rec);
-		break;
-	case MDS_UNLINK64_REC:
-		rc = osp_sync_new_unlink64_job(env, d, llh, rec);
-		break;
-	case MDS_SETATTR64_REC:
-		rc = osp_sync_new_setattr_job(d, llh, rec);
-		break;
-	default:
-		CERROR("%s: unknown record type: %x\n", d->opd_obd->obd_name,
-		       rec->lrh_type);
-		/* we should continue processing */
-		return 0;
+		switch (rec->lrh_type) {
+		/* case MDS_UNLINK_REC is kept for compatibility */
+		case MDS_UNLINK_REC:
+			rc = osp_sync_new_unlink_job(d, llh, rec);
+			break;
+		case MDS_UNLINK64_REC:
+			rc = osp_sync_new_unlink64_job(env, d, llh, rec);
+			break;
+		case MDS_SETATTR64_REC:
+			rc = osp_sync_new_setattr_job(d, llh, rec);
+			break;
+		default:
+			CERROR("%s: unknown record type: %x\n",
+			       d->opd_obd->obd_name, rec->lrh_type);
+			spin_lock(&d->opd_syn_lock);
+			d->opd_syn_rpc_in_flight--;
+			d->opd_syn_rpc_in_progress--;
+			spin_unlock(&d->opd_syn_lock);
+			/* we should continue processing */
+			return 0;
+		}
+
+		if (rc != 0) {
+			spin_lock(&d->opd_syn_lock);
+			d->opd_syn_rpc_in_flight--;
+			d->opd_syn_rpc_in_progress--;
+			spin_unlock(&d->opd_syn_lock);
+		}
 	}
 
 	if (likely(rc == 0)) {
@@ -701,11 +902,6 @@ static int osp_sync_process_record(const struct lu_env *env,
 		       d->opd_obd->obd_name, d->opd_syn_rpc_in_flight,
 		       d->opd_syn_rpc_in_progress);
 		spin_unlock(&d->opd_syn_lock);
-	} else {
-		spin_lock(&d->opd_syn_lock);
-		d->opd_syn_rpc_in_flight--;
-		d->opd_syn_rpc_in_progress--;
-		spin_unlock(&d->opd_syn_lock);
 	}
 
 	CDEBUG(D_HA, "found record %x, %d, idx %u, id %u: %d\n",
@@ -713,6 +909,63 @@ static int osp_sync_process_record(const struct lu_env *env,
 	return rc;
 }
 
+static void osp_sync_cancel_cookies(const struct lu_env *env,
+				    struct osp_device *d,
+				    struct llog_handle *llh, int count)
+{
+	int rc;
+
+	if (count == 0)
+		return;
+
+	rc = llog_cat_cancel_records(env, llh, count, d->opd_syn_cookies);
+	if (rc)
+		CERROR("%s: can't cancel %d records: %d\n",
+		       d->opd_obd->obd_name, count, rc);
+}
+
+/*
+ * collect cookies of the batch records which were applied, or whose
+ * object is already gone. records failed with another error are kept
+ * in llog, as they are for a single failed RPC
+ */
+static int osp_sync_batch_cookies(struct osp_device *d,
+				  struct ptlrpc_request *req,
+				  struct llog_cookie *cookies)
+{
+	struct ost_batch_rec	*obr;
+	__u32			*rcs;
+	int			 count;
+	int			 i, n = 0;
+
+	obr = req_capsule_client_get(&req->rq_pill, &RMF_OST_BATCH_REC);
+	LASSERT(obr);
+	count = req_capsule_get_size(&req->rq_pill, &RMF_OST_BATCH_REC,
+				     RCL_CLIENT) / sizeof(*obr);
+
+	rcs = req_capsule_server_sized_get(&req->rq_pill, &RMF_RCS,
+					   count * sizeof(*rcs));
+	if (rcs == NULL) {
+		DEBUG_REQ(D_ERROR, req, "no result for %d records", count);
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		int rc = (int)rcs[i];
+
+		if (rc == 0 || rc == -ENOENT) {
+			cookies[n++] = obr[i].obr_cookie;
+		} else {
+			CDEBUG(D_HA, "%s: record %u of "DOSTID" failed: %d\n",
+			       d->opd_obd->obd_name,
+			       obr[i].obr_cookie.lgc_index,
+			       POSTID(&obr[i].obr_oi), rc);
+		}
+	}
+
+	return n;
+}
+
 static void osp_sync_process_committed(const struct lu_env *env,
 				       struct osp_device *d)
 {
@@ -723,7 +976,7 @@ static void osp_sync_process_committed(const struct lu_env *env,
 	struct llog_ctxt	*ctxt;
 	struct llog_handle	*llh;
 	cfs_list_t		 list;
-	int			 rc, done = 0;
+	int			 count = 0, done = 0;
 
 	ENTRY;
 
@@ -741,9 +994,8 @@ static void osp_sync_process_committed(const struct lu_env *env,
 		osp_statfs_need_now(d);
 
 	/*
-	 * now cancel them all
-	 * XXX: can we improve this using some batching?
-	 *      with batch RPC that'll happen automatically?
+	 * now cancel them all, cookies are collected in opd_syn_cookies
+	 * and cancelled together
 	 * XXX: can we store ctxt in lod_device and save few cycles ?
 	 */
 	ctxt = llog_get_context(obd, LLOG_MDS_OST_ORIG_CTXT);
@@ -764,6 +1016,28 @@ static void osp_sync_process_committed(const struct lu_env *env,
 		LASSERT(req->rq_svc_thread == (void *) OSP_JOB_MAGIC);
 		cfs_list_del_init(&req->rq_exp_list);
 
+		/* import can be closing, thus all commit cb's are
+		 * called we can check committness directly */
+		if (req->rq_transno > imp->imp_peer_committed_transno) {
+			DEBUG_REQ(D_HA, req, "not committed");
+			goto next;
+		}
+
+		if (osp_sync_is_batch(req)) {
+			int nrec = req_capsule_get_size(&req->rq_pill,
+							&RMF_OST_BATCH_REC,
+							RCL_CLIENT) /
+				   sizeof(struct ost_batch_rec);
+
+			if (count + nrec > OST_BATCH_MAX_RECS) {
+				osp_sync_cancel_cookies(env, d, llh, count);
+				count = 0;
+			}
+			count += osp_sync_batch_cookies(d, req,
+						d->opd_syn_cookies + count);
+			goto next;
+		}
+
 		if (d->opd_connect_mdt) {
 			struct object_update_request *ureq;
 			struct object_update *update;
@@ -785,21 +1059,18 @@ static void osp_sync_process_committed(const struct lu_env *env,
 			LASSERT(body);
 			lcookie = &body->oa.o_lcookie;
 		}
-		/* import can be closing, thus all commit cb's are
-		 * called we can check committness directly */
-		if (req->rq_transno <= imp->imp_peer_committed_transno) {
-			rc = llog_cat_cancel_records(env, llh, 1, lcookie);
-			if (rc)
-				CERROR("%s: can't cancel record: %d\n",
-				       obd->obd_name, rc);
-		} else {
-			DEBUG_REQ(D_HA, req, "not committed");
-		}
 
+		if (count == OST_BATCH_MAX_RECS) {
+			osp_sync_cancel_cookies(env, d, llh, count);
+			count = 0;
+		}
+		d->opd_syn_cookies[count++] = *lcookie;
+next:
 		ptlrpc_req_finished(req);
 		done++;
 	}
 
+	osp_sync_cancel_cookies(env, d, llh, count);
 	llog_ctxt_put(ctxt);
 
 	LASSERT(d->opd_syn_rpc_in_progress >= done);
@@ -867,6 +1138,7 @@ static int osp_sync_process_queues(const struct lu_env *env,
 				 */
 				if (rc) {
 					CERROR("can't send: %d\n", rc);
+					osp_sync_send_batch(d);
 					l_wait_event(d->opd_syn_waitq,
 						     !osp_sync_running(d) ||
 						     osp_sync_has_work(d),
@@ -881,6 +1153,10 @@ static int osp_sync_process_queues(const struct lu_env *env,
 		if (d->opd_syn_last_processed_id == d->opd_syn_last_used_id)
 			osp_sync_remove_from_tracker(d);
 
+		/* don't sleep on a partial batch */
+		if (!osp_sync_can_process_new(d, rec))
+			osp_sync_send_batch(d);
+
 		l_wait_event(d->opd_syn_waitq,
 			     !osp_sync_running(d) ||
 			     osp_sync_can_process_new(d, rec) ||
@@ -946,6 +1222,8 @@ static int osp_sync_thread(void *_arg)
 		 d->opd_syn_changes, d->opd_syn_rpc_in_progress,
 		 d->opd_syn_rpc_in_flight, rc);
 
+	osp_sync_drop_batch(d);
+
 	/* we don't expect llog_process_thread() to exit till umount */
 	LASSERTF(thread->t_flags != SVC_RUNNING,
 		 "%lu changes, %u in progress, %u in flight\n",
@@ -1130,6 +1408,11 @@ int osp_sync_init(const struct lu_env *env, struct osp_device *d)
 	 */
 	d->opd_syn_max_rpc_in_flight = OSP_MAX_IN_FLIGHT;
 	d->opd_syn_max_rpc_in_progress = OSP_MAX_IN_PROGRESS;
+	d->opd_syn_max_batch = OSP_MAX_BATCH;
+	OBD_ALLOC_LARGE(d->opd_syn_cookies,
+			OST_BATCH_MAX_RECS * sizeof(struct llog_cookie));
+	if (d->opd_syn_cookies == NULL)
+		GOTO(err_llog, rc = -ENOMEM);
 	spin_lock_init(&d->opd_syn_lock);
 	init_waitqueue_head(&d->opd_syn_waitq);
 	init_waitqueue_head(&d->opd_syn_thread.t_ctl_waitq);
@@ -1141,13 +1424,17 @@ int osp_sync_init(const struct lu_env *env, struct osp_device *d)
 		rc = PTR_ERR(task);
 		CERROR("%s: cannot start sync thread: rc = %d\n",
 		       d->opd_obd->obd_name, rc);
-		GOTO(err_llog, rc);
+		GOTO(err_cookies, rc);
 	}
 
 	l_wait_event(d->opd_syn_thread.t_ctl_waitq,
 		     osp_sync_running(d) || osp_sync_stopped(d), &lwi);
 
 	RETURN(0);
+err_cookies:
+	OBD_FREE_LARGE(d->opd_syn_cookies,
+		       OST_BATCH_MAX_RECS * sizeof(struct llog_cookie));
+	d->opd_syn_cookies = NULL;
 err_llog:
 	osp_sync_llog_fini(env, d);
 err_id:
@@ -1171,6 +1458,12 @@ int osp_sync_fini(struct osp_device *d)
 	 */
 	osp_sync_id_traction_fini(d);
 
+	if (d->opd_syn_cookies != NULL) {
+		OBD_FREE_LARGE(d->opd_syn_cookies,
+			       OST_BATCH_MAX_RECS * sizeof(struct llog_cookie));
+		d->opd_syn_cookies = NULL;
+	}
+
 	RETURN(0);
 }
 
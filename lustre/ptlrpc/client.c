@@ -1019,7 +1019,7 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
                            struct ptlrpc_request *req)
 {
         struct ptlrpc_request_set *set = pc->pc_set;
-        int count, i;
+        int count;
 
         LASSERT(req->rq_set == NULL);
 	LASSERT(test_bit(LIOD_STOP, &pc->pc_flags) == 0);
@@ -1035,15 +1035,10 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 	spin_unlock(&set->set_new_req_lock);
 
 	/* Only need to call wakeup once for the first entry. */
-	if (count == 1) {
+	if (count == 1)
 		wake_up(&set->set_waitq);
 
-		/* XXX: It maybe unnecessary to wakeup all the partners. But to
-		 *      guarantee the async RPC can be processed ASAP, we have
-		 *      no other better choice. It maybe fixed in future. */
-		for (i = 0; i < pc->pc_npartners; i++)
-			wake_up(&pc->pc_partners[i]->pc_set->set_waitq);
-	}
+	ptlrpcd_wake_partners(pc, count - 1, count);
 }
 EXPORT_SYMBOL(ptlrpc_set_add_new_req);
 
@@ -1203,6 +1198,73 @@ static void ptlrpc_save_versions(struct ptlrpc_request *req)
         EXIT;
 }
 
+/**
+ * Save the transno of the reply to \a req for replay, and keep \a req on the
+ * replay list of its import until the server commits it.
+ */
+static void after_reply_replay(struct ptlrpc_request *req)
+{
+	struct obd_import *imp = req->rq_import;
+
+        /*
+         * Store transno in reqmsg for replay.
+         */
+        if (!(lustre_msg_get_flags(req->rq_reqmsg) & MSG_REPLAY)) {
+                req->rq_transno = lustre_msg_get_transno(req->rq_repmsg);
+                lustre_msg_set_transno(req->rq_reqmsg, req->rq_transno);
+        }
+
+        if (imp->imp_replayable) {
+		spin_lock(&imp->imp_lock);
+                /*
+                 * No point in adding already-committed requests to the replay
+                 * list, we will just remove them immediately. b=9829
+                 */
+                if (req->rq_transno != 0 &&
+                    (req->rq_transno >
+                     lustre_msg_get_last_committed(req->rq_repmsg) ||
+                     req->rq_replay)) {
+                        /** version recovery */
+                        ptlrpc_save_versions(req);
+                        ptlrpc_retain_replayable_request(req, imp);
+		} else if (req->rq_commit_cb != NULL &&
+			   list_empty(&req->rq_replay_list)) {
+			/* NB: don't call rq_commit_cb if it's already on
+			 * rq_replay_list, ptlrpc_free_committed() will call
+			 * it later, see LU-3618 for details */
+			spin_unlock(&imp->imp_lock);
+			req->rq_commit_cb(req);
+			spin_lock(&imp->imp_lock);
+                }
+
+                /*
+                 * Replay-enabled imports return commit-status information.
+                 */
+                if (lustre_msg_get_last_committed(req->rq_repmsg)) {
+                        imp->imp_peer_committed_transno =
+                                lustre_msg_get_last_committed(req->rq_repmsg);
+                }
+
+		ptlrpc_free_committed(imp);
+
+		if (!cfs_list_empty(&imp->imp_replay_list)) {
+			struct ptlrpc_request *last;
+
+			last = cfs_list_entry(imp->imp_replay_list.prev,
+					      struct ptlrpc_request,
+					      rq_replay_list);
+			/*
+			 * Requests with rq_replay stay on the list even if no
+			 * commit is expected.
+			 */
+			if (last->rq_transno > imp->imp_peer_committed_transno)
+				ptlrpc_pinger_commit_expected(imp);
+		}
+
+		spin_unlock(&imp->imp_lock);
+	}
+}
+
 /**
  * Callback function called when client receives RPC reply for \a req.
  * Returns 0 on success or error code.
@@ -1342,63 +1404,7 @@ static int after_reply(struct ptlrpc_request *req)
                 ldlm_cli_update_pool(req);
         }
 
-        /*
-         * Store transno in reqmsg for replay.
-         */
-        if (!(lustre_msg_get_flags(req->rq_reqmsg) & MSG_REPLAY)) {
-                req->rq_transno = lustre_msg_get_transno(req->rq_repmsg);
-                lustre_msg_set_transno(req->rq_reqmsg, req->rq_transno);
-        }
-
-        if (imp->imp_replayable) {
-		spin_lock(&imp->imp_lock);
-                /*
-                 * No point in adding already-committed requests to the replay
-                 * list, we will just remove them immediately. b=9829
-                 */
-                if (req->rq_transno != 0 &&
-                    (req->rq_transno >
-                     lustre_msg_get_last_committed(req->rq_repmsg) ||
-                     req->rq_replay)) {
-                        /** version recovery */
-                        ptlrpc_save_versions(req);
-                        ptlrpc_retain_replayable_request(req, imp);
-		} else if (req->rq_commit_cb != NULL &&
-			   list_empty(&req->rq_replay_list)) {
-			/* NB: don't call rq_commit_cb if it's already on
-			 * rq_replay_list, ptlrpc_free_committed() will call
-			 * it later, see LU-3618 for details */
-			spin_unlock(&imp->imp_lock);
-			req->rq_commit_cb(req);
-			spin_lock(&imp->imp_lock);
-                }
-
-                /*
-                 * Replay-enabled imports return commit-status information.
-                 */
-                if (lustre_msg_get_last_committed(req->rq_repmsg)) {
-                        imp->imp_peer_committed_transno =
-                                lustre_msg_get_last_committed(req->rq_repmsg);
-                }
-
-		ptlrpc_free_committed(imp);
-
-		if (!cfs_list_empty(&imp->imp_replay_list)) {
-			struct ptlrpc_request *last;
-
-			last = cfs_list_entry(imp->imp_replay_list.prev,
-					      struct ptlrpc_request,
-					      rq_replay_list);
-			/*
-			 * Requests with rq_replay stay on the list even if no
-			 * commit is expected.
-			 */
-			if (last->rq_transno > imp->imp_peer_committed_transno)
-				ptlrpc_pinger_commit_expected(imp);
-		}
-
-		spin_unlock(&imp->imp_lock);
-	}
+	after_reply_replay(req);
 
 	RETURN(rc);
 }
@@ -2608,6 +2614,89 @@ struct ptlrpc_request *ptlrpc_request_addref(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpc_request_addref);
 
+/**
+ * Prepare the message of request \a req to be carried inside a batch RPC
+ * instead of being sent on its own, filling in what ptl_send_rpc() would.
+ */
+void ptlrpc_batch_sub_prep(struct ptlrpc_request *req)
+{
+	struct obd_import *imp = req->rq_import;
+
+	LASSERT(req->rq_reqmsg != NULL);
+
+	lustre_msg_set_handle(req->rq_reqmsg, &imp->imp_remote_handle);
+	lustre_msg_set_type(req->rq_reqmsg, PTL_RPC_MSG_REQUEST);
+	lustre_msg_set_conn_cnt(req->rq_reqmsg, imp->imp_conn_cnt);
+	lustre_msg_set_status(req->rq_reqmsg, current_pid());
+	lustre_msg_set_jobid(req->rq_reqmsg, NULL);
+}
+EXPORT_SYMBOL(ptlrpc_batch_sub_prep);
+
+/**
+ * Complete request \a req which was carried inside a batch RPC. \a msg is
+ * its reply of \a len bytes found in the batch reply, or NULL if the batch
+ * failed with \a rc. The reply is copied into the own reply buffer of \a req
+ * since the interpreter may keep it beyond the batch reply, and is checked
+ * and recorded for replay like after_reply() does. Then the interpreter is
+ * called and the caller's reference on \a req is dropped.
+ */
+void ptlrpc_batch_sub_complete(const struct lu_env *env,
+			       struct ptlrpc_request *req,
+			       struct lustre_msg *msg, int len, int rc)
+{
+	ENTRY;
+
+	if (msg == NULL) {
+		if (rc == 0)
+			rc = -EIO;
+		GOTO(interpret, rc);
+	}
+
+	rc = sptlrpc_cli_alloc_repbuf(req, len);
+	if (rc)
+		GOTO(interpret, rc);
+
+	memcpy(req->rq_repbuf, msg, len);
+	req->rq_repdata = (struct lustre_msg *)req->rq_repbuf;
+	req->rq_repdata_len = len;
+	req->rq_repmsg = req->rq_repdata;
+	req->rq_replen = len;
+	req->rq_nob_received = len;
+
+	rc = ptlrpc_unpack_rep_msg(req, len);
+	if (rc == 0)
+		rc = lustre_unpack_rep_ptlrpc_body(req, MSG_PTLRPC_BODY_OFF);
+	if (rc) {
+		DEBUG_REQ(D_ERROR, req, "unpack batched reply failed: %d", rc);
+		GOTO(interpret, rc = -EPROTO);
+	}
+
+	spin_lock(&req->rq_lock);
+	req->rq_replied = 1;
+	spin_unlock(&req->rq_lock);
+
+	if (lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_REPLY &&
+	    lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_ERR) {
+		DEBUG_REQ(D_ERROR, req, "invalid batched reply (type=%u)",
+			  lustre_msg_get_type(req->rq_repmsg));
+		GOTO(interpret, rc = -EPROTO);
+	}
+
+	/* as after_reply() does, except for the adaptive timeouts and the
+	 * reconnection which are taken care of by the batch RPC itself */
+	rc = ptlrpc_check_status(req);
+	if (rc == 0)
+		ldlm_cli_update_pool(req);
+	after_reply_replay(req);
+	EXIT;
+interpret:
+	req->rq_status = rc;
+	if (req->rq_interpret_reply != NULL)
+		req->rq_interpret_reply(env, req, &req->rq_async_args, rc);
+	ptlrpc_req_finished(req);
+}
+EXPORT_SYMBOL(ptlrpc_batch_sub_complete);
+
 /**
  * Add a request to import replay_list.
  * Must be called under imp_lock
@@ -357,6 +357,8 @@ void request_in_callback(lnet_event_t *ev)
 
 	if (ev->unlinked) {
 		svcpt->scp_nrqbds_posted--;
+		if (ev->type == LNET_EVENT_PUT)
+			ptlrpc_rqbd_account(svcpt, 1);
 		CDEBUG(D_INFO, "Buffer complete: %d buffers still posted\n",
 		       svcpt->scp_nrqbds_posted);
 
@@ -538,6 +538,16 @@ static const struct req_msg_field *mds_update_server[] = {
 	&RMF_OUT_UPDATE_REPLY,
 };
 
+static const struct req_msg_field *mds_batch_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_BATCH_REQ,
+};
+
+static const struct req_msg_field *mds_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_BATCH_REP,
+};
+
 static const struct req_msg_field *llog_origin_handle_create_client[] = {
         &RMF_PTLRPC_BODY,
         &RMF_LLOGD_BODY,
@@ -613,6 +623,36 @@ static const struct req_msg_field *ost_brw_write_server[] = {
         &RMF_RCS
 };
 
+/* OST_WRITE carrying several objects, the obdo and capability of the first
+ * object stay in ost_body and RMF_CAPA1, the others follow in RMF_OBDO_ARRAY
+ * and RMF_CAPA_ARRAY in ioobj order */
+static const struct req_msg_field *ost_brw_write_multi_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_OBD_IOOBJ,
+	&RMF_NIOBUF_REMOTE,
+	&RMF_CAPA1,
+	&RMF_OBDO_ARRAY,
+	&RMF_CAPA_ARRAY
+};
+
+static const struct req_msg_field *ost_brw_write_multi_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BODY,
+	&RMF_RCS,
+	&RMF_OBDO_ARRAY
+};
+
+static const struct req_msg_field *ost_destroy_batch_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_BATCH_REC
+};
+
+static const struct req_msg_field *ost_destroy_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_RCS
+};
+
 static const struct req_msg_field *ost_get_info_generic_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_GENERIC_DATA,
@@ -753,6 +793,7 @@ static struct req_format *req_formats[] = {
 	&RQF_MDS_HSM_ACTION,
 	&RQF_MDS_HSM_REQUEST,
 	&RQF_MDS_SWAP_LAYOUTS,
+	&RQF_MDS_BATCH,
 	&RQF_OUT_UPDATE,
 	&RQF_QC_CALLBACK,
         &RQF_OST_CONNECT,
@@ -767,6 +808,8 @@ static struct req_format *req_formats[] = {
         &RQF_OST_DESTROY,
         &RQF_OST_BRW_READ,
         &RQF_OST_BRW_WRITE,
+	&RQF_OST_BRW_WRITE_MULTI,
+	&RQF_OST_DESTROY_BATCH,
         &RQF_OST_STATFS,
         &RQF_OST_SET_GRANT_INFO,
 	&RQF_OST_GET_INFO,
@@ -1121,6 +1164,22 @@ struct req_msg_field RMF_RCS =
                     lustre_swab_generic_32s, dump_rcs);
 EXPORT_SYMBOL(RMF_RCS);
 
+struct req_msg_field RMF_OBDO_ARRAY =
+	DEFINE_MSGF("obdo_array", RMF_F_STRUCT_ARRAY, sizeof(struct obdo),
+		    lustre_swab_obdo, dump_obdo);
+EXPORT_SYMBOL(RMF_OBDO_ARRAY);
+
+struct req_msg_field RMF_CAPA_ARRAY =
+	DEFINE_MSGF("capa_array", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct lustre_capa), lustre_swab_lustre_capa, NULL);
+EXPORT_SYMBOL(RMF_CAPA_ARRAY);
+
+struct req_msg_field RMF_OST_BATCH_REC =
+	DEFINE_MSGF("ost_batch_rec", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ost_batch_rec), lustre_swab_ost_batch_rec,
+		    NULL);
+EXPORT_SYMBOL(RMF_OST_BATCH_REC);
+
 struct req_msg_field RMF_EAVALS_LENS =
 	DEFINE_MSGF("eavals_lens", RMF_F_STRUCT_ARRAY, sizeof(__u32),
 		lustre_swab_generic_32s, NULL);
@@ -1199,6 +1258,14 @@ struct req_msg_field RMF_OUT_UPDATE_REPLY =
 				    lustre_swab_object_update_reply, NULL);
 EXPORT_SYMBOL(RMF_OUT_UPDATE_REPLY);
 
+struct req_msg_field RMF_BATCH_REQ =
+	DEFINE_MSGF("batch_req", 0, -1, lustre_swab_batch_buf, NULL);
+EXPORT_SYMBOL(RMF_BATCH_REQ);
+
+struct req_msg_field RMF_BATCH_REP =
+	DEFINE_MSGF("batch_rep", 0, -1, lustre_swab_batch_buf, NULL);
+EXPORT_SYMBOL(RMF_BATCH_REP);
+
 struct req_msg_field RMF_SWAP_LAYOUTS =
 	DEFINE_MSGF("swap_layouts", 0, sizeof(struct  mdc_swap_layouts),
 		    lustre_swab_swap_layouts, NULL);
@@ -1567,6 +1634,10 @@ struct req_format RQF_MDS_SWAP_LAYOUTS =
 			mdt_swap_layouts, empty);
 EXPORT_SYMBOL(RQF_MDS_SWAP_LAYOUTS);
 
+struct req_format RQF_MDS_BATCH =
+	DEFINE_REQ_FMT0("MDS_BATCH", mds_batch_client, mds_batch_server);
+EXPORT_SYMBOL(RQF_MDS_BATCH);
+
 /* This is for split */
 struct req_format RQF_MDS_WRITEPAGE =
         DEFINE_REQ_FMT0("MDS_WRITEPAGE",
@@ -1652,6 +1723,16 @@ struct req_format RQF_OST_BRW_WRITE =
         DEFINE_REQ_FMT0("OST_BRW_WRITE", ost_brw_client, ost_brw_write_server);
 EXPORT_SYMBOL(RQF_OST_BRW_WRITE);
 
+struct req_format RQF_OST_BRW_WRITE_MULTI =
+	DEFINE_REQ_FMT0("OST_BRW_WRITE_MULTI", ost_brw_write_multi_client,
+			ost_brw_write_multi_server);
+EXPORT_SYMBOL(RQF_OST_BRW_WRITE_MULTI);
+
+struct req_format RQF_OST_DESTROY_BATCH =
+	DEFINE_REQ_FMT0("OST_DESTROY_BATCH", ost_destroy_batch_client,
+			ost_destroy_batch_server);
+EXPORT_SYMBOL(RQF_OST_DESTROY_BATCH);
+
 struct req_format RQF_OST_STATFS =
         DEFINE_REQ_FMT0("OST_STATFS", empty, obd_statfs_server);
 EXPORT_SYMBOL(RQF_OST_STATFS);
@@ -73,6 +73,7 @@ struct ll_rpc_opcode {
         { OST_QUOTACHECK,   "ost_quotacheck" },
         { OST_QUOTACTL,     "ost_quotactl" },
         { OST_QUOTA_ADJUST_QUNIT, "ost_quota_adjust_qunit" },
+	{ OST_DESTROY_BATCH,	"ost_destroy_batch" },
         { MDS_GETATTR,      "mds_getattr" },
         { MDS_GETATTR_NAME, "mds_getattr_lock" },
         { MDS_CLOSE,        "mds_close" },
@@ -102,6 +103,7 @@ struct ll_rpc_opcode {
 	{ MDS_HSM_CT_REGISTER, "mds_hsm_ct_register" },
 	{ MDS_HSM_CT_UNREGISTER, "mds_hsm_ct_unregister" },
 	{ MDS_SWAP_LAYOUTS,	"mds_swap_layouts" },
+	{ MDS_BATCH,		"mds_batch" },
         { LDLM_ENQUEUE,     "ldlm_enqueue" },
         { LDLM_CONVERT,     "ldlm_convert" },
         { LDLM_CANCEL,      "ldlm_cancel" },
@@ -181,6 +183,13 @@ const char *ll_opcode2str(__u32 opcode)
         return ll_rpc_opcode_table[offset].opname;
 }
 
+/* name of the opcode at \a offset of the table, see opcode_offset() */
+const char *ll_opcode_offset2str(int offset)
+{
+	LASSERT(offset >= 0 && offset < LUSTRE_MAX_OPCODES);
+	return ll_rpc_opcode_table[offset].opname;
+}
+
 const char* ll_eopcode2str(__u32 opcode)
 {
         LASSERT(ll_eopcode_table[opcode].opcode == opcode);
@@ -274,6 +283,59 @@ ptlrpc_lprocfs_req_history_len_seq_show(struct seq_file *m, void *v)
 }
 LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_req_history_len);
 
+static int
+ptlrpc_lprocfs_req_buffers_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	time_t				now = cfs_time_current_sec();
+	time_t				t;
+	int				i;
+
+	seq_printf(m, "%-4s %8s %8s %8s %10s %10s  %s\n", "cpt", "total",
+		   "posted", "target", "allocated", "freed",
+		   "filled/s, latest first");
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		spin_lock(&svcpt->scp_lock);
+		ptlrpc_rqbd_account(svcpt, 0);
+		seq_printf(m, "%-4d %8d %8d %8d %10lu %10lu ", svcpt->scp_cpt,
+			   svcpt->scp_nrqbds_total, svcpt->scp_nrqbds_posted,
+			   svcpt->scp_rqbd_target, svcpt->scp_rqbd_nalloc,
+			   svcpt->scp_rqbd_nfree);
+		for (t = now; t > now - PTLRPC_RQBD_HIST; t--)
+			seq_printf(m, " %d",
+				   svcpt->scp_rqbd_hist[t % PTLRPC_RQBD_HIST]);
+		spin_unlock(&svcpt->scp_lock);
+		seq_printf(m, "\n");
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_req_buffers);
+
+static int
+ptlrpc_lprocfs_reply_cache_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	int				i;
+
+	seq_printf(m, "%-4s %8s %10s %10s\n", "cpt", "cached", "hits",
+		   "misses");
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		spin_lock(&svcpt->scp_rep_cache_lock);
+		seq_printf(m, "%-4d %8d %10lu %10lu\n", svcpt->scp_cpt,
+			   svcpt->scp_rep_ncached, svcpt->scp_rep_cache_hits,
+			   svcpt->scp_rep_cache_misses);
+		spin_unlock(&svcpt->scp_rep_cache_lock);
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_reply_cache);
+
 static int
 ptlrpc_lprocfs_req_history_max_seq_show(struct seq_file *m, void *n)
 {
@@ -1072,6 +1134,12 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
 		{ .name = "req_buffer_history_max",
 		  .fops	= &ptlrpc_lprocfs_req_history_max_fops,
 		  .data	= svc },
+		{ .name = "req_buffers",
+		  .fops	= &ptlrpc_lprocfs_req_buffers_fops,
+		  .data	= svc },
+		{ .name = "reply_cache",
+		  .fops	= &ptlrpc_lprocfs_reply_cache_fops,
+		  .data	= svc },
 		{ .name = "threads_min",
 		  .fops = &ptlrpc_lprocfs_threads_min_fops,
 		  .data = svc },
@@ -0,0 +1,731 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.  A copy is
+ * included in the COPYING file that accompanied this code.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_deadline.c
+ *
+ * Network Request Scheduler (NRS) deadline policy
+ *
+ * Serves requests by earliest deadline, the deadline of a request being its
+ * arrival time plus a latency target of its class of operation.
+ */
+
+#ifdef HAVE_SERVER_SUPPORT
+
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+#ifndef __KERNEL__
+#include <liblustre.h>
+#endif
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lprocfs_status.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name deadline
+ *
+ * The latency target of a class is its average handling time scaled by
+ * nrs_dl_factor, so that a request which is quick to handle, such as a
+ * getattr, does not wait behind a backlog of creates queued just before it.
+ * Targets never exceed half of the adaptive timeout estimate of the service,
+ * which leaves time to handle the request before the client expects an early
+ * reply, and bounds the wait of any request.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_DEADLINE	"deadline"
+
+#define NRS_DL_FACTOR_DEFAULT	16
+/**
+ * Larger factors leave the order of the requests to the cap alone.
+ */
+#define NRS_DL_FACTOR_MAX	1024
+
+static int nrs_dl_factor = NRS_DL_FACTOR_DEFAULT;
+CFS_MODULE_PARM(nrs_dl_factor, "i", int, 0444,
+		"Default latency target of the deadline NRS policy, in "
+		"multiples of the request handling time");
+
+/**
+ * Binary heap predicate.
+ *
+ * \param[in] e1 the first binheap node to compare
+ * \param[in] e2 the second binheap node to compare
+ *
+ * \retval 0 e1 > e2
+ * \retval 1 e1 <= e2
+ */
+static int dl_req_compare(cfs_binheap_node_t *e1, cfs_binheap_node_t *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_node);
+
+	if (nrq1->nr_u.dl.dr_deadline < nrq2->nr_u.dl.dr_deadline)
+		return 1;
+	else if (nrq1->nr_u.dl.dr_deadline > nrq2->nr_u.dl.dr_deadline)
+		return 0;
+
+	return nrq1->nr_u.dl.dr_sequence < nrq2->nr_u.dl.dr_sequence;
+}
+
+static cfs_binheap_ops_t nrs_dl_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= dl_req_compare,
+};
+
+/**
+ * Finds the enum nrs_dl_class of request \a req.
+ *
+ * MDS_REINT and LDLM_ENQUEUE cover operations of very different cost, e.g.
+ * an intent lookup for stat(2) and an intent open with create, so they are
+ * told apart by the reint operation and the intent respectively.
+ */
+static __u32 nrs_dl_class(struct ptlrpc_request *req)
+{
+	__u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
+	int   idx;
+
+	switch (opc) {
+	case MDS_REINT: {
+		__u32 *op;
+		__u32  reint;
+
+		op = lustre_msg_buf(req->rq_reqmsg, REQ_REC_OFF, sizeof(*op));
+		if (op == NULL)
+			break;
+		/* sent by the client, so any value is possible */
+		reint = ptlrpc_req_need_swab(req) ? __swab32(*op) : *op;
+		if (reint >= REINT_MAX)
+			break;
+		return NRS_DL_CLASS_REINT + reint;
+	}
+	case LDLM_ENQUEUE: {
+		struct ldlm_intent *it;
+		__u64		    it_opc;
+
+		if (lustre_msg_bufcount(req->rq_reqmsg) <= DLM_INTENT_IT_OFF)
+			break;
+		it = lustre_msg_buf(req->rq_reqmsg, DLM_INTENT_IT_OFF,
+				    sizeof(*it));
+		if (it == NULL)
+			break;
+		it_opc = ptlrpc_req_need_swab(req) ? __swab64(it->opc) :
+						     it->opc;
+		if (it_opc & IT_OPEN)
+			return NRS_DL_CLASS_IT_OPEN;
+		if (it_opc & (IT_LOOKUP | IT_GETATTR))
+			return NRS_DL_CLASS_IT_LOOKUP;
+		return NRS_DL_CLASS_IT_OTHER;
+	}
+	default:
+		break;
+	}
+
+	idx = opcode_offset(opc);
+	return idx >= 0 ? idx : 0;
+}
+
+/**
+ * Latency target of requests of class \a class, in microseconds.
+ */
+static __u64 nrs_dl_target(struct ptlrpc_nrs_policy *policy, __u32 class)
+{
+	struct nrs_dl_head	   *head = policy->pol_private;
+	struct ptlrpc_service_part *svcpt = policy->pol_nrs->nrs_svcpt;
+	__u64			    cap;
+
+	cap = (AT_OFF ? obd_timeout : at_get(&svcpt->scp_at_estimate)) *
+	      USEC_PER_SEC / 2;
+
+	LASSERT(class < NRS_DL_CLASS_MAX);
+	/* classes never handled so far only get the cap */
+	if (head->dh_svc_time[class] == 0)
+		return cap;
+
+	return min_t(__u64, cap, head->dh_svc_time[class] * head->dh_factor);
+}
+
+/**
+ * Called when a deadline policy instance is started.
+ *
+ * \param[in] policy the policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval 0	   success
+ */
+static int nrs_dl_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_dl_head *head;
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		return -ENOMEM;
+
+	head->dh_binheap = cfs_binheap_create(&nrs_dl_heap_ops,
+					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_pol2cptab(policy),
+					      nrs_pol2cptid(policy));
+	if (head->dh_binheap == NULL) {
+		OBD_FREE_PTR(head);
+		return -ENOMEM;
+	}
+
+	head->dh_factor = nrs_dl_factor;
+	if (nrs_dl_factor <= 0 || nrs_dl_factor > NRS_DL_FACTOR_MAX) {
+		CWARN("%s: invalid nrs_dl_factor %d, using %d\n",
+		      policy->pol_nrs->nrs_svcpt->scp_service->srv_name,
+		      nrs_dl_factor, NRS_DL_FACTOR_DEFAULT);
+		head->dh_factor = NRS_DL_FACTOR_DEFAULT;
+	}
+
+	policy->pol_private = head;
+	return 0;
+}
+
+/**
+ * Called when a deadline policy instance is stopped.
+ *
+ * \param[in] policy the policy
+ */
+static void nrs_dl_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_dl_head *head = policy->pol_private;
+
+	LASSERT(head != NULL);
+	LASSERT(head->dh_binheap != NULL);
+	LASSERT(cfs_binheap_is_empty(head->dh_binheap));
+
+	cfs_binheap_destroy(head->dh_binheap);
+	OBD_FREE_PTR(head);
+}
+
+/**
+ * Name of request class \a class, for the statistics.
+ */
+static void nrs_dl_class_print(struct seq_file *m, __u32 class)
+{
+	if (class < NRS_DL_CLASS_REINT)
+		seq_printf(m, "%s", ll_opcode_offset2str(class));
+	else if (class < NRS_DL_CLASS_IT_OPEN)
+		seq_printf(m, "mds_reint:%u", class - NRS_DL_CLASS_REINT);
+	else if (class == NRS_DL_CLASS_IT_OPEN)
+		seq_printf(m, "ldlm_enqueue:open");
+	else if (class == NRS_DL_CLASS_IT_LOOKUP)
+		seq_printf(m, "ldlm_enqueue:lookup");
+	else
+		seq_printf(m, "ldlm_enqueue:other");
+}
+
+/**
+ * Performs a ctl function on deadline policy instances; similar to ioctl.
+ *
+ * \param[in]	  policy the policy instance
+ * \param[in]	  opc	 the opcode
+ * \param[in,out] arg	 used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_dl_ctl(struct ptlrpc_nrs_policy *policy, enum ptlrpc_nrs_ctl opc,
+		      void *arg)
+{
+	struct nrs_dl_head *head = policy->pol_private;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_dl)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_DL_RD_FACTOR:
+		*(__u32 *)arg = head->dh_factor;
+		break;
+
+	case NRS_CTL_DL_WR_FACTOR:
+		head->dh_factor = *(__u32 *)arg;
+		LASSERT(head->dh_factor > 0 &&
+			head->dh_factor <= NRS_DL_FACTOR_MAX);
+		break;
+
+	case NRS_CTL_DL_RD_STATS: {
+		struct seq_file *m = arg;
+		__u32		 class;
+
+		seq_printf(m, "  factor: %u\n"
+			   "  queued: %ld\n"
+			   "  late: "LPU64"\n"
+			   "  classes:\n", head->dh_factor,
+			   policy->pol_req_queued, head->dh_late);
+		for (class = 0; class < NRS_DL_CLASS_MAX; class++) {
+			if (head->dh_handled[class] == 0)
+				continue;
+			seq_printf(m, "  - { class: ");
+			nrs_dl_class_print(m, class);
+			seq_printf(m, ", handled: "LPU64", svc_time: "LPU64
+				   ", target: "LPU64" }\n",
+				   head->dh_handled[class],
+				   head->dh_svc_time[class],
+				   nrs_dl_target(policy, class));
+		}
+		break;
+	}
+	}
+
+	RETURN(0);
+}
+
+/**
+ * Obtains the resource of the policy instance; all requests share it.
+ */
+static int nrs_dl_res_get(struct ptlrpc_nrs_policy *policy,
+			  struct ptlrpc_nrs_request *nrq,
+			  const struct ptlrpc_nrs_resource *parent,
+			  struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	*resp = &((struct nrs_dl_head *)policy->pol_private)->dh_res;
+	return 1;
+}
+
+/**
+ * Called when getting a request from the deadline policy for handling, or
+ * just peeking.
+ *
+ * \param[in] policy the policy being polled
+ * \param[in] peek   when set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  force the policy to return a request; unused in this policy
+ *
+ * \retval the request with the earliest deadline
+ * \retval NULL no request available
+ */
+static
+struct ptlrpc_nrs_request *nrs_dl_req_get(struct ptlrpc_nrs_policy *policy,
+					  bool peek, bool force)
+{
+	struct nrs_dl_head	  *head = policy->pol_private;
+	cfs_binheap_node_t	  *node = cfs_binheap_root(head->dh_binheap);
+	struct ptlrpc_nrs_request *nrq;
+
+	nrq = unlikely(node == NULL) ? NULL :
+	      container_of(node, struct ptlrpc_nrs_request, nr_node);
+
+	if (likely(!peek && nrq != NULL)) {
+		struct ptlrpc_request *req = container_of(nrq,
+							  struct ptlrpc_request,
+							  rq_nrq);
+		struct timeval	       now;
+
+		cfs_binheap_remove(head->dh_binheap, &nrq->nr_node);
+		nrq->nr_u.dl.dr_start = ktime_to_ns(ktime_get());
+
+		/* the deadline is on the clock of rq_arrival_time */
+		do_gettimeofday(&now);
+		if ((__u64)now.tv_sec * USEC_PER_SEC + now.tv_usec >
+		    nrq->nr_u.dl.dr_deadline)
+			head->dh_late++;
+
+		CDEBUG(D_RPCTRACE, "NRS start %s request from %s, class %u, "
+		       "deadline "LPU64"\n", policy->pol_desc->pd_name,
+		       libcfs_id2str(req->rq_peer), nrq->nr_u.dl.dr_class,
+		       nrq->nr_u.dl.dr_deadline);
+	}
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to the queue of \a policy, with a deadline of its
+ * arrival time plus the latency target of its class.
+ *
+ * \retval 0 success
+ * \retval != 0 error
+ */
+static int nrs_dl_req_add(struct ptlrpc_nrs_policy *policy,
+			  struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_dl_head    *head = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	int		       rc;
+
+	nrq->nr_u.dl.dr_class = nrs_dl_class(req);
+	nrq->nr_u.dl.dr_deadline = (__u64)req->rq_arrival_time.tv_sec *
+				   USEC_PER_SEC +
+				   req->rq_arrival_time.tv_usec +
+				   nrs_dl_target(policy, nrq->nr_u.dl.dr_class);
+	nrq->nr_u.dl.dr_sequence = head->dh_sequence++;
+
+	rc = cfs_binheap_insert(head->dh_binheap, &nrq->nr_node);
+	return rc;
+}
+
+/**
+ * Removes request \a nrq from the queue of \a policy.
+ */
+static void nrs_dl_req_del(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_dl_head *head = policy->pol_private;
+
+	cfs_binheap_remove(head->dh_binheap, &nrq->nr_node);
+}
+
+/**
+ * Called right after request \a nrq finishes being handled; feeds the
+ * handling time into the moving average of its class.
+ */
+static void nrs_dl_req_stop(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_dl_head    *head = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	__u32		       class = nrq->nr_u.dl.dr_class;
+	__u64		      *avg;
+	__u64		       svc;
+
+	LASSERT(class < NRS_DL_CLASS_MAX);
+	avg = &head->dh_svc_time[class];
+
+	svc = ktime_to_ns(ktime_get()) - nrq->nr_u.dl.dr_start;
+	do_div(svc, NSEC_PER_USEC);
+	if (svc == 0)
+		svc = 1;
+	/* weight 1/8 for the newest sample, like the RTT estimate of TCP */
+	*avg = *avg == 0 ? svc : *avg - (*avg >> 3) + (svc >> 3);
+	head->dh_handled[class]++;
+
+	CDEBUG(D_RPCTRACE, "NRS stop %s request from %s, class %u, "
+	       "handled in "LPU64"us\n", policy->pol_desc->pd_name,
+	       libcfs_id2str(req->rq_peer), nrq->nr_u.dl.dr_class, svc);
+}
+
+#ifdef LPROCFS
+
+/**
+ * lprocfs interface
+ */
+
+#define NRS_LPROCFS_DL_FACTOR_NAME_REG	"reg_factor:"
+#define NRS_LPROCFS_DL_FACTOR_NAME_HP	"hp_factor:"
+
+#define LPROCFS_NRS_WR_DL_FACTOR_MAX_CMD				       \
+	sizeof(NRS_LPROCFS_DL_FACTOR_NAME_REG "-2147483648 "		       \
+	       NRS_LPROCFS_DL_FACTOR_NAME_HP "-2147483648")
+
+/**
+ * Retrieves the latency target factor of the deadline policy instances on
+ * both the regular and high-priority NRS head of a service, in YAML format.
+ *
+ * For example:
+ *
+ *	reg_factor:16
+ *	hp_factor:16
+ */
+static int
+ptlrpc_lprocfs_nrs_dl_factor_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service	*svc = m->private;
+	__u32			 factor;
+	int			 rc;
+
+	/**
+	 * Perform two separate calls to this as only one of the NRS heads'
+	 * policies may be in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED or
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING state.
+	 */
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DL_RD_FACTOR, true, &factor);
+	if (rc == 0)
+		seq_printf(m, NRS_LPROCFS_DL_FACTOR_NAME_REG"%-5u\n", factor);
+	else if (rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return rc;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DL_RD_FACTOR, true, &factor);
+	if (rc == 0)
+		seq_printf(m, NRS_LPROCFS_DL_FACTOR_NAME_HP"%-5u\n", factor);
+	else if (rc != -ENODEV)
+		return rc;
+
+	return rc;
+}
+
+/**
+ * Parses a factor in [1, NRS_DL_FACTOR_MAX] at \a val, which must be followed
+ * by white space or the end of the string.
+ */
+static int nrs_dl_factor_parse(char *val, __u32 *factor)
+{
+	char *end;
+	long  num;
+
+	if (!isdigit(val[0]))
+		return -EINVAL;
+
+	num = simple_strtol(val, &end, 10);
+	if ((*end != '\0' && !cfs_iswhite(*end)) || end - val > 10 ||
+	    num <= 0 || num > NRS_DL_FACTOR_MAX)
+		return -EINVAL;
+
+	*factor = num;
+	return 0;
+}
+
+/**
+ * Sets the latency target factor of the deadline policy instances of a
+ * service, for the regular or high priority NRS head individually, or both
+ * together.
+ *
+ * For example:
+ *
+ * lctl set_param *.*.*.nrs_deadline_factor=reg_factor:8, to set the factor of
+ * regular requests on all PTLRPC services to 8, and
+ *
+ * lctl set_param *.*.mdt.nrs_deadline_factor=32, to set the factor of both
+ * regular and high priority requests of the mdt service to 32.
+ *
+ * Values that are not a number in [1, NRS_DL_FACTOR_MAX] are rejected.
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_dl_factor_seq_write(struct file *file, const char *buffer,
+				       size_t count, loff_t *off)
+{
+	struct ptlrpc_service	    *svc = ((struct seq_file *)file->private_data)->private;
+	enum ptlrpc_nrs_queue_type   queue = 0;
+	char			     kernbuf[LPROCFS_NRS_WR_DL_FACTOR_MAX_CMD];
+	char			    *val;
+	__u32			     factor_reg = 0;
+	__u32			     factor_hp = 0;
+	/** lprocfs_find_named_value() modifies its argument, so keep a copy */
+	size_t			     count_copy;
+	int			     rc = 0;
+	int			     rc2 = 0;
+
+	if (count > (sizeof(kernbuf) - 1))
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+
+	count_copy = count;
+	val = lprocfs_find_named_value(kernbuf, NRS_LPROCFS_DL_FACTOR_NAME_REG,
+				       &count_copy);
+	if (val != kernbuf) {
+		if (nrs_dl_factor_parse(val, &factor_reg) != 0)
+			return -EINVAL;
+		queue |= PTLRPC_NRS_QUEUE_REG;
+	}
+
+	count_copy = count;
+	val = lprocfs_find_named_value(kernbuf, NRS_LPROCFS_DL_FACTOR_NAME_HP,
+				       &count_copy);
+	if (val != kernbuf) {
+		if (!nrs_svc_has_hp(svc))
+			return -ENODEV;
+		if (nrs_dl_factor_parse(val, &factor_hp) != 0)
+			return -EINVAL;
+		queue |= PTLRPC_NRS_QUEUE_HP;
+	}
+
+	/**
+	 * If none of the queues has been specified, look for a valid numerical
+	 * value
+	 */
+	if (queue == 0) {
+		if (nrs_dl_factor_parse(kernbuf, &factor_reg) != 0)
+			return -EINVAL;
+
+		queue = PTLRPC_NRS_QUEUE_REG;
+		if (nrs_svc_has_hp(svc)) {
+			queue |= PTLRPC_NRS_QUEUE_HP;
+			factor_hp = factor_reg;
+		}
+	}
+
+	/**
+	 * Change the heads separately and ignore -ENODEV unless the policy is
+	 * started on none of the heads specified, see
+	 * ptlrpc_lprocfs_nrs_crrn_quantum_seq_write().
+	 */
+	if ((queue & PTLRPC_NRS_QUEUE_REG) != 0) {
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+					       NRS_POL_NAME_DEADLINE,
+					       NRS_CTL_DL_WR_FACTOR, false,
+					       &factor_reg);
+		if ((rc < 0 && rc != -ENODEV) ||
+		    (rc == -ENODEV && queue == PTLRPC_NRS_QUEUE_REG))
+			return rc;
+	}
+
+	if ((queue & PTLRPC_NRS_QUEUE_HP) != 0) {
+		rc2 = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+						NRS_POL_NAME_DEADLINE,
+						NRS_CTL_DL_WR_FACTOR, false,
+						&factor_hp);
+		if ((rc2 < 0 && rc2 != -ENODEV) ||
+		    (rc2 == -ENODEV && queue == PTLRPC_NRS_QUEUE_HP))
+			return rc2;
+	}
+
+	return rc == -ENODEV && rc2 == -ENODEV ? -ENODEV : count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_dl_factor);
+
+/**
+ * Prints the statistics of the deadline policy instances of a service: the
+ * factor, the number of queued requests and of requests started after their
+ * deadline, and the number of requests handled, their average handling time
+ * and latency target in microseconds for each class of request.
+ *
+ * For example:
+ *
+ *	regular_requests:
+ *	  factor: 16
+ *	  queued: 0
+ *	  late: 0
+ *	  classes:
+ *	  - { class: ost_write, handled: 1024, svc_time: 530, target: 8480 }
+ */
+static int
+ptlrpc_lprocfs_nrs_dl_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service	*svc = m->private;
+	int			 rc;
+
+	seq_printf(m, "regular_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DL_RD_STATS, true, m);
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DL_RD_STATS, true, m);
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_nrs_dl_stats);
+
+/**
+ * Initializes a deadline policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_dl_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_seq_vars nrs_dl_lprocfs_vars[] = {
+		{ .name		= "nrs_deadline_factor",
+		  .fops		= &ptlrpc_lprocfs_nrs_dl_factor_fops,
+		  .data		= svc },
+		{ .name		= "nrs_deadline_stats",
+		  .fops		= &ptlrpc_lprocfs_nrs_dl_stats_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (svc->srv_procroot == NULL)
+		return 0;
+
+	return lprocfs_seq_add_vars(svc->srv_procroot, nrs_dl_lprocfs_vars,
+				    NULL);
+}
+
+/**
+ * Cleans up a deadline policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ */
+static void nrs_dl_lprocfs_fini(struct ptlrpc_service *svc)
+{
+	if (svc->srv_procroot == NULL)
+		return;
+
+	lprocfs_remove_proc_entry("nrs_deadline_factor", svc->srv_procroot);
+	lprocfs_remove_proc_entry("nrs_deadline_stats", svc->srv_procroot);
+}
+
+#endif /* LPROCFS */
+
+/**
+ * Deadline policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_dl_ops = {
+	.op_policy_start	= nrs_dl_start,
+	.op_policy_stop		= nrs_dl_stop,
+	.op_policy_ctl		= nrs_dl_ctl,
+	.op_res_get		= nrs_dl_res_get,
+	.op_req_get		= nrs_dl_req_get,
+	.op_req_enqueue		= nrs_dl_req_add,
+	.op_req_dequeue		= nrs_dl_req_del,
+	.op_req_stop		= nrs_dl_req_stop,
+#ifdef LPROCFS
+	.op_lprocfs_init	= nrs_dl_lprocfs_init,
+	.op_lprocfs_fini	= nrs_dl_lprocfs_fini,
+#endif
+};
+
+/**
+ * Deadline policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_deadline = {
+	.nc_name		= NRS_POL_NAME_DEADLINE,
+	.nc_ops			= &nrs_dl_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} deadline */
+
+/** @} nrs */
+
+#endif /* HAVE_SERVER_SUPPORT */
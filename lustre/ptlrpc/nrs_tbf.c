@@ -85,13 +85,20 @@ static enum hrtimer_restart nrs_tbf_timer_cb(struct hrtimer *timer)
 
 #define NRS_TBF_DEFAULT_RULE "default"
 
+static void nrs_tbf_rule_put(struct nrs_tbf_rule *rule);
+
 static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 {
 	LASSERT(atomic_read(&rule->tr_ref) == 0);
 	LASSERT(cfs_list_empty(&rule->tr_cli_list));
 	LASSERT(cfs_list_empty(&rule->tr_linkage));
+	LASSERT(atomic_read(&rule->tr_nchildren) == 0);
 
 	rule->tr_head->th_ops->o_rule_fini(rule);
+	if (rule->tr_parent != NULL) {
+		atomic_dec(&rule->tr_parent->tr_nchildren);
+		nrs_tbf_rule_put(rule->tr_parent);
+	}
 	OBD_FREE_PTR(rule);
 }
 
@@ -137,6 +144,11 @@ nrs_tbf_cli_reset_value(struct nrs_tbf_head *head,
 	cli->tc_depth = rule->tr_depth;
 	cli->tc_ntoken = rule->tr_depth;
 	cli->tc_check_time = ktime_to_ns(ktime_get());
+	cli->tc_ceil_rate = rule->tr_ceil_rate;
+	cli->tc_ceil_nsecs = NSEC_PER_SEC / rule->tr_ceil_rate;
+	cli->tc_ceil_ntoken = rule->tr_depth;
+	cli->tc_ceil_check_time = cli->tc_check_time;
+	cli->tc_deadline = cli->tc_check_time + cli->tc_nsecs;
 	cli->tc_rule_sequence = atomic_read(&head->th_rule_sequence);
 	cli->tc_rule_generation = rule->tr_generation;
 
@@ -162,10 +174,37 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 	nrs_tbf_cli_reset_value(head, cli);
 }
 
+/*
+ * snprintf() returns the length the output would have had, clamp it to
+ * what was actually written into a buffer of \a length bytes, so that the
+ * next write never gets a negative length.
+ */
+static inline int nrs_tbf_dump_len(int rc, int length)
+{
+	return rc < length ? rc : max(length - 1, 0);
+}
+
 static int
 nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, char *buff, int length)
 {
-	return rule->tr_head->th_ops->o_rule_dump(rule, buff, length);
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_dump(rule, buff, length);
+	rc = nrs_tbf_dump_len(rc, length);
+	if (rule->tr_ceil_rate != rule->tr_rpc_rate) {
+		rc += snprintf(buff + rc, length - rc, ", ceil %llu",
+			       rule->tr_ceil_rate);
+		rc = nrs_tbf_dump_len(rc, length);
+	}
+	if (rule->tr_parent != NULL) {
+		rc += snprintf(buff + rc, length - rc, ", parent %s",
+			       rule->tr_parent->tr_name);
+		rc = nrs_tbf_dump_len(rc, length);
+	}
+	rc += snprintf(buff + rc, length - rc, ", ref %d\n",
+		       atomic_read(&rule->tr_ref) - 1 -
+		       atomic_read(&rule->tr_nchildren));
+	return nrs_tbf_dump_len(rc, length);
 }
 
 static int
@@ -267,12 +306,22 @@ nrs_tbf_cli_fini(struct nrs_tbf_client *cli)
 	OBD_FREE_PTR(cli);
 }
 
+/**
+ * Starts a rule described by \a start.
+ *
+ * A rule may name an existing rule as its parent. The parent then lends its
+ * idle tokens to the clients of the child rule, which may so exceed their
+ * own rate up to the ceiling of the child rule. Rules nest to any depth,
+ * e.g. a rule for a whole NID range, with rules for some of its clients
+ * below it.
+ */
 static int
 nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		   struct nrs_tbf_head *head,
 		   struct nrs_tbf_cmd *start)
 {
 	struct nrs_tbf_rule *rule, *tmp_rule;
+	struct nrs_tbf_rule *parent = NULL;
 	int rc;
 
 	rule = nrs_tbf_rule_find(head, start->tc_name);
@@ -289,9 +338,17 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_rpc_rate = start->tc_rpc_rate;
 	rule->tr_nsecs = NSEC_PER_SEC / rule->tr_rpc_rate;
 	rule->tr_depth = tbf_depth;
+	rule->tr_ceil_rate = max(start->tc_ceil_rate, start->tc_rpc_rate);
+	rule->tr_ntoken = rule->tr_depth;
+	rule->tr_ceil_ntoken = rule->tr_depth;
+	rule->tr_check_time = ktime_to_ns(ktime_get());
+	rule->tr_ceil_check_time = rule->tr_check_time;
 	atomic_set(&rule->tr_ref, 1);
+	atomic_set(&rule->tr_nchildren, 0);
+	CFS_INIT_LIST_HEAD(&rule->tr_linkage);
 	CFS_INIT_LIST_HEAD(&rule->tr_cli_list);
 	CFS_INIT_LIST_HEAD(&rule->tr_nids);
+	rule->tr_head = head;
 
 	rc = head->th_ops->o_rule_init(policy, rule, start);
 	if (rc) {
@@ -303,12 +360,23 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	spin_lock(&head->th_rule_lock);
 	tmp_rule = nrs_tbf_rule_find_nolock(head, start->tc_name);
 	if (tmp_rule) {
+		spin_unlock(&head->th_rule_lock);
 		nrs_tbf_rule_put(tmp_rule);
 		nrs_tbf_rule_put(rule);
 		return -EEXIST;
 	}
+	if (start->tc_parent != NULL) {
+		/* the reference is held by the child until it is freed */
+		parent = nrs_tbf_rule_find_nolock(head, start->tc_parent);
+		if (parent == NULL) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -ENOENT;
+		}
+		atomic_inc(&parent->tr_nchildren);
+		rule->tr_parent = parent;
+	}
 	cfs_list_add(&rule->tr_linkage, &head->th_list);
-	rule->tr_head = head;
 	spin_unlock(&head->th_rule_lock);
 	atomic_inc(&head->th_rule_sequence);
 	if (start->tc_rule_flags & NTRS_DEFAULT) {
@@ -335,6 +403,10 @@ nrs_tbf_rule_change(struct ptlrpc_nrs_policy *policy,
 
 	rule->tr_rpc_rate = change->tc_rpc_rate;
 	rule->tr_nsecs = NSEC_PER_SEC / rule->tr_rpc_rate;
+	if (change->tc_ceil_rate != 0)
+		rule->tr_ceil_rate = change->tc_ceil_rate;
+	if (rule->tr_ceil_rate < rule->tr_rpc_rate)
+		rule->tr_ceil_rate = rule->tr_rpc_rate;
 	rule->tr_generation++;
 	nrs_tbf_rule_put(rule);
 
@@ -353,12 +425,23 @@ nrs_tbf_rule_stop(struct ptlrpc_nrs_policy *policy,
 	if (strcmp(stop->tc_name, NRS_TBF_DEFAULT_RULE) == 0)
 		return -EPERM;
 
-	rule = nrs_tbf_rule_find(head, stop->tc_name);
-	if (rule == NULL)
+	spin_lock(&head->th_rule_lock);
+	rule = nrs_tbf_rule_find_nolock(head, stop->tc_name);
+	if (rule == NULL) {
+		spin_unlock(&head->th_rule_lock);
 		return -ENOENT;
+	}
+
+	/* children borrow from the rule, stop them first */
+	if (atomic_read(&rule->tr_nchildren) > 0) {
+		spin_unlock(&head->th_rule_lock);
+		nrs_tbf_rule_put(rule);
+		return -EBUSY;
+	}
 
 	cfs_list_del_init(&rule->tr_linkage);
 	rule->tr_flags |= NTRS_STOPPING;
+	spin_unlock(&head->th_rule_lock);
 	nrs_tbf_rule_put(rule);
 	nrs_tbf_rule_put(rule);
 
@@ -412,11 +495,9 @@ static int tbf_cli_compare(cfs_binheap_node_t *e1, cfs_binheap_node_t *e2)
 	cli1 = container_of(e1, struct nrs_tbf_client, tc_node);
 	cli2 = container_of(e2, struct nrs_tbf_client, tc_node);
 
-	if (cli1->tc_check_time + cli1->tc_nsecs <
-	    cli2->tc_check_time + cli2->tc_nsecs)
+	if (cli1->tc_deadline < cli2->tc_deadline)
 		return 1;
-	else if (cli1->tc_check_time + cli1->tc_nsecs >
-		 cli2->tc_check_time + cli2->tc_nsecs)
+	else if (cli1->tc_deadline > cli2->tc_deadline)
 		return 0;
 
 	if (cli1->tc_check_time < cli2->tc_check_time)
@@ -818,11 +899,10 @@ static int nrs_tbf_jobid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_jobid_rule_dump(struct nrs_tbf_rule *rule, char *buff, int length)
 {
-	return snprintf(buff, length, "%s {%s} %llu, ref %d\n",
+	return snprintf(buff, length, "%s {%s} %llu",
 			rule->tr_name,
 			rule->tr_jobids_str,
-			rule->tr_rpc_rate,
-			atomic_read(&rule->tr_ref) - 1);
+			rule->tr_rpc_rate);
 }
 
 static int
@@ -1025,11 +1105,10 @@ static int nrs_tbf_nid_rule_init(struct ptlrpc_nrs_policy *policy,
 static int
 nrs_tbf_nid_rule_dump(struct nrs_tbf_rule *rule, char *buff, int length)
 {
-	return snprintf(buff, length, "%s {%s} %llu, ref %d\n",
+	return snprintf(buff, length, "%s {%s} %llu",
 			rule->tr_name,
 			rule->tr_nids_str,
-			rule->tr_rpc_rate,
-			atomic_read(&rule->tr_ref) - 1);
+			rule->tr_rpc_rate);
 }
 
 static int
@@ -1356,6 +1435,103 @@ static void nrs_tbf_res_put(struct ptlrpc_nrs_policy *policy,
 	head->th_ops->o_cli_put(head, cli);
 }
 
+/**
+ * Refills a token bucket of \a rate RPC/s and \a depth tokens up to \a now.
+ * The check-point only moves by the time the added tokens took to earn, so
+ * frequent calls do not lose fractions of a token.
+ */
+static void nrs_tbf_refill(__u64 *ntoken, __u64 *check_time, __u64 rate,
+			   __u64 depth, __u64 now)
+{
+	__u64 fill;
+
+	if (now <= *check_time)
+		return;
+
+	/* a full bucket does not save up time, and a long idle time would
+	 * overflow the product below */
+	if (*ntoken >= depth || now - *check_time >= depth * NSEC_PER_SEC) {
+		*ntoken = depth;
+		*check_time = now;
+		return;
+	}
+
+	fill = (now - *check_time) * rate / NSEC_PER_SEC;
+	if (*ntoken + fill >= depth) {
+		*ntoken = depth;
+		*check_time = now;
+	} else {
+		*ntoken += fill;
+		*check_time += fill * NSEC_PER_SEC / rate;
+	}
+}
+
+static void nrs_tbf_rule_refill(struct nrs_tbf_rule *rule, __u64 now)
+{
+	nrs_tbf_refill(&rule->tr_ntoken, &rule->tr_check_time,
+		       rule->tr_rpc_rate, rule->tr_depth, now);
+	nrs_tbf_refill(&rule->tr_ceil_ntoken, &rule->tr_ceil_check_time,
+		       rule->tr_ceil_rate, rule->tr_depth, now);
+}
+
+/**
+ * Charges an RPC of a client of \a rule, whether sent at the client's own
+ * rate or with a borrowed token, to the pools of \a rule and all of its
+ * ancestors. Their pools thus only keep the tokens their subtree leaves
+ * idle, and their ceilings count all the RPCs of their subtree.
+ */
+static void nrs_tbf_rule_charge(struct nrs_tbf_rule *rule, __u64 now)
+{
+	for (; rule != NULL; rule = rule->tr_parent) {
+		nrs_tbf_rule_refill(rule, now);
+		if (rule->tr_ntoken > 0)
+			rule->tr_ntoken--;
+		if (rule->tr_ceil_ntoken > 0)
+			rule->tr_ceil_ntoken--;
+	}
+}
+
+/**
+ * Checks whether \a rule or one of its ancestors has an idle token to lend
+ * to a client of a child rule. Each rule up to the lender must stay under
+ * its ceiling.
+ */
+static bool nrs_tbf_rule_can_lend(struct nrs_tbf_rule *rule, __u64 now)
+{
+	for (; rule != NULL; rule = rule->tr_parent) {
+		nrs_tbf_rule_refill(rule, now);
+		if (rule->tr_ceil_ntoken == 0)
+			return false;
+		if (rule->tr_ntoken > 0)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Lets client \a cli, out of tokens of its own, send one more RPC with an
+ * idle token of the ancestors of its rule, within the ceiling of the rule.
+ * The token is taken when the RPC is charged by nrs_tbf_rule_charge().
+ */
+static bool nrs_tbf_cli_borrow(struct nrs_tbf_client *cli, __u64 now)
+{
+	struct nrs_tbf_rule *parent = cli->tc_rule->tr_parent;
+
+	if (parent == NULL || cli->tc_ceil_rate <= cli->tc_rpc_rate)
+		return false;
+
+	nrs_tbf_refill(&cli->tc_ceil_ntoken, &cli->tc_ceil_check_time,
+		       cli->tc_ceil_rate, cli->tc_depth, now);
+	if (cli->tc_ceil_ntoken == 0 || !nrs_tbf_rule_can_lend(parent, now))
+		return false;
+
+	cli->tc_ceil_ntoken--;
+	/* let the other borrowers have their turn */
+	cli->tc_deadline = min(cli->tc_check_time + cli->tc_nsecs,
+			       now + cli->tc_ceil_nsecs);
+	return true;
+}
+
 /**
  * Called when getting a request from the TBF policy for handling, or just
  * peeking; removes the request from the policy when it is to be handled.
@@ -1391,6 +1567,7 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 	if (unlikely(node == NULL))
 		return NULL;
 
+again:
 	cli = container_of(node, struct nrs_tbf_client, tc_node);
 	LASSERT(cli->tc_in_heap);
 	if (peek) {
@@ -1402,6 +1579,8 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		__u64 passed;
 		long  ntoken;
 		__u64 deadline;
+		bool  borrowed = false;
+		bool  served = false;
 
 		deadline = cli->tc_check_time +
 			  cli->tc_nsecs;
@@ -1412,16 +1591,31 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		if (ntoken > cli->tc_depth)
 			ntoken = cli->tc_depth;
 		if (ntoken > 0) {
+			ntoken--;
+			cli->tc_ntoken = ntoken;
+			cli->tc_check_time = now;
+			cli->tc_deadline = now + cli->tc_nsecs;
+			/* RPCs within the rate count against the ceiling */
+			nrs_tbf_refill(&cli->tc_ceil_ntoken,
+				       &cli->tc_ceil_check_time,
+				       cli->tc_ceil_rate, cli->tc_depth, now);
+			if (cli->tc_ceil_ntoken > 0)
+				cli->tc_ceil_ntoken--;
+			served = true;
+		} else {
+			served = borrowed = nrs_tbf_cli_borrow(cli, now);
+		}
+
+		if (served) {
 			struct ptlrpc_request *req;
+
+			nrs_tbf_rule_charge(cli->tc_rule, now);
 			nrq = cfs_list_entry(cli->tc_list.next,
 					     struct ptlrpc_nrs_request,
 					     nr_u.tbf.tr_list);
 			req = container_of(nrq,
 					   struct ptlrpc_request,
 					   rq_nrq);
-			ntoken--;
-			cli->tc_ntoken = ntoken;
-			cli->tc_check_time = now;
 			cfs_list_del_init(&nrq->nr_u.tbf.tr_list);
 			if (cfs_list_empty(&cli->tc_list)) {
 				cfs_binheap_remove(head->th_binheap,
@@ -1433,10 +1627,17 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 			}
 			CDEBUG(D_RPCTRACE,
 			       "NRS start %s request from %s, "
-			       "seq: "LPU64"\n",
+			       "seq: "LPU64"%s\n",
 			       policy->pol_desc->pd_name,
 			       libcfs_id2str(req->rq_peer),
-			       nrq->nr_u.tbf.tr_sequence);
+			       nrq->nr_u.tbf.tr_sequence,
+			       borrowed ? ", borrowed" : "");
+		} else if (cli->tc_deadline != deadline) {
+			/* nothing to borrow, wait for a token of its own */
+			cli->tc_deadline = deadline;
+			cfs_binheap_relocate(head->th_binheap, &cli->tc_node);
+			node = cfs_binheap_root(head->th_binheap);
+			goto again;
 		} else {
 			ktime_t time;
 
@@ -1484,8 +1685,7 @@ static int nrs_tbf_req_add(struct ptlrpc_nrs_policy *policy,
 			cfs_list_add_tail(&nrq->nr_u.tbf.tr_list,
 					  &cli->tc_list);
 			if (policy->pol_nrs->nrs_throttling) {
-				__u64 deadline = cli->tc_check_time +
-						 cli->tc_nsecs;
+				__u64 deadline = cli->tc_deadline;
 				if ((head->th_deadline > deadline) &&
 				    (hrtimer_try_to_cancel(&head->th_timer)
 				     >= 0)) {
@@ -1680,13 +1880,51 @@ static void nrs_tbf_cmd_fini(struct nrs_tbf_cmd *cmd)
 		nrs_tbf_nid_cmd_fini(cmd);
 }
 
+/**
+ * Parses the name of a rule, made of alphanumeric characters and '_'.
+ */
+static int nrs_tbf_name_parse(const char *name)
+{
+	int i;
+
+	if (strlen(name) == 0 || strlen(name) >= MAX_TBF_NAME)
+		return -EINVAL;
+
+	for (i = 0; i < strlen(name); i++) {
+		if ((!isalnum(name[i])) &&
+		    (name[i] != '_'))
+			return -EINVAL;
+	}
+	return 0;
+}
+
+/**
+ * Parses an RPC rate, a decimal number in [1, LPROCFS_NRS_RATE_MAX), which
+ * may only be followed by white space.
+ */
+static int nrs_tbf_rate_parse(const char *str, __u64 *rate)
+{
+	char *end;
+
+	/* anything longer overflows, or is out of range anyway */
+	if (!isdigit(str[0]) || strlen(str) > 20)
+		return -EINVAL;
+
+	*rate = simple_strtoull(str, &end, 10);
+	while (cfs_iswhite(*end))
+		end++;
+	if (*end != '\0' || end - str > 10 ||
+	    *rate == 0 || *rate >= LPROCFS_NRS_RATE_MAX)
+		return -EINVAL;
+	return 0;
+}
+
 static struct nrs_tbf_cmd *
 nrs_tbf_parse_cmd(char *buffer, unsigned long count)
 {
 	static struct nrs_tbf_cmd *cmd;
 	char			  *token;
 	char			  *val;
-	int			   i;
 	int			   rc = 0;
 
 	OBD_ALLOC_PTR(cmd);
@@ -1719,11 +1957,8 @@ nrs_tbf_parse_cmd(char *buffer, unsigned long count)
 			GOTO(out_free_cmd, rc = -EINVAL);
 	}
 
-	for (i = 0; i < strlen(token); i++) {
-		if ((!isalnum(token[i])) &&
-		    (token[i] != '_'))
-			GOTO(out_free_cmd, rc = -EINVAL);
-	}
+	if (nrs_tbf_name_parse(token) != 0)
+		GOTO(out_free_cmd, rc = -EINVAL);
 	cmd->tc_name = token;
 
 	if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE) {
@@ -1734,21 +1969,45 @@ nrs_tbf_parse_cmd(char *buffer, unsigned long count)
 			GOTO(out_free_cmd, rc);
 	}
 
-	if (val != NULL) {
-		if (cmd->tc_cmd == NRS_CTL_TBF_STOP_RULE ||
-		    strlen(val) == 0 || !isdigit(val[0]))
+	/* [rate] [ceil=<rate>] [parent=<rule>] */
+	while (val != NULL) {
+		if (cmd->tc_cmd == NRS_CTL_TBF_STOP_RULE || strlen(val) == 0)
 			GOTO(out_free_nid, rc = -EINVAL);
 
-		cmd->tc_rpc_rate = simple_strtoull(val, NULL, 10);
-		if (cmd->tc_rpc_rate <= 0 ||
-		    cmd->tc_rpc_rate >= LPROCFS_NRS_RATE_MAX)
+		token = strsep(&val, " ");
+		/* each of them at most once */
+		if (strncmp(token, "ceil=", 5) == 0) {
+			if (cmd->tc_ceil_rate != 0 ||
+			    nrs_tbf_rate_parse(token + 5,
+					       &cmd->tc_ceil_rate) != 0)
+				GOTO(out_free_nid, rc = -EINVAL);
+		} else if (strncmp(token, "parent=", 7) == 0) {
+			/* the parent is fixed when the rule starts */
+			if (cmd->tc_cmd != NRS_CTL_TBF_START_RULE ||
+			    cmd->tc_parent != NULL)
+				GOTO(out_free_nid, rc = -EINVAL);
+			/* drop the end of line left by echo */
+			token[strcspn(token, "\n")] = '\0';
+			if (nrs_tbf_name_parse(token + 7) != 0 ||
+			    strcmp(token + 7, cmd->tc_name) == 0)
+				GOTO(out_free_nid, rc = -EINVAL);
+			cmd->tc_parent = token + 7;
+		} else if (cmd->tc_rpc_rate == 0) {
+			if (nrs_tbf_rate_parse(token, &cmd->tc_rpc_rate) != 0)
+				GOTO(out_free_nid, rc = -EINVAL);
+		} else {
 			GOTO(out_free_nid, rc = -EINVAL);
-	} else {
+		}
+	}
+
+	if (cmd->tc_cmd != NRS_CTL_TBF_STOP_RULE && cmd->tc_rpc_rate == 0) {
 		if (cmd->tc_cmd == NRS_CTL_TBF_CHANGE_RATE)
 			GOTO(out_free_nid, rc = -EINVAL);
 		/* No RPC rate given */
 		cmd->tc_rpc_rate = tbf_rate;
 	}
+	if (cmd->tc_ceil_rate != 0 && cmd->tc_ceil_rate < cmd->tc_rpc_rate)
+		GOTO(out_free_nid, rc = -EINVAL);
 	goto out;
 out_free_nid:
 	nrs_tbf_cmd_fini(cmd);
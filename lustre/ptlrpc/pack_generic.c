@@ -56,6 +56,8 @@
 #include <lustre/ll_fiemap.h>
 #include <lustre_update.h>
 
+#include "ptlrpc_internal.h"
+
 static inline int lustre_msg_hdr_size_v2(int count)
 {
         return cfs_size_round(offsetof(struct lustre_msg_v2,
@@ -329,6 +331,86 @@ void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs)
 	wake_up(&svcpt->scp_rep_waitq);
 }
 
+/**
+ * Get a reply state of PTLRPC_RS_CACHE_SIZE bytes for a reply of \a rs_size
+ * bytes (reply state included), recycled from the cache of \a svcpt if any.
+ * Small replies are the bulk of the RPCs of a metadata server, so this saves
+ * an allocation and a free of the reply buffer for most of them.
+ *
+ * \retval NULL if \a rs_size does not fit, the caller allocates it then
+ */
+struct ptlrpc_reply_state *
+lustre_get_cached_rs(struct ptlrpc_service_part *svcpt, int rs_size)
+{
+	struct ptlrpc_reply_state *rs = NULL;
+
+	if (rs_size > PTLRPC_RS_CACHE_SIZE)
+		return NULL;
+
+	spin_lock(&svcpt->scp_rep_cache_lock);
+	if (!cfs_list_empty(&svcpt->scp_rep_cache)) {
+		rs = cfs_list_entry(svcpt->scp_rep_cache.next,
+				    struct ptlrpc_reply_state, rs_list);
+		cfs_list_del(&rs->rs_list);
+		svcpt->scp_rep_ncached--;
+		svcpt->scp_rep_cache_hits++;
+	} else {
+		svcpt->scp_rep_cache_misses++;
+	}
+	spin_unlock(&svcpt->scp_rep_cache_lock);
+
+	if (rs != NULL) {
+		/* the rest of the buffer is never sent */
+		memset(rs, 0, rs_size);
+	} else {
+		OBD_CPT_ALLOC_LARGE(rs, svcpt->scp_service->srv_cptable,
+				    svcpt->scp_cpt, PTLRPC_RS_CACHE_SIZE);
+		if (rs == NULL)
+			return NULL;
+	}
+
+	rs->rs_size = PTLRPC_RS_CACHE_SIZE;
+	rs->rs_svcpt = svcpt;
+	rs->rs_cached = 1;
+	return rs;
+}
+
+void lustre_put_cached_rs(struct ptlrpc_reply_state *rs)
+{
+	struct ptlrpc_service_part *svcpt = rs->rs_svcpt;
+
+	LASSERT(rs->rs_cached);
+
+	spin_lock(&svcpt->scp_rep_cache_lock);
+	if (svcpt->scp_rep_ncached < rep_cache_max) {
+		cfs_list_add(&rs->rs_list, &svcpt->scp_rep_cache);
+		svcpt->scp_rep_ncached++;
+		rs = NULL;
+	}
+	spin_unlock(&svcpt->scp_rep_cache_lock);
+
+	if (rs != NULL)
+		OBD_FREE_LARGE(rs, PTLRPC_RS_CACHE_SIZE);
+}
+
+void lustre_purge_cached_rs(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_reply_state *rs;
+
+	spin_lock(&svcpt->scp_rep_cache_lock);
+	while (!cfs_list_empty(&svcpt->scp_rep_cache)) {
+		rs = cfs_list_entry(svcpt->scp_rep_cache.next,
+				    struct ptlrpc_reply_state, rs_list);
+		cfs_list_del(&rs->rs_list);
+		svcpt->scp_rep_ncached--;
+		spin_unlock(&svcpt->scp_rep_cache_lock);
+		OBD_FREE_LARGE(rs, PTLRPC_RS_CACHE_SIZE);
+		spin_lock(&svcpt->scp_rep_cache_lock);
+	}
+	LASSERT(svcpt->scp_rep_ncached == 0);
+	spin_unlock(&svcpt->scp_rep_cache_lock);
+}
+
 int lustre_pack_reply_v2(struct ptlrpc_request *req, int count,
                          __u32 *lens, char **bufs, int flags)
 {
@@ -1812,6 +1894,17 @@ void lustre_swab_ost_body (struct ost_body *b)
 }
 EXPORT_SYMBOL(lustre_swab_ost_body);
 
+void lustre_swab_ost_batch_rec(struct ost_batch_rec *obr)
+{
+	lustre_swab_ost_id(&obr->obr_oi);
+	/* obr_cookie is only read back by its sender */
+	__swab32s(&obr->obr_op);
+	__swab32s(&obr->obr_count);
+	__swab32s(&obr->obr_uid);
+	__swab32s(&obr->obr_gid);
+}
+EXPORT_SYMBOL(lustre_swab_ost_batch_rec);
+
 void lustre_swab_ost_last_id(obd_id *id)
 {
         __swab64s(id);
@@ -2640,6 +2733,25 @@ void lustre_swab_object_update_reply(struct object_update_reply *our)
 }
 EXPORT_SYMBOL(lustre_swab_object_update_reply);
 
+/* The embedded messages carry their own magic and are swabbed when each
+ * one is unpacked, only the header needs to be fixed here. */
+void lustre_swab_batch_buf(struct batch_buf *bb)
+{
+	int i;
+
+	__swab32s(&bb->bb_magic);
+	__swab16s(&bb->bb_count);
+	__swab16s(&bb->bb_padding);
+	__swab32s(&bb->bb_reply_size);
+	CLASSERT(offsetof(typeof(*bb), bb_padding2) != 0);
+	for (i = 0; i < bb->bb_count && i < BATCH_MAX_COUNT; i++) {
+		__swab64s(&bb->bb_msgs[i].bm_xid);
+		__swab32s(&bb->bb_msgs[i].bm_len);
+		CLASSERT(offsetof(typeof(bb->bb_msgs[i]), bm_padding) != 0);
+	}
+}
+EXPORT_SYMBOL(lustre_swab_batch_buf);
+
 void lustre_swab_swap_layouts(struct mdc_swap_layouts *msl)
 {
 	__swab64s(&msl->msl_flags);
@@ -46,11 +46,19 @@ struct obd_import;
 struct ldlm_res_id;
 struct ptlrpc_request_set;
 extern int test_req_buffer_pressure;
+extern int rep_cache_max;
 extern struct mutex ptlrpc_all_services_mutex;
 
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
+void ptlrpc_rqbd_account(struct ptlrpc_service_part *svcpt, int nfilled);
+/* max # of posted request buffers, in ptlrpc_service::srv_nbuf_per_group */
+#define PTLRPC_RQBD_MAX_FACTOR		16
+/* max # of request buffers unlinked at once when shrinking the pool */
+#define PTLRPC_RQBD_SHRINK_BATCH	16
+
 /* ptlrpcd.c */
-int ptlrpcd_start(int index, int max, const char *name, struct ptlrpcd_ctl *pc);
+int ptlrpcd_start(const char *name, struct ptlrpcd_ctl *pc, int wait);
+void ptlrpcd_wake_partners(struct ptlrpcd_ctl *pc, int prev, int count);
 
 /* client.c */
 struct ptlrpc_bulk_desc *ptlrpc_new_bulk(unsigned npages, unsigned max_brw,
@@ -239,6 +247,14 @@ struct ptlrpc_reply_state *
 lustre_get_emerg_rs(struct ptlrpc_service_part *svcpt);
 void lustre_put_emerg_rs(struct ptlrpc_reply_state *rs);
 
+/* size of the reply states recycled by each service partition */
+#define PTLRPC_RS_CACHE_SIZE	CFS_PAGE_SIZE
+
+struct ptlrpc_reply_state *
+lustre_get_cached_rs(struct ptlrpc_service_part *svcpt, int rs_size);
+void lustre_put_cached_rs(struct ptlrpc_reply_state *rs);
+void lustre_purge_cached_rs(struct ptlrpc_service_part *svcpt);
+
 /* pinger.c */
 int ptlrpc_start_pinger(void);
 int ptlrpc_stop_pinger(void);
@@ -73,12 +73,35 @@
 
 #include "ptlrpc_internal.h"
 
+/**
+ * The ptlrpcd threads of one CPU partition.
+ *
+ * An async RPC is queued on a thread of the partition of the CPU which adds
+ * it, the threads of a partition are partners of each other: an idle thread
+ * steals part of the new RPCs of a busy one. Only ptlrpcd_per_cpt_min threads
+ * are started at first, a thread which finds a deep queue in its set starts
+ * one more, up to pd_max_threads, and the last of these extra threads stops
+ * again once it has been idle for ptlrpcd_idle_timeout seconds.
+ */
 struct ptlrpcd {
-        int                pd_size;
-        int                pd_index;
-        int                pd_nthreads;
-        struct ptlrpcd_ctl pd_thread_rcv;
-        struct ptlrpcd_ctl pd_threads[0];
+	int			pd_size;
+	/* round-robin cursor on the started threads */
+	int			pd_index;
+	/* CPU partition of the threads */
+	int			pd_cpt;
+	/* protects pd_nthreads, pd_growing and pd_stopping */
+	spinlock_t		pd_lock;
+	/* started threads, pd_threads[0 .. pd_nthreads - 1] */
+	int			pd_nthreads;
+	/* threads started by ptlrpcd_init(), never stopped when idle */
+	int			pd_min_threads;
+	/* size of pd_threads[] */
+	int			pd_max_threads;
+	/* a thread is being started by ptlrpcd_grow() */
+	unsigned int		pd_growing:1,
+	/* ptlrpcd_fini() is stopping the threads */
+				pd_stopping:1;
+	struct ptlrpcd_ctl	pd_threads[0];
 };
 
 #ifdef __KERNEL__
@@ -86,11 +109,35 @@ static int max_ptlrpcds;
 CFS_MODULE_PARM(max_ptlrpcds, "i", int, 0644,
                 "Max ptlrpcd thread count to be started.");
 
-static int ptlrpcd_bind_policy = PDB_POLICY_PAIR;
+static int ptlrpcd_bind_policy;
 CFS_MODULE_PARM(ptlrpcd_bind_policy, "i", int, 0644,
-                "Ptlrpcd threads binding mode.");
+		"Obsolete, ptlrpcd threads are bound to their CPU partition.");
+
+static int ptlrpcd_per_cpt_min = 2;
+CFS_MODULE_PARM(ptlrpcd_per_cpt_min, "i", int, 0644,
+		"Ptlrpcd threads started at first in each CPU partition.");
+
+static int ptlrpcd_per_cpt_max;
+CFS_MODULE_PARM(ptlrpcd_per_cpt_max, "i", int, 0644,
+		"Max ptlrpcd threads in each CPU partition "
+		"(default: CPU count of the partition).");
+
+static int ptlrpcd_queue_depth = 32;
+CFS_MODULE_PARM(ptlrpcd_queue_depth, "i", int, 0644,
+		"RPCs queued on a ptlrpcd thread before its partners are woken "
+		"up to steal them and one more thread is started.");
+
+static int ptlrpcd_idle_timeout = 60;
+CFS_MODULE_PARM(ptlrpcd_idle_timeout, "i", int, 0644,
+		"Seconds a ptlrpcd thread started on demand stays idle before "
+		"it stops (0: never stop).");
 #endif
-static struct ptlrpcd *ptlrpcds;
+/* one pool per CPU partition */
+static struct ptlrpcd **ptlrpcds;
+static int ptlrpcds_num;
+static int ptlrpcds_index;
+/* the thread for the RPCs of recovering imports */
+static struct ptlrpcd_ctl ptlrpcd_rcv;
 
 struct mutex ptlrpcd_mutex;
 static int ptlrpcd_users = 0;
@@ -108,45 +155,91 @@ EXPORT_SYMBOL(ptlrpcd_wake);
 static struct ptlrpcd_ctl *
 ptlrpcd_select_pc(struct ptlrpc_request *req, pdl_policy_t policy, int index)
 {
-        int idx = 0;
+	struct ptlrpcd	*pd;
+	int		 idx = 0;
+#ifdef __KERNEL__
+	int		 cpt = 0;
+	int		 nthreads;
+#endif
 
-        if (req != NULL && req->rq_send_state != LUSTRE_IMP_FULL)
-                return &ptlrpcds->pd_thread_rcv;
+	if (req != NULL && req->rq_send_state != LUSTRE_IMP_FULL)
+		return &ptlrpcd_rcv;
 
 #ifdef __KERNEL__
 	switch (policy) {
-	case PDL_POLICY_SAME:
-		idx = smp_processor_id() % ptlrpcds->pd_nthreads;
+	case PDL_POLICY_ROUND:
+		/* We do not care whether it is strict load balance. */
+		cpt = ++ptlrpcds_index % ptlrpcds_num;
+		ptlrpcds_index = cpt;
 		break;
-        case PDL_POLICY_LOCAL:
-                /* Before CPU partition patches available, process it the same
-                 * as "PDL_POLICY_ROUND". */
-# ifdef CFS_CPU_MODE_NUMA
-# warning "fix this code to use new CPU partition APIs"
-# endif
-                /* Fall through to PDL_POLICY_ROUND until the CPU
-                 * CPU partition patches are available. */
-                index = -1;
-        case PDL_POLICY_PREFERRED:
+	case PDL_POLICY_PREFERRED:
 		if (index >= 0 && index < num_online_cpus()) {
-                        idx = index % ptlrpcds->pd_nthreads;
-                        break;
-                }
-                /* Fall through to PDL_POLICY_ROUND for bad index. */
-        default:
-                /* Fall through to PDL_POLICY_ROUND for unknown policy. */
-        case PDL_POLICY_ROUND:
-                /* We do not care whether it is strict load balance. */
-                idx = ptlrpcds->pd_index + 1;
-		if (idx == smp_processor_id())
-                        idx++;
-                idx %= ptlrpcds->pd_nthreads;
-                ptlrpcds->pd_index = idx;
-                break;
-        }
+			cpt = cfs_cpt_of_cpu(cfs_cpt_table, index);
+			break;
+		}
+		/* Fall through to PDL_POLICY_LOCAL for bad index. */
+	default:
+		/* Fall through to PDL_POLICY_LOCAL for unknown policy. */
+	case PDL_POLICY_SAME:
+	case PDL_POLICY_LOCAL:
+		cpt = cfs_cpt_current(cfs_cpt_table, 1);
+		break;
+	}
+	if (cpt < 0 || cpt >= ptlrpcds_num)
+		cpt = 0;
+	pd = ptlrpcds[cpt];
+
+	nthreads = pd->pd_nthreads;
+	smp_rmb(); /* pairs with smp_wmb() in ptlrpcd_grow() */
+	if (policy == PDL_POLICY_SAME) {
+		idx = smp_processor_id() % nthreads;
+	} else {
+		idx = pd->pd_index + 1;
+		if (idx >= nthreads)
+			idx = 0;
+		pd->pd_index = idx;
+	}
+#else
+	pd = ptlrpcds[0];
 #endif /* __KERNEL__ */
 
-        return &ptlrpcds->pd_threads[idx];
+	return &pd->pd_threads[idx];
+}
+
+/**
+ * Wake up the partners of \a pc after new RPCs are queued on it, raising the
+ * count of its new RPCs from \a prev to \a count: the first ones of a burst
+ * wake up one partner, a queue reaching ptlrpcd_queue_depth all of them, so
+ * that the idle threads of the partition steal the RPCs.
+ */
+void ptlrpcd_wake_partners(struct ptlrpcd_ctl *pc, int prev, int count)
+{
+#ifdef __KERNEL__
+	struct ptlrpc_request_set	*ps;
+	int				 i;
+
+	if (pc->pc_npartners <= 0)
+		return;
+
+	if (prev < ptlrpcd_queue_depth && count >= ptlrpcd_queue_depth) {
+		for (i = 0; i < pc->pc_npartners; i++) {
+			ps = pc->pc_partners[i]->pc_set;
+			if (ps != NULL)
+				wake_up(&ps->set_waitq);
+		}
+	} else if (prev == 0) {
+		/* the first running thread following pc in the partition */
+		for (i = 0; i < pc->pc_npartners; i++) {
+			if (test_bit(LIOD_IDLE, &pc->pc_partners[i]->pc_flags))
+				continue;
+			ps = pc->pc_partners[i]->pc_set;
+			if (ps != NULL) {
+				wake_up(&ps->set_waitq);
+				break;
+			}
+		}
+	}
+#endif
 }
 
 /**
@@ -189,21 +282,18 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 	count = atomic_add_return(i, &new->set_new_count);
 	atomic_set(&set->set_remaining, 0);
 	spin_unlock(&new->set_new_req_lock);
-	if (count == i) {
+	if (count == i)
 		wake_up(&new->set_waitq);
-
-		/* XXX: It maybe unnecessary to wakeup all the partners. But to
-		 *      guarantee the async RPC can be processed ASAP, we have
-		 *      no other better choice. It maybe fixed in future. */
-		for (i = 0; i < pc->pc_npartners; i++)
-			wake_up(&pc->pc_partners[i]->pc_set->set_waitq);
-	}
+	ptlrpcd_wake_partners(pc, count - i, count);
 #endif
 }
 EXPORT_SYMBOL(ptlrpcd_add_rqset);
 
 #ifdef __KERNEL__
 /**
+ * Move the newer half of the new RPCs of \a src to \a des, so that the owner
+ * of \a src keeps the older ones.
+ *
  * Return transferred RPCs count.
  */
 static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
@@ -211,21 +301,24 @@ static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
 {
         cfs_list_t *tmp, *pos;
         struct ptlrpc_request *req;
+	int skip;
         int rc = 0;
 
 	spin_lock(&src->set_new_req_lock);
-        if (likely(!cfs_list_empty(&src->set_new_requests))) {
-                cfs_list_for_each_safe(pos, tmp, &src->set_new_requests) {
-                        req = cfs_list_entry(pos, struct ptlrpc_request,
-                                             rq_set_chain);
-                        req->rq_set = des;
-                }
-                cfs_list_splice_init(&src->set_new_requests,
-                                     &des->set_requests);
-		rc = atomic_read(&src->set_new_count);
-		atomic_add(rc, &des->set_remaining);
-		atomic_set(&src->set_new_count, 0);
+	skip = atomic_read(&src->set_new_count) / 2;
+	cfs_list_for_each_safe(pos, tmp, &src->set_new_requests) {
+		if (skip > 0) {
+			skip--;
+			continue;
+		}
+		req = cfs_list_entry(pos, struct ptlrpc_request,
+				     rq_set_chain);
+		req->rq_set = des;
+		cfs_list_move_tail(&req->rq_set_chain, &des->set_requests);
+		rc++;
 	}
+	atomic_sub(rc, &src->set_new_count);
+	atomic_add(rc, &des->set_remaining);
 	spin_unlock(&src->set_new_req_lock);
 	return rc;
 }
@@ -279,6 +372,20 @@ static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
 	atomic_inc(&set->set_refcount);
 }
 
+/**
+ * Account a completed RPC of the set of \a pc.
+ */
+static void ptlrpcd_req_done(struct ptlrpcd_ctl *pc, struct ptlrpc_request *req)
+{
+	struct timeval tv;
+
+	cfs_duration_usec(cfs_time_sub(cfs_time_current(), req->rq_queued_time),
+			  &tv);
+	lprocfs_oh_tally_log2(&pc->pc_latency_hist,
+			      tv.tv_sec * 1000 + tv.tv_usec / 1000);
+	pc->pc_nr_done++;
+}
+
 /**
  * Check if there is more work to do on ptlrpcd set.
  * Returns 1 if yes.
@@ -306,6 +413,9 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 			rc = 1;
 		}
 		spin_unlock(&set->set_new_req_lock);
+		if (rc)
+			lprocfs_oh_tally_log2(&pc->pc_depth_hist,
+					      atomic_read(&set->set_remaining));
 	}
 
 	/* We should call lu_env_refill() before handling new requests to make
@@ -343,6 +453,7 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 
                         cfs_list_del_init(&req->rq_set_chain);
                         req->rq_set = NULL;
+			ptlrpcd_req_done(pc, req);
                         ptlrpc_req_finished(req);
                 }
         }
@@ -354,9 +465,11 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 		rc = atomic_read(&set->set_new_count);
 
 #ifdef __KERNEL__
-                /* If we have nothing to do, check whether we can take some
-                 * work from our partner threads. */
-                if (rc == 0 && pc->pc_npartners > 0) {
+		/* If we have nothing to do, check whether we can take some
+		 * work from our partner threads. A thread which is stopping
+		 * because it is idle takes none. */
+		if (rc == 0 && pc->pc_npartners > 0 &&
+		    !test_bit(LIOD_IDLE, &pc->pc_flags)) {
                         struct ptlrpcd_ctl *partner;
                         struct ptlrpc_request_set *ps;
                         int first = pc->pc_cursor;
@@ -380,11 +493,13 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 
 				if (atomic_read(&ps->set_new_count)) {
 					rc = ptlrpcd_steal_rqset(set, ps);
-					if (rc > 0)
+					if (rc > 0) {
+						pc->pc_nr_stolen += rc;
 						CDEBUG(D_RPCTRACE, "transfer %d"
 						       " async RPCs [%d->%d]\n",
 						       rc, partner->pc_index,
 						       pc->pc_index);
+					}
 				}
 				ptlrpc_reqset_put(ps);
 			} while (rc == 0 && pc->pc_cursor != first);
@@ -396,6 +511,142 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 }
 
 #ifdef __KERNEL__
+static inline struct ptlrpcd *ptlrpcd_ctl2pool(struct ptlrpcd_ctl *pc)
+{
+	return container_of(pc - pc->pc_index, struct ptlrpcd, pd_threads[0]);
+}
+
+static int ptlrpcd(void *arg);
+
+/**
+ * Run the thread of \a pc, whose set is already set up, and wait for it to
+ * initialize its environment if \a wait is set.
+ */
+static int ptlrpcd_run(struct ptlrpcd_ctl *pc, int wait)
+{
+	struct task_struct *task;
+
+	init_completion(&pc->pc_starting);
+	init_completion(&pc->pc_finishing);
+	task = kthread_run(ptlrpcd, pc, pc->pc_name);
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+
+	if (wait)
+		wait_for_completion(&pc->pc_starting);
+	return 0;
+}
+
+/**
+ * Start one more ptlrpcd thread in the CPU partition of \a pc if the set of
+ * \a pc is deep, the new thread then steals part of the new RPCs.
+ *
+ * This is called by the ptlrpcd thread of \a pc, so it does not wait for the
+ * new thread to start, as ptlrpc_start_thread(svcpt, 0) does not either. A
+ * thread stopped by ptlrpcd_shrink() is run again on the set it kept.
+ */
+static void ptlrpcd_grow(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpc_request_set	*set = pc->pc_set;
+	struct ptlrpcd			*pd;
+	struct ptlrpcd_ctl		*new;
+	char				 name[16];
+	int				 rc;
+
+	if (pc->pc_cpt < 0 ||
+	    atomic_read(&set->set_remaining) +
+	    atomic_read(&set->set_new_count) < ptlrpcd_queue_depth)
+		return;
+
+	pd = ptlrpcd_ctl2pool(pc);
+	spin_lock(&pd->pd_lock);
+	if (pd->pd_growing || pd->pd_stopping ||
+	    pd->pd_nthreads >= pd->pd_max_threads) {
+		spin_unlock(&pd->pd_lock);
+		return;
+	}
+	pd->pd_growing = 1;
+	new = &pd->pd_threads[pd->pd_nthreads];
+	spin_unlock(&pd->pd_lock);
+
+	if (test_bit(LIOD_IDLE, &new->pc_flags)) {
+		/* its old thread may still be draining its last RPCs */
+		if (!completion_done(&new->pc_finishing)) {
+			rc = -EBUSY;
+		} else {
+			clear_bit(LIOD_IDLE, &new->pc_flags);
+			rc = ptlrpcd_run(new, 0);
+			if (rc != 0)
+				set_bit(LIOD_IDLE, &new->pc_flags);
+		}
+	} else {
+		snprintf(name, sizeof(name), "ptlrpcd_%02d_%02d",
+			 pd->pd_cpt, new->pc_index);
+		rc = ptlrpcd_start(name, new, 0);
+	}
+
+	spin_lock(&pd->pd_lock);
+	if (rc == 0) {
+		/* pairs with smp_rmb() in ptlrpcd_select_pc() */
+		smp_wmb();
+		pd->pd_nthreads++;
+	}
+	pd->pd_growing = 0;
+	spin_unlock(&pd->pd_lock);
+
+	CDEBUG(D_RPCTRACE, "%s: start %s for %d RPCs: rc = %d\n",
+	       pc->pc_name, new->pc_name, atomic_read(&set->set_remaining) +
+	       atomic_read(&set->set_new_count), rc);
+}
+
+/**
+ * Stop the thread of \a pc if it is the last started thread of its pool, was
+ * started by ptlrpcd_grow() and has had no RPC since \a idle for
+ * ptlrpcd_idle_timeout seconds.
+ *
+ * The set of a stopped thread is kept until ptlrpcd_fini(): an RPC which
+ * raced with the stop is still stolen by the partners, or sent once the
+ * thread is started again.
+ *
+ * \retval true if the thread has to exit
+ */
+static bool ptlrpcd_shrink(struct ptlrpcd_ctl *pc, cfs_time_t *idle)
+{
+	struct ptlrpc_request_set	*set = pc->pc_set;
+	struct ptlrpcd			*pd;
+	bool				 stop = false;
+
+	if (pc->pc_cpt < 0 || ptlrpcd_idle_timeout <= 0)
+		return false;
+
+	if (atomic_read(&set->set_remaining) +
+	    atomic_read(&set->set_new_count) > 0) {
+		*idle = cfs_time_current();
+		return false;
+	}
+
+	pd = ptlrpcd_ctl2pool(pc);
+	if (pc->pc_index < pd->pd_min_threads ||
+	    cfs_time_before(cfs_time_current(),
+			    cfs_time_add(*idle,
+				cfs_time_seconds(ptlrpcd_idle_timeout))))
+		return false;
+
+	spin_lock(&pd->pd_lock);
+	if (!pd->pd_growing && !pd->pd_stopping &&
+	    pc->pc_index == pd->pd_nthreads - 1) {
+		pd->pd_nthreads--;
+		set_bit(LIOD_IDLE, &pc->pc_flags);
+		stop = true;
+	}
+	spin_unlock(&pd->pd_lock);
+
+	if (stop)
+		CDEBUG(D_RPCTRACE, "%s: stop after %d idle seconds\n",
+		       pc->pc_name, ptlrpcd_idle_timeout);
+	return stop;
+}
+
 /**
  * Main ptlrpcd thread.
  * ptlrpc's code paths like to execute in process context, so we have this
@@ -408,24 +659,20 @@ static int ptlrpcd(void *arg)
 	struct ptlrpc_request_set *set = pc->pc_set;
 	struct lu_context ses = { 0 };
 	struct lu_env env = { .le_ses = &ses };
+	cfs_time_t idle = cfs_time_current();
 	int rc, exit = 0;
 	ENTRY;
 
 	unshare_fs_struct();
-#if defined(CONFIG_SMP)
-	if (test_bit(LIOD_BIND, &pc->pc_flags)) {
-		int index = pc->pc_index;
-
-		if (index >= 0 && index < num_possible_cpus()) {
-			while (!cpu_online(index)) {
-				if (++index >= num_possible_cpus())
-					index = 0;
-			}
-			set_cpus_allowed_ptr(current,
-				     cpumask_of_node(cpu_to_node(index)));
-		}
+	if (pc->pc_cpt >= 0) {
+		rc = cfs_cpt_bind(cfs_cpt_table, pc->pc_cpt);
+		if (rc == 0)
+			set_bit(LIOD_BIND, &pc->pc_flags);
+		else
+			CWARN("%s: failed to bind to CPT %d: rc = %d\n",
+			      pc->pc_name, pc->pc_cpt, rc);
 	}
-#endif
+
 	/* Both client and server (MDT/OST) may use the environment. */
 	rc = lu_context_init(&env.le_ctx, LCT_MD_THREAD | LCT_DT_THREAD |
 					  LCT_CL_THREAD | LCT_REMEMBER |
@@ -468,7 +715,11 @@ static int ptlrpcd(void *arg)
 			if (test_bit(LIOD_FORCE, &pc->pc_flags))
                                 ptlrpc_abort_set(set);
                         exit++;
-                }
+		} else if (exit > 0 || ptlrpcd_shrink(pc, &idle)) {
+			exit++;
+		} else {
+			ptlrpcd_grow(pc);
+		}
 
                 /*
                  * Let's make one more loop to make sure that ptlrpcd_check()
@@ -489,145 +740,53 @@ static int ptlrpcd(void *arg)
 	return 0;
 }
 
-/* XXX: We want multiple CPU cores to share the async RPC load. So we start many
- *      ptlrpcd threads. We also want to reduce the ptlrpcd overhead caused by
- *      data transfer cross-CPU cores. So we bind ptlrpcd thread to specified
- *      CPU core. But binding all ptlrpcd threads maybe cause response delay
- *      because of some CPU core(s) busy with other loads.
- *
- *      For example: "ls -l", some async RPCs for statahead are assigned to
- *      ptlrpcd_0, and ptlrpcd_0 is bound to CPU_0, but CPU_0 may be quite busy
- *      with other non-ptlrpcd, like "ls -l" itself (we want to the "ls -l"
- *      thread, statahead thread, and ptlrpcd thread can run in parallel), under
- *      such case, the statahead async RPCs can not be processed in time, it is
- *      unexpected. If ptlrpcd_0 can be re-scheduled on other CPU core, it may
- *      be better. But it breaks former data transfer policy.
- *
- *      So we shouldn't be blind for avoiding the data transfer. We make some
- *      compromise: divide the ptlrpcd threds pool into two parts. One part is
- *      for bound mode, each ptlrpcd thread in this part is bound to some CPU
- *      core. The other part is for free mode, all the ptlrpcd threads in the
- *      part can be scheduled on any CPU core. We specify some partnership
- *      between bound mode ptlrpcd thread(s) and free mode ptlrpcd thread(s),
- *      and the async RPC load within the partners are shared.
- *
- *      It can partly avoid data transfer cross-CPU (if the bound mode ptlrpcd
- *      thread can be scheduled in time), and try to guarantee the async RPC
- *      processed ASAP (as long as the free mode ptlrpcd thread can be scheduled
- *      on any CPU core).
+/**
+ * Size of the ptlrpcd pool of CPU partition \a cpt.
  *
- *      As for how to specify the partnership between bound mode ptlrpcd
- *      thread(s) and free mode ptlrpcd thread(s), the simplest way is to use
- *      <free bound> pair. In future, we can specify some more complex
- *      partnership based on the patches for CPU partition. But before such
- *      patches are available, we prefer to use the simplest one.
+ * The async RPCs are processed in the partition of the CPU which sent them,
+ * by threads bound to this partition: this avoids moving the RPC data across
+ * NUMA nodes, while the threads of the partition are still scheduled on any
+ * of its cores. All the threads of a partition are partners, an idle thread
+ * steals the new RPCs of a busy one, so that a burst of async I/O completions
+ * is not serialized on the thread it was queued to.
  */
-# ifdef CFS_CPU_MODE_NUMA
-# warning "fix ptlrpcd_bind() to use new CPU partition APIs"
-# endif
-static int ptlrpcd_bind(int index, int max)
+static int ptlrpcd_pool_size(int cpt, int ncpts)
 {
-	struct ptlrpcd_ctl *pc;
-	int rc = 0;
-#if defined(CONFIG_NUMA)
-	cpumask_t mask;
-#endif
-	ENTRY;
+	int nthreads = cfs_cpt_weight(cfs_cpt_table, cpt);
 
-        LASSERT(index <= max - 1);
-        pc = &ptlrpcds->pd_threads[index];
-        switch (ptlrpcd_bind_policy) {
-        case PDB_POLICY_NONE:
-                pc->pc_npartners = -1;
-                break;
-        case PDB_POLICY_FULL:
-                pc->pc_npartners = 0;
-		set_bit(LIOD_BIND, &pc->pc_flags);
-                break;
-        case PDB_POLICY_PAIR:
-                LASSERT(max % 2 == 0);
-                pc->pc_npartners = 1;
-                break;
-	case PDB_POLICY_NEIGHBOR:
-#if defined(CONFIG_NUMA)
-	{
-		int i;
-		mask = *cpumask_of_node(cpu_to_node(index));
-		for (i = max; i < num_online_cpus(); i++)
-			cpu_clear(i, mask);
-		pc->pc_npartners = cpus_weight(mask) - 1;
-		set_bit(LIOD_BIND, &pc->pc_flags);
-	}
-#else
-                LASSERT(max >= 3);
-                pc->pc_npartners = 2;
-#endif
-                break;
-        default:
-                CERROR("unknown ptlrpcd bind policy %d\n", ptlrpcd_bind_policy);
-                rc = -EINVAL;
-        }
+	if (ptlrpcd_per_cpt_max > 0 && ptlrpcd_per_cpt_max < nthreads)
+		nthreads = ptlrpcd_per_cpt_max;
+	if (max_ptlrpcds > 0 && max_ptlrpcds / ncpts < nthreads)
+		nthreads = max_ptlrpcds / ncpts;
 
-        if (rc == 0 && pc->pc_npartners > 0) {
-                OBD_ALLOC(pc->pc_partners,
-                          sizeof(struct ptlrpcd_ctl *) * pc->pc_npartners);
-                if (pc->pc_partners == NULL) {
-                        pc->pc_npartners = 0;
-                        rc = -ENOMEM;
-                } else {
-                        switch (ptlrpcd_bind_policy) {
-                        case PDB_POLICY_PAIR:
-                                if (index & 0x1) {
-					set_bit(LIOD_BIND, &pc->pc_flags);
-                                        pc->pc_partners[0] = &ptlrpcds->
-                                                pd_threads[index - 1];
-                                        ptlrpcds->pd_threads[index - 1].
-                                                pc_partners[0] = pc;
-                                }
-                                break;
-			case PDB_POLICY_NEIGHBOR:
-#if defined(CONFIG_NUMA)
-			{
-				struct ptlrpcd_ctl *ppc;
-				int i, pidx;
-				/* partners are cores in the same NUMA node.
-				 * setup partnership only with ptlrpcd threads
-				 * that are already initialized
-				 */
-				for (pidx = 0, i = 0; i < index; i++) {
-					if (cpu_isset(i, mask)) {
-						ppc = &ptlrpcds->pd_threads[i];
-						pc->pc_partners[pidx++] = ppc;
-						ppc->pc_partners[ppc->
-							  pc_npartners++] = pc;
-					}
-				}
-                                /* adjust number of partners to the number
-                                 * of partnership really setup */
-                                pc->pc_npartners = pidx;
-			}
-#else
-                                if (index & 0x1)
-					set_bit(LIOD_BIND, &pc->pc_flags);
-                                if (index > 0) {
-                                        pc->pc_partners[0] = &ptlrpcds->
-                                                pd_threads[index - 1];
-                                        ptlrpcds->pd_threads[index - 1].
-                                                pc_partners[1] = pc;
-                                        if (index == max - 1) {
-                                                pc->pc_partners[1] =
-                                                &ptlrpcds->pd_threads[0];
-                                                ptlrpcds->pd_threads[0].
-                                                pc_partners[0] = pc;
-                                        }
-                                }
-#endif
-                                break;
-                        }
-                }
-        }
+	/* one thread may be blocked in a request interpreter */
+	return max(nthreads, 2);
+}
 
-        RETURN(rc);
+/**
+ * Make all the threads of \a pd partners of each other, in the order of the
+ * threads following each one.
+ */
+static int ptlrpcd_partners(struct ptlrpcd *pd)
+{
+	struct ptlrpcd_ctl	*pc;
+	int			 i;
+	int			 j;
+
+	for (i = 0; i < pd->pd_max_threads; i++) {
+		pc = &pd->pd_threads[i];
+		OBD_CPT_ALLOC(pc->pc_partners, cfs_cpt_table, pd->pd_cpt,
+			      sizeof(pc->pc_partners[0]) *
+			      (pd->pd_max_threads - 1));
+		if (pc->pc_partners == NULL)
+			return -ENOMEM;
+
+		pc->pc_npartners = pd->pd_max_threads - 1;
+		for (j = 0; j < pc->pc_npartners; j++)
+			pc->pc_partners[j] = &pd->pd_threads[(i + j + 1) %
+							     pd->pd_max_threads];
+	}
+	return 0;
 }
 
 #else /* !__KERNEL__ */
@@ -677,10 +836,25 @@ int ptlrpcd_idle(void *arg)
 
 #endif
 
-int ptlrpcd_start(int index, int max, const char *name, struct ptlrpcd_ctl *pc)
+
+/**
+ * Set up \a pc before its thread is started, the threads of a partition are
+ * all set up at once as they are partners of each other.
+ */
+static void ptlrpcd_ctl_init(struct ptlrpcd_ctl *pc, int index, int cpt)
 {
-        int rc;
-        ENTRY;
+	pc->pc_index = index;
+	pc->pc_cpt = cpt;
+	spin_lock_init(&pc->pc_lock);
+	spin_lock_init(&pc->pc_depth_hist.oh_lock);
+	spin_lock_init(&pc->pc_latency_hist.oh_lock);
+}
+
+int ptlrpcd_start(const char *name, struct ptlrpcd_ctl *pc, int wait)
+{
+	struct ptlrpc_request_set *set;
+	int rc;
+	ENTRY;
 
         /*
          * Do not allow start second thread for one pc.
@@ -691,14 +865,19 @@ int ptlrpcd_start(int index, int max, const char *name, struct ptlrpcd_ctl *pc)
 		RETURN(0);
 	}
 
-	pc->pc_index = index;
-	init_completion(&pc->pc_starting);
-	init_completion(&pc->pc_finishing);
-	spin_lock_init(&pc->pc_lock);
-        strncpy(pc->pc_name, name, sizeof(pc->pc_name) - 1);
-        pc->pc_set = ptlrpc_prep_set();
-        if (pc->pc_set == NULL)
-                GOTO(out, rc = -ENOMEM);
+	strncpy(pc->pc_name, name, sizeof(pc->pc_name) - 1);
+	pc->pc_nr_done = 0;
+	pc->pc_nr_stolen = 0;
+	lprocfs_oh_clear(&pc->pc_depth_hist);
+	lprocfs_oh_clear(&pc->pc_latency_hist);
+	set = ptlrpc_prep_set();
+	if (set == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	/* the partners of pc may already look at pc_set */
+	spin_lock(&pc->pc_lock);
+	pc->pc_set = set;
+	spin_unlock(&pc->pc_lock);
 
 #ifndef __KERNEL__
         pc->pc_wait_callback =
@@ -718,34 +897,19 @@ int ptlrpcd_start(int index, int max, const char *name, struct ptlrpcd_ctl *pc)
         if (rc != 0)
 		GOTO(out_set, rc);
 
-	{
-		struct task_struct *task;
-		if (index >= 0) {
-			rc = ptlrpcd_bind(index, max);
-			if (rc < 0)
-				GOTO(out_env, rc);
-		}
-
-		task = kthread_run(ptlrpcd, pc, pc->pc_name);
-		if (IS_ERR(task))
-			GOTO(out_env, rc = PTR_ERR(task));
-
-		wait_for_completion(&pc->pc_starting);
-	}
+	rc = ptlrpcd_run(pc, wait);
+	if (rc != 0)
+		GOTO(out_env, rc);
 	RETURN(0);
 
 out_env:
 	lu_context_fini(&pc->pc_env.le_ctx);
 
 out_set:
-	if (pc->pc_set != NULL) {
-		struct ptlrpc_request_set *set = pc->pc_set;
-
-		spin_lock(&pc->pc_lock);
-		pc->pc_set = NULL;
-		spin_unlock(&pc->pc_lock);
-		ptlrpc_set_destroy(set);
-	}
+	spin_lock(&pc->pc_lock);
+	pc->pc_set = NULL;
+	spin_unlock(&pc->pc_lock);
+	ptlrpc_set_destroy(set);
 	clear_bit(LIOD_BIND, &pc->pc_flags);
 #endif
 out:
@@ -798,35 +962,158 @@ void ptlrpcd_free(struct ptlrpcd_ctl *pc)
 	clear_bit(LIOD_STOP, &pc->pc_flags);
 	clear_bit(LIOD_FORCE, &pc->pc_flags);
 	clear_bit(LIOD_BIND, &pc->pc_flags);
+	clear_bit(LIOD_IDLE, &pc->pc_flags);
 
 out:
-#ifdef __KERNEL__
-        if (pc->pc_npartners > 0) {
-                LASSERT(pc->pc_partners != NULL);
-
-                OBD_FREE(pc->pc_partners,
-                         sizeof(struct ptlrpcd_ctl *) * pc->pc_npartners);
-                pc->pc_partners = NULL;
-        }
-        pc->pc_npartners = 0;
-#endif
         EXIT;
 }
 
+#ifdef LPROCFS
+#define pct(a,b) (b ? a * 100 / b : 0)
+
+static void ptlrpcd_hist_seq_show(struct seq_file *seq, const char *title,
+				  struct obd_histogram *oh)
+{
+	unsigned long tot;
+	unsigned long cum = 0;
+	int i;
+
+	seq_printf(seq, "%-22srpcs   %% cum %%\n", title);
+	tot = lprocfs_oh_sum(oh);
+	for (i = 0; i < OBD_HIST_MAX && cum < tot; i++) {
+		unsigned long n = oh->oh_buckets[i];
+
+		cum += n;
+		seq_printf(seq, "%d:\t\t%10lu %3lu %3lu\n",
+			   (i == 0) ? 0 : 1 << (i - 1),
+			   n, pct(n, tot), pct(cum, tot));
+	}
+}
+#undef pct
+
+static void ptlrpcd_ctl_seq_show(struct seq_file *seq, struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpc_request_set *set = pc->pc_set;
+
+	if (!test_bit(LIOD_START, &pc->pc_flags) || set == NULL)
+		return;
+
+	seq_printf(seq, "\n%s: cpt %d, queued %d, in set %d, "
+		   "done "LPU64", stolen "LPU64"\n",
+		   pc->pc_name, pc->pc_cpt, atomic_read(&set->set_new_count),
+		   atomic_read(&set->set_remaining), pc->pc_nr_done,
+		   pc->pc_nr_stolen);
+	ptlrpcd_hist_seq_show(seq, "rpcs in set", &pc->pc_depth_hist);
+	ptlrpcd_hist_seq_show(seq, "rpc latency (ms)", &pc->pc_latency_hist);
+}
+
+static int ptlrpcd_stats_seq_show(struct seq_file *seq, void *v)
+{
+	struct timeval now;
+	struct ptlrpcd *pd;
+	int nthreads;
+	int i;
+	int j;
+
+	do_gettimeofday(&now);
+	seq_printf(seq, "snapshot_time:         %lu.%lu (secs.usecs)\n",
+		   now.tv_sec, now.tv_usec);
+
+	ptlrpcd_ctl_seq_show(seq, &ptlrpcd_rcv);
+	for (i = 0; i < ptlrpcds_num; i++) {
+		pd = ptlrpcds[i];
+		nthreads = pd->pd_nthreads;
+		smp_rmb(); /* pairs with smp_wmb() in ptlrpcd_grow() */
+		for (j = 0; j < nthreads; j++)
+			ptlrpcd_ctl_seq_show(seq, &pd->pd_threads[j]);
+	}
+	return 0;
+}
+
+static void ptlrpcd_ctl_stats_clear(struct ptlrpcd_ctl *pc)
+{
+	pc->pc_nr_done = 0;
+	pc->pc_nr_stolen = 0;
+	lprocfs_oh_clear(&pc->pc_depth_hist);
+	lprocfs_oh_clear(&pc->pc_latency_hist);
+}
+
+static ssize_t ptlrpcd_stats_seq_write(struct file *file, const char *buf,
+				       size_t len, loff_t *off)
+{
+	struct ptlrpcd *pd;
+	int i;
+	int j;
+
+	ptlrpcd_ctl_stats_clear(&ptlrpcd_rcv);
+	for (i = 0; i < ptlrpcds_num; i++) {
+		pd = ptlrpcds[i];
+		for (j = 0; j < pd->pd_max_threads; j++)
+			ptlrpcd_ctl_stats_clear(&pd->pd_threads[j]);
+	}
+	return len;
+}
+LPROC_SEQ_FOPS(ptlrpcd_stats);
+#endif /* LPROCFS */
+
 static void ptlrpcd_fini(void)
 {
+	struct ptlrpcd *pd;
 	int i;
+	int j;
 	ENTRY;
 
+#ifdef LPROCFS
+	lprocfs_remove_proc_entry("ptlrpcd_stats", proc_lustre_root);
+#endif
+
 	if (ptlrpcds != NULL) {
-		for (i = 0; i < ptlrpcds->pd_nthreads; i++)
-			ptlrpcd_stop(&ptlrpcds->pd_threads[i], 0);
-		for (i = 0; i < ptlrpcds->pd_nthreads; i++)
-			ptlrpcd_free(&ptlrpcds->pd_threads[i]);
-		ptlrpcd_stop(&ptlrpcds->pd_thread_rcv, 0);
-		ptlrpcd_free(&ptlrpcds->pd_thread_rcv);
-		OBD_FREE(ptlrpcds, ptlrpcds->pd_size);
+		for (i = 0; i < ptlrpcds_num && ptlrpcds[i] != NULL; i++) {
+			pd = ptlrpcds[i];
+#ifdef __KERNEL__
+			/* let a thread being started by ptlrpcd_grow() be
+			 * counted in pd_nthreads, and start no other one */
+			spin_lock(&pd->pd_lock);
+			pd->pd_stopping = 1;
+			while (pd->pd_growing) {
+				spin_unlock(&pd->pd_lock);
+				schedule_timeout_and_set_state(
+					TASK_UNINTERRUPTIBLE,
+					cfs_time_seconds(1) / 10);
+				spin_lock(&pd->pd_lock);
+			}
+			spin_unlock(&pd->pd_lock);
+#endif
+			/* the threads stopped when idle have exited, but
+			 * their sets are still to be freed */
+			for (j = 0; j < pd->pd_nthreads; j++)
+				ptlrpcd_stop(&pd->pd_threads[j], 0);
+			for (j = 0; j < pd->pd_max_threads; j++) {
+				struct ptlrpcd_ctl *pc = &pd->pd_threads[j];
+
+				if (test_bit(LIOD_START, &pc->pc_flags))
+					ptlrpcd_free(pc);
+			}
+			pd->pd_nthreads = 0;
+			for (j = 0; j < pd->pd_max_threads; j++) {
+				struct ptlrpcd_ctl *pc = &pd->pd_threads[j];
+
+				if (pc->pc_partners != NULL)
+					OBD_FREE(pc->pc_partners,
+						 sizeof(pc->pc_partners[0]) *
+						 (pd->pd_max_threads - 1));
+			}
+			OBD_FREE(pd, pd->pd_size);
+			ptlrpcds[i] = NULL;
+		}
+		OBD_FREE(ptlrpcds, sizeof(ptlrpcds[0]) * ptlrpcds_num);
 		ptlrpcds = NULL;
+		ptlrpcds_num = 0;
+	}
+
+	if (test_bit(LIOD_START, &ptlrpcd_rcv.pc_flags)) {
+		ptlrpcd_stop(&ptlrpcd_rcv, 0);
+		ptlrpcd_free(&ptlrpcd_rcv);
 	}
 
 	EXIT;
@@ -834,71 +1121,85 @@ static void ptlrpcd_fini(void)
 
 static int ptlrpcd_init(void)
 {
-	int	nthreads = num_online_cpus();
-	char	name[16];
-	int	size, i = -1, j, rc = 0;
+	struct ptlrpcd	*pd;
+	char		 name[16];
+	int		 ncpts;
+	int		 nthreads;
+	int		 size;
+	int		 i;
+	int		 j;
+	int		 rc = 0;
 	ENTRY;
 
+	memset(&ptlrpcd_rcv, 0, sizeof(ptlrpcd_rcv));
+	ptlrpcd_ctl_init(&ptlrpcd_rcv, -1, -1);
+	set_bit(LIOD_RECOVERY, &ptlrpcd_rcv.pc_flags);
+	rc = ptlrpcd_start("ptlrpcd_rcv", &ptlrpcd_rcv, 1);
+	if (rc < 0)
+		RETURN(rc);
+
 #ifdef __KERNEL__
-        if (max_ptlrpcds > 0 && max_ptlrpcds < nthreads)
-                nthreads = max_ptlrpcds;
-        if (nthreads < 2)
-                nthreads = 2;
-        if (nthreads < 3 && ptlrpcd_bind_policy == PDB_POLICY_NEIGHBOR)
-                ptlrpcd_bind_policy = PDB_POLICY_PAIR;
-        else if (nthreads % 2 != 0 && ptlrpcd_bind_policy == PDB_POLICY_PAIR)
-                nthreads &= ~1; /* make sure it is even */
+	ncpts = cfs_cpt_number(cfs_cpt_table);
 #else
-        nthreads = 1;
+	ncpts = 1;
 #endif
+	OBD_ALLOC(ptlrpcds, sizeof(ptlrpcds[0]) * ncpts);
+	if (ptlrpcds == NULL)
+		GOTO(out, rc = -ENOMEM);
+	ptlrpcds_num = ncpts;
 
-        size = offsetof(struct ptlrpcd, pd_threads[nthreads]);
-        OBD_ALLOC(ptlrpcds, size);
-        if (ptlrpcds == NULL)
-                GOTO(out, rc = -ENOMEM);
-
-        snprintf(name, 15, "ptlrpcd_rcv");
-	set_bit(LIOD_RECOVERY, &ptlrpcds->pd_thread_rcv.pc_flags);
-        rc = ptlrpcd_start(-1, nthreads, name, &ptlrpcds->pd_thread_rcv);
-        if (rc < 0)
-                GOTO(out, rc);
-
-        /* XXX: We start nthreads ptlrpc daemons. Each of them can process any
-         *      non-recovery async RPC to improve overall async RPC efficiency.
-         *
-         *      But there are some issues with async I/O RPCs and async non-I/O
-         *      RPCs processed in the same set under some cases. The ptlrpcd may
-         *      be blocked by some async I/O RPC(s), then will cause other async
-         *      non-I/O RPC(s) can not be processed in time.
-         *
-         *      Maybe we should distinguish blocked async RPCs from non-blocked
-         *      async RPCs, and process them in different ptlrpcd sets to avoid
-         *      unnecessary dependency. But how to distribute async RPCs load
-         *      among all the ptlrpc daemons becomes another trouble. */
-        for (i = 0; i < nthreads; i++) {
-                snprintf(name, 15, "ptlrpcd_%d", i);
-                rc = ptlrpcd_start(i, nthreads, name, &ptlrpcds->pd_threads[i]);
-                if (rc < 0)
-                        GOTO(out, rc);
-        }
+	for (i = 0; i < ncpts; i++) {
+#ifdef __KERNEL__
+		nthreads = ptlrpcd_pool_size(i, ncpts);
+#else
+		nthreads = 1;
+#endif
+		size = offsetof(struct ptlrpcd, pd_threads[nthreads]);
+		OBD_CPT_ALLOC(pd, cfs_cpt_table, i, size);
+		if (pd == NULL)
+			GOTO(out, rc = -ENOMEM);
+
+		pd->pd_size = size;
+		pd->pd_index = 0;
+		pd->pd_cpt = i;
+		spin_lock_init(&pd->pd_lock);
+		pd->pd_max_threads = nthreads;
+		ptlrpcds[i] = pd;
+		for (j = 0; j < nthreads; j++)
+			ptlrpcd_ctl_init(&pd->pd_threads[j], j, i);
 
-        ptlrpcds->pd_size = size;
-        ptlrpcds->pd_index = 0;
-        ptlrpcds->pd_nthreads = nthreads;
+#ifdef __KERNEL__
+		rc = ptlrpcd_partners(pd);
+		if (rc < 0)
+			GOTO(out, rc);
+
+		if (ptlrpcd_per_cpt_min > 0 && ptlrpcd_per_cpt_min < nthreads)
+			nthreads = ptlrpcd_per_cpt_min;
+#endif
+		for (j = 0; j < nthreads; j++) {
+			snprintf(name, sizeof(name), "ptlrpcd_%02d_%02d", i, j);
+			rc = ptlrpcd_start(name, &pd->pd_threads[j], 1);
+			if (rc < 0)
+				GOTO(out, rc);
+			pd->pd_nthreads++;
+		}
+		pd->pd_min_threads = pd->pd_nthreads;
+	}
 
+#ifdef LPROCFS
+	rc = lprocfs_seq_create(proc_lustre_root, "ptlrpcd_stats", 0644,
+				&ptlrpcd_stats_fops, NULL);
+	if (rc != 0) {
+		CWARN("cannot create ptlrpcd_stats: rc = %d\n", rc);
+		rc = 0;
+	}
+#endif
+	EXIT;
 out:
-        if (rc != 0 && ptlrpcds != NULL) {
-                for (j = 0; j <= i; j++)
-                        ptlrpcd_stop(&ptlrpcds->pd_threads[j], 0);
-		for (j = 0; j <= i; j++)
-			ptlrpcd_free(&ptlrpcds->pd_threads[j]);
-		ptlrpcd_stop(&ptlrpcds->pd_thread_rcv, 0);
-		ptlrpcd_free(&ptlrpcds->pd_thread_rcv);
-                OBD_FREE(ptlrpcds, size);
-                ptlrpcds = NULL;
-        }
+	if (rc != 0)
+		ptlrpcd_fini();
 
-	RETURN(rc);
+	return rc;
 }
 
 int ptlrpcd_addref(void)
@@ -2180,6 +2180,7 @@ void sptlrpc_svc_free_rs(struct ptlrpc_reply_state *rs)
 {
         struct ptlrpc_sec_policy *policy;
         unsigned int prealloc;
+	unsigned int cached;
         ENTRY;
 
         LASSERT(rs->rs_svc_ctx);
@@ -2189,9 +2190,12 @@ void sptlrpc_svc_free_rs(struct ptlrpc_reply_state *rs)
         LASSERT(policy->sp_sops->free_rs);
 
         prealloc = rs->rs_prealloc;
+	cached = rs->rs_cached;
         policy->sp_sops->free_rs(rs);
 
-        if (prealloc)
+	if (cached)
+		lustre_put_cached_rs(rs);
+	else if (prealloc)
                 lustre_put_emerg_rs(rs);
         EXIT;
 }
@@ -73,12 +73,19 @@
 
 #define CACHE_QUIESCENT_PERIOD  (20)
 
-static struct ptlrpc_enc_page_pool {
+/*
+ * One pool per CPU partition, so that the bulk RPCs of different partitions
+ * do not serialize on a single lock and wait queue. The pages of a pool are
+ * allocated on the memory node of its partition, and return to it when the
+ * bulk descriptor is freed.
+ */
+struct ptlrpc_enc_page_pool {
         /*
          * constants
          */
         unsigned long    epp_max_pages;   /* maximum pages can hold, const */
         unsigned int     epp_max_pools;   /* number of pools, const */
+	int		 epp_cpt;	  /* CPU partition, const */
 
 	/*
 	 * wait queue in case of not enough free pages.
@@ -87,6 +94,7 @@ static struct ptlrpc_enc_page_pool {
 	unsigned int     epp_waitqlen;    /* wait queue length */
 	unsigned long    epp_pages_short; /* # of pages wanted of in-q users */
 	unsigned int     epp_growing:1;   /* during adding pages */
+	struct mutex	 epp_add_mutex;   /* serialize adding pages */
 
         /*
          * indicating how idle the pools are, from 0 to MAX_IDLE_IDX
@@ -124,7 +132,13 @@ static struct ptlrpc_enc_page_pool {
 	 * pointers to pools
 	 */
 	struct page    ***epp_pools;
-} page_pools;
+};
+
+static struct ptlrpc_enc_page_pool **page_pools;
+static int page_pools_num;
+
+#define for_each_enc_pool(pool, i)					\
+	for (i = 0; i < page_pools_num && ((pool) = page_pools[i]) != NULL; i++)
 
 /*
  * memory shrinker
@@ -138,83 +152,89 @@ static struct shrinker *pools_shrinker;
  */
 int sptlrpc_proc_enc_pool_seq_show(struct seq_file *m, void *v)
 {
-        int     rc;
-
-	spin_lock(&page_pools.epp_lock);
-
-	rc = seq_printf(m,
-                      "physical pages:          %lu\n"
-                      "pages per pool:          %lu\n"
-                      "max pages:               %lu\n"
-                      "max pools:               %u\n"
-                      "total pages:             %lu\n"
-                      "total free:              %lu\n"
-                      "idle index:              %lu/100\n"
-                      "last shrink:             %lds\n"
-                      "last access:             %lds\n"
-                      "max pages reached:       %lu\n"
-                      "grows:                   %u\n"
-                      "grows failure:           %u\n"
-                      "shrinks:                 %u\n"
-                      "cache access:            %lu\n"
-                      "cache missing:           %lu\n"
-                      "low free mark:           %lu\n"
-                      "max waitqueue depth:     %u\n"
-                      "max wait time:           "CFS_TIME_T"/%u\n"
-                      ,
-		      totalram_pages,
-                      PAGES_PER_POOL,
-                      page_pools.epp_max_pages,
-                      page_pools.epp_max_pools,
-                      page_pools.epp_total_pages,
-                      page_pools.epp_free_pages,
-                      page_pools.epp_idle_idx,
-                      cfs_time_current_sec() - page_pools.epp_last_shrink,
-                      cfs_time_current_sec() - page_pools.epp_last_access,
-                      page_pools.epp_st_max_pages,
-                      page_pools.epp_st_grows,
-                      page_pools.epp_st_grow_fails,
-                      page_pools.epp_st_shrinks,
-                      page_pools.epp_st_access,
-		      page_pools.epp_st_missings,
-		      page_pools.epp_st_lowfree,
-		      page_pools.epp_st_max_wqlen,
-		      page_pools.epp_st_max_wait, HZ
-		     );
-
-	spin_unlock(&page_pools.epp_lock);
-	return rc;
+	struct ptlrpc_enc_page_pool *pool;
+	int	i;
+
+	seq_printf(m, "physical pages:          %lu\n"
+		      "pages per pool:          %lu\n",
+		   totalram_pages, PAGES_PER_POOL);
+
+	for_each_enc_pool(pool, i) {
+		spin_lock(&pool->epp_lock);
+
+		seq_printf(m,
+			      "cpt:                     %d\n"
+			      "max pages:               %lu\n"
+			      "max pools:               %u\n"
+			      "total pages:             %lu\n"
+			      "total free:              %lu\n"
+			      "idle index:              %lu/100\n"
+			      "last shrink:             %lds\n"
+			      "last access:             %lds\n"
+			      "max pages reached:       %lu\n"
+			      "grows:                   %u\n"
+			      "grows failure:           %u\n"
+			      "shrinks:                 %u\n"
+			      "cache access:            %lu\n"
+			      "cache missing:           %lu\n"
+			      "low free mark:           %lu\n"
+			      "max waitqueue depth:     %u\n"
+			      "max wait time:           "CFS_TIME_T"/%u\n"
+			      ,
+			      pool->epp_cpt,
+			      pool->epp_max_pages,
+			      pool->epp_max_pools,
+			      pool->epp_total_pages,
+			      pool->epp_free_pages,
+			      pool->epp_idle_idx,
+			      cfs_time_current_sec() - pool->epp_last_shrink,
+			      cfs_time_current_sec() - pool->epp_last_access,
+			      pool->epp_st_max_pages,
+			      pool->epp_st_grows,
+			      pool->epp_st_grow_fails,
+			      pool->epp_st_shrinks,
+			      pool->epp_st_access,
+			      pool->epp_st_missings,
+			      pool->epp_st_lowfree,
+			      pool->epp_st_max_wqlen,
+			      pool->epp_st_max_wait, HZ
+			     );
+
+		spin_unlock(&pool->epp_lock);
+	}
+	return 0;
 }
 
-static void enc_pools_release_free_pages(long npages)
+static void enc_pools_release_free_pages(struct ptlrpc_enc_page_pool *pool,
+					 long npages)
 {
         int     p_idx, g_idx;
         int     p_idx_max1, p_idx_max2;
 
         LASSERT(npages > 0);
-        LASSERT(npages <= page_pools.epp_free_pages);
-        LASSERT(page_pools.epp_free_pages <= page_pools.epp_total_pages);
+        LASSERT(npages <= pool->epp_free_pages);
+        LASSERT(pool->epp_free_pages <= pool->epp_total_pages);
 
         /* max pool index before the release */
-        p_idx_max2 = (page_pools.epp_total_pages - 1) / PAGES_PER_POOL;
+        p_idx_max2 = (pool->epp_total_pages - 1) / PAGES_PER_POOL;
 
-        page_pools.epp_free_pages -= npages;
-        page_pools.epp_total_pages -= npages;
+        pool->epp_free_pages -= npages;
+        pool->epp_total_pages -= npages;
 
         /* max pool index after the release */
-        p_idx_max1 = page_pools.epp_total_pages == 0 ? -1 :
-                     ((page_pools.epp_total_pages - 1) / PAGES_PER_POOL);
+        p_idx_max1 = pool->epp_total_pages == 0 ? -1 :
+                     ((pool->epp_total_pages - 1) / PAGES_PER_POOL);
 
-        p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-        g_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
-        LASSERT(page_pools.epp_pools[p_idx]);
+        p_idx = pool->epp_free_pages / PAGES_PER_POOL;
+        g_idx = pool->epp_free_pages % PAGES_PER_POOL;
+        LASSERT(pool->epp_pools[p_idx]);
 
         while (npages--) {
-                LASSERT(page_pools.epp_pools[p_idx]);
-                LASSERT(page_pools.epp_pools[p_idx][g_idx] != NULL);
+                LASSERT(pool->epp_pools[p_idx]);
+                LASSERT(pool->epp_pools[p_idx][g_idx] != NULL);
 
-		__free_page(page_pools.epp_pools[p_idx][g_idx]);
-                page_pools.epp_pools[p_idx][g_idx] = NULL;
+		__free_page(pool->epp_pools[p_idx][g_idx]);
+                pool->epp_pools[p_idx][g_idx] = NULL;
 
                 if (++g_idx == PAGES_PER_POOL) {
                         p_idx++;
@@ -224,52 +244,77 @@ static void enc_pools_release_free_pages(long npages)
 
         /* free unused pools */
         while (p_idx_max1 < p_idx_max2) {
-                LASSERT(page_pools.epp_pools[p_idx_max2]);
-		OBD_FREE(page_pools.epp_pools[p_idx_max2], PAGE_CACHE_SIZE);
-                page_pools.epp_pools[p_idx_max2] = NULL;
+                LASSERT(pool->epp_pools[p_idx_max2]);
+		OBD_FREE(pool->epp_pools[p_idx_max2], PAGE_CACHE_SIZE);
+                pool->epp_pools[p_idx_max2] = NULL;
                 p_idx_max2--;
         }
 }
 
 /*
- * could be called frequently for query (@nr_to_scan == 0).
+ * release up to @nr_to_scan free pages of @pool, and return how many of its
+ * pages can be released. each pool is shrunk on its own idle index.
  * we try to keep at least PTLRPC_MAX_BRW_PAGES pages in the pool.
  */
-static int enc_pools_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+static int enc_pool_shrink(struct ptlrpc_enc_page_pool *pool, long nr_to_scan)
 {
-	if (unlikely(shrink_param(sc, nr_to_scan) != 0)) {
-		spin_lock(&page_pools.epp_lock);
-                shrink_param(sc, nr_to_scan) = min_t(unsigned long,
-                                                   shrink_param(sc, nr_to_scan),
-                                                   page_pools.epp_free_pages -
-                                                   PTLRPC_MAX_BRW_PAGES);
-                if (shrink_param(sc, nr_to_scan) > 0) {
-                        enc_pools_release_free_pages(shrink_param(sc,
-                                                                  nr_to_scan));
-                        CDEBUG(D_SEC, "released %ld pages, %ld left\n",
-                               (long)shrink_param(sc, nr_to_scan),
-                               page_pools.epp_free_pages);
-
-                        page_pools.epp_st_shrinks++;
-                        page_pools.epp_last_shrink = cfs_time_current_sec();
+	if (unlikely(nr_to_scan != 0)) {
+		spin_lock(&pool->epp_lock);
+		nr_to_scan = min_t(long, nr_to_scan,
+				   (long)pool->epp_free_pages -
+				   PTLRPC_MAX_BRW_PAGES);
+		if (nr_to_scan > 0) {
+			enc_pools_release_free_pages(pool, nr_to_scan);
+			CDEBUG(D_SEC, "cpt %d: released %ld pages, %ld left\n",
+			       pool->epp_cpt, nr_to_scan,
+			       pool->epp_free_pages);
+
+                        pool->epp_st_shrinks++;
+                        pool->epp_last_shrink = cfs_time_current_sec();
                 }
-		spin_unlock(&page_pools.epp_lock);
+		spin_unlock(&pool->epp_lock);
 	}
 
 	/*
 	 * if no pool access for a long time, we consider it's fully idle.
 	 * a little race here is fine.
 	 */
-	if (unlikely(cfs_time_current_sec() - page_pools.epp_last_access >
+	if (unlikely(cfs_time_current_sec() - pool->epp_last_access >
 		     CACHE_QUIESCENT_PERIOD)) {
-		spin_lock(&page_pools.epp_lock);
-		page_pools.epp_idle_idx = IDLE_IDX_MAX;
-		spin_unlock(&page_pools.epp_lock);
+		spin_lock(&pool->epp_lock);
+		pool->epp_idle_idx = IDLE_IDX_MAX;
+		spin_unlock(&pool->epp_lock);
 	}
 
-	LASSERT(page_pools.epp_idle_idx <= IDLE_IDX_MAX);
-	return max((int)page_pools.epp_free_pages - PTLRPC_MAX_BRW_PAGES, 0) *
-		(IDLE_IDX_MAX - page_pools.epp_idle_idx) / IDLE_IDX_MAX;
+	LASSERT(pool->epp_idle_idx <= IDLE_IDX_MAX);
+	return max((int)pool->epp_free_pages - PTLRPC_MAX_BRW_PAGES, 0) *
+		(IDLE_IDX_MAX - pool->epp_idle_idx) / IDLE_IDX_MAX;
+}
+
+/*
+ * could be called frequently for query (@nr_to_scan == 0).
+ * the pages to scan are spread over the pools by their reclaimable pages.
+ */
+static int enc_pools_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+{
+	struct ptlrpc_enc_page_pool *pool;
+	long	nr = shrink_param(sc, nr_to_scan);
+	int	total = 0;
+	int	count;
+	int	i;
+
+	for_each_enc_pool(pool, i) {
+		if (nr > 0) {
+			count = enc_pool_shrink(pool, 0);
+			if (count == 0)
+				continue;
+			count = min_t(long, nr, count);
+			enc_pool_shrink(pool, count);
+			nr -= count;
+		}
+		total += enc_pool_shrink(pool, 0);
+	}
+	return total;
 }
 
 static inline
@@ -309,39 +354,40 @@ static unsigned long enc_pools_cleanup(struct page ***pools, int npools)
  * we have options to avoid most memory copy with some tricks. but we choose
  * the simplest way to avoid complexity. It's not frequently called.
  */
-static void enc_pools_insert(struct page ***pools, int npools, int npages)
+static void enc_pools_insert(struct ptlrpc_enc_page_pool *pool,
+			     struct page ***pools, int npools, int npages)
 {
         int     freeslot;
         int     op_idx, np_idx, og_idx, ng_idx;
         int     cur_npools, end_npools;
 
         LASSERT(npages > 0);
-        LASSERT(page_pools.epp_total_pages+npages <= page_pools.epp_max_pages);
+        LASSERT(pool->epp_total_pages+npages <= pool->epp_max_pages);
         LASSERT(npages_to_npools(npages) == npools);
-        LASSERT(page_pools.epp_growing);
+        LASSERT(pool->epp_growing);
 
-	spin_lock(&page_pools.epp_lock);
+	spin_lock(&pool->epp_lock);
 
         /*
          * (1) fill all the free slots of current pools.
          */
         /* free slots are those left by rent pages, and the extra ones with
          * index >= total_pages, locate at the tail of last pool. */
-        freeslot = page_pools.epp_total_pages % PAGES_PER_POOL;
+        freeslot = pool->epp_total_pages % PAGES_PER_POOL;
         if (freeslot != 0)
                 freeslot = PAGES_PER_POOL - freeslot;
-        freeslot += page_pools.epp_total_pages - page_pools.epp_free_pages;
+        freeslot += pool->epp_total_pages - pool->epp_free_pages;
 
-        op_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-        og_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
+        op_idx = pool->epp_free_pages / PAGES_PER_POOL;
+        og_idx = pool->epp_free_pages % PAGES_PER_POOL;
         np_idx = npools - 1;
         ng_idx = (npages - 1) % PAGES_PER_POOL;
 
         while (freeslot) {
-                LASSERT(page_pools.epp_pools[op_idx][og_idx] == NULL);
+                LASSERT(pool->epp_pools[op_idx][og_idx] == NULL);
                 LASSERT(pools[np_idx][ng_idx] != NULL);
 
-                page_pools.epp_pools[op_idx][og_idx] = pools[np_idx][ng_idx];
+                pool->epp_pools[op_idx][og_idx] = pools[np_idx][ng_idx];
                 pools[np_idx][ng_idx] = NULL;
 
                 freeslot--;
@@ -361,38 +407,37 @@ static void enc_pools_insert(struct page ***pools, int npools, int npages)
         /*
          * (2) add pools if needed.
          */
-        cur_npools = (page_pools.epp_total_pages + PAGES_PER_POOL - 1) /
+        cur_npools = (pool->epp_total_pages + PAGES_PER_POOL - 1) /
                      PAGES_PER_POOL;
-        end_npools = (page_pools.epp_total_pages + npages + PAGES_PER_POOL -1) /
+        end_npools = (pool->epp_total_pages + npages + PAGES_PER_POOL -1) /
                      PAGES_PER_POOL;
-        LASSERT(end_npools <= page_pools.epp_max_pools);
+        LASSERT(end_npools <= pool->epp_max_pools);
 
         np_idx = 0;
         while (cur_npools < end_npools) {
-                LASSERT(page_pools.epp_pools[cur_npools] == NULL);
+                LASSERT(pool->epp_pools[cur_npools] == NULL);
                 LASSERT(np_idx < npools);
                 LASSERT(pools[np_idx] != NULL);
 
-                page_pools.epp_pools[cur_npools++] = pools[np_idx];
+                pool->epp_pools[cur_npools++] = pools[np_idx];
                 pools[np_idx++] = NULL;
         }
 
-        page_pools.epp_total_pages += npages;
-        page_pools.epp_free_pages += npages;
-        page_pools.epp_st_lowfree = page_pools.epp_free_pages;
+        pool->epp_total_pages += npages;
+        pool->epp_free_pages += npages;
+        pool->epp_st_lowfree = pool->epp_free_pages;
 
-        if (page_pools.epp_total_pages > page_pools.epp_st_max_pages)
-                page_pools.epp_st_max_pages = page_pools.epp_total_pages;
+        if (pool->epp_total_pages > pool->epp_st_max_pages)
+                pool->epp_st_max_pages = pool->epp_total_pages;
 
         CDEBUG(D_SEC, "add %d pages to total %lu\n", npages,
-               page_pools.epp_total_pages);
+               pool->epp_total_pages);
 
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 }
 
-static int enc_pools_add_pages(int npages)
+static int enc_pools_add_pages(struct ptlrpc_enc_page_pool *pool, int npages)
 {
-	static DEFINE_MUTEX(add_pages_mutex);
 	struct page   ***pools;
 	int             npools, alloced = 0;
 	int             i, j, rc = -ENOMEM;
@@ -400,13 +445,13 @@ static int enc_pools_add_pages(int npages)
 	if (npages < PTLRPC_MAX_BRW_PAGES)
 		npages = PTLRPC_MAX_BRW_PAGES;
 
-	mutex_lock(&add_pages_mutex);
+	mutex_lock(&pool->epp_add_mutex);
 
-        if (npages + page_pools.epp_total_pages > page_pools.epp_max_pages)
-                npages = page_pools.epp_max_pages - page_pools.epp_total_pages;
+        if (npages + pool->epp_total_pages > pool->epp_max_pages)
+                npages = pool->epp_max_pages - pool->epp_total_pages;
         LASSERT(npages > 0);
 
-        page_pools.epp_st_grows++;
+        pool->epp_st_grows++;
 
         npools = npages_to_npools(npages);
         OBD_ALLOC(pools, npools * sizeof(*pools));
@@ -414,13 +459,16 @@ static int enc_pools_add_pages(int npages)
                 goto out;
 
 	for (i = 0; i < npools; i++) {
-		OBD_ALLOC(pools[i], PAGE_CACHE_SIZE);
+		OBD_CPT_ALLOC(pools[i], cfs_cpt_table, pool->epp_cpt,
+			      PAGE_CACHE_SIZE);
 		if (pools[i] == NULL)
 			goto out_pools;
 
 		for (j = 0; j < PAGES_PER_POOL && alloced < npages; j++) {
-			pools[i][j] = alloc_page(GFP_NOFS |
-						 __GFP_HIGHMEM);
+			pools[i][j] = cfs_page_cpt_alloc(cfs_cpt_table,
+							 pool->epp_cpt,
+							 GFP_NOFS |
+							 __GFP_HIGHMEM);
 			if (pools[i][j] == NULL)
 				goto out_pools;
 
@@ -429,7 +477,7 @@ static int enc_pools_add_pages(int npages)
 	}
 	LASSERT(alloced == npages);
 
-        enc_pools_insert(pools, npools, npages);
+        enc_pools_insert(pool, pools, npools, npages);
         CDEBUG(D_SEC, "added %d pages into pools\n", npages);
         rc = 0;
 
@@ -438,35 +486,37 @@ out_pools:
         OBD_FREE(pools, npools * sizeof(*pools));
 out:
         if (rc) {
-                page_pools.epp_st_grow_fails++;
-                CERROR("Failed to allocate %d enc pages\n", npages);
+                pool->epp_st_grow_fails++;
+		CERROR("cpt %d: failed to allocate %d enc pages\n",
+		       pool->epp_cpt, npages);
         }
 
-	mutex_unlock(&add_pages_mutex);
+	mutex_unlock(&pool->epp_add_mutex);
         return rc;
 }
 
-static inline void enc_pools_wakeup(void)
+static inline void enc_pools_wakeup(struct ptlrpc_enc_page_pool *pool)
 {
-	assert_spin_locked(&page_pools.epp_lock);
+	assert_spin_locked(&pool->epp_lock);
 
-	if (unlikely(page_pools.epp_waitqlen)) {
-		LASSERT(waitqueue_active(&page_pools.epp_waitq));
-		wake_up_all(&page_pools.epp_waitq);
+	if (unlikely(pool->epp_waitqlen)) {
+		LASSERT(waitqueue_active(&pool->epp_waitq));
+		wake_up_all(&pool->epp_waitq);
 	}
 }
 
-static int enc_pools_should_grow(int page_needed, long now)
+static int enc_pools_should_grow(struct ptlrpc_enc_page_pool *pool,
+				 int page_needed, long now)
 {
         /* don't grow if someone else is growing the pools right now,
          * or the pools has reached its full capacity
          */
-        if (page_pools.epp_growing ||
-            page_pools.epp_total_pages == page_pools.epp_max_pages)
+        if (pool->epp_growing ||
+            pool->epp_total_pages == pool->epp_max_pages)
                 return 0;
 
         /* if total pages is not enough, we need to grow */
-        if (page_pools.epp_total_pages < page_needed)
+        if (pool->epp_total_pages < page_needed)
                 return 1;
 
         /*
@@ -475,7 +525,7 @@ static int enc_pools_should_grow(int page_needed, long now)
          * live on single node.
          */
 #if 0
-        if (now - page_pools.epp_last_shrink < 2)
+        if (now - pool->epp_last_shrink < 2)
                 return 0;
 #endif
 
@@ -493,6 +543,7 @@ static int enc_pools_should_grow(int page_needed, long now)
  */
 int sptlrpc_enc_pool_get_pages(struct ptlrpc_bulk_desc *desc)
 {
+	struct ptlrpc_enc_page_pool *pool;
 	wait_queue_t  waitlink;
 	unsigned long   this_idle = -1;
 	cfs_time_t      tick = 0;
@@ -500,61 +551,67 @@ int sptlrpc_enc_pool_get_pages(struct ptlrpc_bulk_desc *desc)
 	int             p_idx, g_idx;
 	int             i;
 
-	LASSERT(desc->bd_iov_count > 0);
-	LASSERT(desc->bd_iov_count <= page_pools.epp_max_pages);
-
 	/* resent bulk, enc iov might have been allocated previously */
 	if (desc->bd_enc_iov != NULL)
 		return 0;
 
+	/* the pool of the CPU partition the bulk is processed in */
+	desc->bd_enc_cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	if (desc->bd_enc_cpt < 0 || desc->bd_enc_cpt >= page_pools_num)
+		desc->bd_enc_cpt = 0;
+	pool = page_pools[desc->bd_enc_cpt];
+
+	LASSERT(desc->bd_iov_count > 0);
+	LASSERT(desc->bd_iov_count <= pool->epp_max_pages);
+
 	OBD_ALLOC(desc->bd_enc_iov,
 		  desc->bd_iov_count * sizeof(*desc->bd_enc_iov));
 	if (desc->bd_enc_iov == NULL)
 		return -ENOMEM;
 
-	spin_lock(&page_pools.epp_lock);
+	spin_lock(&pool->epp_lock);
 
-	page_pools.epp_st_access++;
+	pool->epp_st_access++;
 again:
-	if (unlikely(page_pools.epp_free_pages < desc->bd_iov_count)) {
+	if (unlikely(pool->epp_free_pages < desc->bd_iov_count)) {
 		if (tick == 0)
 			tick = cfs_time_current();
 
 		now = cfs_time_current_sec();
 
-		page_pools.epp_st_missings++;
-		page_pools.epp_pages_short += desc->bd_iov_count;
+		pool->epp_st_missings++;
+		pool->epp_pages_short += desc->bd_iov_count;
 
-		if (enc_pools_should_grow(desc->bd_iov_count, now)) {
-			page_pools.epp_growing = 1;
+		if (enc_pools_should_grow(pool, desc->bd_iov_count, now)) {
+			pool->epp_growing = 1;
 
-			spin_unlock(&page_pools.epp_lock);
-			enc_pools_add_pages(page_pools.epp_pages_short / 2);
-			spin_lock(&page_pools.epp_lock);
+			spin_unlock(&pool->epp_lock);
+			enc_pools_add_pages(pool, pool->epp_pages_short / 2);
+			spin_lock(&pool->epp_lock);
 
-			page_pools.epp_growing = 0;
+			pool->epp_growing = 0;
 
-			enc_pools_wakeup();
+			enc_pools_wakeup(pool);
 		} else {
-			if (++page_pools.epp_waitqlen >
-			    page_pools.epp_st_max_wqlen)
-				page_pools.epp_st_max_wqlen =
-						page_pools.epp_waitqlen;
+			if (++pool->epp_waitqlen >
+			    pool->epp_st_max_wqlen)
+				pool->epp_st_max_wqlen =
+						pool->epp_waitqlen;
 
 			set_current_state(TASK_UNINTERRUPTIBLE);
 			init_waitqueue_entry_current(&waitlink);
-			add_wait_queue(&page_pools.epp_waitq, &waitlink);
+			add_wait_queue(&pool->epp_waitq, &waitlink);
 
-			spin_unlock(&page_pools.epp_lock);
+			spin_unlock(&pool->epp_lock);
 			waitq_wait(&waitlink, TASK_UNINTERRUPTIBLE);
-			remove_wait_queue(&page_pools.epp_waitq, &waitlink);
-			LASSERT(page_pools.epp_waitqlen > 0);
-			spin_lock(&page_pools.epp_lock);
-			page_pools.epp_waitqlen--;
+			remove_wait_queue(&pool->epp_waitq, &waitlink);
+			LASSERT(pool->epp_waitqlen > 0);
+			spin_lock(&pool->epp_lock);
+			pool->epp_waitqlen--;
 		}
 
-		LASSERT(page_pools.epp_pages_short >= desc->bd_iov_count);
-		page_pools.epp_pages_short -= desc->bd_iov_count;
+		LASSERT(pool->epp_pages_short >= desc->bd_iov_count);
+		pool->epp_pages_short -= desc->bd_iov_count;
 
 		this_idle = 0;
 		goto again;
@@ -563,21 +620,21 @@ again:
         /* record max wait time */
         if (unlikely(tick != 0)) {
                 tick = cfs_time_current() - tick;
-                if (tick > page_pools.epp_st_max_wait)
-                        page_pools.epp_st_max_wait = tick;
+                if (tick > pool->epp_st_max_wait)
+                        pool->epp_st_max_wait = tick;
         }
 
         /* proceed with rest of allocation */
-        page_pools.epp_free_pages -= desc->bd_iov_count;
+        pool->epp_free_pages -= desc->bd_iov_count;
 
-        p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-        g_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
+        p_idx = pool->epp_free_pages / PAGES_PER_POOL;
+        g_idx = pool->epp_free_pages % PAGES_PER_POOL;
 
         for (i = 0; i < desc->bd_iov_count; i++) {
-                LASSERT(page_pools.epp_pools[p_idx][g_idx] != NULL);
+                LASSERT(pool->epp_pools[p_idx][g_idx] != NULL);
                 desc->bd_enc_iov[i].kiov_page =
-                                        page_pools.epp_pools[p_idx][g_idx];
-                page_pools.epp_pools[p_idx][g_idx] = NULL;
+                                        pool->epp_pools[p_idx][g_idx];
+                pool->epp_pools[p_idx][g_idx] = NULL;
 
                 if (++g_idx == PAGES_PER_POOL) {
                         p_idx++;
@@ -585,29 +642,30 @@ again:
                 }
         }
 
-        if (page_pools.epp_free_pages < page_pools.epp_st_lowfree)
-                page_pools.epp_st_lowfree = page_pools.epp_free_pages;
+        if (pool->epp_free_pages < pool->epp_st_lowfree)
+                pool->epp_st_lowfree = pool->epp_free_pages;
 
         /*
          * new idle index = (old * weight + new) / (weight + 1)
          */
         if (this_idle == -1) {
-                this_idle = page_pools.epp_free_pages * IDLE_IDX_MAX /
-                            page_pools.epp_total_pages;
+                this_idle = pool->epp_free_pages * IDLE_IDX_MAX /
+                            pool->epp_total_pages;
         }
-        page_pools.epp_idle_idx = (page_pools.epp_idle_idx * IDLE_IDX_WEIGHT +
+        pool->epp_idle_idx = (pool->epp_idle_idx * IDLE_IDX_WEIGHT +
                                    this_idle) /
                                   (IDLE_IDX_WEIGHT + 1);
 
-        page_pools.epp_last_access = cfs_time_current_sec();
+        pool->epp_last_access = cfs_time_current_sec();
 
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 	return 0;
 }
 EXPORT_SYMBOL(sptlrpc_enc_pool_get_pages);
 
 void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
 {
+	struct ptlrpc_enc_page_pool *pool;
         int     p_idx, g_idx;
         int     i;
 
@@ -615,22 +673,24 @@ void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
                 return;
 
         LASSERT(desc->bd_iov_count > 0);
+	LASSERT(desc->bd_enc_cpt >= 0 && desc->bd_enc_cpt < page_pools_num);
+	pool = page_pools[desc->bd_enc_cpt];
 
-	spin_lock(&page_pools.epp_lock);
+	spin_lock(&pool->epp_lock);
 
-        p_idx = page_pools.epp_free_pages / PAGES_PER_POOL;
-        g_idx = page_pools.epp_free_pages % PAGES_PER_POOL;
+        p_idx = pool->epp_free_pages / PAGES_PER_POOL;
+        g_idx = pool->epp_free_pages % PAGES_PER_POOL;
 
-        LASSERT(page_pools.epp_free_pages + desc->bd_iov_count <=
-                page_pools.epp_total_pages);
-        LASSERT(page_pools.epp_pools[p_idx]);
+        LASSERT(pool->epp_free_pages + desc->bd_iov_count <=
+                pool->epp_total_pages);
+        LASSERT(pool->epp_pools[p_idx]);
 
         for (i = 0; i < desc->bd_iov_count; i++) {
                 LASSERT(desc->bd_enc_iov[i].kiov_page != NULL);
-                LASSERT(g_idx != 0 || page_pools.epp_pools[p_idx]);
-                LASSERT(page_pools.epp_pools[p_idx][g_idx] == NULL);
+                LASSERT(g_idx != 0 || pool->epp_pools[p_idx]);
+                LASSERT(pool->epp_pools[p_idx][g_idx] == NULL);
 
-                page_pools.epp_pools[p_idx][g_idx] =
+                pool->epp_pools[p_idx][g_idx] =
                                         desc->bd_enc_iov[i].kiov_page;
 
                 if (++g_idx == PAGES_PER_POOL) {
@@ -639,11 +699,11 @@ void sptlrpc_enc_pool_put_pages(struct ptlrpc_bulk_desc *desc)
                 }
         }
 
-        page_pools.epp_free_pages += desc->bd_iov_count;
+        pool->epp_free_pages += desc->bd_iov_count;
 
-        enc_pools_wakeup();
+        enc_pools_wakeup(pool);
 
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 
 	OBD_FREE(desc->bd_enc_iov,
 		 desc->bd_iov_count * sizeof(*desc->bd_enc_iov));
@@ -658,23 +718,31 @@ EXPORT_SYMBOL(sptlrpc_enc_pool_put_pages);
  */
 int sptlrpc_enc_pool_add_user(void)
 {
+	struct ptlrpc_enc_page_pool *pool;
+	int     cpt;
 	int     need_grow = 0;
 
-	spin_lock(&page_pools.epp_lock);
-	if (page_pools.epp_growing == 0 && page_pools.epp_total_pages == 0) {
-		page_pools.epp_growing = 1;
+	/* the other pools grow on their first bulk */
+	cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	if (cpt < 0 || cpt >= page_pools_num)
+		cpt = 0;
+	pool = page_pools[cpt];
+
+	spin_lock(&pool->epp_lock);
+	if (pool->epp_growing == 0 && pool->epp_total_pages == 0) {
+		pool->epp_growing = 1;
 		need_grow = 1;
 	}
-	spin_unlock(&page_pools.epp_lock);
+	spin_unlock(&pool->epp_lock);
 
 	if (need_grow) {
-		enc_pools_add_pages(PTLRPC_MAX_BRW_PAGES +
-				    PTLRPC_MAX_BRW_PAGES);
+		enc_pools_add_pages(pool, PTLRPC_MAX_BRW_PAGES +
+					  PTLRPC_MAX_BRW_PAGES);
 
-		spin_lock(&page_pools.epp_lock);
-		page_pools.epp_growing = 0;
-		enc_pools_wakeup();
-		spin_unlock(&page_pools.epp_lock);
+		spin_lock(&pool->epp_lock);
+		pool->epp_growing = 0;
+		enc_pools_wakeup(pool);
+		spin_unlock(&pool->epp_lock);
 	}
 	return 0;
 }
@@ -686,100 +754,151 @@ int sptlrpc_enc_pool_del_user(void)
 }
 EXPORT_SYMBOL(sptlrpc_enc_pool_del_user);
 
-static inline void enc_pools_alloc(void)
+static inline void enc_pools_alloc(struct ptlrpc_enc_page_pool *pool)
 {
-        LASSERT(page_pools.epp_max_pools);
-        OBD_ALLOC_LARGE(page_pools.epp_pools,
-                        page_pools.epp_max_pools *
-                        sizeof(*page_pools.epp_pools));
+        LASSERT(pool->epp_max_pools);
+	OBD_CPT_ALLOC_LARGE(pool->epp_pools, cfs_cpt_table, pool->epp_cpt,
+			    pool->epp_max_pools * sizeof(*pool->epp_pools));
 }
 
-static inline void enc_pools_free(void)
+static inline void enc_pools_free(struct ptlrpc_enc_page_pool *pool)
 {
-        LASSERT(page_pools.epp_max_pools);
-        LASSERT(page_pools.epp_pools);
+        LASSERT(pool->epp_max_pools);
+        LASSERT(pool->epp_pools);
 
-        OBD_FREE_LARGE(page_pools.epp_pools,
-                       page_pools.epp_max_pools *
-                       sizeof(*page_pools.epp_pools));
+        OBD_FREE_LARGE(pool->epp_pools,
+                       pool->epp_max_pools *
+                       sizeof(*pool->epp_pools));
 }
 
-int sptlrpc_enc_pool_init(void)
+static int enc_pool_init(struct ptlrpc_enc_page_pool *pool, int cpt)
 {
+	pool->epp_cpt = cpt;
 	/*
-	 * maximum capacity is 1/8 of total physical memory.
+	 * maximum capacity is 1/8 of total physical memory, shared by the
+	 * pools of all the CPU partitions.
 	 * is the 1/8 a good number?
 	 */
-	page_pools.epp_max_pages = totalram_pages / 8;
-	page_pools.epp_max_pools = npages_to_npools(page_pools.epp_max_pages);
-
-	init_waitqueue_head(&page_pools.epp_waitq);
-	page_pools.epp_waitqlen = 0;
-	page_pools.epp_pages_short = 0;
-
-        page_pools.epp_growing = 0;
-
-        page_pools.epp_idle_idx = 0;
-        page_pools.epp_last_shrink = cfs_time_current_sec();
-        page_pools.epp_last_access = cfs_time_current_sec();
-
-	spin_lock_init(&page_pools.epp_lock);
-        page_pools.epp_total_pages = 0;
-        page_pools.epp_free_pages = 0;
-
-        page_pools.epp_st_max_pages = 0;
-        page_pools.epp_st_grows = 0;
-        page_pools.epp_st_grow_fails = 0;
-        page_pools.epp_st_shrinks = 0;
-        page_pools.epp_st_access = 0;
-        page_pools.epp_st_missings = 0;
-        page_pools.epp_st_lowfree = 0;
-        page_pools.epp_st_max_wqlen = 0;
-        page_pools.epp_st_max_wait = 0;
-
-        enc_pools_alloc();
-        if (page_pools.epp_pools == NULL)
+	pool->epp_max_pages = max_t(unsigned long,
+				    totalram_pages / 8 / page_pools_num,
+				    PTLRPC_MAX_BRW_PAGES * 2);
+	pool->epp_max_pools = npages_to_npools(pool->epp_max_pages);
+
+	init_waitqueue_head(&pool->epp_waitq);
+	pool->epp_waitqlen = 0;
+	pool->epp_pages_short = 0;
+
+        pool->epp_growing = 0;
+	mutex_init(&pool->epp_add_mutex);
+
+        pool->epp_idle_idx = 0;
+        pool->epp_last_shrink = cfs_time_current_sec();
+        pool->epp_last_access = cfs_time_current_sec();
+
+	spin_lock_init(&pool->epp_lock);
+        pool->epp_total_pages = 0;
+        pool->epp_free_pages = 0;
+
+        pool->epp_st_max_pages = 0;
+        pool->epp_st_grows = 0;
+        pool->epp_st_grow_fails = 0;
+        pool->epp_st_shrinks = 0;
+        pool->epp_st_access = 0;
+        pool->epp_st_missings = 0;
+        pool->epp_st_lowfree = 0;
+        pool->epp_st_max_wqlen = 0;
+        pool->epp_st_max_wait = 0;
+
+        enc_pools_alloc(pool);
+        if (pool->epp_pools == NULL)
                 return -ENOMEM;
 
-	pools_shrinker = set_shrinker(pools_shrinker_seeks,
-                                          enc_pools_shrink);
-        if (pools_shrinker == NULL) {
-                enc_pools_free();
-                return -ENOMEM;
-        }
-
         return 0;
 }
 
-void sptlrpc_enc_pool_fini(void)
+static void enc_pool_fini(struct ptlrpc_enc_page_pool *pool)
 {
         unsigned long cleaned, npools;
 
-        LASSERT(pools_shrinker);
-        LASSERT(page_pools.epp_pools);
-        LASSERT(page_pools.epp_total_pages == page_pools.epp_free_pages);
+        LASSERT(pool->epp_total_pages == pool->epp_free_pages);
 
-	remove_shrinker(pools_shrinker);
+	if (pool->epp_pools == NULL)
+		return;
 
-        npools = npages_to_npools(page_pools.epp_total_pages);
-        cleaned = enc_pools_cleanup(page_pools.epp_pools, npools);
-        LASSERT(cleaned == page_pools.epp_total_pages);
+        npools = npages_to_npools(pool->epp_total_pages);
+        cleaned = enc_pools_cleanup(pool->epp_pools, npools);
+        LASSERT(cleaned == pool->epp_total_pages);
 
-        enc_pools_free();
+        enc_pools_free(pool);
 
-        if (page_pools.epp_st_access > 0) {
+        if (pool->epp_st_access > 0) {
                 CDEBUG(D_SEC,
-                       "max pages %lu, grows %u, grow fails %u, shrinks %u, "
-                       "access %lu, missing %lu, max qlen %u, max wait "
-                       CFS_TIME_T"/%d\n",
-                       page_pools.epp_st_max_pages, page_pools.epp_st_grows,
-                       page_pools.epp_st_grow_fails,
-		       page_pools.epp_st_shrinks, page_pools.epp_st_access,
-		       page_pools.epp_st_missings, page_pools.epp_st_max_wqlen,
-		       page_pools.epp_st_max_wait, HZ);
+		       "cpt %d: max pages %lu, grows %u, grow fails %u, "
+		       "shrinks %u, access %lu, missing %lu, max qlen %u, "
+		       "max wait "CFS_TIME_T"/%d\n", pool->epp_cpt,
+                       pool->epp_st_max_pages, pool->epp_st_grows,
+                       pool->epp_st_grow_fails,
+		       pool->epp_st_shrinks, pool->epp_st_access,
+		       pool->epp_st_missings, pool->epp_st_max_wqlen,
+		       pool->epp_st_max_wait, HZ);
+	}
+}
+
+static void enc_pools_fini(void)
+{
+	struct ptlrpc_enc_page_pool *pool;
+	int	i;
+
+	for_each_enc_pool(pool, i) {
+		enc_pool_fini(pool);
+		OBD_FREE_PTR(pool);
+		page_pools[i] = NULL;
+	}
+	OBD_FREE(page_pools, page_pools_num * sizeof(page_pools[0]));
+	page_pools = NULL;
+	page_pools_num = 0;
+}
+
+int sptlrpc_enc_pool_init(void)
+{
+	int	ncpts = cfs_cpt_number(cfs_cpt_table);
+	int	rc;
+	int	i;
+
+	OBD_ALLOC(page_pools, ncpts * sizeof(page_pools[0]));
+	if (page_pools == NULL)
+		return -ENOMEM;
+	page_pools_num = ncpts;
+
+	for (i = 0; i < ncpts; i++) {
+		OBD_CPT_ALLOC_PTR(page_pools[i], cfs_cpt_table, i);
+		if (page_pools[i] == NULL)
+			GOTO(out, rc = -ENOMEM);
+
+		rc = enc_pool_init(page_pools[i], i);
+		if (rc != 0)
+			GOTO(out, rc);
 	}
+
+	pools_shrinker = set_shrinker(pools_shrinker_seeks,
+                                          enc_pools_shrink);
+	if (pools_shrinker == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	return 0;
+out:
+	enc_pools_fini();
+	return rc;
 }
 
+void sptlrpc_enc_pool_fini(void)
+{
+        LASSERT(pools_shrinker);
+        LASSERT(page_pools != NULL);
+
+	remove_shrinker(pools_shrinker);
+	enc_pools_fini();
+}
 #else /* !__KERNEL__ */
 
 int sptlrpc_enc_pool_get_pages(struct ptlrpc_bulk_desc *desc)
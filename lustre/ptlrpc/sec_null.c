@@ -50,6 +50,8 @@
 #include <lustre_net.h>
 #include <lustre_sec.h>
 
+#include "ptlrpc_internal.h"
+
 static struct ptlrpc_sec_policy null_policy;
 static struct ptlrpc_sec        null_sec;
 static struct ptlrpc_cli_ctx    null_cli_ctx;
@@ -317,11 +319,14 @@ int null_alloc_rs(struct ptlrpc_request *req, int msgsize)
                 /* pre-allocated */
                 LASSERT(rs->rs_size >= rs_size);
         } else {
-                OBD_ALLOC_LARGE(rs, rs_size);
-                if (rs == NULL)
-                        return -ENOMEM;
-
-                rs->rs_size = rs_size;
+		rs = lustre_get_cached_rs(req->rq_rqbd->rqbd_svcpt, rs_size);
+		if (rs == NULL) {
+			OBD_ALLOC_LARGE(rs, rs_size);
+			if (rs == NULL)
+				return -ENOMEM;
+
+			rs->rs_size = rs_size;
+		}
         }
 
 	rs->rs_svc_ctx = req->rq_svc_ctx;
@@ -341,7 +346,8 @@ void null_free_rs(struct ptlrpc_reply_state *rs)
 	LASSERT_ATOMIC_GT(&rs->rs_svc_ctx->sc_refcount, 1);
 	atomic_dec(&rs->rs_svc_ctx->sc_refcount);
 
-	if (!rs->rs_prealloc)
+	/* sptlrpc_svc_free_rs() gives these back to their pool */
+	if (!rs->rs_prealloc && !rs->rs_cached)
 		OBD_FREE_LARGE(rs, rs->rs_size);
 }
 
@@ -50,6 +50,8 @@
 #include <lustre_net.h>
 #include <lustre_sec.h>
 
+#include "ptlrpc_internal.h"
+
 struct plain_sec {
         struct ptlrpc_sec       pls_base;
 	rwlock_t            pls_lock;
@@ -827,11 +829,14 @@ int plain_alloc_rs(struct ptlrpc_request *req, int msgsize)
                 /* pre-allocated */
                 LASSERT(rs->rs_size >= rs_size);
         } else {
-                OBD_ALLOC_LARGE(rs, rs_size);
-                if (rs == NULL)
-                        RETURN(-ENOMEM);
+		rs = lustre_get_cached_rs(req->rq_rqbd->rqbd_svcpt, rs_size);
+		if (rs == NULL) {
+			OBD_ALLOC_LARGE(rs, rs_size);
+			if (rs == NULL)
+				RETURN(-ENOMEM);
 
-                rs->rs_size = rs_size;
+			rs->rs_size = rs_size;
+		}
         }
 
 	rs->rs_svc_ctx = req->rq_svc_ctx;
@@ -854,7 +859,8 @@ void plain_free_rs(struct ptlrpc_reply_state *rs)
 	LASSERT(atomic_read(&rs->rs_svc_ctx->sc_refcount) > 1);
 	atomic_dec(&rs->rs_svc_ctx->sc_refcount);
 
-	if (!rs->rs_prealloc)
+	/* sptlrpc_svc_free_rs() gives these back to their pool */
+	if (!rs->rs_prealloc && !rs->rs_cached)
 		OBD_FREE_LARGE(rs, rs->rs_size);
 	EXIT;
 }
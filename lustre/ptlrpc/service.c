@@ -49,6 +49,9 @@
 int test_req_buffer_pressure = 0;
 CFS_MODULE_PARM(test_req_buffer_pressure, "i", int, 0444,
                 "set non-zero to put pressure on request buffer pools");
+int rep_cache_max = 128;
+CFS_MODULE_PARM(rep_cache_max, "i", int, 0644,
+		"max # of small reply states recycled per service partition");
 CFS_MODULE_PARM(at_min, "i", int, 0644,
                 "Adaptive timeout minimum (sec)");
 CFS_MODULE_PARM(at_max, "i", int, 0644,
@@ -97,6 +100,7 @@ ptlrpc_alloc_rqbd(struct ptlrpc_service_part *svcpt)
 	spin_lock(&svcpt->scp_lock);
 	cfs_list_add(&rqbd->rqbd_list, &svcpt->scp_rqbd_idle);
 	svcpt->scp_nrqbds_total++;
+	svcpt->scp_rqbd_nalloc++;
 	spin_unlock(&svcpt->scp_lock);
 
 	return rqbd;
@@ -113,12 +117,57 @@ ptlrpc_free_rqbd(struct ptlrpc_request_buffer_desc *rqbd)
 	spin_lock(&svcpt->scp_lock);
 	cfs_list_del(&rqbd->rqbd_list);
 	svcpt->scp_nrqbds_total--;
+	svcpt->scp_rqbd_nfree++;
 	spin_unlock(&svcpt->scp_lock);
 
 	OBD_FREE_LARGE(rqbd->rqbd_buffer, svcpt->scp_service->srv_buf_size);
 	OBD_FREE_PTR(rqbd);
 }
 
+/**
+ * Account \a nfilled request buffers filled by LNet in the current second,
+ * the buffer count of the seconds without any is cleared.
+ * Called with ptlrpc_service_part::scp_lock held.
+ */
+void
+ptlrpc_rqbd_account(struct ptlrpc_service_part *svcpt, int nfilled)
+{
+	time_t	now = cfs_time_current_sec();
+	time_t	t;
+
+	if (now != svcpt->scp_rqbd_period) {
+		t = max(svcpt->scp_rqbd_period + 1,
+			now - PTLRPC_RQBD_HIST + 1);
+		for (; t <= now; t++)
+			svcpt->scp_rqbd_hist[t % PTLRPC_RQBD_HIST] = 0;
+		svcpt->scp_rqbd_period = now;
+	}
+	svcpt->scp_rqbd_hist[now % PTLRPC_RQBD_HIST] += nfilled;
+}
+
+/**
+ * Posted request buffers needed by \a svcpt: twice the peak # of buffers
+ * filled per second in the last PTLRPC_RQBD_HIST seconds, as a filled buffer
+ * is only reposted after all its requests are handled. The pool is never
+ * smaller than ptlrpc_service::srv_nbuf_per_group.
+ */
+static int
+ptlrpc_rqbd_target(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service	*svc = svcpt->scp_service;
+	int			peak = 0;
+	int			i;
+
+	if (test_req_buffer_pressure)
+		return svc->srv_nbuf_per_group;
+
+	for (i = 0; i < PTLRPC_RQBD_HIST; i++)
+		peak = max(peak, svcpt->scp_rqbd_hist[i]);
+
+	return min(max(svc->srv_nbuf_per_group, 2 * peak),
+		   svc->srv_nbuf_per_group * PTLRPC_RQBD_MAX_FACTOR);
+}
+
 int
 ptlrpc_grow_req_bufs(struct ptlrpc_service_part *svcpt, int post)
 {
@@ -143,10 +192,11 @@ ptlrpc_grow_req_bufs(struct ptlrpc_service_part *svcpt, int post)
 	spin_unlock(&svcpt->scp_lock);
 
 
-        for (i = 0; i < svc->srv_nbuf_per_group; i++) {
-                /* NB: another thread might have recycled enough rqbds, we
-		 * need to make sure it wouldn't over-allocate, see LU-1212. */
-		if (svcpt->scp_nrqbds_posted >= svc->srv_nbuf_per_group)
+	for (i = 0; i < svcpt->scp_rqbd_target; i++) {
+		/* NB: another thread might have recycled enough rqbds, we
+		 * need to make sure it wouldn't over-allocate, see LU-1212.
+		 * The new rqbds are idle until they are posted. */
+		if (svcpt->scp_nrqbds_posted + i >= svcpt->scp_rqbd_target)
 			break;
 
 		rqbd = ptlrpc_alloc_rqbd(svcpt);
@@ -467,6 +517,14 @@ ptlrpc_server_post_idle_rqbds(struct ptlrpc_service_part *svcpt)
 		rqbd = cfs_list_entry(svcpt->scp_rqbd_idle.next,
 				      struct ptlrpc_request_buffer_desc,
 				      rqbd_list);
+
+		if (svcpt->scp_nrqbds_posted >= svcpt->scp_rqbd_target) {
+			/* more buffers than the load needs, return the
+			 * memory instead of posting it */
+			spin_unlock(&svcpt->scp_lock);
+			ptlrpc_free_rqbd(rqbd);
+			continue;
+		}
 		cfs_list_del(&rqbd->rqbd_list);
 
 		/* assume we will post successfully */
@@ -629,6 +687,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	/* rqbd and incoming request queue */
 	spin_lock_init(&svcpt->scp_lock);
 	CFS_INIT_LIST_HEAD(&svcpt->scp_rqbd_idle);
+	svcpt->scp_rqbd_target = svc->srv_nbuf_per_group;
 	CFS_INIT_LIST_HEAD(&svcpt->scp_rqbd_posted);
 	CFS_INIT_LIST_HEAD(&svcpt->scp_req_incoming);
 	init_waitqueue_head(&svcpt->scp_waitq);
@@ -648,6 +707,11 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	CFS_INIT_LIST_HEAD(&svcpt->scp_rep_idle);
 	init_waitqueue_head(&svcpt->scp_rep_waitq);
 	atomic_set(&svcpt->scp_nreps_difficult, 0);
+	spin_lock_init(&svcpt->scp_rep_cache_lock);
+	CFS_INIT_LIST_HEAD(&svcpt->scp_rep_cache);
+	svcpt->scp_rep_ncached = 0;
+	svcpt->scp_rep_cache_hits = 0;
+	svcpt->scp_rep_cache_misses = 0;
 
 	/* adaptive timeout */
 	spin_lock_init(&svcpt->scp_at_lock);
@@ -989,6 +1053,219 @@ void ptlrpc_server_drop_request(struct ptlrpc_request *req)
 	}
 }
 
+/**
+ * Cancel the lock granted to the client by the LDLM_ENQUEUE sub-request \a req
+ * whose reply could not be returned, the client would never learn about it.
+ */
+static void ptlrpc_batch_sub_cancel(struct ptlrpc_request *req)
+{
+	struct ldlm_reply	*rep;
+	struct ldlm_lock	*lock;
+
+	if (lustre_msg_get_opc(req->rq_reqmsg) != LDLM_ENQUEUE ||
+	    req->rq_type == PTL_RPC_MSG_ERR ||
+	    lustre_msg_bufcount(req->rq_repmsg) <= DLM_LOCKREPLY_OFF)
+		return;
+
+	rep = lustre_msg_buf(req->rq_repmsg, DLM_LOCKREPLY_OFF, sizeof(*rep));
+	if (rep == NULL || !lustre_handle_is_used(&rep->lock_handle))
+		return;
+
+	lock = ldlm_handle2lock(&rep->lock_handle);
+	if (lock == NULL)
+		return;
+
+	LDLM_DEBUG(lock, "cancel, reply does not fit the batch reply");
+	ldlm_lock_cancel(lock);
+	LDLM_LOCK_PUT(lock);
+}
+
+/**
+ * Finish the reply of sub-request \a sub of batch request \a req like
+ * ptlrpc_send_reply() would, and copy it into \a repbuf of \a repsize bytes
+ * instead of sending it. The locks saved by the sub-request handler are
+ * moved to the reply state of \a req, to be released when the batch reply
+ * is acked or committed. Returns the length of the reply, or negative error.
+ */
+static int ptlrpc_batch_sub_reply(struct ptlrpc_request *req,
+				  struct ptlrpc_request *sub,
+				  void *repbuf, int repsize)
+{
+	struct ptlrpc_reply_state *prs = req->rq_reply_state;
+	struct ptlrpc_reply_state *rs;
+	int			   i;
+	int			   rc;
+
+	if (sub->rq_reply_state == NULL) {
+		/* the handler failed before packing its reply */
+		rc = lustre_pack_reply(sub, 1, NULL, NULL);
+		if (rc)
+			return rc;
+		sub->rq_type = PTL_RPC_MSG_ERR;
+	}
+
+	rs = sub->rq_reply_state;
+	if (rs->rs_difficult) {
+		/* ptlrpc_server_handle_batch_sub() checked there is room */
+		LASSERT(prs->rs_nlocks + rs->rs_nlocks <= RS_MAX_LOCKS);
+		for (i = 0; i < rs->rs_nlocks; i++) {
+			prs->rs_locks[prs->rs_nlocks] = rs->rs_locks[i];
+			prs->rs_modes[prs->rs_nlocks] = rs->rs_modes[i];
+			prs->rs_nlocks++;
+		}
+		/* wait for the ack if any of the sub-requests needs it */
+		if (!prs->rs_difficult)
+			prs->rs_no_ack = rs->rs_no_ack;
+		else
+			prs->rs_no_ack &= rs->rs_no_ack;
+		prs->rs_difficult = 1;
+		rs->rs_nlocks = 0;
+		rs->rs_difficult = 0;
+	}
+	/* the saved locks are released once the batch commits */
+	if (sub->rq_transno > req->rq_transno)
+		req->rq_transno = sub->rq_transno;
+
+	if (sub->rq_type != PTL_RPC_MSG_ERR)
+		sub->rq_type = PTL_RPC_MSG_REPLY;
+
+	lustre_msg_set_type(sub->rq_repmsg, sub->rq_type);
+	lustre_msg_set_status(sub->rq_repmsg,
+			      ptlrpc_status_hton(sub->rq_status));
+	lustre_msg_set_opc(sub->rq_repmsg, lustre_msg_get_opc(sub->rq_reqmsg));
+	target_pack_pool_reply(sub);
+
+	if (sub->rq_replen > repsize) {
+		/* larger than the reply buffer the client prepared for it */
+		ptlrpc_batch_sub_cancel(sub);
+		return -EOVERFLOW;
+	}
+
+	memcpy(repbuf, sub->rq_repmsg, sub->rq_replen);
+	return sub->rq_replen;
+}
+
+/**
+ * Handle the request message \a msg of \a msglen bytes and xid \a xid
+ * carried inside the batch request \a req with \a handler, as if it had
+ * arrived on its own.
+ * Only messages with opcode \a opc are accepted.
+ * The sub-request shares the export, security context and service thread
+ * of \a req but gets its own session, so the handler may be the generic
+ * target one that \a req itself is being handled by.
+ *
+ * The caller must make sure that \a repsize is at least the size of the
+ * reply buffer the client prepared for the message before calling this, so
+ * that any lock granted by the handler can be returned.
+ *
+ * \retval length of the reply copied into \a repbuf
+ * \retval -ENOSPC if the message was not handled and may be sent again
+ * \retval negative error if the message could not be handled
+ */
+int ptlrpc_server_handle_batch_sub(struct ptlrpc_request *req,
+				   struct lustre_msg *msg, int msglen,
+				   __u64 xid, void *repbuf, int repsize,
+				   __u32 opc, svc_handler_t handler)
+{
+	struct ptlrpc_thread	*thread = req->rq_svc_thread;
+	struct lu_context	*ses = thread->t_env->le_ses;
+	struct ptlrpc_request	*sub;
+	int			 rc;
+	ENTRY;
+
+	LASSERT(req->rq_export != NULL);
+
+	sub = ptlrpc_request_cache_alloc(GFP_NOFS);
+	if (sub == NULL)
+		RETURN(-ENOMEM);
+
+	sub->rq_xid = xid;
+	sub->rq_reqbuf = (char *)msg;
+	sub->rq_reqdata_len = msglen;
+	sub->rq_reqmsg = msg;
+	sub->rq_reqlen = msglen;
+	sub->rq_arrival_time = req->rq_arrival_time;
+	sub->rq_deadline = req->rq_deadline;
+	sub->rq_peer = req->rq_peer;
+	sub->rq_self = req->rq_self;
+	sub->rq_rqbd = req->rq_rqbd;
+	sub->rq_svc_thread = thread;
+	sub->rq_phase = RQ_PHASE_INTERPRET;
+	spin_lock_init(&sub->rq_lock);
+	CFS_INIT_LIST_HEAD(&sub->rq_list);
+	CFS_INIT_LIST_HEAD(&sub->rq_timed_list);
+	CFS_INIT_LIST_HEAD(&sub->rq_exp_list);
+	CFS_INIT_LIST_HEAD(&sub->rq_history_list);
+	atomic_set(&sub->rq_refcount, 1);
+
+	/* the batch was authenticated as a whole */
+	sub->rq_flvr = req->rq_flvr;
+	sub->rq_sp_from = req->rq_sp_from;
+	sub->rq_auth_gss = req->rq_auth_gss;
+	sub->rq_auth_remote = req->rq_auth_remote;
+	sub->rq_auth_usr_root = req->rq_auth_usr_root;
+	sub->rq_auth_usr_mdt = req->rq_auth_usr_mdt;
+	sub->rq_auth_usr_ost = req->rq_auth_usr_ost;
+	sub->rq_auth_uid = req->rq_auth_uid;
+	sub->rq_auth_mapped_uid = req->rq_auth_mapped_uid;
+	sub->rq_user_desc = req->rq_user_desc;
+	sub->rq_svc_ctx = req->rq_svc_ctx;
+	sptlrpc_svc_ctx_addref(sub);
+
+	rc = ptlrpc_unpack_req_msg(sub, msglen);
+	if (rc == 0)
+		rc = lustre_unpack_req_ptlrpc_body(sub, MSG_PTLRPC_BODY_OFF);
+	if (rc != 0 ||
+	    lustre_msg_get_type(msg) != PTL_RPC_MSG_REQUEST ||
+	    lustre_msg_get_opc(msg) != opc ||
+	    lustre_msg_get_handle(msg)->cookie !=
+	    req->rq_export->exp_handle.h_cookie) {
+		CERROR("%s: malformed batched request from %s: rc = %d\n",
+		       req->rq_export->exp_obd->obd_name,
+		       libcfs_id2str(req->rq_peer), rc);
+		GOTO(out, rc = -EPROTO);
+	}
+
+	/* A sub-request may save up to RS_MAX_LOCKS locks for its difficult
+	 * reply, they must fit in the reply state of the batch. The ones
+	 * not handled are sent again by the client on their own. */
+	LASSERT(req->rq_reply_state != NULL);
+	if (req->rq_reply_state->rs_nlocks > 0)
+		GOTO(out, rc = -ENOSPC);
+
+	sub->rq_export = class_export_get(req->rq_export);
+	/* the sub-requests are resent together with their batch */
+	lustre_msg_add_flags(msg, lustre_msg_get_flags(req->rq_reqmsg) &
+				  MSG_RESENT);
+	/* the reply goes back inside the batch reply */
+	sub->rq_no_reply = 1;
+
+	rc = lu_context_init(&sub->rq_session,
+			     LCT_SERVER_SESSION | LCT_NOREF);
+	if (rc != 0)
+		GOTO(out, rc);
+	sub->rq_session.lc_thread = thread;
+	lu_context_enter(&sub->rq_session);
+	thread->t_env->le_ses = &sub->rq_session;
+
+	handler(sub);
+
+	thread->t_env->le_ses = ses;
+	lu_context_exit(&sub->rq_session);
+	lu_context_fini(&sub->rq_session);
+
+	rc = ptlrpc_batch_sub_reply(req, sub, repbuf, repsize);
+	EXIT;
+out:
+	ptlrpc_req_drop_rs(sub);
+	sptlrpc_svc_ctx_decref(sub);
+	if (sub->rq_export != NULL)
+		class_export_put(sub->rq_export);
+	ptlrpc_request_cache_free(sub);
+	return rc;
+}
+EXPORT_SYMBOL(ptlrpc_server_handle_batch_sub);
+
 /** Change request export and move hp request from old export to new */
 void ptlrpc_request_change_export(struct ptlrpc_request *req,
 				  struct obd_export *export)
@@ -1873,6 +2150,11 @@ ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
 	 * concerned */
 	spin_unlock(&svcpt->scp_lock);
 
+	/* the final event of a request buffer unlinked without a request,
+	 * see ptlrpc_shrink_req_bufs() */
+	if (req->rq_reqdata_len == 0)
+		goto err_req;
+
         /* go through security check/transform */
         rc = sptlrpc_svc_unwrap_request(req);
         switch (rc) {
@@ -2335,12 +2617,65 @@ liblustre_check_services (void *arg)
 
 #else /* __KERNEL__ */
 
+/**
+ * Whether \a svcpt has a group of posted request buffers more than needed.
+ */
+static inline int
+ptlrpc_rqbd_surplus(struct ptlrpc_service_part *svcpt)
+{
+	return svcpt->scp_nrqbds_posted > svcpt->scp_rqbd_target +
+					  svcpt->scp_service->srv_nbuf_per_group;
+}
+
+/**
+ * Unlink the posted request buffers of \a svcpt which did not receive any
+ * request while there are more than scp_rqbd_target posted, they are freed
+ * by ptlrpc_server_post_idle_rqbds() once LNet releases them.
+ */
+static void
+ptlrpc_shrink_req_bufs(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_request_buffer_desc *rqbd;
+	lnet_handle_md_t		  mdh[PTLRPC_RQBD_SHRINK_BATCH];
+	int				  surplus;
+	int				  n = 0;
+	int				  i;
+
+	spin_lock(&svcpt->scp_lock);
+	surplus = svcpt->scp_nrqbds_posted - svcpt->scp_rqbd_target;
+	cfs_list_for_each_entry(rqbd, &svcpt->scp_rqbd_posted, rqbd_list) {
+		if (n >= min(surplus, PTLRPC_RQBD_SHRINK_BATCH))
+			break;
+		/* the reference of the posted buffer only, see
+		 * ptlrpc_register_rqbd() */
+		if (rqbd->rqbd_refcount == 1)
+			mdh[n++] = rqbd->rqbd_md_h;
+	}
+	spin_unlock(&svcpt->scp_lock);
+
+	/* the unlink event may be delivered from LNetMDUnlink() itself, its
+	 * callback takes scp_lock */
+	for (i = 0; i < n; i++)
+		LNetMDUnlink(mdh[i]);
+
+	CDEBUG(D_RPCTRACE, "%s: unlink %d of %d surplus reqbufs\n",
+	       svcpt->scp_service->srv_name, n, surplus);
+}
+
 static void
 ptlrpc_check_rqbd_pool(struct ptlrpc_service_part *svcpt)
 {
 	int avail = svcpt->scp_nrqbds_posted;
-	int low_water = test_req_buffer_pressure ? 0 :
-			svcpt->scp_service->srv_nbuf_per_group / 2;
+	int low_water;
+
+	/* resize the pool once a second from the recent usage */
+	if (cfs_time_current_sec() != svcpt->scp_rqbd_period) {
+		spin_lock(&svcpt->scp_lock);
+		ptlrpc_rqbd_account(svcpt, 0);
+		svcpt->scp_rqbd_target = ptlrpc_rqbd_target(svcpt);
+		spin_unlock(&svcpt->scp_lock);
+	}
+	low_water = test_req_buffer_pressure ? 0 : svcpt->scp_rqbd_target / 2;
 
         /* NB I'm not locking; just looking. */
 
@@ -2351,6 +2686,8 @@ ptlrpc_check_rqbd_pool(struct ptlrpc_service_part *svcpt)
 
         if (avail <= low_water)
 		ptlrpc_grow_req_bufs(svcpt, 1);
+	else if (ptlrpc_rqbd_surplus(svcpt))
+		ptlrpc_shrink_req_bufs(svcpt);
 
 	if (svcpt->scp_service->srv_stats) {
 		lprocfs_counter_add(svcpt->scp_service->srv_stats,
@@ -2437,6 +2774,11 @@ ptlrpc_wait_event(struct ptlrpc_service_part *svcpt,
 	struct l_wait_info lwi = LWI_TIMEOUT(svcpt->scp_rqbd_timeout,
 					     ptlrpc_retry_rqbds, svcpt);
 
+	/* wake up to shrink the request buffers left by a burst of requests
+	 * even if no more comes, see ptlrpc_check_rqbd_pool() */
+	if (svcpt->scp_rqbd_timeout == 0 && ptlrpc_rqbd_surplus(svcpt))
+		lwi = LWI_TIMEOUT(cfs_time_seconds(1), NULL, NULL);
+
 	lc_watchdog_disable(thread->t_watchdog);
 
 	cond_resched();
@@ -3205,6 +3547,7 @@ ptlrpc_service_purge_all(struct ptlrpc_service *svc)
 			cfs_list_del(&rs->rs_list);
 			OBD_FREE_LARGE(rs, svc->srv_max_reply_size);
 		}
+		lustre_purge_cached_rs(svcpt);
 	}
 }
 
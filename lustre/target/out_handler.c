@@ -1482,7 +1482,7 @@ int out_handle(struct tgt_session_info *tsi)
 		RETURN(err_serious(-EPROTO));
 	object_update_reply_init(reply, count);
 	tti->tti_u.update.tti_update_reply = reply;
-	tti->tti_mult_trans = !req_is_replay(tgt_ses_req(tsi));
+	tgt_mult_trans_set(tsi);
 
 	/* Walk through updates in the request to execute them synchronously */
 	for (i = 0; i < count; i++) {
@@ -184,12 +184,102 @@ out:
 }
 EXPORT_SYMBOL(tgt_validate_obdo);
 
+/*
+ * Unpack the obdos of the extra objects of a multi-object OST_WRITE.  The
+ * first object is described by ost_body, objects 1..obj_count-1 by the
+ * RMF_OBDO_ARRAY entries in ioobj order, each with its capability in
+ * RMF_CAPA_ARRAY if OBD_MD_FLOSSCAPA is set.  The objects must arrive in
+ * increasing FID order, so that all multi-object writes take the object
+ * locks in the same order.
+ */
+static int tgt_io_multi_unpack(struct tgt_session_info *tsi,
+			       struct obd_ioobj *ioo, int obj_count)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct obdo		*oa;
+	struct ost_id		 oi;
+	int			 ncapa;
+	int			 i, rc;
+
+	ENTRY;
+
+	if (!(exp_connect_flags(tsi->tsi_exp) & OBD_CONNECT_MULTIOBJ_BRW) ||
+	    lustre_msg_get_opc(tgt_ses_req(tsi)->rq_reqmsg) != OST_WRITE ||
+	    obj_count > PTLRPC_MAX_BRW_OBJS) {
+		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
+		       obj_count);
+		RETURN(-EPROTO);
+	}
+
+	req_capsule_extend(pill, &RQF_OST_BRW_WRITE_MULTI);
+	if (!req_capsule_field_present(pill, &RMF_OBDO_ARRAY, RCL_CLIENT) ||
+	    req_capsule_get_size(pill, &RMF_OBDO_ARRAY, RCL_CLIENT) !=
+	    (obj_count - 1) * sizeof(*oa)) {
+		CERROR("%s: %d ioobjs without matching obdos\n",
+		       tgt_name(tsi->tsi_tgt), obj_count);
+		RETURN(-EPROTO);
+	}
+
+	oa = req_capsule_client_get(pill, &RMF_OBDO_ARRAY);
+	if (oa == NULL)
+		RETURN(-EPROTO);
+
+	ncapa = 0;
+	if (req_capsule_field_present(pill, &RMF_CAPA_ARRAY, RCL_CLIENT))
+		ncapa = req_capsule_get_size(pill, &RMF_CAPA_ARRAY,
+					     RCL_CLIENT) /
+			sizeof(struct lustre_capa);
+	if (ncapa != 0 && (ncapa != obj_count - 1 ||
+	    req_capsule_client_get(pill, &RMF_CAPA_ARRAY) == NULL)) {
+		CERROR("%s: %d ioobjs with %d capabilities\n",
+		       tgt_name(tsi->tsi_tgt), obj_count, ncapa);
+		RETURN(-EPROTO);
+	}
+
+	for (i = 1; i < obj_count; i++) {
+		if (oa[i - 1].o_valid & OBD_MD_FLOSSCAPA && ncapa == 0) {
+			CERROR("%s: OSSCAPA flag is set without capability\n",
+			       tgt_name(tsi->tsi_tgt));
+			RETURN(-EFAULT);
+		}
+
+		/* the ioobj must describe the object of its obdo, as packed
+		 * by obdo_to_ioobj() */
+		oi = oa[i - 1].o_oi;
+		if (unlikely(!(oa[i - 1].o_valid & OBD_MD_FLGROUP)))
+			ostid_set_seq_mdt0(&oi);
+		if (memcmp(&oi, &ioo[i].ioo_oid, sizeof(oi)) != 0) {
+			CERROR("%s: ioobj "DOSTID" does not match obdo "
+			       DOSTID"\n", tgt_name(tsi->tsi_tgt),
+			       POSTID(&ioo[i].ioo_oid), POSTID(&oi));
+			RETURN(-EPROTO);
+		}
+
+		rc = tgt_validate_obdo(tsi, &oa[i - 1]);
+		if (rc != 0)
+			RETURN(rc);
+
+		ioo[i].ioo_oid = oa[i - 1].o_oi;
+		if (lu_fid_cmp(&ioo[i - 1].ioo_oid.oi_fid,
+			       &ioo[i].ioo_oid.oi_fid) >= 0) {
+			CERROR("%s: ioobj "DFID" out of order\n",
+			       tgt_name(tsi->tsi_tgt),
+			       PFID(&ioo[i].ioo_oid.oi_fid));
+			RETURN(-EPROTO);
+		}
+	}
+
+	RETURN(0);
+}
+
 static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 {
 	unsigned		 max_brw;
 	struct niobuf_remote	*rnb;
 	struct obd_ioobj	*ioo;
 	int			 obj_count;
+	int			 niocount;
+	int			 i, rc;
 
 	ENTRY;
 
@@ -217,21 +307,30 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 		CERROR("%s: short ioobj\n", tgt_name(tsi->tsi_tgt));
 		RETURN(-EPROTO);
 	} else if (obj_count > 1) {
-		CERROR("%s: too many ioobjs (%d)\n", tgt_name(tsi->tsi_tgt),
-		       obj_count);
-		RETURN(-EPROTO);
-	}
-
-	if (ioo->ioo_bufcnt == 0) {
-		CERROR("%s: ioo has zero bufcnt\n", tgt_name(tsi->tsi_tgt));
-		RETURN(-EPROTO);
+		/* lockless I/O takes one extent lock per request */
+		if (rnb->flags & OBD_BRW_SRVLOCK) {
+			CERROR("%s: srvlock write with %d ioobjs\n",
+			       tgt_name(tsi->tsi_tgt), obj_count);
+			RETURN(-EPROTO);
+		}
+		rc = tgt_io_multi_unpack(tsi, ioo, obj_count);
+		if (rc < 0)
+			RETURN(rc);
 	}
 
-	if (ioo->ioo_bufcnt > PTLRPC_MAX_BRW_PAGES) {
-		DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
-			  "bulk has too many pages (%d)",
-			  ioo->ioo_bufcnt);
-		RETURN(-EPROTO);
+	for (niocount = i = 0; i < obj_count; i++) {
+		if (ioo[i].ioo_bufcnt == 0) {
+			CERROR("%s: ioo has zero bufcnt\n",
+			       tgt_name(tsi->tsi_tgt));
+			RETURN(-EPROTO);
+		}
+		if (ioo[i].ioo_bufcnt > PTLRPC_MAX_BRW_PAGES - niocount) {
+			DEBUG_REQ(D_RPCTRACE, tgt_ses_req(tsi),
+				  "bulk has too many pages (%d)",
+				  niocount + ioo[i].ioo_bufcnt);
+			RETURN(-EPROTO);
+		}
+		niocount += ioo[i].ioo_bufcnt;
 	}
 
 	RETURN(0);
@@ -1887,6 +1986,7 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 	struct niobuf_local	*local_nb;
 	struct obd_ioobj	*ioo;
 	struct ost_body		*body, *repbody;
+	struct obdo		*oa = NULL;
 	struct l_wait_info	 lwi;
 	struct lustre_handle	 lockh = {0};
 	__u32			*rcs;
@@ -1953,6 +2053,9 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 
 	req_capsule_set_size(&req->rq_pill, &RMF_RCS, RCL_SERVER,
 			     niocount * sizeof(*rcs));
+	if (objcount > 1)
+		req_capsule_set_size(&req->rq_pill, &RMF_OBDO_ARRAY, RCL_SERVER,
+				     (objcount - 1) * sizeof(*oa));
 	rc = req_capsule_server_pack(&req->rq_pill);
 	if (rc != 0)
 		GOTO(out, rc = err_serious(rc));
@@ -1996,10 +2099,24 @@ int tgt_brw_write(struct tgt_session_info *tsi)
 		GOTO(out_lock, rc = -ENOMEM);
 	repbody->oa = body->oa;
 
+	/* obd_preprw() and obd_commitrw() take one obdo per ioobj, build a
+	 * contiguous array when the write carries several objects */
+	if (objcount > 1) {
+		struct obdo *reqoa;
+
+		OBD_ALLOC(oa, objcount * sizeof(*oa));
+		if (oa == NULL)
+			GOTO(out_lock, rc = -ENOMEM);
+		reqoa = req_capsule_client_get(&req->rq_pill, &RMF_OBDO_ARRAY);
+		oa[0] = body->oa;
+		memcpy(oa + 1, reqoa, (objcount - 1) * sizeof(*oa));
+	} else {
+		oa = &repbody->oa;
+	}
+
 	npages = PTLRPC_MAX_BRW_PAGES;
-	rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			objcount, ioo, remote_nb, &npages, local_nb, NULL,
-			BYPASS_CAPA);
+	rc = obd_preprw(tsi->tsi_env, OBD_BRW_WRITE, exp, oa, objcount, ioo,
+			remote_nb, &npages, local_nb, NULL, BYPASS_CAPA);
 	if (rc < 0)
 		GOTO(out_lock, rc);
 
@@ -2028,33 +2145,32 @@ skip_transfer:
 		if (body->oa.o_valid & OBD_MD_FLFLAGS)
 			cksum_type = cksum_type_unpack(body->oa.o_flags);
 
-		repbody->oa.o_valid |= OBD_MD_FLCKSUM | OBD_MD_FLFLAGS;
-		repbody->oa.o_flags &= ~OBD_FL_CKSUM_ALL;
-		repbody->oa.o_flags |= cksum_type_pack(cksum_type);
-		repbody->oa.o_cksum = tgt_checksum_bulk(tsi->tsi_tgt, desc,
-							OST_WRITE, cksum_type);
+		/* one checksum covers the bulk of all objects */
+		oa->o_valid |= OBD_MD_FLCKSUM | OBD_MD_FLFLAGS;
+		oa->o_flags &= ~OBD_FL_CKSUM_ALL;
+		oa->o_flags |= cksum_type_pack(cksum_type);
+		oa->o_cksum = tgt_checksum_bulk(tsi->tsi_tgt, desc,
+						OST_WRITE, cksum_type);
 		cksum_counter++;
 
-		if (unlikely(body->oa.o_cksum != repbody->oa.o_cksum)) {
+		if (unlikely(body->oa.o_cksum != oa->o_cksum)) {
 			mmap = (body->oa.o_valid & OBD_MD_FLFLAGS &&
 				body->oa.o_flags & OBD_FL_MMAP);
 
 			tgt_warn_on_cksum(req, desc, local_nb, npages,
-					  body->oa.o_cksum,
-					  repbody->oa.o_cksum, mmap);
+					  body->oa.o_cksum, oa->o_cksum, mmap);
 			cksum_counter = 0;
 		} else if ((cksum_counter & (-cksum_counter)) ==
 			   cksum_counter) {
 			CDEBUG(D_INFO, "Checksum %u from %s OK: %x\n",
 			       cksum_counter, libcfs_id2str(req->rq_peer),
-			       repbody->oa.o_cksum);
+			       oa->o_cksum);
 		}
 	}
 
 	/* Must commit after prep above in all cases */
-	rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp, &repbody->oa,
-			  objcount, ioo, remote_nb, npages, local_nb, NULL,
-			  rc);
+	rc = obd_commitrw(tsi->tsi_env, OBD_BRW_WRITE, exp, oa, objcount, ioo,
+			  remote_nb, npages, local_nb, NULL, rc);
 	if (rc == -ENOTCONN)
 		/* quota acquire process has been given up because
 		 * either the client has been evicted or the client
@@ -2066,7 +2182,8 @@ skip_transfer:
 	 * whole object, then it has already updated the mtime on its side,
 	 * otherwise it will have to glimpse anyway (see bug 21489, comment 32)
 	 */
-	repbody->oa.o_valid &= ~(OBD_MD_FLMTIME | OBD_MD_FLATIME);
+	for (i = 0; i < objcount; i++)
+		oa[i].o_valid &= ~(OBD_MD_FLMTIME | OBD_MD_FLATIME);
 
 	if (rc == 0) {
 		int nob = 0;
@@ -2089,9 +2206,20 @@ skip_transfer:
 		LASSERT(j == npages);
 		ptlrpc_lprocfs_brw(req, nob);
 
-		tgt_drop_id(exp, &repbody->oa);
+		for (i = 0; i < objcount; i++)
+			tgt_drop_id(exp, &oa[i]);
+	}
+
+	if (objcount > 1) {
+		struct obdo *repoa;
+
+		repbody->oa = oa[0];
+		repoa = req_capsule_server_get(&req->rq_pill, &RMF_OBDO_ARRAY);
+		memcpy(repoa, oa + 1, (objcount - 1) * sizeof(*oa));
 	}
 out_lock:
+	if (objcount > 1 && oa != NULL)
+		OBD_FREE(oa, objcount * sizeof(*oa));
 	tgt_brw_unlock(ioo, remote_nb, &lockh, LCK_PW);
 	if (desc)
 		ptlrpc_free_bulk_nopin(desc);
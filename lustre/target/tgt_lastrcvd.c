@@ -691,6 +691,20 @@ int tgt_client_del(const struct lu_env *env, struct obd_export *exp)
 }
 EXPORT_SYMBOL(tgt_client_del);
 
+/**
+ * Let the handler of the current request run several transactions, each of
+ * which gets its own transno and last_rcvd update, as OUT does. The reply
+ * carries the highest transno, so the client keeps the request until all of
+ * them are committed. A replay keeps its single transno.
+ */
+void tgt_mult_trans_set(struct tgt_session_info *tsi)
+{
+	struct tgt_thread_info *tti = tgt_th_info(tsi->tsi_env);
+
+	tti->tti_mult_trans = !req_is_replay(tgt_ses_req(tsi));
+}
+EXPORT_SYMBOL(tgt_mult_trans_set);
+
 /*
  * last_rcvd & last_committed update callbacks
  */
@@ -739,8 +753,12 @@ int tgt_last_rcvd_update(const struct lu_env *env, struct lu_target *tgt,
 	CDEBUG(D_INODE, "transno = "LPU64", last_committed = "LPU64"\n",
 	       tti->tti_transno, tgt->lut_obd->obd_last_committed);
 
-	req->rq_transno = tti->tti_transno;
-	lustre_msg_set_transno(req->rq_repmsg, tti->tti_transno);
+	/* with several transactions, reply with the highest transno and not
+	 * with the one of the last, possibly failed, transaction */
+	if (!tti->tti_mult_trans || tti->tti_transno > req->rq_transno) {
+		req->rq_transno = tti->tti_transno;
+		lustre_msg_set_transno(req->rq_repmsg, tti->tti_transno);
+	}
 
 	/* if can't add callback, do sync write */
 	th->th_sync |= !!tgt_last_commit_cb_add(th, tgt, req->rq_export,
@@ -67,6 +67,7 @@ sem_t sem;
 char usage[] =
 "Usage: %s filename command-sequence [path...]\n"
 "    command-sequence items:\n"
+"	 a[R|W]start,end request a lock-ahead lock on bytes [start, end]\n"
 "	 c  close\n"
 "	 B[num] call setstripe ioctl to create stripes\n"
 "	 C[num] create with optional stripes\n"
@@ -218,6 +219,8 @@ int main(int argc, char **argv)
 	lustre_fid		 fid;
 	struct timespec		 ts;
 	struct lov_user_md_v3	 lum;
+	struct lu_lock_ahead_extent lle;
+	char			*end;
 	__u64			 dv;
 
         if (argc < 3) {
@@ -292,6 +295,38 @@ int main(int argc, char **argv)
                                 exit(save_errno);
                         }
                         break;
+		case 'a':
+			commands++;
+			switch (*commands) {
+			case 'R':
+				flags = LLA_READ;
+				break;
+			case 'W':
+				flags = LLA_WRITE;
+				break;
+			default:
+				errx(-1, "unknown mode: %c", *commands);
+			}
+
+			memset(&lle, 0, sizeof(lle));
+			lle.lle_start = strtoull(commands + 1, &end, 0);
+			if (*end != ',')
+				errx(-1, "bad extent: %s", commands + 1);
+			lle.lle_end = strtoull(end + 1, &end, 0);
+			commands = end - 1;
+
+			rc = llapi_lock_ahead(fd, flags, &lle, 1);
+			if (rc == 0)
+				rc = lle.lle_result;
+			if (rc < 0) {
+				save_errno = -rc;
+				fprintf(stderr, "lock_ahead [%llu, %llu]: %s\n",
+					(unsigned long long)lle.lle_start,
+					(unsigned long long)lle.lle_end,
+					strerror(save_errno));
+				exit(save_errno);
+			}
+			break;
 		case 'e':
 			commands++;
 			switch (*commands) {
@@ -5493,6 +5493,11 @@ export ORIG_CSUM_TYPE="`lctl get_param -n osc.*osc-[^mM]*.checksum_type |
                         sed 's/.*\[\(.*\)\].*/\1/g' | head -n1`"
 CKSUM_TYPES=${CKSUM_TYPES:-"crc32 adler"}
 [ "$ORIG_CSUM_TYPE" = "crc32c" ] && CKSUM_TYPES="$CKSUM_TYPES crc32c"
+# the T10-PI style types are only offered if both ends support them
+for algo in t10ip512 t10ip4k; do
+	lctl get_param -n osc.*osc-[^mM]*.checksum_type | grep -qw $algo &&
+		CKSUM_TYPES="$CKSUM_TYPES $algo"
+done
 set_checksum_type()
 {
 	lctl set_param -n osc.*osc-[^mM]*.checksum_type $1
@@ -5642,6 +5647,28 @@ test_77j() { # bug 13805
 }
 run_test 77j "client only supporting ADLER32"
 
+test_77k() { # T10-PI style checksums are opt-in
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	$GSS && skip "could not run with gss" && return
+	lctl get_param -n osc.*osc-[^mM]*.checksum_type | grep -qw t10ip512 ||
+		{ skip "T10-PI checksum types not supported" && return; }
+	remount_client $MOUNT
+	sleep 2 # wait async osc connect to finish
+	for VALUE in $(lctl get_param osc.*osc-[^mM]*.checksum_type); do
+		PARAM=$(echo $VALUE | cut -d "=" -f1)
+		algo=$(lctl get_param -n $PARAM | sed 's/.*\[\(.*\)\].*/\1/g')
+		[[ "$algo" != t10ip* ]] || error "algo $algo selected by default"
+	done
+	set_checksum_type t10ip4k
+	for VALUE in $(lctl get_param osc.*osc-[^mM]*.checksum_type); do
+		PARAM=$(echo $VALUE | cut -d "=" -f1)
+		algo=$(lctl get_param -n $PARAM | sed 's/.*\[\(.*\)\].*/\1/g')
+		[ "$algo" = "t10ip4k" ] || error "algo $algo, not t10ip4k"
+	done
+	remount_client $MOUNT
+}
+run_test 77k "T10-PI checksum types are only used when chosen"
+
 [ "$ORIG_CSUM" ] && set_checksums $ORIG_CSUM || true
 rm -f $F77_TMP
 unset F77_TMP
@@ -6201,6 +6228,101 @@ test_101f() {
 }
 run_test 101f "check read-ahead for max_read_ahead_whole_mb"
 
+test_101g() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local file=$DIR/$tfile
+	local size_mb=64
+	local half=$((size_mb / 2))
+	local cmd="o"
+	local i
+
+	$LCTL get_param -n llite.*.max_read_ahead_streams > /dev/null ||
+		{ skip "no multi-stream read-ahead support" && return; }
+
+	dd if=/dev/zero of=$file bs=1M count=$size_mb 2>/dev/null ||
+		error "dd $file failed"
+
+	# two sequential streams interleaved on the same file descriptor
+	for ((i = 0; i < half; i++)); do
+		cmd+="z$((i << 20))r1048576z$(((half + i) << 20))r1048576"
+	done
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+	$MULTIOP $file ${cmd}c || error "interleaved read of $file failed"
+
+	local resumed=$($LCTL get_param -n llite.*.read_ahead_stats |
+			get_named_value 'read stream resumed' |
+			cut -d" " -f1 | calc_total)
+	local miss=$($LCTL get_param -n llite.*.read_ahead_stats |
+		     get_named_value 'misses' | cut -d" " -f1 | calc_total)
+	$LCTL get_param llite.*.read_ahead_stats
+	[[ $resumed -gt 0 ]] || error "interleaved streams not tracked"
+	# without stream tracking every 1MB read misses all 256 pages
+	[[ $miss -lt $((size_mb * 256 / 2)) ]] ||
+		error "too many misses ($miss) for interleaved streams"
+
+	# one stream reading the file backward
+	cmd="o"
+	for ((i = size_mb - 1; i >= 0; i--)); do
+		cmd+="z$((i << 20))r1048576"
+	done
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+	$LCTL set_param -n llite.*.read_ahead_streams 0
+	$MULTIOP $file ${cmd}c || error "backward read of $file failed"
+
+	local reverse=$($LCTL get_param -n llite.*.read_ahead_stats |
+			get_named_value 'reverse read-ahead' |
+			cut -d" " -f1 | calc_total)
+	$LCTL get_param llite.*.read_ahead_stats
+	[[ $reverse -gt 0 ]] || error "backward read not detected"
+
+	# the stream is recorded on close, and once the backward window has
+	# built up most of its pages are read-ahead hits
+	$LCTL get_param llite.*.read_ahead_streams
+	local stream=($($LCTL get_param -n llite.*.read_ahead_streams |
+			awk '$2 == "bwd" { print $5, $6 }'))
+	[[ -n "${stream[0]}" ]] || error "backward stream not recorded"
+	[[ ${stream[0]} -gt ${stream[1]} ]] ||
+		error "backward stream hits ${stream[0]} <= misses ${stream[1]}"
+	rm -f $file
+}
+run_test 101g "check read-ahead for interleaved and backward streams"
+
+test_101h() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local file=$DIR/$tfile
+	local size_mb=64
+
+	local old_async=$($LCTL get_param -n llite.*.read_ahead_async |
+			  head -n 1)
+	[ -z "$old_async" ] &&
+		skip "no asynchronous read-ahead support" && return
+
+	dd if=/dev/zero of=$file bs=1M count=$size_mb 2>/dev/null ||
+		error "dd $file failed"
+	$LCTL set_param -n llite.*.read_ahead_async 1
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+
+	dd if=$file of=/dev/null bs=1M 2>/dev/null
+	local rc=$?
+	$LCTL set_param -n llite.*.read_ahead_async $old_async
+	[ $rc -eq 0 ] || error "read $file failed"
+
+	local async=$($LCTL get_param -n llite.*.read_ahead_stats |
+		      get_named_value 'async read-ahead' |
+		      cut -d" " -f1 | calc_total)
+	local miss=$($LCTL get_param -n llite.*.read_ahead_stats |
+		     get_named_value 'misses' | cut -d" " -f1 | calc_total)
+	$LCTL get_param llite.*.read_ahead_stats
+	[[ $async -gt 0 ]] || error "no asynchronous read-ahead issued"
+	[[ $miss -lt $((size_mb * 256 / 10)) ]] ||
+		error "too many misses ($miss) with asynchronous read-ahead"
+	rm -f $file
+}
+run_test 101h "check asynchronous read-ahead of sequential reads"
+
 setup_test102() {
 	test_mkdir -p $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -7860,6 +7982,44 @@ test_123b () { # statahead(bug 15027)
 }
 run_test 123b "not panic with network error in statahead enqueue (bug 15027)"
 
+test_123c() { # batched statahead getattr
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	[ -z "$($LCTL get_param -n mdc.*.connect_flags | grep batch_rpc)" ] &&
+		skip "no batch RPC support on server" && return 0
+
+	local nr=500
+	local batch=$($LCTL get_param -n mdc.*MDT0000*.max_getattr_batch |
+		      head -n 1)
+
+	test_mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/$tfile-%d $nr ||
+		error "failed to create $nr files"
+
+	do_facet $SINGLEMDS $LCTL set_param mds.MDS.mdt.stats=clear
+	$LCTL set_param mdc.*.max_getattr_batch=16
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	[ $(ls -l $DIR/$tdir | grep -c $tfile) -eq $nr ] ||
+		error "ls with batched statahead failed"
+	$LCTL get_param -n llite.*.statahead_stats
+
+	local batches=$(do_facet $SINGLEMDS $LCTL get_param -n \
+			mds.MDS.mdt.stats | awk '/mds_batch/ { print $2 }')
+	log "$batches batch RPCs for $nr entries"
+	[ -n "$batches" ] && [ $batches -gt 0 ] ||
+		error "no getattr was batched"
+
+	$LCTL set_param mdc.*.max_getattr_batch=0
+	cancel_lru_locks mdc
+	cancel_lru_locks osc
+	[ $(ls -l $DIR/$tdir | grep -c $tfile) -eq $nr ] ||
+		error "ls without batched statahead failed"
+
+	$LCTL set_param mdc.*.max_getattr_batch=$batch
+	rm -rf $DIR/$tdir
+}
+run_test 123c "statahead getattr batched in MDS_BATCH RPC"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
 	[ -z "$($LCTL get_param -n mdc.*.connect_flags | grep lru_resize)" ] &&
@@ -8990,6 +9150,38 @@ test_133g() {
 }
 run_test 133g "Check for Oopses on bad io area writes/reads in /proc"
 
+test_133h() {
+	local magic=$((0x4c535442))
+	local stats
+	local bin
+
+	stats=$(ls /proc/fs/lustre/llite/*/stats 2>/dev/null | head -n 1)
+	bin=${stats}_binary
+	[ -f "$bin" ] || { skip "no binary stats export" && return; }
+
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=1 2>/dev/null ||
+		error "dd $DIR/$tfile failed"
+	cat $DIR/$tfile > /dev/null
+
+	local size=$(cat $bin | wc -c)
+	local hdr_magic=$(od -An -tu4 -N4 $bin | tr -d ' ')
+	local count=$(od -An -tu2 -j6 -N2 $bin | tr -d ' ')
+	local cntr_size=$(od -An -tu4 -j8 -N4 $bin | tr -d ' ')
+
+	[ "$hdr_magic" == "$magic" ] ||
+		error "bad magic $hdr_magic in $bin, expected $magic"
+	[ $size -eq $((24 + count * cntr_size)) ] ||
+		error "$bin is $size bytes for $count counters of $cntr_size"
+
+	# every counter with samples in the text file is in the binary one
+	local name
+	for name in $(awk 'NR > 1 { print $1 }' $stats); do
+		grep -q -a "$name" $bin || error "$name missing in $bin"
+	done
+	rm -f $DIR/$tfile
+}
+run_test 133h "Verifying binary stats export ==============================="
+
 test_140() { #bug-17379
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
         test_mkdir -p $DIR/$tdir || error "Creating dir $DIR/$tdir"
@@ -9918,6 +10110,181 @@ test_160c() {
 }
 run_test 160c "verify that changelog log catch the truncate event"
 
+test_160d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local CL_USERS="mdd.$MDT0.changelog_users"
+	local GET_CL_USERS="do_facet $SINGLEMDS $LCTL get_param -n $CL_USERS"
+	local USERS=$(( $($GET_CL_USERS | wc -l) - 2 ))
+	[ $USERS -eq 0 ] ||
+		{ skip "$USERS other changelog users"; return; }
+
+	local USER=$(do_facet $SINGLEMDS $LCTL --device $MDT0 \
+		changelog_register -n -m MKDIR)
+	echo "Registered as changelog user $USER for MKDIR only"
+
+	mkdir -p $DIR/$tdir || error "mkdir $tdir failed"
+	touch $DIR/$tdir/f0 || error "touch f0 failed"
+	mkdir $DIR/$tdir/d0 || error "mkdir d0 failed"
+
+	local CREATS=$($LFS changelog $MDT0 | grep -c "CREAT.*f0")
+	local MKDIRS=$($LFS changelog $MDT0 | grep -c "MKDIR.*d0")
+	[ $MKDIRS -eq 1 ] || error "MKDIR count $MKDIRS != 1"
+	[ $CREATS -eq 0 ] || error "CREAT logged without a user for it"
+
+	local CUR=$($GET_CL_USERS | head -n1 | cut -f3 -d' ')
+	local LAG=$($GET_CL_USERS | awk "\$1 == \"$USER\" {print \$3}")
+	local REC=$($GET_CL_USERS | awk "\$1 == \"$USER\" {print \$2}")
+	echo "verifying user lag: $LAG == $CUR - $REC"
+	[ $LAG -eq $((CUR - REC)) ] || error "lag $LAG != $((CUR - REC))"
+
+	do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_deregister $USER
+}
+run_test 160d "changelog records only the types wanted by users"
+
+test_160e() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local CL_USERS="mdd.$MDT0.changelog_users"
+	local GET_CL_USERS="do_facet $SINGLEMDS $LCTL get_param -n $CL_USERS"
+	local IDLE="mdd.$MDT0.changelog_max_idle_indexes"
+	local OLD_IDLE=$(do_facet $SINGLEMDS $LCTL get_param -n $IDLE)
+	local USERS=$(( $($GET_CL_USERS | wc -l) - 2 ))
+	[ $USERS -eq 0 ] ||
+		{ skip "$USERS other changelog users"; return; }
+
+	local USER=$(do_facet $SINGLEMDS $LCTL --device $MDT0 \
+		changelog_register -n)
+	echo "Registered as changelog user $USER"
+	local USER2=$(do_facet $SINGLEMDS $LCTL --device $MDT0 \
+		changelog_register -n)
+	echo "Registered as changelog user $USER2"
+
+	mkdir -p $DIR/$tdir || error "mkdir $tdir failed"
+	touch $DIR/$tdir/f0 || error "touch f0 failed"
+	$LFS changelog_clear $MDT0 $USER2 0 ||
+		error "changelog_clear $USER2 failed"
+	local REC2=$($GET_CL_USERS | awk "\$1 == \"$USER2\" {print \$2}")
+
+	do_facet $SINGLEMDS $LCTL set_param $IDLE=20
+	createmany -o $DIR/$tdir/f 40 || error "createmany failed"
+	sleep 2
+	do_facet $SINGLEMDS $LCTL set_param $IDLE=$OLD_IDLE
+
+	if $GET_CL_USERS | grep -q "^$USER "; then
+		do_facet $SINGLEMDS $LCTL --device $MDT0 \
+			changelog_deregister $USER
+		do_facet $SINGLEMDS $LCTL --device $MDT0 \
+			changelog_deregister $USER2
+		error "idle user $USER was not deregistered"
+	fi
+
+	# the records only the deregistered user was holding are purged
+	local FIRST=$($LFS changelog $MDT0 | head -n1 | awk '{ print $1 }')
+	do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_deregister $USER2
+	echo "first record $FIRST, $USER2 cleared up to $REC2"
+	[ -n "$FIRST" ] && [ $FIRST -le $REC2 ] &&
+		error "record $FIRST kept after $USER was deregistered"
+	return 0
+}
+run_test 160e "changelog user lagging too much is deregistered"
+
+test_160f() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local CL_USERS="mdd.$MDT0.changelog_users"
+	local GET_CL_USERS="do_facet $SINGLEMDS $LCTL get_param -n $CL_USERS"
+	local nfiles=2000
+	# long names, so that the records fill many CL_BATCH messages
+	local name=$DIR/$tdir/$(printf "%0100d" 0)_
+	local out=$TMP/$tfile.changelog
+
+	local USER=$(do_facet $SINGLEMDS $LCTL --device $MDT0 \
+		changelog_register -n)
+	echo "Registered as changelog user $USER"
+	local REC=$($GET_CL_USERS | awk "\$1 == \"$USER\" {print \$2}")
+
+	mkdir -p $DIR/$tdir || error "mkdir $tdir failed"
+	createmany -o $name $nfiles || error "createmany failed"
+
+	$LFS changelog $MDT0 $((REC + 1)) > $out ||
+		error "lfs changelog failed"
+	local CREATS=$(grep -c "CREAT.*$(basename $name)" $out)
+	echo "$CREATS CREAT records in $(wc -l < $out) records"
+	[ $CREATS -eq $nfiles ] || error "CREAT count $CREATS != $nfiles"
+
+	# records from several batches come in order, none lost or repeated
+	awk -v first=$((REC + 1)) '$1 != first + NR - 1 {
+		print "record " NR " has index " $1; bad = 1; exit }
+		END { exit bad }' $out ||
+		error "changelog indexes are not consecutive"
+
+	$LFS changelog_clear $MDT0 $USER 0
+	do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_deregister $USER
+	unlinkmany $name $nfiles || error "unlinkmany failed"
+	rm -f $out
+}
+run_test 160f "changelog records are read in batches without loss"
+
+test_160g() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+
+	local CL_USERS="mdd.$MDT0.changelog_users"
+	local GET_CL_USERS="do_facet $SINGLEMDS $LCTL get_param -n $CL_USERS"
+	local MDT_DEV=$(mdsdevname ${SINGLEMDS//mds/})
+	local nfiles=500
+	local count
+
+	local USER=$(do_facet $SINGLEMDS $LCTL --device $MDT0 \
+		changelog_register -n)
+	echo "Registered as changelog user $USER"
+	local REC=$($GET_CL_USERS | awk "\$1 == \"$USER\" {print \$2}")
+
+	# start a new plain llog every 10 records, so that the catalog
+	# has many of them to be processed in parallel at mount
+	#define OBD_FAIL_CAT_RECORDS	0x1312
+	do_facet $SINGLEMDS $LCTL set_param fail_loc=0x1312 fail_val=10
+	mkdir -p $DIR/$tdir || error "mkdir $tdir failed"
+	createmany -o $DIR/$tdir/$tfile- $nfiles
+	local rc=$?
+	do_facet $SINGLEMDS $LCTL set_param fail_loc=0 fail_val=0
+	[ $rc -eq 0 ] || error "createmany failed"
+
+	count=$($LFS changelog $MDT0 $((REC + 1)) | grep -c CREAT)
+	echo "$count CREAT records before MDT restart"
+	[ $count -eq $nfiles ] || error "CREAT count $count != $nfiles"
+
+	# plain llogs holding records are kept
+	stop $SINGLEMDS || error "Fail to stop MDT."
+	start $SINGLEMDS $MDT_DEV $MDS_MOUNT_OPTS || error "Fail to start MDT."
+	count=$($LFS changelog $MDT0 $((REC + 1)) | grep -c CREAT)
+	echo "$count CREAT records after MDT restart"
+	[ $count -eq $nfiles ] || error "CREAT count $count != $nfiles"
+
+	# empty plain llogs are destroyed, and their catalog records
+	# cancelled, by the parallel processing at mount
+	$LFS changelog_clear $MDT0 $USER 0
+	stop $SINGLEMDS || error "Fail to stop MDT."
+	start $SINGLEMDS $MDT_DEV $MDS_MOUNT_OPTS || error "Fail to start MDT."
+	count=$($LFS changelog $MDT0 $((REC + 1)) | wc -l)
+	[ $count -eq 0 ] || error "$count records left after clear"
+
+	# the catalog is still usable
+	touch $DIR/$tdir/$tfile-new
+	$LFS changelog $MDT0 | grep -q "CREAT.*$tfile-new" ||
+		error "no CREAT record after MDT restart"
+
+	$LFS changelog_clear $MDT0 $USER 0
+	do_facet $SINGLEMDS $LCTL --device $MDT0 changelog_deregister $USER
+	unlinkmany $DIR/$tdir/$tfile- $nfiles || error "unlinkmany failed"
+	rm -f $DIR/$tdir/$tfile-new
+}
+run_test 160g "catalog with many plain llogs is processed in parallel at mount"
+
 test_161a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
 	test_mkdir -p -c1 $DIR/$tdir
@@ -11396,37 +11763,39 @@ test_215() { # for bugs 18102, 21079, 21517
 
 	# /proc/sys/lnet/routes should look like this:
 	# Routing disabled/enabled
-	# net hops priority state router
+	# net hops priority state router sent util
 	# where net is a string like tcp0, hops > 0, priority >= 0,
-	# state is up/down,
-	# router is a string like 192.168.1.1@tcp2
+	# state is up/down, router is a string like 192.168.1.1@tcp2,
+	# sent >= 0, util is a percentage
 	L1="^Routing (disabled|enabled)$"
-	L2="^net +hops +priority +state +router$"
-	BR="^$NET +$N +(0|1) +(up|down) +$NID$"
+	L2="^net +hops +priority +state +router +sent +util$"
+	BR="^$NET +$N +(0|1) +(up|down) +$NID +$N +$N$"
 	create_lnet_proc_files "routes"
 	check_lnet_proc_entry "routes.out" "/proc/sys/lnet/routes" "$BR" "$L1" "$L2"
 	check_lnet_proc_entry "routes.sys" "lnet.routes" "$BR" "$L1" "$L2"
 	remove_lnet_proc_files "routes"
 
 	# /proc/sys/lnet/routers should look like this:
-	# ref rtr_ref alive_cnt state last_ping ping_sent deadline down_ni router
+	# ref rtr_ref alive_cnt state last_ping ping_sent deadline down_ni
+	# router rtt load
 	# where ref > 0, rtr_ref > 0, alive_cnt >= 0, state is up/down,
 	# last_ping >= 0, ping_sent is boolean (0/1), deadline and down_ni are
-	# numeric (0 or >0 or <0), router is a string like 192.168.1.1@tcp2
-	L1="^ref +rtr_ref +alive_cnt +state +last_ping +ping_sent +deadline +down_ni +router$"
-	BR="^$P +$P +$N +(up|down) +$N +(0|1) +$I +$I +$NID$"
+	# numeric (0 or >0 or <0), router is a string like 192.168.1.1@tcp2,
+	# rtt >= 0, load is numeric
+	L1="^ref +rtr_ref +alive_cnt +state +last_ping +ping_sent +deadline +down_ni +router +rtt +load$"
+	BR="^$P +$P +$N +(up|down) +$N +(0|1) +$I +$I +$NID +$N +$I$"
 	create_lnet_proc_files "routers"
 	check_lnet_proc_entry "routers.out" "/proc/sys/lnet/routers" "$BR" "$L1"
 	check_lnet_proc_entry "routers.sys" "lnet.routers" "$BR" "$L1"
 	remove_lnet_proc_files "routers"
 
 	# /proc/sys/lnet/peers should look like this:
-	# nid refs state last max rtr min tx min queue
+	# nid refs state last max rtr min tx min queue sent recv
 	# where nid is a string like 192.168.1.1@tcp2, refs > 0,
 	# state is up/down/NA, max >= 0. last, rtr, min, tx, min are
-	# numeric (0 or >0 or <0), queue >= 0.
-	L1="^nid +refs +state +last +max +rtr +min +tx +min +queue$"
-	BR="^$NID +$P +(up|down|NA) +$I +$N +$I +$I +$I +$I +$N$"
+	# numeric (0 or >0 or <0), queue, sent and recv >= 0.
+	L1="^nid +refs +state +last +max +rtr +min +tx +min +queue +sent +recv$"
+	BR="^$NID +$P +(up|down|NA) +$I +$N +$I +$I +$I +$I +$N +$N +$N$"
 	create_lnet_proc_files "peers"
 	check_lnet_proc_entry "peers.out" "/proc/sys/lnet/peers" "$BR" "$L1"
 	check_lnet_proc_entry "peers.sys" "lnet.peers" "$BR" "$L1"
@@ -11443,12 +11812,13 @@ test_215() { # for bugs 18102, 21079, 21517
 	remove_lnet_proc_files "buffers"
 
 	# /proc/sys/lnet/nis should look like this:
-	# nid status alive refs peer rtr max tx min
+	# nid status alive refs peer rtr max tx min sent recv
 	# where nid is a string like 192.168.1.1@tcp2, status is up/down,
 	# alive is numeric (0 or >0 or <0), refs >= 0, peer >= 0,
-	# rtr >= 0, max >=0, tx and min are numeric (0 or >0 or <0).
-	L1="^nid +status +alive +refs +peer +rtr +max +tx +min$"
-	BR="^$NID +(up|down) +$I +$N +$N +$N +$N +$I +$I$"
+	# rtr >= 0, max >=0, tx and min are numeric (0 or >0 or <0),
+	# sent and recv >= 0.
+	L1="^nid +status +alive +refs +peer +rtr +max +tx +min +sent +recv$"
+	BR="^$NID +(up|down) +$I +$N +$N +$N +$N +$I +$I +$N +$N$"
 	create_lnet_proc_files "nis"
 	check_lnet_proc_entry "nis.out" "/proc/sys/lnet/nis" "$BR" "$L1"
 	check_lnet_proc_entry "nis.sys" "lnet.nis" "$BR" "$L1"
@@ -12408,6 +12778,433 @@ test_238() {
 }
 run_test 238 "Verify linkea consistency"
 
+osc_lru_in_list() {
+	$LCTL get_param -n osc.$FSNAME-OST0000-osc-[^mM]*.lru_partitions |
+		awk -F'[ ,]+' '/in_list/ { sum += $5 } END { print sum + 0 }'
+}
+
+test_239() { # per-CPT OSC page LRU
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local cache_limit=64
+	local pages_per_mb=$((1024 * 1024 / $(page_size)))
+
+	$LCTL get_param osc.$FSNAME-OST0000-osc-[^mM]*.lru_partitions ||
+		{ skip "no per-CPT LRU on client" && return; }
+
+	$SETSTRIPE -c 1 -i 0 $DIR/$tfile || error "setstripe failed"
+	trap cleanup_101a EXIT
+	$LCTL set_param -n llite.*.max_cached_mb $cache_limit
+
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=$((cache_limit * 2)) ||
+		error "dd write failed"
+	sync
+	$LCTL get_param osc.$FSNAME-OST0000-osc-[^mM]*.lru_partitions
+
+	local in_list=$(osc_lru_in_list)
+	[ $in_list -gt 0 ] || error "no page in any LRU partition"
+	[ $in_list -le $((cache_limit * pages_per_mb)) ] ||
+		error "$in_list LRU pages over limit $cache_limit MB"
+
+	$LCTL set_param osc.$FSNAME-OST0000-osc-[^mM]*.osc_cached_mb=0
+	local left=$(osc_lru_in_list)
+	[ $left -lt $in_list ] ||
+		error "LRU partitions not shrunk: $left/$in_list pages"
+
+	cleanup_101a
+	rm -f $DIR/$tfile
+}
+run_test 239 "OSC page LRU is partitioned per CPT"
+
+cleanup_240() {
+	$LCTL set_param -n osc.$FSNAME-OST0000-osc-[^mM]*.max_objs_per_rpc=$1
+	trap 0
+}
+
+test_240() { # multi-object OST_WRITE
+	local osc=osc.$FSNAME-OST0000-osc-[^mM]*
+	local nfiles=64
+	local old
+	local multi
+	local i
+
+	$LCTL get_param -n $osc.import | grep -q multiobj_brw ||
+		{ skip "OST does not support multi-object writes" && return; }
+
+	old=$($LCTL get_param -n $osc.max_objs_per_rpc | head -1)
+	trap "cleanup_240 $old" EXIT
+	$LCTL set_param -n $osc.max_objs_per_rpc=16
+
+	mkdir -p $DIR/$tdir
+	$SETSTRIPE -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	cancel_lru_locks osc
+	$LCTL set_param -n $osc.rpc_stats=0
+
+	for i in $(seq $nfiles); do
+		dd if=/dev/urandom of=$DIR/$tdir/f$i bs=4k count=1 2>/dev/null ||
+			error "write f$i failed"
+	done
+	local sums=$(cat $DIR/$tdir/f* | md5sum)
+	sync
+
+	$LCTL get_param $osc.rpc_stats
+	multi=$($LCTL get_param -n $osc.rpc_stats |
+		awk '/^objects per rpc/ { found = 1; next }
+		     found && $1 + 0 > 1 { sum += $2 } END { print sum + 0 }')
+	[ $multi -gt 0 ] || error "no RPC carried more than one object"
+
+	cancel_lru_locks osc
+	[ "$(cat $DIR/$tdir/f* | md5sum)" == "$sums" ] ||
+		error "data mismatch after multi-object write"
+
+	cleanup_240 $old
+	rm -rf $DIR/$tdir
+}
+run_test 240 "write small files with multi-object OST_WRITE RPCs"
+
+cleanup_241() {
+	do_facet $SINGLEMDS $LCTL set_param -n \
+		osp.$FSNAME-OST0000-osc-MDT0000.max_sync_batch=$1
+	trap 0
+}
+
+test_241() { # batched OST object destroy
+	local osp=osp.$FSNAME-OST0000-osc-MDT0000
+	local nfiles=500
+	local old
+	local before
+	local after
+
+	do_facet $SINGLEMDS $LCTL get_param -n $osp.import |
+		grep -q destroy_batch ||
+		{ skip "OST does not support batched destroy" && return; }
+
+	old=$(do_facet $SINGLEMDS $LCTL get_param -n $osp.max_sync_batch)
+	trap "cleanup_241 $old" EXIT
+	do_facet $SINGLEMDS $LCTL set_param -n $osp.max_sync_batch=64
+
+	mkdir -p $DIR/$tdir
+	$SETSTRIPE -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	createmany -o $DIR/$tdir/f $nfiles || error "createmany failed"
+	wait_delete_completed
+
+	before=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost.stats |
+		 awk '/^ost_destroy_batch / { print $2 }')
+	unlinkmany $DIR/$tdir/f $nfiles || error "unlinkmany failed"
+	wait_delete_completed
+	after=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost.stats |
+		awk '/^ost_destroy_batch / { print $2 }')
+
+	echo "ost_destroy_batch RPCs: ${before:-0} -> ${after:-0}"
+	[ ${after:-0} -gt ${before:-0} ] || error "no OST_DESTROY_BATCH sent"
+	[ $((after - ${before:-0})) -lt $nfiles ] ||
+		error "$((after - ${before:-0})) batches for $nfiles objects"
+
+	[ $(do_facet $SINGLEMDS $LCTL get_param -n $osp.sync_changes) -eq 0 ] ||
+		error "llog records left after destroy"
+
+	cleanup_241 $old
+	rm -rf $DIR/$tdir
+}
+run_test 241 "destroy OST objects with OST_DESTROY_BATCH RPCs"
+
+test_242() { # per-CPT ptlrpcd pools
+	local done
+
+	$LCTL get_param -n ptlrpcd_stats > /dev/null 2>&1 ||
+		{ skip "no ptlrpcd_stats" && return; }
+
+	$LCTL set_param -n ptlrpcd_stats=0
+	mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/f 100 || error "createmany failed"
+	sync
+	cancel_lru_locks osc
+
+	$LCTL get_param ptlrpcd_stats
+	$LCTL get_param -n ptlrpcd_stats | grep -q "^ptlrpcd_rcv:" ||
+		error "no ptlrpcd_rcv in ptlrpcd_stats"
+	# "ptlrpcd_CC_NN: cpt C, queued Q, in set S, done D, stolen T"
+	done=$($LCTL get_param -n ptlrpcd_stats |
+	       awk '/^ptlrpcd_[0-9]+_[0-9]+:/ { sum += $10 }
+		    END { print sum + 0 }')
+	[ $done -gt 0 ] || error "no async RPC completed by ptlrpcd threads"
+
+	unlinkmany $DIR/$tdir/f 100 || error "unlinkmany failed"
+	rm -rf $DIR/$tdir
+}
+run_test 242 "ptlrpcd threads per CPU partition report their RPCs"
+
+# "posted target" request buffers of the MDT service, summed over its CPTs
+mdt_req_buffers() {
+	# "cpt total posted target allocated freed filled/s..."
+	do_facet $SINGLEMDS $LCTL get_param -n mds.MDS.mdt.req_buffers |
+		awk '$1 ~ /^-?[0-9]+$/ { posted += $3; target += $4 }
+		     END { print posted + 0, target + 0 }'
+}
+
+test_243() { # elastic request buffer pools
+	local fcount=2000
+	local tcount=8
+	local counts
+	local posted0
+	local target0
+	local posted1
+	local target1
+	local posted
+	local target
+	local i
+
+	do_facet $SINGLEMDS $LCTL get_param -n mds.MDS.mdt.req_buffers \
+		> /dev/null 2>&1 ||
+		{ skip "no mds.MDS.mdt.req_buffers" && return; }
+
+	counts=$(mdt_req_buffers)
+	posted0=${counts% *}
+	target0=${counts#* }
+
+	# a burst of metadata RPCs raises the target and the posted buffers
+	mkdir -p $DIR/$tdir
+	for (( i=0; i < $tcount; i++ )) ; do
+		mkdir $DIR/$tdir/$i
+		createmany -o $DIR/$tdir/$i/f- $fcount &
+	done
+	wait
+
+	do_facet $SINGLEMDS $LCTL get_param mds.MDS.mdt.req_buffers
+	counts=$(mdt_req_buffers)
+	posted1=${counts% *}
+	target1=${counts#* }
+	[ $target1 -gt $target0 ] ||
+		error "target $target1 did not grow from $target0"
+	[ $posted1 -gt $posted0 ] ||
+		error "posted $posted1 did not grow from $posted0"
+
+	for (( i=0; i < $tcount; i++ )) ; do
+		unlinkmany $DIR/$tdir/$i/f- $fcount &
+	done
+	wait
+	rm -rf $DIR/$tdir
+	counts=$(mdt_req_buffers)
+	posted=${counts% *}
+	[ $posted -gt $posted1 ] && posted1=$posted
+
+	# once the burst is out of the history, the surplus is unlinked
+	for (( i=0; i < 60; i += 2 )) ; do
+		counts=$(mdt_req_buffers)
+		posted=${counts% *}
+		target=${counts#* }
+		[ $target -le $target0 -a $posted -lt $posted1 ] && break
+		sleep 2
+	done
+	do_facet $SINGLEMDS $LCTL get_param mds.MDS.mdt.req_buffers
+	[ $target -le $target0 ] ||
+		error "target $target did not drop back to $target0"
+	[ $posted -lt $posted1 ] ||
+		error "posted $posted did not drop from $posted1"
+}
+run_test 243 "request buffer pools follow the offered load"
+
+test_244() { # per-CPT encryption page pools
+	local param=sptlrpc.encrypt_page_pools
+	local npools
+	local bad
+
+	$LCTL get_param -n $param > /dev/null 2>&1 ||
+		{ skip "no $param" && return; }
+
+	$LCTL get_param $param
+	npools=$($LCTL get_param -n $param | grep -c "^cpt:")
+	[ $npools -ge 1 ] || error "no per-CPT pool in $param"
+
+	bad=$($LCTL get_param -n $param |
+	      awk '/^total pages:/ { total = $3 }
+		   /^total free:/ { if ($3 > total) bad++ }
+		   END { print bad + 0 }')
+	[ $bad -eq 0 ] || error "$bad pools with more free than total pages"
+}
+run_test 244 "encryption page pools are partitioned per CPT"
+
+cleanup_245() {
+	do_facet ost1 $LCTL set_param ost.OSS.ost_io.nrs_policies=fifo
+	trap 0
+}
+
+test_245() { # deadline NRS policy
+	local svc=ost.OSS.ost_io
+	local handled
+	local val
+
+	remote_ost_nodsh && skip "remote OST with nodsh" && return
+	do_facet ost1 $LCTL get_param -n $svc.nrs_policies |
+		grep -q "name: deadline" ||
+		{ skip "no deadline NRS policy on ost1" && return; }
+
+	do_facet ost1 $LCTL set_param $svc.nrs_policies=deadline ||
+		error "failed to start the deadline policy"
+	trap cleanup_245 EXIT
+
+	for val in 0 -1 1025 abc 10x reg_factor:0 hp_factor:2000; do
+		do_facet ost1 $LCTL set_param $svc.nrs_deadline_factor=$val &&
+			error "factor '$val' was accepted"
+	done
+	do_facet ost1 $LCTL set_param $svc.nrs_deadline_factor=32 ||
+		error "failed to set the factor to 32"
+	do_facet ost1 $LCTL get_param -n $svc.nrs_deadline_factor |
+		grep -q "^reg_factor:32" || error "factor is not 32"
+
+	mkdir -p $DIR/$tdir
+	$SETSTRIPE -c 1 -i 0 $DIR/$tdir || error "setstripe failed"
+	dd if=/dev/zero of=$DIR/$tdir/$tfile bs=1M count=20 oflag=direct ||
+		error "dd write failed"
+	dd if=$DIR/$tdir/$tfile of=/dev/null bs=1M iflag=direct ||
+		error "dd read failed"
+
+	do_facet ost1 $LCTL get_param $svc.nrs_deadline_stats
+	do_facet ost1 $LCTL get_param -n $svc.nrs_deadline_stats |
+		grep -q "^  factor: 32" || error "stats do not show factor 32"
+	# "  - { class: ost_write, handled: N, svc_time: N, target: N }"
+	handled=$(do_facet ost1 $LCTL get_param -n $svc.nrs_deadline_stats |
+		  awk '/class: ost_write,/ { gsub(",", ""); sum += $6 }
+		       END { print sum + 0 }')
+	[ $handled -ge 20 ] ||
+		error "only $handled OST_WRITE handled by the deadline policy"
+
+	cleanup_245
+	rm -rf $DIR/$tdir
+}
+run_test 245 "deadline NRS policy tunables and statistics"
+
+test_246() { # BRW into partly allocated objects
+	local file=$DIR/$tdir/$tfile
+	local ref=$TMP/$tfile.ref
+	local new=$TMP/$tfile.new
+	local chunks=32
+	local blocks
+	local expect
+	local i
+
+	[ "$(facet_fstype ost1)" = "ldiskfs" ] ||
+		{ skip "ldiskfs only test" && return; }
+
+	mkdir -p $DIR/$tdir
+	$SETSTRIPE -c 1 -i 0 $file || error "setstripe failed"
+	rm -f $ref
+
+	# a sparse object: 4KB allocated every 64KB
+	for ((i = 0; i < chunks; i++)); do
+		dd if=/dev/urandom of=$new bs=4k count=1 2>/dev/null
+		dd if=$new of=$ref bs=4k seek=$((i * 16)) conv=notrunc \
+			2>/dev/null || error "dd $ref chunk $i failed"
+		dd if=$new of=$file bs=4k seek=$((i * 16)) conv=notrunc \
+			oflag=direct 2>/dev/null || error "dd chunk $i failed"
+	done
+
+	# one 1MB BRW from 32KB on, over 16 allocated extents and the holes
+	# between them
+	dd if=/dev/urandom of=$new bs=1M count=1 2>/dev/null
+	dd if=$new of=$ref bs=1M count=1 seek=32768 oflag=seek_bytes \
+		conv=notrunc 2>/dev/null || error "dd $ref overwrite failed"
+	dd if=$new of=$file bs=1M count=1 seek=32768 oflag=seek_bytes,direct \
+		conv=notrunc || error "dd overwrite failed"
+
+	sync
+	cancel_lru_locks osc
+	cmp $ref $file || error "data differ after the partial overwrite"
+
+	# the first chunk, the 1MB overwrite, and the chunks past it
+	expect=$(( (4 + 1024 + (chunks - 17) * 4) * 2 ))
+	blocks=$(stat -c %b $file)
+	echo "$blocks blocks, $expect expected for the data"
+	# extent tree blocks come on top of the data
+	[ $blocks -ge $expect -a $blocks -le $((expect + 128)) ] ||
+		error "$blocks blocks, expected $expect"
+
+	# a pure overwrite of allocated blocks allocates nothing
+	dd if=/dev/urandom of=$new bs=1M count=1 2>/dev/null
+	dd if=$new of=$ref bs=1M count=1 seek=32768 oflag=seek_bytes \
+		conv=notrunc 2>/dev/null || error "dd $ref rewrite failed"
+	dd if=$new of=$file bs=1M count=1 seek=32768 oflag=seek_bytes,direct \
+		conv=notrunc || error "dd rewrite failed"
+
+	sync
+	cancel_lru_locks osc
+	cmp $ref $file || error "data differ after the rewrite"
+	[ $(stat -c %b $file) -eq $blocks ] ||
+		error "blocks changed from $blocks to $(stat -c %b $file)"
+
+	rm -f $ref $new $file
+}
+run_test 246 "BRW across allocated extents and holes of an object"
+
+mdt_reply_cache() {
+	# "cpt cached hits misses"
+	do_facet $SINGLEMDS $LCTL get_param -n mds.MDS.mdt.reply_cache |
+		awk '$1 ~ /^-?[0-9]+$/ { c += $2; h += $3; m += $4 }
+		     END { print c + 0, h + 0, m + 0 }'
+}
+
+cleanup_247() {
+	do_facet $SINGLEMDS \
+		"echo $1 > /sys/module/ptlrpc/parameters/rep_cache_max"
+	trap 0
+}
+
+test_247() { # reply state cache
+	local param=/sys/module/ptlrpc/parameters/rep_cache_max
+	local MDT_DEV=$(mdsdevname ${SINGLEMDS//mds/})
+	local fcount=2000
+	local ncpts
+	local max
+	local stats
+
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+	do_facet $SINGLEMDS $LCTL get_param -n mds.MDS.mdt.reply_cache \
+		> /dev/null 2>&1 ||
+		{ skip "no mds.MDS.mdt.reply_cache" && return; }
+
+	max=$(do_facet $SINGLEMDS cat $param)
+	ncpts=$(do_facet $SINGLEMDS $LCTL get_param -n mds.MDS.mdt.reply_cache |
+		awk '$1 ~ /^-?[0-9]+$/' | wc -l)
+	trap "cleanup_247 $max" EXIT
+
+	stats=($(mdt_reply_cache))
+	local hits0=${stats[1]}
+	local misses0=${stats[2]}
+
+	# small metadata replies are recycled, not allocated one by one
+	mkdir -p $DIR/$tdir
+	createmany -o $DIR/$tdir/f- $fcount || error "createmany failed"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+
+	stats=($(mdt_reply_cache))
+	local hits=$((${stats[1]} - hits0))
+	local misses=$((${stats[2]} - misses0))
+	echo "${stats[0]} cached, $hits hits, $misses misses"
+	[ $hits -ge $fcount ] || error "only $hits replies from the cache"
+	[ $misses -lt $hits ] || error "$misses misses for $hits hits"
+	[ ${stats[0]} -le $((max * ncpts)) ] ||
+		error "${stats[0]} cached, more than $max on $ncpts CPTs"
+
+	# without room in the cache, it drains as replies are sent
+	do_facet $SINGLEMDS "echo 0 > $param"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	stats=($(mdt_reply_cache))
+	[ ${stats[0]} -eq 0 ] || error "${stats[0]} cached with no room"
+	cleanup_247 $max
+
+	# the cache is emptied when the service stops
+	createmany -o $DIR/$tdir/g- 100 || error "createmany failed"
+	stop $SINGLEMDS || error "Fail to stop MDT."
+	start $SINGLEMDS $MDT_DEV $MDS_MOUNT_OPTS || error "Fail to start MDT."
+	client_up || error "client_up failed"
+
+	unlinkmany $DIR/$tdir/f- $fcount || error "unlinkmany failed"
+	unlinkmany $DIR/$tdir/g- 100 || error "unlinkmany failed"
+	rm -rf $DIR/$tdir
+}
+run_test 247 "small reply states are recycled per service partition"
+
 test_striped_dir() {
 	local mdt_index=$1
 	local stripe_count
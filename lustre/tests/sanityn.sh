@@ -2666,6 +2666,345 @@ test_76() { #LU-946
 }
 run_test 76 "Verify open file for 2048 files"
 
+# run a TBF rule command on the ost_io service of ost1
+tbf_rule() {
+	do_facet ost1 $LCTL set_param ost.OSS.ost_io.nrs_tbf_rule=\"$*\"
+}
+
+tbf_rules() {
+	do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.nrs_tbf_rule
+}
+
+tbf_nid() {
+	$LCTL list_nids | head -n1
+}
+
+tbf_setup() {
+	remote_ost_nodsh && skip "remote OST with nodsh" && return 1
+	do_facet ost1 $LCTL set_param ost.OSS.ost_io.nrs_policies=\"tbf nid\" ||
+		error "failed to start the TBF NID policy"
+	return 0
+}
+
+tbf_cleanup() {
+	do_facet ost1 $LCTL set_param ost.OSS.ost_io.nrs_policies=fifo
+}
+
+# time in seconds taken by $1 4KB O_DIRECT writes to ost1, one RPC each
+tbf_write_time() {
+	local start=$(date +%s.%N)
+
+	dd if=/dev/zero of=$DIR1/$tfile bs=4k count=$1 oflag=direct ||
+		error "dd to $DIR1/$tfile failed"
+	awk -v start=$start -v end=$(date +%s.%N) \
+		'BEGIN { printf("%.2f\n", end - start) }'
+}
+
+test_77a() {
+	local nid=$(tbf_nid)
+
+	tbf_setup || return 0
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile
+
+	tbf_rule start ext_a {$nid} 1000 || error "start ext_a failed"
+	tbf_rule start ext_b {$nid} 100 ceil=500 parent=ext_a ||
+		error "start ext_b failed"
+	tbf_rule start ext_c {$nid} 10 ceil=200 parent=ext_b ||
+		error "start ext_c failed"
+	tbf_rules
+	tbf_rules | grep -q "ext_b .*100, ceil 500, parent ext_a" ||
+		error "ext_b is not nested under ext_a"
+	tbf_rules | grep -q "ext_c .*10, ceil 200, parent ext_b" ||
+		error "ext_c is not nested under ext_b"
+
+	# the parent of a running rule can't be stopped
+	tbf_rule stop ext_b && error "ext_b stopped with a child rule"
+	tbf_rules | grep -q "ext_b " || error "ext_b is gone"
+
+	tbf_rule change ext_c 20 ceil=300 || error "change ext_c failed"
+	tbf_rules | grep -q "ext_c .*20, ceil 300, parent ext_b" ||
+		error "ext_c was not changed"
+
+	# RPCs flow through the nested rules
+	tbf_write_time 100
+
+	tbf_rule stop ext_c || error "stop ext_c failed"
+	tbf_rule stop ext_b || error "stop ext_b failed"
+	tbf_rule stop ext_a || error "stop ext_a failed"
+	tbf_rules | grep -q "ext_" && error "rules left after stop"
+	tbf_cleanup
+	rm -f $DIR1/$tfile
+}
+run_test 77a "TBF rules nest with a rate and a ceiling"
+
+test_77b() {
+	local nid=$(tbf_nid)
+	local bad
+
+	tbf_setup || return 0
+
+	tbf_rule start ext_b {$nid} 100 parent=ext_none &&
+		error "started a rule with a nonexistent parent"
+	tbf_rules | grep -q "ext_b " && error "ext_b exists"
+
+	tbf_rule start ext_a {$nid} 100 || error "start ext_a failed"
+	for bad in "ceil=" "ceil=abc" "ceil=10x" "ceil=0" "ceil=-5" \
+		   "ceil=65535" "ceil=99999999999999999999" "ceil=50" \
+		   "ceil=200 ceil=300" "parent=" "parent=ext-a" \
+		   "parent=ext_b" "parent=ext_a parent=ext_a" "100x" "0"; do
+		tbf_rule start ext_b {$nid} 100 $bad &&
+			error "started ext_b with '$bad'"
+		tbf_rules | grep -q "ext_b " && error "ext_b exists with '$bad'"
+	done
+	for bad in "20 ceil=10" "20 ceil=x" "20 parent=ext_a" "20 20"; do
+		tbf_rule change ext_a $bad && error "changed ext_a with '$bad'"
+	done
+	tbf_rules | grep -q "ext_a .*100, ref" || error "ext_a was changed"
+
+	tbf_rule stop ext_a || error "stop ext_a failed"
+	tbf_cleanup
+}
+run_test 77b "TBF rejects malformed ceilings and missing parents"
+
+test_77c() {
+	local nid=$(tbf_nid)
+	local count=60
+	local rate=5
+	local ceil=20
+	local depth=3 # default tbf_depth of the ptlrpc module
+	local t
+
+	tbf_setup || return 0
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile
+
+	# without a parent, the ceiling is never reached
+	tbf_rule start ext_b {$nid} $rate ceil=$ceil ||
+		error "start ext_b failed"
+	t=$(tbf_write_time $count)
+	echo "$count RPCs at rate $rate without parent: $t seconds"
+	awk -v t=$t -v n=$((count - 2 * depth)) -v r=$rate \
+		'BEGIN { exit !(t < n / r) }' &&
+		error "RPCs went faster than the rate without parent"
+	tbf_rule stop ext_b || error "stop ext_b failed"
+
+	# the idle parent lends tokens up to the ceiling, not beyond
+	tbf_rule start ext_a {$nid} 10000 || error "start ext_a failed"
+	tbf_rule start ext_b {$nid} $rate ceil=$ceil parent=ext_a ||
+		error "start ext_b failed"
+	t=$(tbf_write_time $count)
+	echo "$count RPCs at rate $rate ceil $ceil: $t seconds"
+	awk -v t=$t -v n=$((count - 2 * depth)) -v r=$ceil \
+		'BEGIN { exit !(t < n / r) }' &&
+		error "RPCs went faster than the ceiling"
+	awk -v t=$t -v n=$count -v r=$rate 'BEGIN { exit !(t > n / r) }' &&
+		error "RPCs did not borrow from the parent"
+
+	tbf_rule stop ext_b || error "stop ext_b failed"
+	tbf_rule stop ext_a || error "stop ext_a failed"
+	tbf_cleanup
+	rm -f $DIR1/$tfile
+}
+run_test 77c "TBF enforces the ceiling of a rule borrowing from its parent"
+
+test_77d() {
+	local nid=$(tbf_nid)
+	local count=60
+	local rate=5
+	local prate=10
+	local ceil=20
+	local depth=3 # default tbf_depth of the ptlrpc module
+	local t
+
+	tbf_setup || return 0
+	$LFS setstripe -c 1 -i 0 $DIR1/$tfile
+
+	# the RPCs sent at the child's own rate are charged to the parent,
+	# which only lends what is left of its rate
+	tbf_rule start ext_a {$nid} $prate || error "start ext_a failed"
+	tbf_rule start ext_b {$nid} $rate ceil=$ceil parent=ext_a ||
+		error "start ext_b failed"
+	t=$(tbf_write_time $count)
+	echo "$count RPCs at rate $rate ceil $ceil parent $prate: $t seconds"
+	awk -v t=$t -v n=$((count - 3 * depth)) -v r=$prate \
+		'BEGIN { exit !(t < n / r) }' &&
+		error "RPCs went faster than the rate of the parent"
+	awk -v t=$t -v n=$count -v r=$rate 'BEGIN { exit !(t > n / r) }' &&
+		error "RPCs did not borrow from the parent"
+
+	tbf_rule stop ext_b || error "stop ext_b failed"
+	tbf_rule stop ext_a || error "stop ext_a failed"
+	tbf_cleanup
+	rm -f $DIR1/$tfile
+}
+run_test 77d "TBF parent rule caps the RPC rate of its subtree"
+
+# blocking ASTs received by the clients of this node
+ldlm_bl_callbacks() {
+	$LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		awk '/ldlm_bl_callback/ { print $2 }'
+}
+
+test_78() { # waiting extent lock index
+	local file1=$DIR1/$tfile
+	local file2=$DIR2/$tfile
+	local data=$TMP/$tfile
+	local gpid
+	local g2pid
+	local pids=""
+	local pid
+	local bl1
+	local bl2
+	local bl3
+	local i
+
+	$LFS setstripe -c 1 -i 0 $file1 || error "setstripe failed"
+	dd if=/dev/zero of=$file1 bs=1M count=9 || error "dd failed"
+	for i in a b c e d; do
+		yes $i | head -c 4096 > $data.$i
+	done
+	cancel_lru_locks osc
+
+	# group lock 1 on the whole file: every lock below has to wait
+	multiop_bg_pause $file1 OG1_g1c || error "group lock 1 failed"
+	gpid=$!
+	bl1=$(ldlm_bl_callbacks)
+
+	# queued in this order: identical extents [0, 4k) "a" then "b",
+	# overlapping extents [4k, 12k) "c" then [8k, 16k) "e", a disjoint
+	# extent at 8MB "d", then group lock 2 over all of them
+	dd if=$data.a of=$file2 bs=4k count=1 conv=notrunc &
+	pids="$pids $!"
+	sleep 1
+	dd if=$data.b of=$file2 bs=4k count=1 conv=notrunc &
+	pids="$pids $!"
+	sleep 1
+	cat $data.c $data.c |
+		dd of=$file2 bs=4k seek=1 count=2 conv=notrunc iflag=fullblock &
+	pids="$pids $!"
+	sleep 1
+	cat $data.e $data.e |
+		dd of=$file2 bs=4k seek=2 count=2 conv=notrunc iflag=fullblock &
+	pids="$pids $!"
+	sleep 1
+	dd if=$data.d of=$file2 bs=4k seek=2048 count=1 conv=notrunc &
+	pids="$pids $!"
+	sleep 1
+	$MULTIOP $file2 OG2g2c &
+	g2pid=$!
+	sleep 2
+
+	for pid in $pids $g2pid; do
+		kill -0 $pid 2>/dev/null ||
+			error "process $pid did not wait for group lock 1"
+	done
+	bl2=$(ldlm_bl_callbacks)
+	echo "blocking ASTs while waiting: $bl1 -> $bl2"
+	[ $bl2 -gt $bl1 ] || error "no blocking AST for group lock 1"
+
+	kill -USR1 $gpid
+	wait $gpid || error "group lock 1 failed"
+	for pid in $pids; do
+		wait $pid || error "write $pid failed"
+	done
+	# group lock 2 is granted only once the writers' locks are cancelled
+	wait $g2pid || error "group lock 2 failed"
+	bl3=$(ldlm_bl_callbacks)
+	echo "blocking ASTs after release: $bl2 -> $bl3"
+	[ $bl3 -gt $bl2 ] || error "no blocking AST to the waiting writers"
+
+	# the waiting locks were granted in the order they were queued
+	cancel_lru_locks osc
+	for i in 0:b 1:c 2:e 3:e 2048:d; do
+		dd if=$file1 bs=4k skip=${i%:*} count=1 2>/dev/null |
+			cmp -s - $data.${i#*:} ||
+			error "block ${i%:*} is not \"${i#*:}\""
+	done
+
+	# conflicting waiting locks of both mounts at disjoint extents: the
+	# one granted first is not expanded over the other one, found in the
+	# waiting lock index, so the other one is granted without revoking it
+	cancel_lru_locks osc
+	multiop_bg_pause $file1 OG1_g1c || error "group lock 1 failed"
+	gpid=$!
+	dd if=$data.a of=$file2 bs=4k count=1 conv=notrunc &
+	pids=$!
+	sleep 1
+	dd if=$data.d of=$file1 bs=4k seek=2048 count=1 conv=notrunc &
+	pids="$pids $!"
+	sleep 2
+	for pid in $pids; do
+		kill -0 $pid 2>/dev/null ||
+			error "process $pid did not wait for group lock 1"
+	done
+	bl2=$(ldlm_bl_callbacks)
+	kill -USR1 $gpid
+	wait $gpid || error "group lock 1 failed"
+	for pid in $pids; do
+		wait $pid || error "write $pid failed"
+	done
+	bl3=$(ldlm_bl_callbacks)
+	echo "blocking ASTs after release: $bl2 -> $bl3"
+	[ $bl3 -eq $bl2 ] ||
+		error "a lock was expanded over a conflicting waiting lock"
+
+	rm -f $file1 $data.*
+}
+run_test 78 "waiting extent locks are granted in order"
+
+# number of locks cached by the OST0000 OSC of mount point $1
+osc_lock_count() {
+	local name=$($LFS getname $1 | cut -d' ' -f1)
+
+	$LCTL get_param -n \
+		ldlm.namespaces.$FSNAME-OST0000-osc-${name#$FSNAME-}.lock_count
+}
+
+test_79() { # lock-ahead
+	local file1=$DIR1/$tfile
+	local file2=$DIR2/$tfile
+	local count
+	local bl
+	local rc
+
+	$LCTL get_param -n osc.$FSNAME-OST0000-osc-*.import |
+		grep -q lockahead ||
+		{ skip "OST does not support lock-ahead" && return; }
+
+	$LFS setstripe -c 1 -i 0 $file1 || error "setstripe failed"
+	cancel_lru_locks osc
+
+	# not expanded: the lock of mount 1 leaves [1M, 2M) to mount 2
+	$MULTIOP $file1 oO_WRONLY:aW0,1048575c ||
+		error "lock-ahead on [0, 1M) failed"
+	[ $(osc_lock_count $MOUNT1) -eq 1 ] || error "no lock on mount 1"
+	$MULTIOP $file2 oO_WRONLY:aW1048576,2097151c ||
+		error "lock-ahead on [1M, 2M) conflicts with [0, 1M)"
+	[ $(osc_lock_count $MOUNT2) -eq 1 ] || error "no lock on mount 2"
+
+	# a conflicting request is refused and revokes nothing
+	count=$(osc_lock_count $MOUNT1)
+	bl=$(ldlm_bl_callbacks)
+	$MULTIOP $file2 oO_WRONLY:aW4096,8191c
+	rc=$?
+	[ $rc -eq 11 ] || # EWOULDBLOCK
+		error "conflicting lock-ahead returned $rc, not EWOULDBLOCK"
+	[ $(osc_lock_count $MOUNT1) -eq $count ] ||
+		error "lock of mount 1 was cancelled"
+	[ $(ldlm_bl_callbacks) -eq $bl ] ||
+		error "conflicting lock-ahead sent a blocking AST"
+	$MULTIOP $file2 oO_RDONLY:aR0,4095c &&
+		error "read lock-ahead over a write lock was granted"
+
+	# the write in the lock-ahead extent uses it, without callback
+	dd if=/dev/zero of=$file1 bs=4k count=1 conv=notrunc ||
+		error "write failed"
+	[ $(ldlm_bl_callbacks) -eq $bl ] ||
+		error "write in the lock-ahead extent sent a blocking AST"
+
+	rm -f $file1
+}
+run_test 79 "lock-ahead locks are granted exactly, never revoke others"
+
 test_80() {
 	[ $MDSCOUNT -lt 2 ] && skip "needs >= 2 MDTs" && return
 	local MDTIDX=1
@@ -2708,6 +3047,52 @@ test_80() {
 }
 run_test 80 "migrate directory when some children is being opened"
 
+# reprocessings skipped by the OST0000 namespace, nothing was waiting
+ost_reprocess_skipped() {
+	do_facet ost1 $LCTL get_param -n \
+		ldlm.namespaces.filter-$FSNAME-OST0000_UUID.reprocess_skipped
+}
+
+test_81() {
+	local file1=$DIR1/$tfile
+	local file2=$DIR2/$tfile
+	local skip1
+	local skip2
+	local gpid
+	local pid
+	local i
+
+	$LFS setstripe -c 1 -i 0 $file1 || error "setstripe failed"
+	dd if=/dev/zero of=$file1 bs=4k count=1 || error "dd failed"
+	cancel_lru_locks osc
+
+	# compatible read locks of both mounts on the same object: their
+	# cancels leave nothing to grant, lr_lock is not taken again for it
+	skip1=$(ost_reprocess_skipped)
+	for i in $(seq 10); do
+		cat $file1 > /dev/null || error "read from mount 1 failed"
+		cat $file2 > /dev/null || error "read from mount 2 failed"
+		cancel_lru_locks osc
+	done
+	skip2=$(ost_reprocess_skipped)
+	echo "reprocessings skipped: $skip1 -> $skip2"
+	[ $skip2 -gt $skip1 ] || error "cancels reprocessed an idle resource"
+
+	# a waiting lock is still granted once the lock it waits for goes
+	multiop_bg_pause $file1 OG1_g1c || error "group lock failed"
+	gpid=$!
+	dd if=/dev/zero of=$file2 bs=4k count=1 conv=notrunc &
+	pid=$!
+	sleep 2
+	kill -0 $pid 2>/dev/null || error "write did not wait for group lock"
+	kill -USR1 $gpid
+	wait $gpid || error "group lock failed"
+	wait $pid || error "write waiting for the group lock failed"
+
+	rm -f $file1
+}
+run_test 81 "cancel on a resource without waiting locks skips reprocessing"
+
 log "cleanup: ======================================================"
 
 [ "$(mount | grep $MOUNT2)" ] && umount $MOUNT2
@@ -261,7 +261,8 @@ command_t cmdlist[] = {
         {"===  Changelogs ==", jt_noop, 0, "changelog user management"},
         {"changelog_register", jt_changelog_register, 0,
          "register a new persistent changelog user, returns id\n"
-         "usage:\tdevice <mdtname>\n\tchangelog_register [-n]"},
+	 "usage:\tdevice <mdtname>\n\tchangelog_register [-n] "
+	 "[-m <type>[,<type>...]]"},
         {"changelog_deregister", jt_changelog_deregister, 0,
          "deregister an existing changelog user\n"
          "usage:\tdevice <mdtname>\n\tchangelog_deregister <id>"},
@@ -3118,10 +3118,10 @@ static int lfs_changelog(int argc, char **argv)
         if (argc > optind)
                 endrec = strtoll(argv[optind++], NULL, 10);
 
-        rc = llapi_changelog_start(&changelog_priv,
-                                   CHANGELOG_FLAG_BLOCK |
-                                   (follow ? CHANGELOG_FLAG_FOLLOW : 0),
-                                   mdd, startrec);
+	rc = llapi_changelog_start(&changelog_priv,
+				   CHANGELOG_FLAG_BLOCK | CHANGELOG_FLAG_BATCH |
+				   (follow ? CHANGELOG_FLAG_FOLLOW : 0),
+				   mdd, startrec);
         if (rc < 0) {
                 fprintf(stderr, "Can't start changelog: %s\n",
                         strerror(errno = -rc));
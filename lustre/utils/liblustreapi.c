@@ -4065,7 +4065,7 @@ int root_ioctl(const char *mdtname, int opc, void *data, int *mdtidxp,
 /****** Changelog API ********/
 
 static int changelog_ioctl(const char *mdtname, int opc, int id,
-                           long long recno, int flags)
+			   long long recno, int flags, __u32 typemask)
 {
         struct ioc_changelog data;
         int *idx;
@@ -4073,6 +4073,7 @@ static int changelog_ioctl(const char *mdtname, int opc, int id,
         data.icc_id = id;
         data.icc_recno = recno;
         data.icc_flags = flags;
+	data.icc_typemask = typemask;
         idx = (int *)(&data.icc_mdtindex);
 
         return root_ioctl(mdtname, opc, &data, idx, WANT_ERROR);
@@ -4083,8 +4084,18 @@ struct changelog_private {
         int magic;
         int flags;
         lustre_kernelcomm kuc;
+	/* CHANGELOG_FLAG_BATCH: last CL_BATCH message received, and the
+	 * records of it not returned yet */
+	struct kuc_hdr *batch;
+	struct changelog_ext_rec *batch_next;
+	int batch_left;
+	/* types wanted, only checked here if the MDC sends CL_RECORD */
+	__u32 typemask;
 };
 
+static int changelog_start(void **priv, int flags, const char *device,
+			   long long startrec, __u32 typemask);
+
 /** Start reading from a changelog
  * @param priv Opaque private control structure
  * @param flags Start flags (e.g. CHANGELOG_FLAG_BLOCK)
@@ -4094,6 +4105,25 @@ struct changelog_private {
  */
 int llapi_changelog_start(void **priv, int flags, const char *device,
                           long long startrec)
+{
+	return changelog_start(priv, flags, device, startrec, 0);
+}
+
+/** Start reading from a changelog, records being sent by batches
+ * @param typemask Only report records whose type bit (1 << CL_xxx) is
+ * set, 0 for all
+ * Records are then read with llapi_changelog_recv_batch(), or one by one
+ * with llapi_changelog_recv().
+ */
+int llapi_changelog_start_batch(void **priv, int flags, const char *device,
+				long long startrec, __u32 typemask)
+{
+	return changelog_start(priv, flags | CHANGELOG_FLAG_BATCH, device,
+			       startrec, typemask);
+}
+
+static int changelog_start(void **priv, int flags, const char *device,
+			   long long startrec, __u32 typemask)
 {
         struct changelog_private *cp;
         int rc;
@@ -4105,6 +4135,14 @@ int llapi_changelog_start(void **priv, int flags, const char *device,
 
         cp->magic = CHANGELOG_PRIV_MAGIC;
         cp->flags = flags;
+	cp->typemask = typemask;
+	if (flags & CHANGELOG_FLAG_BATCH) {
+		cp->batch = malloc(KUC_CHANGELOG_BATCH_MAXSIZE);
+		if (cp->batch == NULL) {
+			rc = -ENOMEM;
+			goto out_free;
+		}
+	}
 
         /* Set up the receiver */
         rc = libcfs_ukuc_start(&cp->kuc, 0 /* no group registration */);
@@ -4115,7 +4153,7 @@ int llapi_changelog_start(void **priv, int flags, const char *device,
 
         /* Tell the kernel to start sending */
         rc = changelog_ioctl(device, OBD_IOC_CHANGELOG_SEND, cp->kuc.lk_wfd,
-                             startrec, flags);
+			     startrec, flags, typemask);
         /* Only the kernel reference keeps the write side open */
         close(cp->kuc.lk_wfd);
         cp->kuc.lk_wfd = LK_NOFD;
@@ -4128,6 +4166,7 @@ int llapi_changelog_start(void **priv, int flags, const char *device,
         return 0;
 
 out_free:
+	free(cp->batch);
         free(cp);
         return rc;
 }
@@ -4141,6 +4180,7 @@ int llapi_changelog_fini(void **priv)
                 return -EINVAL;
 
         libcfs_ukuc_stop(&cp->kuc);
+	free(cp->batch);
         free(cp);
         *priv = NULL;
         return 0;
@@ -4185,6 +4225,24 @@ int llapi_changelog_recv(void *priv, struct changelog_ext_rec **rech)
 	if (kuch == NULL)
 		return -ENOMEM;
 
+	if (cp->flags & CHANGELOG_FLAG_BATCH) {
+		struct changelog_ext_rec *rec;
+		int count;
+
+		/* hand out the records of the batch one by one, with the
+		 * same allocation as CL_RECORD messages for
+		 * llapi_changelog_free() */
+		rc = llapi_changelog_recv_batch(priv, &rec, &count);
+		if (rc != 0)
+			goto out_free;
+		/* give back the records after the first one */
+		cp->batch_next = changelog_batch_next(rec);
+		cp->batch_left = count - 1;
+		memcpy(kuch + 1, rec, changelog_batch_rec_len(rec));
+		*rech = (struct changelog_ext_rec *)(kuch + 1);
+		return 0;
+	}
+
 repeat:
 	rc = libcfs_ukuc_msg_get(&cp->kuc, (char *)kuch,
 				 KUC_CHANGELOG_MSG_MAXSIZE,
@@ -4226,6 +4284,93 @@ out_free:
         return rc;
 }
 
+/** Read the next batch of changelog records, received with
+ * CHANGELOG_FLAG_BATCH set
+ * @param priv Opaque private control structure
+ * @param recs First record of the batch, the following ones are reached
+ * with changelog_batch_next(). They are in extended format, and valid
+ * until the next call or llapi_changelog_fini(); nothing is allocated.
+ * @param count Number of records in the batch
+ * @return 0 valid batch received; recs and count are set
+ *         <0 error code
+ *         1 EOF
+ */
+int llapi_changelog_recv_batch(void *priv, struct changelog_ext_rec **recs,
+			       int *count)
+{
+	struct changelog_private *cp = (struct changelog_private *)priv;
+	struct changelog_ext_rec *rec;
+	char *pos, *end;
+	int rc;
+
+	if (!cp || (cp->magic != CHANGELOG_PRIV_MAGIC))
+		return -EINVAL;
+	if (recs == NULL || count == NULL || cp->batch == NULL)
+		return -EINVAL;
+
+	while (cp->batch_left == 0) {
+		rc = libcfs_ukuc_msg_get(&cp->kuc, (char *)cp->batch,
+					 KUC_CHANGELOG_BATCH_MAXSIZE,
+					 KUC_TRANSPORT_CHANGELOG);
+		if (rc < 0)
+			return rc;
+
+		if (cp->batch->kuc_transport != KUC_TRANSPORT_CHANGELOG ||
+		    (cp->batch->kuc_msgtype != CL_BATCH &&
+		     cp->batch->kuc_msgtype != CL_RECORD &&
+		     cp->batch->kuc_msgtype != CL_EOF)) {
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "Unknown changelog message type "
+					  "%d:%d\n", cp->batch->kuc_transport,
+					  cp->batch->kuc_msgtype);
+			return -EPROTO;
+		}
+
+		if (cp->batch->kuc_msgtype == CL_EOF) {
+			/* Ignore EOFs when following */
+			if (cp->flags & CHANGELOG_FLAG_FOLLOW)
+				continue;
+			return 1;
+		}
+
+		/* An MDC which does not know CHANGELOG_FLAG_BATCH sends one
+		 * record per message and ignores the type mask: hand out
+		 * each wanted record as a batch of one */
+		if (cp->batch->kuc_msgtype == CL_RECORD) {
+			rec = (struct changelog_ext_rec *)(cp->batch + 1);
+			changelog_extend_rec(rec);
+			if (cp->typemask != 0 &&
+			    !(cp->typemask & (1 << rec->cr_type)))
+				continue;
+			cp->batch_next = rec;
+			cp->batch_left = 1;
+			break;
+		}
+
+		/* check once that every record lies within the message */
+		end = (char *)cp->batch + cp->batch->kuc_msglen;
+		for (pos = (char *)(cp->batch + 1); pos < end;
+		     pos = (char *)changelog_batch_next(rec)) {
+			rec = (struct changelog_ext_rec *)pos;
+			if (pos + sizeof(*rec) > end ||
+			    changelog_batch_rec_len(rec) > CR_MAXSIZE ||
+			    pos + changelog_batch_rec_len(rec) > end) {
+				llapi_err_noerrno(LLAPI_MSG_ERROR,
+						  "truncated changelog batch\n");
+				cp->batch_left = 0;
+				return -EPROTO;
+			}
+			cp->batch_left++;
+		}
+		cp->batch_next = (struct changelog_ext_rec *)(cp->batch + 1);
+	}
+
+	*recs = cp->batch_next;
+	*count = cp->batch_left;
+	cp->batch_left = 0;
+	return 0;
+}
+
 /** Release the changelog record when done with it. */
 int llapi_changelog_free(struct changelog_ext_rec **rech)
 {
@@ -4262,7 +4407,8 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
                 return -EINVAL;
         }
 
-        return changelog_ioctl(mdtname, OBD_IOC_CHANGELOG_CLEAR, id, endrec, 0);
+	return changelog_ioctl(mdtname, OBD_IOC_CHANGELOG_CLEAR, id, endrec, 0,
+			       0);
 }
 
 int llapi_fid2path(const char *device, const char *fidstr, char *buf,
@@ -4439,6 +4585,58 @@ int llapi_get_data_version(int fd, __u64 *data_version, __u64 flags)
         return rc;
 }
 
+/**
+ * Request extent locks on an open file before doing IO on these extents.
+ *
+ * This is for processes writing disjoint parts of a shared file, like an
+ * MPI-IO collective buffering aggregator: the OSTs grant each lock exactly
+ * on the requested extent, so the locks of the writers do not conflict and
+ * the writes do not need lock callbacks. The call never waits for another
+ * lock to be released: a lock which conflicts with another lock is not
+ * granted, the other lock is kept, and the later IO just takes a normal lock.
+ *
+ * \param fd       file descriptor, opened for write if \a mode is LLA_WRITE
+ * \param mode     LLA_READ or LLA_WRITE
+ * \param extents  byte extents to lock, on return lle_result holds 0 if the
+ *                 lock was granted, -EWOULDBLOCK if it conflicts with another
+ *                 lock, or another negative errno
+ * \param count    number of extents, at most LLA_MAX_EXTENTS
+ *
+ * \retval 0 on success, an OST which does not support lock-ahead gives
+ *         -EOPNOTSUPP in lle_result.
+ * \retval -errno on error.
+ */
+int llapi_lock_ahead(int fd, enum lock_ahead_mode mode,
+		     struct lu_lock_ahead_extent *extents, int count)
+{
+	struct lu_lock_ahead	*lla;
+	size_t			 size;
+	int			 rc;
+
+	if (count <= 0 || count > LLA_MAX_EXTENTS)
+		return -EINVAL;
+
+	size = sizeof(*lla) + count * sizeof(*extents);
+	lla = calloc(1, size);
+	if (lla == NULL)
+		return -ENOMEM;
+
+	lla->lla_mode = mode;
+	lla->lla_extent_count = count;
+	memcpy(lla->lla_extents, extents, count * sizeof(*extents));
+
+	rc = ioctl(fd, LL_IOC_LOCK_AHEAD, lla);
+	if (rc != 0) {
+		rc = -errno;
+		llapi_error(LLAPI_MSG_ERROR, rc, "cannot request lock-ahead");
+	} else {
+		memcpy(extents, lla->lla_extents, count * sizeof(*extents));
+	}
+
+	free(lla);
+	return rc;
+}
+
 /*
  * Create a volatile file and open it for write:
  * - file is created as a standard file in the directory
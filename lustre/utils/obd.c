@@ -4444,22 +4444,63 @@ void  llapi_ping_target(char *obd_type, char *obd_name,
         }
 }
 
+/* parse a list of changelog record type names, e.g. "CREAT,UNLNK" */
+static int changelog_str2mask(char *str, __u32 *mask)
+{
+	char *name;
+	int i;
+
+	*mask = 0;
+	for (name = strtok(str, ", "); name != NULL;
+	     name = strtok(NULL, ", ")) {
+		for (i = 0; i < CL_LAST; i++) {
+			if (strcasecmp(name, changelog_type2str(i)) == 0)
+				break;
+		}
+		if (i == CL_LAST) {
+			fprintf(stderr, "error: unknown changelog record "
+				"type '%s'\n", name);
+			return -EINVAL;
+		}
+		*mask |= 1 << i;
+	}
+	return 0;
+}
+
 int jt_changelog_register(int argc, char **argv)
 {
         char rawbuf[MAX_IOC_BUFLEN], *buf = rawbuf;
         struct obd_ioctl_data data;
         char devname[30];
+	int bare = 0;
+	__u32 mask = 0;
+	int c;
         int rc;
 
-        if (argc > 2)
-                return CMD_HELP;
-        else if (argc == 2 && strcmp(argv[1], "-n") != 0)
-                return CMD_HELP;
+	optind = 0;
+	while ((c = getopt(argc, argv, "nm:")) != -1) {
+		switch (c) {
+		case 'n':
+			/* -n means bare name */
+			bare = 1;
+			break;
+		case 'm':
+			if (changelog_str2mask(optarg, &mask) != 0)
+				return CMD_HELP;
+			break;
+		default:
+			return CMD_HELP;
+		}
+	}
+	if (optind != argc)
+		return CMD_HELP;
         if (cur_device < 0)
                 return CMD_HELP;
 
         memset(&data, 0, sizeof(data));
         data.ioc_dev = cur_device;
+	/* record types this user wants, 0 for all */
+	data.ioc_u32_2 = mask;
         memset(buf, 0, sizeof(rawbuf));
         rc = obd_ioctl_pack(&data, &buf, sizeof(rawbuf));
         if (rc) {
@@ -4495,8 +4536,7 @@ int jt_changelog_register(int argc, char **argv)
 		}
 	}
 
-        if (argc == 2)
-                /* -n means bare name */
+	if (bare)
                 printf(CHANGELOG_USER_PREFIX"%u\n", data.ioc_u32_1);
         else
                 printf("%s: Registered changelog userid '"CHANGELOG_USER_PREFIX
@@ -525,10 +525,16 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT_FLOCK_DEAD);
 	CHECK_DEFINE_64X(OBD_CONNECT_OPEN_BY_FID);
 	CHECK_DEFINE_64X(OBD_CONNECT_LFSCK);
+	CHECK_DEFINE_64X(OBD_CONNECT_BATCH_RPC);
+	CHECK_DEFINE_64X(OBD_CONNECT_MULTIOBJ_BRW);
+	CHECK_DEFINE_64X(OBD_CONNECT_DESTROY_BATCH);
+	CHECK_DEFINE_64X(OBD_CONNECT_LOCKAHEAD);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
 	CHECK_VALUE_X(OBD_CKSUM_CRC32C);
+	CHECK_VALUE_X(OBD_CKSUM_T10IP512);
+	CHECK_VALUE_X(OBD_CKSUM_T10IP4K);
 }
 
 static void
@@ -628,6 +634,8 @@ check_obdo(void)
 	CHECK_CVALUE_X(OBD_FL_CKSUM_CRC32);
 	CHECK_CVALUE_X(OBD_FL_CKSUM_ADLER);
 	CHECK_CVALUE_X(OBD_FL_CKSUM_CRC32C);
+	CHECK_CVALUE_X(OBD_FL_CKSUM_T10IP512);
+	CHECK_CVALUE_X(OBD_FL_CKSUM_T10IP4K);
 	CHECK_CVALUE_X(OBD_FL_CKSUM_RSVD2);
 	CHECK_CVALUE_X(OBD_FL_CKSUM_RSVD3);
 	CHECK_CVALUE_X(OBD_FL_SHRINK_GRANT);
@@ -857,6 +865,19 @@ check_ost_body(void)
 	CHECK_MEMBER(ost_body, oa);
 }
 
+static void
+check_ost_batch_rec(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(ost_batch_rec);
+	CHECK_MEMBER(ost_batch_rec, obr_oi);
+	CHECK_MEMBER(ost_batch_rec, obr_cookie);
+	CHECK_MEMBER(ost_batch_rec, obr_op);
+	CHECK_MEMBER(ost_batch_rec, obr_count);
+	CHECK_MEMBER(ost_batch_rec, obr_uid);
+	CHECK_MEMBER(ost_batch_rec, obr_gid);
+}
+
 static void
 check_ll_fid(void)
 {
@@ -1575,7 +1596,7 @@ check_llog_changelog_user_rec(void)
 	CHECK_STRUCT(llog_changelog_user_rec);
 	CHECK_MEMBER(llog_changelog_user_rec, cur_hdr);
 	CHECK_MEMBER(llog_changelog_user_rec, cur_id);
-	CHECK_MEMBER(llog_changelog_user_rec, cur_padding);
+	CHECK_MEMBER(llog_changelog_user_rec, cur_mask);
 	CHECK_MEMBER(llog_changelog_user_rec, cur_endrec);
 	CHECK_MEMBER(llog_changelog_user_rec, cur_tail);
 }
@@ -2034,6 +2055,27 @@ static void check_object_update_request(void)
 	CHECK_MEMBER(object_update_request, ourq_updates);
 }
 
+static void check_batch_msg(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(batch_msg);
+	CHECK_MEMBER(batch_msg, bm_xid);
+	CHECK_MEMBER(batch_msg, bm_len);
+	CHECK_MEMBER(batch_msg, bm_padding);
+}
+
+static void check_batch_buf(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(batch_buf);
+	CHECK_MEMBER(batch_buf, bb_magic);
+	CHECK_MEMBER(batch_buf, bb_count);
+	CHECK_MEMBER(batch_buf, bb_padding);
+	CHECK_MEMBER(batch_buf, bb_reply_size);
+	CHECK_MEMBER(batch_buf, bb_padding2);
+	CHECK_MEMBER(batch_buf, bb_msgs);
+}
+
 static void check_object_update_result(void)
 {
 	BLANK_LINE();
@@ -2198,6 +2240,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(OST_QUOTACHECK);
 	CHECK_VALUE(OST_QUOTACTL);
 	CHECK_VALUE(OST_QUOTA_ADJUST_QUNIT);
+	CHECK_VALUE(OST_DESTROY_BATCH);
 	CHECK_VALUE(OST_LAST_OPC);
 
 	CHECK_DEFINE_64X(OBD_OBJECT_EOF);
@@ -2238,6 +2281,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(MDS_HSM_CT_REGISTER);
 	CHECK_VALUE(MDS_HSM_CT_UNREGISTER);
 	CHECK_VALUE(MDS_SWAP_LAYOUTS);
+	CHECK_VALUE(MDS_BATCH);
 	CHECK_VALUE(MDS_LAST_OPC);
 
 	CHECK_VALUE(REINT_SETATTR);
@@ -2416,6 +2460,7 @@ main(int argc, char **argv)
 	check_obd_idx_read();
 	check_niobuf_remote();
 	check_ost_body();
+	check_ost_batch_rec();
 	check_ll_fid();
 	check_mdt_body();
 	check_mdt_ioepoch();
@@ -2500,6 +2545,8 @@ main(int argc, char **argv)
 	check_object_update_request();
 	check_object_update_result();
 	check_object_update_reply();
+	check_batch_msg();
+	check_batch_buf();
 
 	check_lfsck_request();
 	check_lfsck_reply();
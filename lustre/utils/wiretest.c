@@ -116,7 +116,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)OST_QUOTACTL);
 	LASSERTF(OST_QUOTA_ADJUST_QUNIT == 20, "found %lld\n",
 		 (long long)OST_QUOTA_ADJUST_QUNIT);
-	LASSERTF(OST_LAST_OPC == 21, "found %lld\n",
+	LASSERTF(OST_DESTROY_BATCH == 21, "found %lld\n",
+		 (long long)OST_DESTROY_BATCH);
+	LASSERTF(OST_LAST_OPC == 22, "found %lld\n",
 		 (long long)OST_LAST_OPC);
 	LASSERTF(OBD_OBJECT_EOF == 0xffffffffffffffffULL, "found 0x%.16llxULL\n",
 		 OBD_OBJECT_EOF);
@@ -188,7 +190,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)MDS_HSM_CT_UNREGISTER);
 	LASSERTF(MDS_SWAP_LAYOUTS == 61, "found %lld\n",
 		 (long long)MDS_SWAP_LAYOUTS);
-	LASSERTF(MDS_LAST_OPC == 62, "found %lld\n",
+	LASSERTF(MDS_BATCH == 62, "found %lld\n",
+		 (long long)MDS_BATCH);
+	LASSERTF(MDS_LAST_OPC == 63, "found %lld\n",
 		 (long long)MDS_LAST_OPC);
 	LASSERTF(REINT_SETATTR == 1, "found %lld\n",
 		 (long long)REINT_SETATTR);
@@ -1184,12 +1188,24 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT_OPEN_BY_FID);
 	LASSERTF(OBD_CONNECT_LFSCK == 0x40000000000000ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT_LFSCK);
+	LASSERTF(OBD_CONNECT_BATCH_RPC == 0x80000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT_BATCH_RPC);
+	LASSERTF(OBD_CONNECT_MULTIOBJ_BRW == 0x100000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT_MULTIOBJ_BRW);
+	LASSERTF(OBD_CONNECT_DESTROY_BATCH == 0x200000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT_DESTROY_BATCH);
+	LASSERTF(OBD_CONNECT_LOCKAHEAD == 0x400000000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT_LOCKAHEAD);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_ADLER);
 	LASSERTF(OBD_CKSUM_CRC32C == 0x00000004UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32C);
+	LASSERTF(OBD_CKSUM_T10IP512 == 0x00000008UL, "found 0x%.8xUL\n",
+		(unsigned)OBD_CKSUM_T10IP512);
+	LASSERTF(OBD_CKSUM_T10IP4K == 0x00000010UL, "found 0x%.8xUL\n",
+		(unsigned)OBD_CKSUM_T10IP4K);
 
 	/* Checks for struct obdo */
 	LASSERTF((int)sizeof(struct obdo) == 208, "found %lld\n",
@@ -1416,6 +1432,8 @@ void lustre_assert_wire_constants(void)
 	CLASSERT(OBD_FL_CKSUM_CRC32 == 0x00001000);
 	CLASSERT(OBD_FL_CKSUM_ADLER == 0x00002000);
 	CLASSERT(OBD_FL_CKSUM_CRC32C == 0x00004000);
+	CLASSERT(OBD_FL_CKSUM_T10IP512 == 0x00005000);
+	CLASSERT(OBD_FL_CKSUM_T10IP4K == 0x00006000);
 	CLASSERT(OBD_FL_CKSUM_RSVD2 == 0x00008000);
 	CLASSERT(OBD_FL_CKSUM_RSVD3 == 0x00010000);
 	CLASSERT(OBD_FL_SHRINK_GRANT == 0x00020000);
@@ -1908,6 +1926,34 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct ost_body *)0)->oa) == 208, "found %lld\n",
 		 (long long)(int)sizeof(((struct ost_body *)0)->oa));
 
+	/* Checks for struct ost_batch_rec */
+	LASSERTF((int)sizeof(struct ost_batch_rec) == 64, "found %lld\n",
+		 (long long)(int)sizeof(struct ost_batch_rec));
+	LASSERTF((int)offsetof(struct ost_batch_rec, obr_oi) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_batch_rec, obr_oi));
+	LASSERTF((int)sizeof(((struct ost_batch_rec *)0)->obr_oi) == 16, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_batch_rec *)0)->obr_oi));
+	LASSERTF((int)offsetof(struct ost_batch_rec, obr_cookie) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_batch_rec, obr_cookie));
+	LASSERTF((int)sizeof(((struct ost_batch_rec *)0)->obr_cookie) == 32, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_batch_rec *)0)->obr_cookie));
+	LASSERTF((int)offsetof(struct ost_batch_rec, obr_op) == 48, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_batch_rec, obr_op));
+	LASSERTF((int)sizeof(((struct ost_batch_rec *)0)->obr_op) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_batch_rec *)0)->obr_op));
+	LASSERTF((int)offsetof(struct ost_batch_rec, obr_count) == 52, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_batch_rec, obr_count));
+	LASSERTF((int)sizeof(((struct ost_batch_rec *)0)->obr_count) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_batch_rec *)0)->obr_count));
+	LASSERTF((int)offsetof(struct ost_batch_rec, obr_uid) == 56, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_batch_rec, obr_uid));
+	LASSERTF((int)sizeof(((struct ost_batch_rec *)0)->obr_uid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_batch_rec *)0)->obr_uid));
+	LASSERTF((int)offsetof(struct ost_batch_rec, obr_gid) == 60, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_batch_rec, obr_gid));
+	LASSERTF((int)sizeof(((struct ost_batch_rec *)0)->obr_gid) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_batch_rec *)0)->obr_gid));
+
 	/* Checks for struct ll_fid */
 	LASSERTF((int)sizeof(struct ll_fid) == 16, "found %lld\n",
 		 (long long)(int)sizeof(struct ll_fid));
@@ -3627,10 +3673,10 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct llog_changelog_user_rec, cur_id));
 	LASSERTF((int)sizeof(((struct llog_changelog_user_rec *)0)->cur_id) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct llog_changelog_user_rec *)0)->cur_id));
-	LASSERTF((int)offsetof(struct llog_changelog_user_rec, cur_padding) == 20, "found %lld\n",
-		 (long long)(int)offsetof(struct llog_changelog_user_rec, cur_padding));
-	LASSERTF((int)sizeof(((struct llog_changelog_user_rec *)0)->cur_padding) == 4, "found %lld\n",
-		 (long long)(int)sizeof(((struct llog_changelog_user_rec *)0)->cur_padding));
+	LASSERTF((int)offsetof(struct llog_changelog_user_rec, cur_mask) == 20, "found %lld\n",
+		 (long long)(int)offsetof(struct llog_changelog_user_rec, cur_mask));
+	LASSERTF((int)sizeof(((struct llog_changelog_user_rec *)0)->cur_mask) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct llog_changelog_user_rec *)0)->cur_mask));
 	LASSERTF((int)offsetof(struct llog_changelog_user_rec, cur_endrec) == 24, "found %lld\n",
 		 (long long)(int)offsetof(struct llog_changelog_user_rec, cur_endrec));
 	LASSERTF((int)sizeof(((struct llog_changelog_user_rec *)0)->cur_endrec) == 8, "found %lld\n",
@@ -4590,6 +4636,50 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct object_update_reply *)0)->ourp_lens) == 0, "found %lld\n",
 		 (long long)(int)sizeof(((struct object_update_reply *)0)->ourp_lens));
 
+	/* Checks for struct batch_msg */
+	LASSERTF((int)sizeof(struct batch_msg) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct batch_msg));
+	LASSERTF((int)offsetof(struct batch_msg, bm_xid) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_msg, bm_xid));
+	LASSERTF((int)sizeof(((struct batch_msg *)0)->bm_xid) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_msg *)0)->bm_xid));
+	LASSERTF((int)offsetof(struct batch_msg, bm_len) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_msg, bm_len));
+	LASSERTF((int)sizeof(((struct batch_msg *)0)->bm_len) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_msg *)0)->bm_len));
+	LASSERTF((int)offsetof(struct batch_msg, bm_padding) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_msg, bm_padding));
+	LASSERTF((int)sizeof(((struct batch_msg *)0)->bm_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_msg *)0)->bm_padding));
+
+	/* Checks for struct batch_buf */
+	LASSERTF((int)sizeof(struct batch_buf) == 16, "found %lld\n",
+		 (long long)(int)sizeof(struct batch_buf));
+	LASSERTF((int)offsetof(struct batch_buf, bb_magic) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_buf, bb_magic));
+	LASSERTF((int)sizeof(((struct batch_buf *)0)->bb_magic) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_buf *)0)->bb_magic));
+	LASSERTF((int)offsetof(struct batch_buf, bb_count) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_buf, bb_count));
+	LASSERTF((int)sizeof(((struct batch_buf *)0)->bb_count) == 2, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_buf *)0)->bb_count));
+	LASSERTF((int)offsetof(struct batch_buf, bb_padding) == 6, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_buf, bb_padding));
+	LASSERTF((int)sizeof(((struct batch_buf *)0)->bb_padding) == 2, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_buf *)0)->bb_padding));
+	LASSERTF((int)offsetof(struct batch_buf, bb_reply_size) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_buf, bb_reply_size));
+	LASSERTF((int)sizeof(((struct batch_buf *)0)->bb_reply_size) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_buf *)0)->bb_reply_size));
+	LASSERTF((int)offsetof(struct batch_buf, bb_padding2) == 12, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_buf, bb_padding2));
+	LASSERTF((int)sizeof(((struct batch_buf *)0)->bb_padding2) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_buf *)0)->bb_padding2));
+	LASSERTF((int)offsetof(struct batch_buf, bb_msgs) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct batch_buf, bb_msgs));
+	LASSERTF((int)sizeof(((struct batch_buf *)0)->bb_msgs) == 0, "found %lld\n",
+		 (long long)(int)sizeof(((struct batch_buf *)0)->bb_msgs));
+
 	/* Checks for struct lfsck_request */
 	LASSERTF((int)sizeof(struct lfsck_request) == 96, "found %lld\n",
 		 (long long)(int)sizeof(struct lfsck_request));